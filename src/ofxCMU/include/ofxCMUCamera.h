@@ -30,9 +30,11 @@ public:
 	CAMERA_BASE_FEATURE* getSupportedFeatures(int* featuresCount);
 	void callSettingsDialog();
 protected:
-	void getNewFrame(unsigned char* newFrame);
+	bool getNewFrame(unsigned char* newFrame);
 	void cameraInitializationLogic();
 	void cameraDeinitializationLogic();
+	void cameraPauseLogic();
+	void cameraResumeLogic();
 	void setCameraType();
 private:
 	void decodePixelMode(int pixelCode,int* format0Code,int* format1Code);
@@ -27,10 +27,10 @@ void ofxCMUCamera::callSettingsDialog()
 	CameraControlDialog(NULL,theCamera,TRUE);
 }
 
-void ofxCMUCamera::getNewFrame(unsigned char* newFrame)
+bool ofxCMUCamera::getNewFrame(unsigned char* newFrame)
 {
 	if (theCamera == NULL)
-		return;
+		return false;
 	HANDLE hFrameEvent;
 	DWORD dwRet;
 	bool localFrameNew = false;
@@ -38,7 +38,7 @@ void ofxCMUCamera::getNewFrame(unsigned char* newFrame)
 	if(hFrameEvent == NULL)
 	{
 		if(theCamera->AcquireImageEx(FALSE,NULL) != CAM_ERROR_FRAME_TIMEOUT)
-			return;
+			return false;
 		hFrameEvent = theCamera->GetFrameEvent();
 	}
 	dwRet = MsgWaitForMultipleObjects(1,&hFrameEvent,FALSE,1000,QS_ALLEVENTS);
@@ -62,6 +62,7 @@ void ofxCMUCamera::getNewFrame(unsigned char* newFrame)
 		theCamera->GetVideoFrameDimensions((unsigned long*)(&width),(unsigned long*)(&height));
 		theCamera->getDIB(newFrame,width*height*depth*sizeof(unsigned char));
 	}
+	return localFrameNew;
 }
 void ofxCMUCamera::setCameraType()
 {
@@ -119,6 +120,19 @@ void ofxCMUCamera::cameraDeinitializationLogic()
 	theCamera = NULL;	
 }
 
+void ofxCMUCamera::cameraPauseLogic()
+{
+	//idle camera doesn't stream over 1394 bus
+	if (theCamera != NULL)
+		theCamera->StopImageAcquisition();
+}
+
+void ofxCMUCamera::cameraResumeLogic()
+{
+	if (theCamera != NULL)
+		theCamera->StartImageAcquisitionEx(6,0,ACQ_START_VIDEO_STREAM);
+}
+
 CAMERA_BASE_FEATURE* ofxCMUCamera::getSupportedFeatures(int* featuresCount)
 {
 	*featuresCount = 9;
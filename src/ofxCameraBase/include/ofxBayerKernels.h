@@ -0,0 +1,24 @@
+/*
+*  ofxBayerKernels.h
+*
+*  Created on 17/10/26.
+*  Copyright 2026 NUI Group. All rights reserved.
+*
+*/
+#ifndef OFX_BAYER_KERNELS_H
+#define OFX_BAYER_KERNELS_H
+
+//Bayer patterns in the same order as SETTINGS:FRAME:RAW values of camera settings
+#define BAYER_RGGB 1
+#define BAYER_GRBG 2
+#define BAYER_GBRG 3
+#define BAYER_BGGR 4
+
+//size of rows cache which is needed by bayerToLuma for frame of such width
+int getBayerRowsBufferSize(int width);
+//Extracts red (IR) channel from raw Bayer frame with bilinear interpolation and integer (truncating) averaging.
+//rawFrame has pixelStride bytes per pixel and Bayer sample is the first of them. Borders are mirrored,
+//so no sample outside of the frame is read. rowsBuffer must have getBayerRowsBufferSize(width) bytes.
+void bayerToLuma(const unsigned char* rawFrame,unsigned char* lumaFrame,int width,int height,int pixelStride,int bayerPattern,unsigned char* rowsBuffer);
+
+#endif // OFX_BAYER_KERNELS_H
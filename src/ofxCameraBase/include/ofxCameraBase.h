@@ -10,13 +10,17 @@
 #define OFX_CAMERABASE_H
 
 #define _MAX_CAMERAS_ 16
-#define _MAX_FRAME_LIFETIME_ 3
+#define _FRAME_SLOTS_COUNT_ 3
+#define _FRAME_SLOT_MASK_ 0x3
+#define _FRESH_FRAME_FLAG_ 0x4
 
-#include <windows.h>
+#include "ofxCameraBasePlatform.h"
 #include "ofxCameraBaseSettings.h"
+#include "ofxFrameNotifier.h"
+#include "ofxBayerKernels.h"
 #include "ofMain.h"
 #include "ofxGUIDHelper.h"
-#include "ofxXMLSettings.h"
+#include "ofxXmlSettings.h"
 
 class ofxCameraBase
 {
@@ -33,15 +37,25 @@ public:
 		isInitialized = false;
 		index = 0;
 		memset((void*)&guid,0,sizeof(GUID));
-		captureThread = NULL;
 		isCaptureThreadRunning = false;
 		isUsedForTracking = false;
-		isNewFrame = true;
-		newFrameCurrentLifetime = 0;
+		frameListener = NULL;
 		cameraPixelMode = 0;
 		cameraBaseSettings = NULL;
+		cameraFrame = NULL;
 		rawCameraFrame = NULL;
+		bayerRowsBuffer = NULL;
+		previewFrame = NULL;
+		isPreviewRequested = 0;
+		memset((void*)frameSlots,0,_FRAME_SLOTS_COUNT_*sizeof(unsigned char*));
+		memset((void*)slotTimestamps,0,_FRAME_SLOTS_COUNT_*sizeof(unsigned long long));
+		captureTimestamp = 0;
+		lastCaptureTimestamp = 0;
+		writeSlot = 0;
+		spareSlot = 1;
+		readSlot = 2;
 		isPaused = false;
+		isCaptureStarted = false;
 		isRaw = 0;
 	}
 	//Virtual destructor for CameraBase class
@@ -60,22 +74,36 @@ public:
 	virtual int getCameraBaseCount()=0;	
 	//public getter of camera frame size and depth
 	void getCameraSize(unsigned int* cameraWidth,unsigned int* cameraHeight,unsigned char* cameraDepth,unsigned char* pixelMode);
-	//public getter of cameraFrame
+	//public getter of cameraFrame for drawing (copies recent complete frame). It doesn't take frames from consumer
+	//of getLatestCameraFrame, capture thread copies its next frame for the following call
 	void getCameraFrame(unsigned char* newFrameData);	
+	//returns newest complete frame without copying and locking. Pointer stays valid till next call of this method,
+	//so it should be used only from one consumer thread at a time (multiplexer hands it over by joining stitching thread)
+	unsigned char* getLatestCameraFrame();
+	//capture time (ofxGetTickMicroseconds clock) of frame returned by last getLatestCameraFrame, 0 before first frame.
+	//Strictly increasing, so it identifies frame: repeated camera timestamps are moved by microsecond
+	unsigned long long getLatestFrameTimestamp() { return slotTimestamps[readSlot]; }
+	//capture time of published frame which was not taken by consumer yet, false when there is no such frame.
+	//Consumer thread only, frame may be replaced by newer one before it's taken
+	bool peekNewFrameTimestamp(unsigned long long* timestamp);
 	//public getter of camera index position
 	int getCameraIndex(){return index;}
 	//public getter of camera global identifier
 	GUID getCameraGUID(){return guid;}
 	//public getter of camera initialized status
 	bool isCameraInitialized() { return isInitialized; }
-	//public getter of camera isNewFrame property
-	bool isCapturedNewFrame() { return isNewFrame;}
+	//check if capture thread published frame which was not taken by consumer yet
+	bool isCapturedNewFrame() { return (ofxAtomicLoad(&spareSlot) & _FRESH_FRAME_FLAG_) != 0;}
+	//wait till capture thread publishes new frame or timeout (in milliseconds) expires
+	bool waitForNewFrame(unsigned int timeout);
+	//additional notifier which is raised on each published frame (used by multiplexer to wait for several cameras)
+	void setFrameListener(ofxFrameNotifier* listener) { frameListener = listener; }
 	//start camera logic
 	void startCamera();
-	//pause camera active capturing when it's not in use
-	void pauseCamera() { isPaused = true; }
-	//fast resume capturing from camera
-	void resumeCamera() { isPaused = false; }
+	//pause camera active capturing when it's not in use. Capture thread is stopped and driver may stop streaming
+	void pauseCamera();
+	//fast resume capturing from camera, capture thread of started camera runs again
+	void resumeCamera();
 	//check is camera capturing is paused
 	bool isCameraPaused() { return isPaused;}
 	//get camera Type
@@ -95,31 +123,39 @@ public:
 	//start settings dialog
 	virtual void callSettingsDialog() { };
 protected:
-	//logic for updating current frame
-	void updateCurrentFrame();
+	//logic for updating current frame, returns false if camera had no new frame
+	bool updateCurrentFrame();
+	//hand over filled write slot to consumer through spare slot
+	void publishCurrentFrame();
 	//capturing thread logic
-	static DWORD WINAPI CaptureThread(LPVOID instance);
+	static void CaptureThread(void* instance);
 	//capturing thread start
 	void StartThreadingCapture();
 	//capturing thread stop
 	void StopThreadingCapture();
-	//specific logic for getting frame from each camera
-	virtual void getNewFrame(unsigned char* newFrame) {}
+	//specific logic for getting frame from each camera. Returns true only when new frame was written to newFrame.
+	//Should block till driver signals frame arrival (with timeout) when driver supports it. Camera which knows
+	//when frame was captured sets captureTimestamp, otherwise frame is stamped with time of its arrival
+	virtual bool getNewFrame(unsigned char* newFrame) { return false; }
 	//specific logic for initialization camera
 	virtual void cameraInitializationLogic() {}
 	//specific logic for deinitialization camera
 	virtual void cameraDeinitializationLogic() {}
+	//specific logic for pausing camera, it's called after capture thread is stopped
+	virtual void cameraPauseLogic() {}
+	//specific logic for resuming camera, it's called before capture thread is started again
+	virtual void cameraResumeLogic() {}
 	//setting camera type
 	virtual void setCameraType() {}
 	void loadDefaultCameraSettings();
 private:
 	void Capture();
+	static bool IsNewFrameReady(void* instance);
 	void receiveSettingsFromCamera();
 	void loadCameraSettings(ofxXmlSettings* xmlSettings);
 protected:
-	HANDLE captureThread;
+	ofxCaptureThread captureThread;
 	bool isCaptureThreadRunning;
-	CRITICAL_SECTION criticalSection;
 	GUID guid;
 	std::string cameraTypeName;
 	CAMERATYPE cameraType;
@@ -127,11 +163,31 @@ protected:
 	int isRaw;
 	int index,left,top;
 	unsigned char depth;
-	bool isInitialized,isNewFrame,isUsedForTracking,isPaused;
-	int newFrameCurrentLifetime;
+	bool isInitialized,isUsedForTracking,isPaused;
+	//startCamera was called, so resumeCamera has capture thread to start
+	bool isCaptureStarted;
 	unsigned char cameraPixelMode;
+	//slot which is filled by capture thread now (always equals frameSlots[writeSlot])
 	unsigned char* cameraFrame;
 	unsigned char* rawCameraFrame;
+	//rows cache for Bayer kernels (allocated only for raw modes)
+	unsigned char* bayerRowsBuffer;
+	//triple buffer: write slot belongs to capture thread, read slot belongs to consumer and spare slot is exchanged between them
+	unsigned char* frameSlots[_FRAME_SLOTS_COUNT_];
+	int writeSlot,readSlot;
+	//index of spare slot, _FRESH_FRAME_FLAG_ bit is set when it holds frame newer than read slot
+	ofxAtomicLong spareSlot;
+	//monotonic capture time of frame in each slot, it's written before slot is published
+	unsigned long long slotTimestamps[_FRAME_SLOTS_COUNT_];
+	unsigned long long captureTimestamp;
+	unsigned long long lastCaptureTimestamp;
+	//copy of frame for getCameraFrame, capture thread refreshes it only when it was asked for
+	unsigned char* previewFrame;
+	ofxCaptureLock previewLock;
+	ofxAtomicLong isPreviewRequested;
+	//raised when frame is published or capturing is stopped
+	ofxFrameNotifier frameNotifier;
+	ofxFrameNotifier* volatile frameListener;
 	ofxCameraBaseSettings* cameraBaseSettings;
 };
 
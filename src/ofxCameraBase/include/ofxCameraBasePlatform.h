@@ -0,0 +1,116 @@
+/*
+*  ofxCameraBasePlatform.h
+*
+*  Created on 17/10/26.
+*  Copyright 2026 NUI Group. All rights reserved.
+*
+*/
+#ifndef OFX_CAMERABASE_PLATFORM_H
+#define OFX_CAMERABASE_PLATFORM_H
+
+//Thin layer over threads, locks, atomics and sleep which are used by capture stack.
+//Win32 API is used on Windows (VS2010 has no std::thread), C++11 standard library everywhere else.
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <stdint.h>
+	#include <string.h>
+	#include <thread>
+	#include <mutex>
+	#include <condition_variable>
+	#include <atomic>
+#endif
+
+#define OFX_INFINITE 0xFFFFFFFF
+
+//instruction sets of SIMD kernels, 32 bit Windows builds need /arch:SSE2 for SSE2 ones
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+	#define OFX_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#define OFX_NEON
+#endif
+
+#ifdef _WIN32
+	typedef volatile LONG ofxAtomicLong;
+#else
+	typedef std::atomic<long> ofxAtomicLong;
+	//same layout as Win32 GUID, so GUID based camera identifiers and settings work on every platform
+	typedef struct _GUID
+	{
+		uint32_t Data1;
+		uint16_t Data2;
+		uint16_t Data3;
+		uint8_t Data4[8];
+	} GUID;
+	inline bool operator==(const GUID& first,const GUID& second) { return memcmp(&first,&second,sizeof(GUID)) == 0; }
+	inline bool operator!=(const GUID& first,const GUID& second) { return !(first == second); }
+#endif
+
+//entry point of thread, instance is pointer passed to start
+typedef void (*ofxThreadRoutine)(void* instance);
+
+class ofxCaptureThread
+{
+public:
+	ofxCaptureThread();
+	~ofxCaptureThread();
+	bool start(ofxThreadRoutine threadRoutine,void* threadInstance);
+	//wait till thread routine returns
+	void join();
+	bool isStarted();
+private:
+	ofxThreadRoutine routine;
+	void* instance;
+#ifdef _WIN32
+	static DWORD WINAPI ThreadProc(LPVOID parameter);
+	HANDLE threadHandle;
+#else
+	std::thread* thread;
+#endif
+};
+
+class ofxCaptureLock
+{
+public:
+	ofxCaptureLock();
+	~ofxCaptureLock();
+	void lock();
+	void unlock();
+private:
+	friend class ofxCaptureCondition;
+#ifdef _WIN32
+	CRITICAL_SECTION criticalSection;
+#else
+	std::mutex mutex;
+#endif
+};
+
+class ofxCaptureCondition
+{
+public:
+	ofxCaptureCondition();
+	//lock must be taken by caller, it's released while sleeping. Timeout is in milliseconds (OFX_INFINITE to wait forever)
+	void wait(ofxCaptureLock* lock,unsigned int timeout);
+	void wakeAll();
+private:
+#ifdef _WIN32
+	CONDITION_VARIABLE conditionVariable;
+#else
+	std::condition_variable_any conditionVariable;
+#endif
+};
+
+//atomic operations are full memory barriers on all platforms
+long ofxAtomicExchange(ofxAtomicLong* target,long value);
+long ofxAtomicIncrement(ofxAtomicLong* target);
+long ofxAtomicDecrement(ofxAtomicLong* target);
+long ofxAtomicLoad(ofxAtomicLong* target);
+void ofxSleepMilliseconds(unsigned int milliseconds);
+//monotonic milliseconds counter for timeouts
+unsigned int ofxGetTickMilliseconds();
+//monotonic microseconds counter for frame timestamps
+unsigned long long ofxGetTickMicroseconds();
+//number of logical processors
+int ofxGetProcessorsCount();
+
+#endif // OFX_CAMERABASE_PLATFORM_H
@@ -12,7 +12,7 @@
 
 #include <vector>
 #include "vector2d.h"
-#include <windows.h>
+#include "ofxCameraBasePlatform.h"
 
 typedef enum 
 {
@@ -20,7 +20,8 @@ typedef enum
 	CMU,
 	FFMV,
 	DIRECTSHOW,
-	KINECT
+	KINECT,
+	RECORDED
 } CAMERATYPE;
 
 typedef enum 
@@ -0,0 +1,32 @@
+/*
+*  ofxFrameNotifier.h
+*  
+*  Created on 17/10/26.
+*  Copyright 2026 NUI Group. All rights reserved.
+*
+*/
+#ifndef OFX_FRAME_NOTIFIER_H
+#define OFX_FRAME_NOTIFIER_H
+
+#include "ofxCameraBasePlatform.h"
+
+//condition checked by waiting thread, instance is pointer passed to waitFor
+typedef bool (*ofxFrameCondition)(void* instance);
+
+//Notification which is raised by capture threads when they publish new frame.
+//Waiting threads sleep on condition variable and wake exactly when notify() is called.
+class ofxFrameNotifier
+{
+public:
+	ofxFrameNotifier();
+	//wake all waiting threads. Lock is taken only when somebody waits, so it's cheap for capture thread
+	void notify();
+	//wait till condition becomes true or timeout (in milliseconds) expires. Returns last condition value
+	bool waitFor(ofxFrameCondition condition,void* instance,unsigned int timeout);
+private:
+	ofxCaptureLock lock;
+	ofxCaptureCondition condition;
+	ofxAtomicLong waitersCount;
+};
+
+#endif // OFX_FRAME_NOTIFIER_H
@@ -0,0 +1,74 @@
+/*
+*  ofxThreadPool.h
+*
+*  Created on 17/10/26.
+*  Copyright 2026 NUI Group. All rights reserved.
+*
+*/
+#ifndef OFX_THREAD_POOL_H
+#define OFX_THREAD_POOL_H
+
+#include "ofxCameraBasePlatform.h"
+
+//parallel loops which can run at the same time (from different threads or nested), others run on calling thread
+#define THREAD_POOL_MAX_JOBS 8
+#define THREAD_POOL_MAX_WORKERS 63
+
+//body of parallel loop, processes tasks [first,last). Participant is index of thread inside one parallelFor call
+typedef void (*ofxParallelRoutine)(void* instance,int first,int last,int participant);
+
+//chunks of job owned by one participant, owner takes them from front and thieves from back
+struct ofxThreadPoolRange
+{
+	ofxCaptureLock lock;
+	int begin;
+	int end;
+};
+
+struct ofxThreadPoolJob
+{
+	ofxParallelRoutine routine;
+	void* instance;
+	int tasksCount;
+	int grainSize;
+	ofxThreadPoolRange* ranges;
+	//workers inside job, job entry is reused only when it drops to zero
+	int helpersCount;
+	bool isActive;
+	//set when some worker found no chunk left, so other workers don't join anymore
+	bool isExhausted;
+};
+
+//Engine-wide pool of worker threads with work stealing. Stitching and frame processing submit to
+//the same workers, so together they never run more threads than configured.
+class ofxThreadPool
+{
+public:
+	ofxThreadPool();
+	~ofxThreadPool();
+	static ofxThreadPool* getShared();
+	//0 - one worker less than processors (calling thread works too). Must not be called while parallelFor runs
+	void setWorkersCount(int count);
+	int getWorkersCount() { return workersCount; }
+	//workers and calling thread
+	int getParticipantsCount() { return workersCount + 1; }
+	//calls routine for chunks of grainSize tasks from [0,tasksCount) on workers and calling thread,
+	//returns when all of them are done
+	void parallelFor(int tasksCount,int grainSize,ofxParallelRoutine routine,void* instance);
+private:
+	static void WorkerThread(void* instance);
+	void startWorkers(int count);
+	void stopWorkers();
+	//runs one chunk of own range or stolen from other participant, false when there is none left
+	bool runChunk(ofxThreadPoolJob* job,int participant);
+	ofxThreadPoolJob jobs[THREAD_POOL_MAX_JOBS];
+	ofxCaptureThread* workers;
+	int workersCount;
+	bool isStopping;
+	ofxAtomicLong startedWorkers;
+	ofxCaptureLock lock;
+	//raised when job is added, when worker leaves job and when pool stops
+	ofxCaptureCondition condition;
+};
+
+#endif // OFX_THREAD_POOL_H
@@ -0,0 +1,212 @@
+#include "ofxBayerKernels.h"
+#include "ofxCameraBasePlatform.h"
+#include <string.h>
+
+#if defined(OFX_SSE2)
+	#include <emmintrin.h>
+#elif defined(OFX_NEON)
+	#include <arm_neon.h>
+#endif
+
+//each cached row has mirrored pixel before and after it, vector loads never go further
+#define BAYER_ROW_FRONT 16
+#define BAYER_ROW_TAIL 16
+//rows -1..2 around pair of output rows are cached
+#define BAYER_CACHED_ROWS 4
+
+static int getBayerRowStride(int width)
+{
+	return (BAYER_ROW_FRONT + width + BAYER_ROW_TAIL + 15) & ~15;
+}
+
+int getBayerRowsBufferSize(int width)
+{
+	return BAYER_CACHED_ROWS * getBayerRowStride(width);
+}
+
+static inline int mirrorIndex(int index,int size)
+{
+	if (size < 2)
+		return 0;
+	if (index < 0)
+		return -index;
+	if (index >= size)
+		return 2 * size - 2 - index;
+	return index;
+}
+
+//copies Bayer samples of raw row to cache and mirrors first and last pixel around it
+static void loadBayerRow(const unsigned char* rawRow,unsigned char* row,int width,int pixelStride)
+{
+	if (pixelStride == 1)
+		memcpy(row,rawRow,width);
+	else
+	{
+		for (int x=0;x<width;x++)
+			row[x] = rawRow[x*pixelStride];
+	}
+	row[-1] = row[mirrorIndex(-1,width)];
+	row[width] = row[mirrorIndex(width,width)];
+}
+
+//row with red samples: red pixels are copied, others are average of left and right neighbours
+static void bayerRedRowScalar(const unsigned char* cur,unsigned char* dst,int from,int width,int redColumn)
+{
+	for (int x=from;x<width;x++)
+	{
+		int interpolated = ((int)cur[x-1] + cur[x+1]) >> 1;
+		dst[x] = ((x & 1) == redColumn) ? cur[x] : (unsigned char)interpolated;
+	}
+}
+
+//row without red samples: red column gets vertical average, other pixels average of four diagonal neighbours
+static void bayerOtherRowScalar(const unsigned char* up,const unsigned char* down,unsigned char* dst,int from,int width,int redColumn)
+{
+	for (int x=from;x<width;x++)
+	{
+		int vertical = ((int)up[x] + down[x]) >> 1;
+		int diagonal = ((int)up[x-1] + up[x+1] + down[x-1] + down[x+1]) >> 2;
+		dst[x] = (unsigned char)(((x & 1) == redColumn) ? vertical : diagonal);
+	}
+}
+
+#if defined(OFX_SSE2)
+
+//truncating average of unsigned bytes (_mm_avg_epu8 rounds up)
+static inline __m128i averageFloor(__m128i a,__m128i b,__m128i one)
+{
+	return _mm_sub_epi8(_mm_avg_epu8(a,b),_mm_and_si128(_mm_xor_si128(a,b),one));
+}
+
+static inline __m128i redColumnMask(int redColumn)
+{
+	return redColumn ? _mm_set1_epi16((short)0xFF00) : _mm_set1_epi16(0x00FF);
+}
+
+static int bayerRedRow(const unsigned char* cur,unsigned char* dst,int width,int redColumn)
+{
+	const __m128i one = _mm_set1_epi8(1);
+	const __m128i mask = redColumnMask(redColumn);
+	int x = 0;
+	for (;x+16<=width;x+=16)
+	{
+		__m128i center = _mm_loadu_si128((const __m128i*)(cur+x));
+		__m128i interpolated = averageFloor(_mm_loadu_si128((const __m128i*)(cur+x-1)),_mm_loadu_si128((const __m128i*)(cur+x+1)),one);
+		_mm_storeu_si128((__m128i*)(dst+x),_mm_or_si128(_mm_and_si128(mask,center),_mm_andnot_si128(mask,interpolated)));
+	}
+	return x;
+}
+
+static int bayerOtherRow(const unsigned char* up,const unsigned char* down,unsigned char* dst,int width,int redColumn)
+{
+	const __m128i one = _mm_set1_epi8(1);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i mask = redColumnMask(redColumn);
+	int x = 0;
+	for (;x+16<=width;x+=16)
+	{
+		__m128i vertical = averageFloor(_mm_loadu_si128((const __m128i*)(up+x)),_mm_loadu_si128((const __m128i*)(down+x)),one);
+		__m128i upLeft = _mm_loadu_si128((const __m128i*)(up+x-1));
+		__m128i upRight = _mm_loadu_si128((const __m128i*)(up+x+1));
+		__m128i downLeft = _mm_loadu_si128((const __m128i*)(down+x-1));
+		__m128i downRight = _mm_loadu_si128((const __m128i*)(down+x+1));
+		__m128i sumLow = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(upLeft,zero),_mm_unpacklo_epi8(upRight,zero)),
+			_mm_add_epi16(_mm_unpacklo_epi8(downLeft,zero),_mm_unpacklo_epi8(downRight,zero)));
+		__m128i sumHigh = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(upLeft,zero),_mm_unpackhi_epi8(upRight,zero)),
+			_mm_add_epi16(_mm_unpackhi_epi8(downLeft,zero),_mm_unpackhi_epi8(downRight,zero)));
+		__m128i diagonal = _mm_packus_epi16(_mm_srli_epi16(sumLow,2),_mm_srli_epi16(sumHigh,2));
+		_mm_storeu_si128((__m128i*)(dst+x),_mm_or_si128(_mm_and_si128(mask,vertical),_mm_andnot_si128(mask,diagonal)));
+	}
+	return x;
+}
+
+#elif defined(OFX_NEON)
+
+static inline uint8x16_t redColumnMask(int redColumn)
+{
+	return vreinterpretq_u8_u16(vdupq_n_u16(redColumn ? 0xFF00 : 0x00FF));
+}
+
+static int bayerRedRow(const unsigned char* cur,unsigned char* dst,int width,int redColumn)
+{
+	const uint8x16_t mask = redColumnMask(redColumn);
+	int x = 0;
+	for (;x+16<=width;x+=16)
+	{
+		uint8x16_t interpolated = vhaddq_u8(vld1q_u8(cur+x-1),vld1q_u8(cur+x+1));
+		vst1q_u8(dst+x,vbslq_u8(mask,vld1q_u8(cur+x),interpolated));
+	}
+	return x;
+}
+
+static int bayerOtherRow(const unsigned char* up,const unsigned char* down,unsigned char* dst,int width,int redColumn)
+{
+	const uint8x16_t mask = redColumnMask(redColumn);
+	int x = 0;
+	for (;x+16<=width;x+=16)
+	{
+		uint8x16_t vertical = vhaddq_u8(vld1q_u8(up+x),vld1q_u8(down+x));
+		uint8x16_t upLeft = vld1q_u8(up+x-1);
+		uint8x16_t upRight = vld1q_u8(up+x+1);
+		uint8x16_t downLeft = vld1q_u8(down+x-1);
+		uint8x16_t downRight = vld1q_u8(down+x+1);
+		uint16x8_t sumLow = vaddq_u16(vaddl_u8(vget_low_u8(upLeft),vget_low_u8(upRight)),vaddl_u8(vget_low_u8(downLeft),vget_low_u8(downRight)));
+		uint16x8_t sumHigh = vaddq_u16(vaddl_u8(vget_high_u8(upLeft),vget_high_u8(upRight)),vaddl_u8(vget_high_u8(downLeft),vget_high_u8(downRight)));
+		uint8x16_t diagonal = vcombine_u8(vshrn_n_u16(sumLow,2),vshrn_n_u16(sumHigh,2));
+		vst1q_u8(dst+x,vbslq_u8(mask,vertical,diagonal));
+	}
+	return x;
+}
+
+#else
+
+//scalar code does every pixel
+static int bayerRedRow(const unsigned char*,unsigned char*,int,int)
+{
+	return 0;
+}
+
+static int bayerOtherRow(const unsigned char*,const unsigned char*,unsigned char*,int,int)
+{
+	return 0;
+}
+
+#endif
+
+static void bayerLumaRow(unsigned char** rows,unsigned char* dst,int y,int width,int redColumn,int redRow)
+{
+	//rows[] is indexed by (row+1)&3, so row -1 and row height are mirrored copies
+	const unsigned char* up = rows[y & 3];
+	const unsigned char* cur = rows[(y + 1) & 3];
+	const unsigned char* down = rows[(y + 2) & 3];
+	if ((y & 1) == redRow)
+		bayerRedRowScalar(cur,dst,bayerRedRow(cur,dst,width,redColumn),width,redColumn);
+	else
+		bayerOtherRowScalar(up,down,dst,bayerOtherRow(up,down,dst,width,redColumn),width,redColumn);
+}
+
+void bayerToLuma(const unsigned char* rawFrame,unsigned char* lumaFrame,int width,int height,int pixelStride,int bayerPattern,unsigned char* rowsBuffer)
+{
+	if ((width <= 0) || (height <= 0) || (bayerPattern < BAYER_RGGB) || (bayerPattern > BAYER_BGGR))
+		return;
+	//position of red sample inside 2x2 cell
+	int redColumn = (bayerPattern == BAYER_GRBG) || (bayerPattern == BAYER_BGGR) ? 1 : 0;
+	int redRow = (bayerPattern == BAYER_GBRG) || (bayerPattern == BAYER_BGGR) ? 1 : 0;
+	int rowStride = getBayerRowStride(width);
+	int rawRowStride = width * pixelStride;
+	unsigned char* rows[BAYER_CACHED_ROWS];
+	for (int i=0;i<BAYER_CACHED_ROWS;i++)
+		rows[i] = rowsBuffer + i * rowStride + BAYER_ROW_FRONT;
+	//rows -1 and 0 for the first pair
+	loadBayerRow(rawFrame + mirrorIndex(-1,height) * rawRowStride,rows[0],width,pixelStride);
+	loadBayerRow(rawFrame,rows[1],width,pixelStride);
+	for (int y=0;y<height;y+=2)
+	{
+		//each pair of output rows needs two more source rows
+		loadBayerRow(rawFrame + mirrorIndex(y + 1,height) * rawRowStride,rows[(y + 2) & 3],width,pixelStride);
+		loadBayerRow(rawFrame + mirrorIndex(y + 2,height) * rawRowStride,rows[(y + 3) & 3],width,pixelStride);
+		bayerLumaRow(rows,lumaFrame + y * width,y,width,redColumn,redRow);
+		if (y + 1 < height)
+			bayerLumaRow(rows,lumaFrame + (y + 1) * width,y + 1,width,redColumn,redRow);
+	}
+}
@@ -13,80 +13,162 @@ void ofxCameraBase::getCameraSize(unsigned int* cameraWidth,unsigned int* camera
 	*pixelMode = cameraPixelMode;
 }
 
-DWORD WINAPI ofxCameraBase::CaptureThread(LPVOID instance)
+void ofxCameraBase::CaptureThread(void* instance)
 {
 	ofxCameraBase *pThis = (ofxCameraBase*)instance;
 	pThis->Capture();
-	return 0;
 }
 
 void ofxCameraBase::StartThreadingCapture()
 {
-	InitializeCriticalSection(&criticalSection); 
 	isCaptureThreadRunning = true;
-	captureThread = CreateThread(NULL, 0, &ofxCameraBase::CaptureThread, this, 0, 0);
+	captureThread.start(&ofxCameraBase::CaptureThread,this);
 }
 
 void ofxCameraBase::StopThreadingCapture()
 {
 	isCaptureThreadRunning = false;
-	Sleep(300);
+	frameNotifier.notify();
+	captureThread.join();
 }
 
+bool ofxCameraBase::IsNewFrameReady(void* instance)
+{
+	return ((ofxCameraBase*)instance)->isCapturedNewFrame();
+}
 
 void ofxCameraBase::Capture()
 {
 	while (isCaptureThreadRunning)
 	{
-		if (isPaused)
-		{
-			isNewFrame = true;
-			Sleep(30);
-		}
+		if (!isInitialized)
+			return;
+		//blocking drivers wait for frame inside getNewFrame, so we sleep only when there was no frame
+		if (updateCurrentFrame())
+			publishCurrentFrame();
 		else
-		{
-			if ((!isNewFrame) || (newFrameCurrentLifetime>=_MAX_FRAME_LIFETIME_))
-			{
-				isNewFrame = true;
-				newFrameCurrentLifetime = 0;
-				if (!isInitialized)
-					return;
-				EnterCriticalSection(&criticalSection); 
-				updateCurrentFrame();
-				LeaveCriticalSection(&criticalSection);
-			}
-			else
-				newFrameCurrentLifetime++;
-			Sleep(1);
-		}
+			ofxSleepMilliseconds(1);
 	}
 }
 
-void ofxCameraBase::getCameraFrame(unsigned char* newFrameData)	
-{ 
-	if (isNewFrame)
+void ofxCameraBase::publishCurrentFrame()
+{
+	//write slot still belongs to capture thread, so preview is copied before it's handed over
+	if ((ofxAtomicLoad(&isPreviewRequested) != 0) && (ofxAtomicExchange(&isPreviewRequested,0) != 0))
+	{
+		previewLock.lock();
+		memcpy(previewFrame,cameraFrame,width*height*sizeof(unsigned char));
+		previewLock.unlock();
+	}
+	//atomic exchange is full memory barrier, so frame data is visible to consumer before slot index
+	long previousSlot = ofxAtomicExchange(&spareSlot,writeSlot | _FRESH_FRAME_FLAG_);
+	writeSlot = previousSlot & _FRAME_SLOT_MASK_;
+	cameraFrame = frameSlots[writeSlot];
+	frameNotifier.notify();
+	ofxFrameNotifier* listener = frameListener;
+	if (listener != NULL)
+		listener->notify();
+}
+
+bool ofxCameraBase::waitForNewFrame(unsigned int timeout)
+{
+	return frameNotifier.waitFor(&ofxCameraBase::IsNewFrameReady,this,timeout);
+}
+
+void ofxCameraBase::pauseCamera()
+{
+	if (isPaused)
+		return;
+	isPaused = true;
+	//paused camera has no capture thread, so it costs nothing while it's not in use
+	if (captureThread.isStarted())
+	{
+		StopThreadingCapture();
+		cameraPauseLogic();
+	}
+}
+
+void ofxCameraBase::resumeCamera()
+{
+	if (!isPaused)
+		return;
+	isPaused = false;
+	if (isInitialized && isCaptureStarted && (!captureThread.isStarted()))
 	{
-		EnterCriticalSection(&criticalSection); 
-		isNewFrame = false;
-		memcpy((void*)newFrameData,cameraFrame,width*height*sizeof(unsigned char));
-		LeaveCriticalSection(&criticalSection);
+		cameraResumeLogic();
+		StartThreadingCapture();
 	}
 }
 
+unsigned char* ofxCameraBase::getLatestCameraFrame()
+{
+	if (!isInitialized)
+		return NULL;
+	//only consumer clears fresh flag, so it can't disappear between check and exchange
+	if (ofxAtomicLoad(&spareSlot) & _FRESH_FRAME_FLAG_)
+	{
+		long previousSlot = ofxAtomicExchange(&spareSlot,readSlot);
+		readSlot = previousSlot & _FRAME_SLOT_MASK_;
+	}
+	return frameSlots[readSlot];
+}
+
+bool ofxCameraBase::peekNewFrameTimestamp(unsigned long long* timestamp)
+{
+	long slot = ofxAtomicLoad(&spareSlot);
+	if ((!isInitialized) || ((slot & _FRESH_FRAME_FLAG_) == 0))
+		return false;
+	*timestamp = slotTimestamps[slot & _FRAME_SLOT_MASK_];
+	//spare slot was swapped while reading, its timestamp may be overwritten by capture thread
+	if (ofxAtomicLoad(&spareSlot) != slot)
+		return peekNewFrameTimestamp(timestamp);
+	return true;
+}
+
+void ofxCameraBase::getCameraFrame(unsigned char* newFrameData)	
+{ 
+	if (!isInitialized)
+		return;
+	//read slot belongs to consumer, preview is copy of its own
+	previewLock.lock();
+	if (previewFrame != NULL)
+		memcpy((void*)newFrameData,previewFrame,width*height*sizeof(unsigned char));
+	previewLock.unlock();
+	ofxAtomicExchange(&isPreviewRequested,1);
+}
+
 void ofxCameraBase::initializeWithGUID(GUID cameraGuid)
 {
 	guid = cameraGuid;
 	setCameraType();
 	loadCameraSettings();
 	cameraInitializationLogic();
-	cameraFrame = (unsigned char*)malloc(width*height*sizeof(unsigned char));
+	for (int i=0;i<_FRAME_SLOTS_COUNT_;i++)
+	{
+		frameSlots[i] = (unsigned char*)malloc(width*height*sizeof(unsigned char));
+		memset(frameSlots[i],0,width*height*sizeof(unsigned char));
+	}
+	memset((void*)slotTimestamps,0,_FRAME_SLOTS_COUNT_*sizeof(unsigned long long));
+	lastCaptureTimestamp = 0;
+	writeSlot = 0;
+	spareSlot = 1;
+	readSlot = 2;
+	cameraFrame = frameSlots[writeSlot];
+	previewFrame = (unsigned char*)malloc(width*height*sizeof(unsigned char));
+	memset(previewFrame,0,width*height*sizeof(unsigned char));
+	isPreviewRequested = 1;
 	rawCameraFrame = (unsigned char*)malloc(depth*width*height*sizeof(unsigned char));
+	if (isRaw)
+		bayerRowsBuffer = (unsigned char*)malloc(getBayerRowsBufferSize(width)*sizeof(unsigned char));
 	isInitialized = true;
 }
 
 void ofxCameraBase::startCamera()
 {
-	StartThreadingCapture();
+	isCaptureStarted = true;
+	//camera paused before start gets its capture thread on resume
+	if (!isPaused)
+		StartThreadingCapture();
 }
 
 void ofxCameraBase::deinitializeCamera()
@@ -95,167 +177,50 @@ void ofxCameraBase::deinitializeCamera()
 	{
 		saveCameraSettings();
 		StopThreadingCapture();
-		EnterCriticalSection(&criticalSection);
 		cameraDeinitializationLogic();
 		isInitialized = false;
-		LeaveCriticalSection(&criticalSection);
-		Sleep(100);
-		DeleteCriticalSection(&criticalSection);
-		free(cameraFrame);
+		isCaptureStarted = false;
+		for (int i=0;i<_FRAME_SLOTS_COUNT_;i++)
+		{
+			free(frameSlots[i]);
+			frameSlots[i] = NULL;
+		}
+		cameraFrame = NULL;
+		previewLock.lock();
+		free(previewFrame);
+		previewFrame = NULL;
+		previewLock.unlock();
 		free(rawCameraFrame);
-		isInitialized = false;
+		rawCameraFrame = NULL;
+		if (bayerRowsBuffer != NULL)
+		{
+			free(bayerRowsBuffer);
+			bayerRowsBuffer = NULL;
+		}
 	}
 }
 
-void ofxCameraBase::updateCurrentFrame()
+bool ofxCameraBase::updateCurrentFrame()
 {
-	getNewFrame(depth>1 ? rawCameraFrame : cameraFrame);
+	captureTimestamp = 0;
+	if (!getNewFrame(depth>1 ? rawCameraFrame : cameraFrame))
+		return false;
+	unsigned long long timestamp = captureTimestamp != 0 ? captureTimestamp : ofxGetTickMicroseconds();
+	//timestamp is identity of frame for multiplexer, so it always grows, even when camera repeats or turns it back
+	lastCaptureTimestamp = timestamp > lastCaptureTimestamp ? timestamp : lastCaptureTimestamp + 1;
+	slotTimestamps[writeSlot] = lastCaptureTimestamp;
 	if (depth>1)
 	{
 		int size = width*height;
 		if (isRaw)
-		{
-			//RGGB
-			int x,y,index;
-			float r = 0.0f;
-			switch (isRaw)
-			{
-			case 1:		//RGGB
-				for (y=0;y<height;y++)
-				{
-					for (x=0;x<width;x++)
-					{
-						index = x + y * width;
-						if (x % 2)
-						{
-							if (y % 2)
-								r = ((float)rawCameraFrame[(x-1+(y-1)*width)*depth] + rawCameraFrame[(x-1+(y+1)*width)*depth] + rawCameraFrame[(x+1+(y-1)*width)*depth] + rawCameraFrame[(x+1+(y+1)*width)*depth]) * 0.25f;
-							else
-								r = ((float)rawCameraFrame[(x-1+y*width)*depth] + rawCameraFrame[(x+1+y*width)*depth]) * 0.5f;
-						}
-						else
-						{
-							if (y % 2)
-								r = ((float)rawCameraFrame[(x+(y-1)*width)*depth] + rawCameraFrame[(x+(y+1)*width)*depth]) * 0.5f;
-							else
-								r = rawCameraFrame[(x+y*width)*depth];
-						}
-						cameraFrame[index] = (unsigned char)r;
-					}
-				}
-				break;
-			case 2:		//GRBG
-				for (y=0;y<height;y++)
-				{
-					for (x=0;x<width;x++)
-					{
-						index = x + y * width;
-						if (x % 2)
-						{
-							if (y % 2)
-								r = ((float)rawCameraFrame[(x+(y-1)*width)*depth] + rawCameraFrame[(x+(y+1)*width)*depth]) * 0.5f;
-							else
-								r = rawCameraFrame[(x+y*width)*depth];
-						}
-						else
-						{
-							if (y % 2)
-							{
-								if (x != 0)
-									r = ((float)rawCameraFrame[(x-1+(y-1)*width)*depth] + rawCameraFrame[(x-1+(y+1)*width)*depth] + rawCameraFrame[(x+1+(y-1)*width)*depth] + rawCameraFrame[(x+1+(y+1)*width)*depth]) * 0.25f;
-								else
-									r = ((float)rawCameraFrame[(1+(y-1)*width)*depth] + rawCameraFrame[(1+(y+1)*width)*depth]) * 0.5f;
-							}
-							else
-							{
-								if (x != 0)
-									r = ((float)rawCameraFrame[(x-1+y*width)*depth] + rawCameraFrame[(x+1+y*width)*depth]) * 0.5f;
-								else
-									r = rawCameraFrame[(1+y*width)*depth];
-							}
-						}
-					}
-					cameraFrame[index] = (unsigned char)r;
-				}
-				break;
-			case 3: //GBRG
-				for (y=0;y<height;y++)
-				{
-					for (x=0;x<width;x++)
-					{
-						index = x + y * width;
-						if (x % 2)
-						{
-							if (y % 2)
-								r = ((float)rawCameraFrame[(x-1+y*width)*depth] + rawCameraFrame[(x+1+y*width)*depth]) * 0.5f;
-							else
-								if (y!=0)
-									r = ((float)rawCameraFrame[(x-1+(y-1)*width)*depth] + rawCameraFrame[(x-1+(y+1)*width)*depth] + rawCameraFrame[(x+1+(y-1)*width)*depth] + rawCameraFrame[(x+1+(y+1)*width)*depth]) * 0.25f;
-								else
-									r = ((float)rawCameraFrame[(x+1+width)*depth] + rawCameraFrame[(x-1+width)*depth]) * 0.5f;
-						}
-						else
-						{
-							if (y % 2)
-								r = rawCameraFrame[(x+y*width)*depth];
-							else
-								if (y!=0)
-									r = ((float)rawCameraFrame[(x+(y-1)*width)*depth] + rawCameraFrame[(x+(y+1)*width)*depth]) * 0.5f;
-								else
-									r = rawCameraFrame[(x+width)*depth];
-								
-						}
-						cameraFrame[index] = (unsigned char)r;
-					}
-				}
-				break;
-			case 4:		//BGGR
-				for (y=0;y<height;y++)
-				{
-					for (x=0;x<width;x++)
-					{
-						index = x + y * width;
-						if (x % 2)
-						{
-							if (y % 2)
-								r = rawCameraFrame[(x+y*width)*depth];
-							else
-								if (y!=0)
-									r = ((float)rawCameraFrame[(x+(y-1)*width)*depth] + rawCameraFrame[(x+(y+1)*width)*depth]) * 0.5f;
-								else
-									r = rawCameraFrame[(x+width)*depth];
-						}
-						else
-						{
-							if (y % 2)
-								if (x != 0)
-									r = ((float)rawCameraFrame[(x-1+y*width)*depth] + rawCameraFrame[(x+1+y*width)*depth]) * 0.5f;
-								else
-									r = rawCameraFrame[(1+y*width)*depth];
-							else
-								if (x!=0)
-									if (y!=0)
-										r = ((float)rawCameraFrame[(x-1+(y-1)*width)*depth] + rawCameraFrame[(x-1+(y+1)*width)*depth] + rawCameraFrame[(x+1+(y-1)*width)*depth] + rawCameraFrame[(x+1+(y+1)*width)*depth]) * 0.25f;
-									else
-										r = ((float)rawCameraFrame[(x-1+width)*depth] + rawCameraFrame[(x+1+width)*depth]) * 0.5f;
-								else
-									if (y!=0)
-										r = ((float)rawCameraFrame[(1+width*(y-1))*depth] + rawCameraFrame[(1+width*(y+1))*depth]) * 0.5f;
-									else
-										r = rawCameraFrame[(1+width)*depth];
-						}
-						cameraFrame[index] = (unsigned char)r;
-					}
-				}
-				break;
-			}	
-		}
+			bayerToLuma(rawCameraFrame,cameraFrame,width,height,depth,isRaw,bayerRowsBuffer);
 		else
 		{
 			for (int i=0;i<size;i++)
 				cameraFrame[i] = (unsigned char)(0.3f*(float)rawCameraFrame[i*depth+2] + 0.59f*(float)rawCameraFrame[i*depth+1] +0.11f*(float)rawCameraFrame[i*depth]) ;
 		}
 	}
+	return true;
 }
 
 void ofxCameraBase::loadCameraSettings(ofxXmlSettings* xmlSettings)
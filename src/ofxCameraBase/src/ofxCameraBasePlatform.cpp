@@ -0,0 +1,246 @@
+#include "ofxCameraBasePlatform.h"
+
+#ifndef _WIN32
+	#include <chrono>
+#endif
+
+ofxCaptureThread::ofxCaptureThread()
+{
+	routine = NULL;
+	instance = NULL;
+#ifdef _WIN32
+	threadHandle = NULL;
+#else
+	thread = NULL;
+#endif
+}
+
+ofxCaptureThread::~ofxCaptureThread()
+{
+	join();
+}
+
+#ifdef _WIN32
+
+DWORD WINAPI ofxCaptureThread::ThreadProc(LPVOID parameter)
+{
+	ofxCaptureThread *pThis = (ofxCaptureThread*)parameter;
+	pThis->routine(pThis->instance);
+	return 0;
+}
+
+bool ofxCaptureThread::start(ofxThreadRoutine threadRoutine,void* threadInstance)
+{
+	if (threadHandle != NULL)
+		return false;
+	routine = threadRoutine;
+	instance = threadInstance;
+	threadHandle = CreateThread(NULL, 0, &ofxCaptureThread::ThreadProc, this, 0, 0);
+	return threadHandle != NULL;
+}
+
+void ofxCaptureThread::join()
+{
+	if (threadHandle != NULL)
+	{
+		WaitForSingleObject(threadHandle,INFINITE);
+		CloseHandle(threadHandle);
+		threadHandle = NULL;
+	}
+}
+
+bool ofxCaptureThread::isStarted()
+{
+	return threadHandle != NULL;
+}
+
+ofxCaptureLock::ofxCaptureLock()
+{
+	InitializeCriticalSection(&criticalSection);
+}
+
+ofxCaptureLock::~ofxCaptureLock()
+{
+	DeleteCriticalSection(&criticalSection);
+}
+
+void ofxCaptureLock::lock()
+{
+	EnterCriticalSection(&criticalSection);
+}
+
+void ofxCaptureLock::unlock()
+{
+	LeaveCriticalSection(&criticalSection);
+}
+
+ofxCaptureCondition::ofxCaptureCondition()
+{
+	InitializeConditionVariable(&conditionVariable);
+}
+
+void ofxCaptureCondition::wait(ofxCaptureLock* lock,unsigned int timeout)
+{
+	SleepConditionVariableCS(&conditionVariable,&lock->criticalSection,timeout == OFX_INFINITE ? INFINITE : timeout);
+}
+
+void ofxCaptureCondition::wakeAll()
+{
+	WakeAllConditionVariable(&conditionVariable);
+}
+
+long ofxAtomicExchange(ofxAtomicLong* target,long value)
+{
+	return InterlockedExchange(target,value);
+}
+
+long ofxAtomicIncrement(ofxAtomicLong* target)
+{
+	return InterlockedIncrement(target);
+}
+
+long ofxAtomicDecrement(ofxAtomicLong* target)
+{
+	return InterlockedDecrement(target);
+}
+
+long ofxAtomicLoad(ofxAtomicLong* target)
+{
+	return InterlockedCompareExchange(target,0,0);
+}
+
+void ofxSleepMilliseconds(unsigned int milliseconds)
+{
+	Sleep(milliseconds);
+}
+
+unsigned int ofxGetTickMilliseconds()
+{
+	return GetTickCount();
+}
+
+unsigned long long ofxGetTickMicroseconds()
+{
+	static LARGE_INTEGER frequency = {0};
+	if (frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&frequency);
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	//split to avoid overflow of counter*1000000
+	return (unsigned long long)(counter.QuadPart / frequency.QuadPart) * 1000000 + (unsigned long long)(counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+}
+
+int ofxGetProcessorsCount()
+{
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+	return systemInfo.dwNumberOfProcessors > 0 ? (int)systemInfo.dwNumberOfProcessors : 1;
+}
+
+#else
+
+bool ofxCaptureThread::start(ofxThreadRoutine threadRoutine,void* threadInstance)
+{
+	if (thread != NULL)
+		return false;
+	routine = threadRoutine;
+	instance = threadInstance;
+	thread = new std::thread(threadRoutine,threadInstance);
+	return true;
+}
+
+void ofxCaptureThread::join()
+{
+	if (thread != NULL)
+	{
+		if (thread->joinable())
+			thread->join();
+		delete thread;
+		thread = NULL;
+	}
+}
+
+bool ofxCaptureThread::isStarted()
+{
+	return thread != NULL;
+}
+
+ofxCaptureLock::ofxCaptureLock()
+{
+}
+
+ofxCaptureLock::~ofxCaptureLock()
+{
+}
+
+void ofxCaptureLock::lock()
+{
+	mutex.lock();
+}
+
+void ofxCaptureLock::unlock()
+{
+	mutex.unlock();
+}
+
+ofxCaptureCondition::ofxCaptureCondition()
+{
+}
+
+void ofxCaptureCondition::wait(ofxCaptureLock* lock,unsigned int timeout)
+{
+	if (timeout == OFX_INFINITE)
+		conditionVariable.wait(lock->mutex);
+	else
+		conditionVariable.wait_for(lock->mutex,std::chrono::milliseconds(timeout));
+}
+
+void ofxCaptureCondition::wakeAll()
+{
+	conditionVariable.notify_all();
+}
+
+long ofxAtomicExchange(ofxAtomicLong* target,long value)
+{
+	return target->exchange(value);
+}
+
+long ofxAtomicIncrement(ofxAtomicLong* target)
+{
+	return ++(*target);
+}
+
+long ofxAtomicDecrement(ofxAtomicLong* target)
+{
+	return --(*target);
+}
+
+long ofxAtomicLoad(ofxAtomicLong* target)
+{
+	//fence orders plain stores made before (pause/stop flags) with this load, like interlocked load on Win32
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	return target->load();
+}
+
+void ofxSleepMilliseconds(unsigned int milliseconds)
+{
+	std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+}
+
+unsigned int ofxGetTickMilliseconds()
+{
+	return (unsigned int)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+unsigned long long ofxGetTickMicroseconds()
+{
+	return (unsigned long long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int ofxGetProcessorsCount()
+{
+	unsigned int count = std::thread::hardware_concurrency();
+	return count > 0 ? (int)count : 1;
+}
+
+#endif
@@ -0,0 +1,39 @@
+#include "ofxFrameNotifier.h"
+
+ofxFrameNotifier::ofxFrameNotifier()
+{
+	waitersCount = 0;
+}
+
+void ofxFrameNotifier::notify()
+{
+	//atomic load is full barrier, so state change made by caller is visible before this check.
+	//Waiter increments waitersCount before checking its condition, so one of them always sees the other
+	if (ofxAtomicLoad(&waitersCount) > 0)
+	{
+		lock.lock();
+		condition.wakeAll();
+		lock.unlock();
+	}
+}
+
+bool ofxFrameNotifier::waitFor(ofxFrameCondition isSatisfiedCondition,void* instance,unsigned int timeout)
+{
+	ofxAtomicIncrement(&waitersCount);
+	bool isSatisfied = isSatisfiedCondition(instance);
+	if ((!isSatisfied) && (timeout > 0))
+	{
+		unsigned int startTime = ofxGetTickMilliseconds();
+		lock.lock();
+		while (!(isSatisfied = isSatisfiedCondition(instance)))
+		{
+			unsigned int elapsedTime = ofxGetTickMilliseconds() - startTime;
+			if ((timeout != OFX_INFINITE) && (elapsedTime >= timeout))
+				break;
+			condition.wait(&lock,timeout == OFX_INFINITE ? OFX_INFINITE : timeout - elapsedTime);
+		}
+		lock.unlock();
+	}
+	ofxAtomicDecrement(&waitersCount);
+	return isSatisfied;
+}
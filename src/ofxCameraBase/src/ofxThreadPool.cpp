@@ -0,0 +1,200 @@
+#include "ofxThreadPool.h"
+
+ofxThreadPool::ofxThreadPool()
+{
+	workers = NULL;
+	workersCount = 0;
+	isStopping = false;
+	ofxAtomicExchange(&startedWorkers,0);
+	for (int i=0;i<THREAD_POOL_MAX_JOBS;i++)
+	{
+		jobs[i].ranges = NULL;
+		jobs[i].helpersCount = 0;
+		jobs[i].isActive = false;
+		jobs[i].isExhausted = true;
+	}
+}
+
+ofxThreadPool::~ofxThreadPool()
+{
+	stopWorkers();
+}
+
+ofxThreadPool* ofxThreadPool::getShared()
+{
+	//never deleted: workers are ended by process exit, joining them from static destructors may hang
+	static ofxThreadPool* sharedPool = NULL;
+	if (sharedPool == NULL)
+	{
+		sharedPool = new ofxThreadPool();
+		sharedPool->setWorkersCount(0);
+	}
+	return sharedPool;
+}
+
+void ofxThreadPool::setWorkersCount(int count)
+{
+	if (count <= 0)
+		count = ofxGetProcessorsCount() - 1;
+	if (count > THREAD_POOL_MAX_WORKERS)
+		count = THREAD_POOL_MAX_WORKERS;
+	stopWorkers();
+	startWorkers(count);
+}
+
+void ofxThreadPool::startWorkers(int count)
+{
+	workersCount = count;
+	for (int i=0;i<THREAD_POOL_MAX_JOBS;i++)
+		jobs[i].ranges = new ofxThreadPoolRange[workersCount + 1];
+	isStopping = false;
+	ofxAtomicExchange(&startedWorkers,0);
+	if (workersCount > 0)
+	{
+		workers = new ofxCaptureThread[workersCount];
+		for (int i=0;i<workersCount;i++)
+			workers[i].start(&ofxThreadPool::WorkerThread,this);
+	}
+}
+
+void ofxThreadPool::stopWorkers()
+{
+	lock.lock();
+	isStopping = true;
+	condition.wakeAll();
+	lock.unlock();
+	if (workers != NULL)
+	{
+		for (int i=0;i<workersCount;i++)
+			workers[i].join();
+		delete[] workers;
+		workers = NULL;
+	}
+	for (int i=0;i<THREAD_POOL_MAX_JOBS;i++)
+	{
+		if (jobs[i].ranges != NULL)
+			delete[] jobs[i].ranges;
+		jobs[i].ranges = NULL;
+	}
+	workersCount = 0;
+}
+
+bool ofxThreadPool::runChunk(ofxThreadPoolJob* job,int participant)
+{
+	int participantsCount = workersCount + 1;
+	ofxThreadPoolRange* own = &job->ranges[participant];
+	int chunk = -1;
+	own->lock.lock();
+	if (own->begin < own->end)
+		chunk = own->begin++;
+	own->lock.unlock();
+	//steal back half of the first non-empty range of other participants
+	for (int i=1;(chunk < 0) && (i<participantsCount);i++)
+	{
+		ofxThreadPoolRange* victim = &job->ranges[(participant + i) % participantsCount];
+		int stolenBegin = 0,stolenEnd = 0;
+		victim->lock.lock();
+		if (victim->begin < victim->end)
+		{
+			stolenEnd = victim->end;
+			victim->end -= (victim->end - victim->begin + 1) / 2;
+			stolenBegin = victim->end;
+		}
+		victim->lock.unlock();
+		if (stolenBegin < stolenEnd)
+		{
+			own->lock.lock();
+			own->begin = stolenBegin + 1;
+			own->end = stolenEnd;
+			own->lock.unlock();
+			chunk = stolenBegin;
+		}
+	}
+	if (chunk < 0)
+		return false;
+	int first = chunk * job->grainSize;
+	int last = first + job->grainSize;
+	job->routine(job->instance,first,last < job->tasksCount ? last : job->tasksCount,participant);
+	return true;
+}
+
+void ofxThreadPool::parallelFor(int tasksCount,int grainSize,ofxParallelRoutine routine,void* instance)
+{
+	if (tasksCount <= 0)
+		return;
+	if (grainSize < 1)
+		grainSize = 1;
+	int chunksCount = (tasksCount + grainSize - 1) / grainSize;
+	ofxThreadPoolJob* job = NULL;
+	if ((workersCount > 0) && (chunksCount > 1))
+	{
+		lock.lock();
+		for (int i=0;(job == NULL) && (i<THREAD_POOL_MAX_JOBS);i++)
+		{
+			if ((!jobs[i].isActive) && (jobs[i].helpersCount == 0))
+				job = &jobs[i];
+		}
+		if (job != NULL)
+		{
+			int participantsCount = workersCount + 1;
+			job->routine = routine;
+			job->instance = instance;
+			job->tasksCount = tasksCount;
+			job->grainSize = grainSize;
+			//chunks are dealt evenly, stealing balances them afterwards
+			for (int i=0;i<participantsCount;i++)
+			{
+				job->ranges[i].begin = (int)((long long)chunksCount * i / participantsCount);
+				job->ranges[i].end = (int)((long long)chunksCount * (i + 1) / participantsCount);
+			}
+			job->isActive = true;
+			job->isExhausted = false;
+			condition.wakeAll();
+		}
+		lock.unlock();
+	}
+	//no workers or every job entry is used (deeply nested loops): whole loop runs on calling thread
+	if (job == NULL)
+	{
+		routine(instance,0,tasksCount,0);
+		return;
+	}
+	while (runChunk(job,workersCount));
+	lock.lock();
+	job->isActive = false;
+	job->isExhausted = true;
+	//chunks taken by workers are done when they leave the job
+	while (job->helpersCount > 0)
+		condition.wait(&lock,OFX_INFINITE);
+	lock.unlock();
+}
+
+void ofxThreadPool::WorkerThread(void* instance)
+{
+	ofxThreadPool *pThis = (ofxThreadPool*)instance;
+	int participant = ofxAtomicIncrement(&pThis->startedWorkers) - 1;
+	pThis->lock.lock();
+	while (!pThis->isStopping)
+	{
+		ofxThreadPoolJob* job = NULL;
+		for (int i=0;(job == NULL) && (i<THREAD_POOL_MAX_JOBS);i++)
+		{
+			if (pThis->jobs[i].isActive && (!pThis->jobs[i].isExhausted))
+				job = &pThis->jobs[i];
+		}
+		if (job == NULL)
+		{
+			pThis->condition.wait(&pThis->lock,OFX_INFINITE);
+			continue;
+		}
+		job->helpersCount++;
+		pThis->lock.unlock();
+		while (pThis->runChunk(job,participant));
+		pThis->lock.lock();
+		job->isExhausted = true;
+		job->helpersCount--;
+		if (job->helpersCount == 0)
+			pThis->condition.wakeAll();
+	}
+	pThis->lock.unlock();
+}
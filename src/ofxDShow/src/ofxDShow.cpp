@@ -201,9 +201,11 @@ int ofxDShow::getCameraBaseCount()
 	
 }
 
-void ofxDShow::getNewFrame(unsigned char* newFrame)
+bool ofxDShow::getNewFrame(unsigned char* newFrame)
 {
-	VI->getPixels(guid.Data1, newFrame, false, false);
+	if (!VI->isFrameNew(guid.Data1))
+		return false;
+	return VI->getPixels(guid.Data1, newFrame, false, false);
 }
 
 void ofxDShow::setCameraType()
@@ -26,7 +26,7 @@ public:
 	CAMERA_BASE_FEATURE* getSupportedFeatures(int* featuresCount);
 	void callSettingsDialog();
 protected:
-	void getNewFrame(unsigned char* newFrame);
+	bool getNewFrame(unsigned char* newFrame);
 	void cameraInitializationLogic();
 	void cameraDeinitializationLogic();
 	void setCameraType();
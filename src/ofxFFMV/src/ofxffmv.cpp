@@ -126,10 +126,12 @@ int ofxffmv::getCameraBaseCount()
    return tcamNum;
 }
 
-void ofxffmv::getNewFrame(unsigned char* newFrame)
+bool ofxffmv::getNewFrame(unsigned char* newFrame)
 {
-	flycaptureGrabImage2(cameraContext,&fcImage);
+	if (flycaptureGrabImage2(cameraContext,&fcImage) != FLYCAPTURE_OK)
+		return false;
 	memcpy((void*)newFrame,fcImage.pData,width * height * depth * sizeof(unsigned char));
+	return true;
 }
 
 void ofxffmv::setCameraType()
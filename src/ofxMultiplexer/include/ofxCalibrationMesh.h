@@ -0,0 +1,81 @@
+/*
+*  ofxCalibrationMesh.h
+*
+*  Created on 17/10/26.
+*  Copyright 2026 NUI Group. All rights reserved.
+*
+*/
+#ifndef OFX_CALIBRATION_MESH_H
+#define OFX_CALIBRATION_MESH_H
+
+#include "vector2d.h"
+
+//side of square tiles of stitched frame, triangles are bucketed and remapped by tiles
+#define CALIBRATION_MESH_TILE_SIZE 32
+
+//Calibration grid of one camera placed over stitched frame, each cell is split to two triangles.
+//Pixel belongs to the first triangle containing it, as the linear search did. Triangles are bucketed
+//by tiles they overlap, so mapping of a tile rasterizes only triangles of its bucket.
+class ofxCalibrationMesh
+{
+public:
+	ofxCalibrationMesh();
+	~ofxCalibrationMesh();
+	//screen points are grid nodes in stitched frame, camera points are the same nodes in camera frame
+	void build(int gridWidth,int gridHeight,const vector2df* screenPoints,const vector2df* cameraPoints,int frameWidth,int frameHeight);
+	void clear();
+	bool isBuilt() { return triangles != NULL; }
+	//changes with every build and camera point change, so users of mesh know their copies are stale
+	unsigned int getRevision() { return revision; }
+	int getGridWidth() { return gridWidth; }
+	int getGridHeight() { return gridHeight; }
+	int getPointsCount() { return (gridWidth + 1) * (gridHeight + 1); }
+	int getTrianglesCount() { return trianglesCount; }
+	//three node indexes of each triangle, triangle is identified by offset of its nodes in this array
+	const int* getTriangles() { return triangles; }
+	const vector2df* getScreenPoints() { return screenPoints; }
+	const vector2df* getCameraPoints() { return cameraPoints; }
+	const vector2df& getCameraPoint(int index) { return cameraPoints[index]; }
+	void setCameraPoint(int index,const vector2df& point);
+	int getTilesWidth() { return tilesWidth; }
+	int getTilesHeight() { return tilesHeight; }
+	//tiles which have pixels of triangles sharing grid node, false when none of them is inside stitched frame
+	bool getPointTiles(int index,int* left,int* top,int* right,int* bottom);
+	//camera position of stitched frame point inside triangle (not rounded, nearest remap truncates it)
+	void transformPoint(int triangle,const vector2df& point,float* x,float* y);
+	//camera position of each pixel of tile (rows of CALIBRATION_MESH_TILE_SIZE, pixels outside frame are skipped),
+	//pixels outside of mesh get 0,0. Owners is scratch of CALIBRATION_MESH_TILE_SIZE^2 items
+	void mapTile(int tile,float* cameraX,float* cameraY,int* owners);
+	//bounds of camera pixels seen by stitched frame rectangle (right and bottom are inclusive), false when none
+	//of rectangle is inside of mesh
+	bool getCameraBounds(int x,int y,int width,int height,int* left,int* top,int* right,int* bottom);
+	//stitched frame position of camera frame point, false when point is outside of triangle and is extrapolated from it
+	bool mapCameraPoint(int triangle,const vector2df& point,float* x,float* y);
+	//area of mesh in stitched frame against its area in camera frame
+	float getAreaScale();
+private:
+	bool isPointInTriangle(const vector2df& point,int triangle,const vector2df* points);
+	//triangle containing stitched frame point, -1 when point is outside of mesh
+	int findTriangle(const vector2df& point);
+	//barycentric position of point in triangle of from points applied to the same triangle of to points,
+	//degenerate triangle gives its first node
+	void interpolate(int triangle,const vector2df& point,const vector2df* from,const vector2df* to,float* x,float* y);
+	//range of pixels which can be inside of triangle, false when it's outside of frame
+	bool getTriangleBounds(int triangle,int* left,int* top,int* right,int* bottom);
+	//columns of row which can be inside of triangle
+	void getRowSpan(int triangle,int y,int* left,int* right);
+	int gridWidth,gridHeight;
+	int frameWidth,frameHeight;
+	unsigned int revision;
+	vector2df* screenPoints;
+	vector2df* cameraPoints;
+	//three node indexes of each triangle, triangle is identified by offset of its nodes in this array
+	int* triangles;
+	int trianglesCount;
+	int tilesWidth,tilesHeight;
+	//bucket of tile i is bucketTriangles[tileBuckets[i]] .. bucketTriangles[tileBuckets[i+1]-1], in mesh order
+	int* tileBuckets;
+	int* bucketTriangles;
+};
+
+#endif // OFX_CALIBRATION_MESH_H
@@ -5,8 +5,12 @@
 #include <string>
 #include <vector>
 #include <iostream>
-#include <windows.h>
-#include <conio.h>
+#ifdef _WIN32
+	#include <windows.h>
+	#include <conio.h>
+#else
+	#include "ofxCameraBasePlatform.h"
+#endif
 
 //Convert an hex string to a number
 template<class T> T HexToInt(const std::string &str);
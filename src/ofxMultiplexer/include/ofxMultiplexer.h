@@ -12,24 +12,85 @@
 #define _OFX_MULTIPLEXER_
 
 #include <stdio.h>
-#include <omp.h>
 #include <memory.h>
 #include <vector>
-#include "omp.h"
 #include "ofxCameraBase.h"
 #include "ofxCameraBaseSettings.h"
-#include "ofxffmv.h"
-#include "ofxPS3.h"
-#include "ofxDShow.h"
-//#include "ofxKinect.h"
-#include "ofxCMUCamera.h"
+#ifdef TARGET_WIN32
+	#include "ofxffmv.h"
+	#include "ofxPS3.h"
+	#include "ofxDShow.h"
+	//#include "ofxKinect.h"
+	#include "ofxCMUCamera.h"
+#endif
 #include "ofxGUIDHelper.h"
-#include "ofxXMLSettings.h"
+#include "ofxXmlSettings.h"
+#include "ofxRawRecording.h"
+#include "ofxMappedFile.h"
+#include "ofxRemapProgram.h"
+#include "ofxCalibrationMesh.h"
+#include "ofxThreadPool.h"
+#include "BackgroundModel.h"
 #include "Calibration.h"
 
 
 
 #define NULL_CAMERA 0xFF
+//stitched frames in ring besides queued ones: one being stitched, latest one and one leased by consumer
+#define _STITCHED_FRAMES_COUNT_ 3
+//stitching thread checks for stop and for streaming cameras this often (milliseconds)
+#define MULTIPLEXER_STITCHING_TIMEOUT 20
+//content of camera region in ring frame: capture time of stitched camera frame or one of these
+#define MULTIPLEXER_SOURCE_BLACK 0
+#define MULTIPLEXER_SOURCE_UNKNOWN 0xFFFFFFFFFFFFFFFFULL
+//side of square tiles of change detection, the same in camera frames and in stitched frame
+#define MULTIPLEXER_CHANGE_TILE_SIZE 16
+//subtracted camera pixels up to this level are noise, tiles without brighter pixel aren't stitched
+#define MULTIPLEXER_BACKGROUND_NOISE_FLOOR 4
+
+//remap cache file: "RMAP" and version of layout and remap builder, increase it when either changes
+#define REMAP_CACHE_MAGIC 0x50414D52
+#define REMAP_CACHE_VERSION 2
+
+//how camera frames are chosen for stitched frame
+typedef enum
+{
+	//latest frame of every camera, the lowest latency
+	MULTIPLEXER_SYNC_LATEST,
+	//frames nearest to capture time of the slowest camera, new frames of faster cameras wait till they fit
+	MULTIPLEXER_SYNC_NEAREST,
+	//stitching waits till every camera has new frame or deadline expires
+	MULTIPLEXER_SYNC_WAIT
+} MULTIPLEXER_SYNC_POLICY;
+
+//what stitching thread does when its queue is full
+typedef enum
+{
+	//the oldest queued frame is overwritten, consumer always gets recent frames
+	MULTIPLEXER_DROP_OLDEST,
+	//stitching waits till consumer takes a frame, camera frames are dropped by cameras meanwhile
+	MULTIPLEXER_DROP_NEWEST
+} MULTIPLEXER_DROP_POLICY;
+
+//skew of camera frames behind the newest camera frame of the same stitched frame, in microseconds
+typedef struct ofxCameraSkew
+{
+	unsigned long long last;
+	unsigned long long total;
+	unsigned long long max;
+	unsigned int framesCount;
+} ofxCameraSkew;
+
+//Header of remap cache file. It's followed by origins (left, top) of calibration mesh of each camera
+//and by serialized remap program. Key is hash of everything the program is computed from.
+typedef struct ofxRemapCacheHeader
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned long long key;
+	unsigned int camerasCount;
+	unsigned int programSize;
+} ofxRemapCacheHeader;
 
 class ofxMultiplexer
 {
@@ -49,8 +110,25 @@ public:
 	void pauseStreamingFromCamera(int index);
 	void startStreamingFromAllCameras();
 	void pauseStreamingFromAllCameras();
+	//wait till any streaming camera publishes new frame or timeout (in milliseconds) expires,
+	//with stitching thread wait till it queues stitched frame. Timeout 0 only polls, even wait sync policy
+	//doesn't block then and its deadline runs over the following calls
+	bool waitForNewFrame(unsigned int timeout);
+	//stitches latest camera frames, with stitching thread the oldest queued frame becomes latest instead
 	void updateStitchedFrame();
 	void getStitchedFrame(int* width,int* height,unsigned char* frameData);
+	//latest stitched frame without copying. It's not overwritten till releaseStitchedFrame, every lease must be released
+	const unsigned char* leaseStitchedFrame(int* width,int* height);
+	void releaseStitchedFrame(const unsigned char* frameData);
+	//takes latest frame of each camera without stitching them (camera frames are recorded as by updateStitchedFrame).
+	//Frames are taken from cameras by calling thread, so stitching thread must be disabled (it's joined when disabled)
+	void updateCameraFrames();
+	//frame of camera position taken by last update, it stays valid till the next one. Black frame for missing camera
+	const unsigned char* getCameraFrame(int cameraPosition,int* width,int* height);
+	//calibration grid of camera position over stitched frame, NULL before distortion is computed
+	ofxCalibrationMesh* getCameraMesh(int cameraPosition);
+	//remaps other frames of camera sizes (like processed camera frames) to buffer of stitched frame size
+	void remapFrames(unsigned char** frames,unsigned char* frameData);
 	void setCalibrationPointsToCamera(int index,vector2df* calibrationPoints);
 	void setCameraGridSize(int width,int height);
 	void getCameraGridSize(int* width,int* height);
@@ -60,31 +138,216 @@ public:
 	void getStitchedFrameSize(int* width,int* height);
 	void setInterleaveMode(bool isInterlaveMode);
 	void getInterleaveMode(bool* isInterleaveMode);
+	//stitched pixels are interpolated from 2x2 camera pixels instead of taking the nearest one
+	void setBilinearMode(bool isBilinearMode);
+	void getBilinearMode(bool* isBilinearMode);
+	//cameras without new frame for deadline (milliseconds) aren't waited for by any policy
+	void setSyncPolicy(MULTIPLEXER_SYNC_POLICY policy,unsigned int deadline);
+	void getSyncPolicy(MULTIPLEXER_SYNC_POLICY* policy,unsigned int* deadline);
+	//skew of camera position since last reset (microseconds), zeros for position without camera
+	void getCameraSkew(int cameraPosition,unsigned int* lastSkew,unsigned int* averageSkew,unsigned int* maxSkew);
+	void resetSkewStatistics();
+	//frames are stitched by own thread to queue of this depth when it's above 0, applied by initializeMultiplexer
+	void setStitchingQueue(int depth,MULTIPLEXER_DROP_POLICY policy);
+	void getStitchingQueue(int* depth,MULTIPLEXER_DROP_POLICY* policy);
+	//stitching thread runs only while it's enabled and queue depth is above 0
+	void setStitchingThreadEnabled(bool isEnabled);
+	bool isStitchingThreadRunning() { return stitchingThreadRunning; }
+	void getStitchingStatistics(unsigned int* stitchedFrames,unsigned int* droppedFrames);
+	//camera tile is changed when mean difference of its pixels from their last changed content is above threshold
+	//(gray levels), only stitched tiles reading changed camera tiles are stitched again. Negative threshold stitches whole frame
+	void setChangeThreshold(int threshold);
+	int getChangeThreshold() { return changeThreshold; }
+	//flags of MULTIPLEXER_CHANGE_TILE_SIZE tiles of latest stitched frame which changed since stitched frame before it,
+	//NULL while change detection is disabled. They stay the same till latest frame changes
+	const unsigned char* getChangedTiles(int* tilesWidth,int* tilesHeight);
+	//background of each camera is subtracted in camera resolution before stitching, so stitched frame has only foreground.
+	//Stitched tiles reading only camera tiles at noise floor or below are cleared instead of remapped
+	void setBackgroundSubtraction(bool isEnabled);
+	bool getBackgroundSubtraction() { return backgroundSubtraction; }
+	//camera frames of next stitch become background
+	void learnBackground();
+	//background moves to each new camera frame by rate (0 keeps it static)
+	void setBackgroundLearnRate(float rate);
+	//rectangles (x,y,width,height each) of stitched frame which aren't learned into background, they're mapped to
+	//each camera by its mesh. They replace rectangles of the previous call, blobs of each frame are usually set
+	void setBackgroundFreeze(const int* rectangles,int count);
+	//dark blobs are background minus frame instead of frame minus background
+	void setBackgroundTrackDark(bool isTrackDark);
+	void setBackgroundNoiseFloor(int noiseFloor);
+	int getBackgroundNoiseFloor() { return backgroundNoiseFloor; }
 	void setIsCalibrationMode(bool isCalibrating);
 	void getIsCalibrationMode(bool* isCalibrating);
+	//recording of new camera frames and stitched frames to raw recording file
+	bool startRecording(const std::string& fileName,int slotsCount);
+	void stopRecording();
+	bool isRecording() { return recorder.isRecording(); }
+	//computed remap is saved to this file and loaded instead of computing when its inputs are the same, empty name disables it
+	void setRemapCacheFileName(const std::string& fileName) { remapCacheFileName = fileName; }
+	void getRecordingStatistics(unsigned int* writtenFrames,unsigned int* droppedFrames);
 private:
 	void computeDistortion();
+	//latest frame of each camera to sourceFrames, new frames are recorded with timestamp
+	void updateSourceFrames(unsigned long long timestamp);
 	void computeCameraMaps();
-	void computeOffsetMap(unsigned int* cameraOffsetMap,vector2df* calibrationPoints,int cameraPosition);
-	void computeWeightMap(float* cameraWeightMap,vector2df* calibrationPoints,int cameraPosition);
-	int findTriangleWithin(vector2df pt,vector2df* screenPoints,int* triangles);
-	bool isPointInTriangle(vector2df p, vector2df a, vector2df b, vector2df c);
-	void cameraToScreenSpace(unsigned int &x, unsigned int &y,vector2df* screenPoints,vector2df* cameraPoints,int* triangles);
+	//first pixel of stitched frame covered by camera
+	void getCameraOrigin(int cameraPosition,int* left,int* top);
+	void computeCameraMesh(int cameraPosition,int left,int top);
+	void computeOffsetMap(int cameraPosition);
+	void computeWeightMap(int cameraPosition);
+	//offsets of camera in given tiles (all of them when tiles is NULL) are computed on thread pool
+	void remapTiles(int cameraPosition,const int* tiles,int tilesCount);
+	static void RemapTiles(void* instance,int first,int last,int participant);
+	//moved calibration points of already stitched camera are applied to remap program in place
+	void updateCameraMesh(int cameraPosition,ofxCameraBaseCalibration* calibration);
+	//position of camera in remap record of output pixel, -1 when camera doesn't cover the pixel
+	int getRecordSlot(int pixel,int camera);
+	float getRecordWeight(int pixel,int camera);
+	void setRecordWeight(int pixel,int camera,float weight);
+	//footprint of remap program against maps it replaced, printed after each computeDistortion
+	void printRemapStatistics();
+	unsigned long long computeRemapKey();
+	//program and camera meshes from cache file, false when file is missing, damaged or has another key
+	bool loadRemapCache(unsigned long long key);
+	void saveRemapCache(unsigned long long key,const int* origins);
+	//stitches latest camera frames to free frame of ring, it becomes latest one or it's queued
+	void stitchFrame(bool isQueued);
+	//free frame of ring, NULL when there is none. Stitched frames lock must be taken
+	unsigned char* getFreeStitchedFrame();
+	//marks cameras whose region in ring frame already holds their source frame, their single source runs aren't stitched again
+	void updateUnchangedCameras(int frameIndex);
+	//camera regions of ring frames have to be stitched again after remap program has changed
+	void invalidateStitchedSources();
+	//content of camera region for updateUnchangedCameras and change detection (MULTIPLEXER_SOURCE_*)
+	unsigned long long getSourceIdentity(int cameraPosition);
+	//camera tiles changed since previous stitch are compared on thread pool, stitched tiles reading them go to changedTiles
+	void detectChanges();
+	static void DetectCameraChanges(void* instance,int first,int last,int participant);
+	void detectRowChanges(int cameraPosition,int tileRow);
+	//changes of ring frame which won't be delivered are added to changes of frame delivered instead of it
+	void mergeDeliveredTiles(int fromFrame,int toFrame);
+	void updateTileSources();
+	//stitched tile is flagged when any camera tile it reads is flagged
+	void mapCameraTiles(unsigned char** cameraTiles,unsigned char* tiles);
+	//camera frames with new source are subtracted on thread pool by tile rows, their active tiles are found
+	void subtractBackgrounds();
+	static void SubtractCameraBackgrounds(void* instance,int first,int last,int participant);
+	void subtractRowBackground(int cameraPosition,int tileRow);
+	//stale tiles of ring frame without foreground are cleared, returns tiles which are still remapped
+	const unsigned char* clearInactiveTiles(int frameIndex,const unsigned char* frameStaleTiles);
+	bool waitForCameraFrames(unsigned int timeout);
+	bool isAnyCameraStreaming();
+	void startStitchingThread();
+	void stopStitchingThread();
+	static void StitchingThread(void* instance);
+	static bool IsStitchedFrameQueued(void* instance);
+	static bool IsStitchingQueueFree(void* instance);
+	static bool IsAnyCameraFrameReady(void* instance);
+	static bool IsEveryCameraFrameReady(void* instance);
+	//capture time which nearest policy chooses frames around: the oldest newest frame of cameras which aren't late
+	unsigned long long getSyncReference();
+	//new frame of camera is closer to reference than frame being stitched
+	bool isNewFrameNearer(int cameraPosition,unsigned long long reference);
+	void updateSkewStatistics();
 private:
 	vector<ofxCameraBaseCalibration* > cameraBasesCalibration;
 	vector2df** cameraCalibrationPoints;
-	unsigned int** offsetMap;
-	float**		   weightMap;
-	unsigned char** cameraMap;
+	//cameras, offsets and weights of each output pixel in scan order, valid only inside computeDistortion
+	ofxRemapRecord* remapRecords;
+	//remap records compiled to runs of gather copies and fixed point blends
+	ofxRemapProgram remapProgram;
+	//calibration grid of each camera position over stitched frame
+	ofxCalibrationMesh* cameraMeshes;
+	std::string remapCacheFileName;
+	//black frame of each camera position, it's used for missing and paused cameras
 	unsigned char** cameraFrames;
+	//frames used for stitching: latest camera frame (not copied) or black frame from cameraFrames
+	unsigned char** sourceFrames;
+	//frame being stitched, it's one of stitchedFrames which is neither latest, queued nor leased
 	unsigned char* stitchedFrame;
+	unsigned char** stitchedFrames;
+	int* stitchedFrameLeases;
+	int stitchedFramesCount;
+	//content of each camera region (MULTIPLEXER_SOURCE_*) in each ring frame, frame by frame
+	unsigned long long* stitchedSources;
+	//cameras which aren't stitched to current ring frame
+	bool* unchangedCameras;
+	int changeThreshold;
+	//content of camera frames which tiles are compared with, changed tiles are copied from source frame
+	unsigned char** referenceFrames;
+	//source which reference frame was compared with last time (MULTIPLEXER_SOURCE_*)
+	unsigned long long* referenceSources;
+	unsigned char** cameraChangedTiles;
+	int* cameraTilesWidth;
+	int* cameraTilesHeight;
+	//tile rows of compared cameras are shared by pool workers, rows of camera i start at cameraFirstTileRows[i]
+	int* cameraFirstTileRows;
+	int changedTilesWidth,changedTilesHeight;
+	//camera tiles read by each stitched tile (bounds of ofxRemapProgram::getTileSources), computed again after remap change
+	short* tileSources;
+	bool isTileSourcesValid;
+	//stitched tiles changed by current stitch
+	unsigned char* changedTiles;
+	//tiles of each ring frame which don't hold their current content, frame by frame
+	unsigned char* staleTiles;
+	//tiles of each ring frame which changed since frame delivered before it, frame by frame
+	unsigned char* deliveredTiles;
+	//remap or threshold has changed, so whole next stitched frame is changed
+	bool isEveryTileChanged;
+	bool backgroundSubtraction;
+	bool isBackgroundLearning;
+	float backgroundLearnRate;
+	bool backgroundTrackDark;
+	int backgroundNoiseFloor;
+	//background model of each camera and background frame it keeps, which is subtracted
+	BackgroundModel* backgroundModels;
+	unsigned char** backgroundFrames;
+	unsigned char** subtractedFrames;
+	//source subtracted to subtracted frame (MULTIPLEXER_SOURCE_*)
+	unsigned long long* subtractedSources;
+	//frames remapped to stitched frame, source frames or their subtracted frames
+	unsigned char** remapSources;
+	//camera tiles with pixel above noise floor and stitched tiles reading them
+	unsigned char** cameraActiveTiles;
+	unsigned char* activeTiles;
+	//stale and active tiles of current stitch
+	unsigned char* foregroundTiles;
+	//tiles of each ring frame which are black since they were cleared, frame by frame
+	unsigned char* clearedTiles;
+	int latestStitchedFrame;
+	//ring frames stitched by stitching thread and not taken by updateStitchedFrame yet, the oldest first
+	int* stitchedQueue;
+	int stitchedQueueFirst,stitchedQueueLength;
+	ofxCaptureLock stitchedFramesLock;
+	int stitchingQueueDepth;
+	MULTIPLEXER_DROP_POLICY dropPolicy;
+	bool stitchingThreadEnabled;
+	bool stitchingThreadRunning;
+	ofxCaptureThread stitchingThread;
+	//held by stitching thread while it stitches, changes of cameras, remap and recording take it too
+	ofxCaptureLock stitchingLock;
+	//raised when stitched frame is queued or taken from queue
+	ofxFrameNotifier stitchedNotifier;
+	unsigned int stitchedFramesCounter,droppedStitchedFrames;
 	int* cameraFramesWidth;
 	int* cameraFramesHeight;
 	ofxCameraBase** cameras;
 	bool* blackCapturingMode;
 	int stitchedFrameWidth,stitchedFrameHeight,cameraGridWidth,cameraGridHeight,calibrationGridWidth,calibrationGridHeight;
 	int actualStitchedFrameWidth,actualStitchedFrameHeight,actualCameraGridWidth,actualCameraGridHeight,actualCalibrationGridWidth,actualCalibrationGridHeight;
-	bool interleaveMode,calibratingMode;
+	bool interleaveMode,bilinearMode,calibratingMode;
+	MULTIPLEXER_SYNC_POLICY syncPolicy;
+	unsigned int syncDeadline;
+	//start of wait sync deadline when caller polls (timeout 0) instead of waiting
+	bool isSyncWaiting;
+	unsigned int syncWaitStartTime;
+	ofxCameraSkew* cameraSkews;
+	//raised by capture threads of all used cameras
+	ofxFrameNotifier frameNotifier;
+	ofxRawRecordingWriter recorder;
+	//recording stream of each camera position (-1 for positions without camera) and of stitched frame
+	int* recordingStreams;
+	int stitchedRecordingStream;
 };
 
 #endif//_OFX_MULTIPLEXER_
\ No newline at end of file
@@ -10,15 +10,18 @@
 
 #include "ofxCameraBase.h"
 #include "ofxCameraBaseSettings.h"
-#include "ofxffmv.h"
-#include "ofxPS3.h"
-#include "ofxDShow.h"
-//#include "ofxKinect.h"
-#include "ofxCMUCamera.h"
+#ifdef TARGET_WIN32
+	#include "ofxffmv.h"
+	#include "ofxPS3.h"
+	#include "ofxDShow.h"
+	//#include "ofxKinect.h"
+	#include "ofxCMUCamera.h"
+#endif
+#include "ofxRecordedCamera.h"
 #include "ofxMultiplexer.h"
-#include "ofxXMLSettings.h"
+#include "ofxXmlSettings.h"
 #include <vector>
-#include "Filters\Filters.h"
+#include "Filters/Filters.h"
 #include "Calibration.h"
 
 
@@ -38,6 +41,11 @@ public:
 	void applySettingsToMultiplexer();
 	//setters
 	void setInterleaveMode(bool isInterleaveMode);
+	void setBilinearMode(bool isBilinearMode);
+	void setSyncPolicy(MULTIPLEXER_SYNC_POLICY policy,unsigned int deadline);
+	void setStitchingQueue(int depth,MULTIPLEXER_DROP_POLICY policy);
+	void setChangeThreshold(int threshold);
+	void setBackgroundSubtraction(bool isEnabled,int noiseFloor);
 	void setMultiplexer(ofxMultiplexer* multiplexer);
 	void setCalibrator(Calibration* calibrator);
 	void setProcessFilter(Filters* processFilter);
@@ -58,6 +66,11 @@ public:
 	void getCalibrationGridSize(int* width,int* height);
 	int getCameraBaseCount();
 	bool getInterleaveMode();
+	bool getBilinearMode();
+	void getSyncPolicy(MULTIPLEXER_SYNC_POLICY* policy,unsigned int* deadline);
+	void getStitchingQueue(int* depth,MULTIPLEXER_DROP_POLICY* policy);
+	int getChangeThreshold();
+	void getBackgroundSubtraction(bool* isEnabled,int* noiseFloor);
 	//XML settings logic
 	void readSettingsFromXML(char* fileName="xml/multiplexer_settings.xml");
 	void saveSettingsToXML(char* fileName="xml/multiplexer_settings.xml");
@@ -71,7 +84,14 @@ private:
 	int stitchedFrameWidth,stitchedFrameHeight;
 	int cameraGridWidth,cameraGridHeight;
 	int calibrationGridWidth,calibrationGridHeight;
-	bool interleaveMode,needToUpdateBackground;
+	bool interleaveMode,bilinearMode,needToUpdateBackground;
+	MULTIPLEXER_SYNC_POLICY syncPolicy;
+	unsigned int syncDeadline;
+	int stitchingQueueDepth;
+	MULTIPLEXER_DROP_POLICY dropPolicy;
+	int changeThreshold;
+	bool backgroundSubtraction;
+	int backgroundNoiseFloor;
 	std::vector<ofxCameraBase* > cameraBases;
 	std::vector<ofxCameraBaseCalibration* > cameraBasesCalibration;
 	std::vector<CAMERATYPE> allowdedCameraTypes;
@@ -0,0 +1,119 @@
+/*
+*  ofxRemapProgram.h
+*
+*  Created on 17/10/26.
+*  Copyright 2026 NUI Group. All rights reserved.
+*
+*/
+#ifndef OFX_REMAP_PROGRAM_H
+#define OFX_REMAP_PROGRAM_H
+
+#include <stddef.h>
+
+//weights are fixed point with this many fraction bits (Q8, 256 is 1.0)
+#define REMAP_WEIGHT_BITS 8
+//runs are split to this length, so they can be shared between pool workers
+#define REMAP_MAX_RUN_LENGTH 2048
+//camera index of empty position in remap record
+#define REMAP_NULL_CAMERA 0xFF
+//source of output pixel is packed to camera index (high byte) and offset in camera frame
+#define REMAP_CAMERA_SHIFT 24
+#define REMAP_OFFSET_MASK 0x00FFFFFF
+//cameras which can overlap in one output pixel
+#define REMAP_MAX_SOURCES 4
+//bilinear sources are 2x2 taps from packed offset, their fraction keeps x (low byte) and y (high byte) position
+//between taps as fixed point with this many bits
+#define REMAP_FRACTION_BITS 8
+
+//Remap record of one output pixel, used while remap is computed. Cameras are filled in order,
+//offsets, fractions and weights belong to camera at the same position
+struct ofxRemapRecord
+{
+	unsigned int offsets[REMAP_MAX_SOURCES];
+	unsigned short fractions[REMAP_MAX_SOURCES];
+	float weights[REMAP_MAX_SOURCES];
+	unsigned char cameras[REMAP_MAX_SOURCES];
+};
+
+//output pixels with the same number of sources. Single source runs read one camera only,
+//pixels with 3 sources are padded to 4 by repeating the third one with zero weight
+struct ofxRemapRun
+{
+	unsigned int start;
+	unsigned int firstSource;
+	unsigned int firstWeight;
+	unsigned short length;
+	unsigned char sourcesCount;
+	unsigned char camera;
+};
+
+//parts of output which already hold their result, execution leaves them as they are
+struct ofxRemapSkip
+{
+	//single source runs of cameras which are true are skipped, NULL skips none
+	const bool* cameras;
+	//flags of output tiles (tileSize pixels square) in rows of tilesWidth, pixels of tiles which are 0 are skipped.
+	//NULL skips none
+	const unsigned char* tiles;
+	int tilesWidth;
+	int tileSize;
+	//width of output frame
+	int width;
+};
+
+//Remapping of camera frames to stitched frame compiled from remap records.
+//Single source runs are gather copies, overlap runs are fixed point blends. Only blended sources have weights.
+//Bilinear program interpolates each source from 2x2 taps, so every source has a fraction too.
+class ofxRemapProgram
+{
+public:
+	ofxRemapProgram();
+	~ofxRemapProgram();
+	//frame widths are row strides of bilinear taps, offsets of bilinear sources must leave one column and row for them
+	void build(const ofxRemapRecord* records,int size,bool isBlending,bool isBilinear,const int* frameWidths,int camerasCount);
+	void clear();
+	bool isBuilt() { return runs != NULL; }
+	//runs are executed on shared thread pool, parts of output given by skip (when it isn't NULL) are left as they are
+	void execute(unsigned char** sourceFrames,unsigned char* stitchedFrame,const ofxRemapSkip* skip);
+	//overlapping pixels get the last non-black source instead of blending (used while calibrating)
+	void executeCalibration(unsigned char** sourceFrames,unsigned char* stitchedFrame,const ofxRemapSkip* skip);
+	//camera tiles which each output tile reads (tiles are tileSize pixels square, output is width pixels wide), bilinear
+	//taps included. Bounds are left, top, right and bottom camera tile for each camera of each output tile,
+	//left is above right when output tile doesn't read the camera
+	void getTileSources(int width,int tileSize,int tilesWidth,int tilesHeight,short* bounds);
+	//program as one block (counts, runs, sources, weights and fractions) for caching in file
+	unsigned int getSerializedSize();
+	void serialize(unsigned char* data);
+	//false when block is damaged or doesn't fit output size and camera frame sizes, program stays cleared then
+	bool deserialize(const unsigned char* data,unsigned int size,int pixelsCount,const int* frameWidths,const int* frameHeights,int camerasCount);
+	//replaces offset (and fraction of bilinear program) of camera in sources of output pixel, false when camera isn't its source
+	bool setSourceOffset(int pixel,int camera,unsigned int offset,unsigned short fraction);
+	bool isBilinear() { return fractions != NULL; }
+	int getRunsCount() { return runsCount; }
+	//number of output pixels blended from more than one source
+	int getBlendedPixelsCount() { return blendedPixelsCount; }
+	//bytes of runs, sources, weights and fractions, all of them are streamed once per stitched frame
+	unsigned int getFootprint();
+private:
+	static void ExecuteRuns(void* instance,int first,int last,int participant);
+	static void ExecuteCalibrationRuns(void* instance,int first,int last,int participant);
+	//run without parts in skipped tiles
+	void executeRunTiles(const ofxRemapRun& run,unsigned char** sourceFrames,unsigned char* stitchedFrame,const ofxRemapSkip* skip,bool isCalibration);
+	void executeRunPart(const ofxRemapRun& run,unsigned int start,unsigned int end,unsigned char** sourceFrames,unsigned char* stitchedFrame,bool isCalibration);
+	void executeRun(const ofxRemapRun& run,unsigned char** sourceFrames,unsigned char* stitchedFrame);
+	void executeCalibrationRun(const ofxRemapRun& run,unsigned char** sourceFrames,unsigned char* stitchedFrame);
+	void setFrameWidths(const int* widths,int count);
+	ofxRemapRun* runs;
+	unsigned int* sources;
+	short* weights;
+	//fraction of each source, NULL for nearest neighbour program
+	unsigned short* fractions;
+	int* frameWidths;
+	int camerasCount;
+	int runsCount;
+	int sourcesCount;
+	int weightsCount;
+	int blendedPixelsCount;
+};
+
+#endif // OFX_REMAP_PROGRAM_H
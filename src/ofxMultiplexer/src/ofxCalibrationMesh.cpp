@@ -0,0 +1,403 @@
+#include "ofxCalibrationMesh.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+ofxCalibrationMesh::ofxCalibrationMesh()
+{
+	screenPoints = NULL;
+	cameraPoints = NULL;
+	triangles = NULL;
+	tileBuckets = NULL;
+	bucketTriangles = NULL;
+	gridWidth = gridHeight = 0;
+	frameWidth = frameHeight = 0;
+	trianglesCount = 0;
+	tilesWidth = tilesHeight = 0;
+	revision = 0;
+}
+
+ofxCalibrationMesh::~ofxCalibrationMesh()
+{
+	clear();
+}
+
+void ofxCalibrationMesh::clear()
+{
+	if (screenPoints != NULL)
+		free(screenPoints);
+	if (cameraPoints != NULL)
+		free(cameraPoints);
+	if (triangles != NULL)
+		free(triangles);
+	if (tileBuckets != NULL)
+		free(tileBuckets);
+	if (bucketTriangles != NULL)
+		free(bucketTriangles);
+	screenPoints = NULL;
+	cameraPoints = NULL;
+	triangles = NULL;
+	tileBuckets = NULL;
+	bucketTriangles = NULL;
+	trianglesCount = 0;
+	tilesWidth = tilesHeight = 0;
+}
+
+void ofxCalibrationMesh::build(int gridWidth,int gridHeight,const vector2df* screenPoints,const vector2df* cameraPoints,int frameWidth,int frameHeight)
+{
+	clear();
+	revision++;
+	this->gridWidth = gridWidth;
+	this->gridHeight = gridHeight;
+	this->frameWidth = frameWidth;
+	this->frameHeight = frameHeight;
+	int pointsCount = getPointsCount();
+	this->screenPoints = (vector2df*)malloc(pointsCount * sizeof(vector2df));
+	this->cameraPoints = (vector2df*)malloc(pointsCount * sizeof(vector2df));
+	memcpy((void*)this->screenPoints,screenPoints,pointsCount * sizeof(vector2df));
+	memcpy((void*)this->cameraPoints,cameraPoints,pointsCount * sizeof(vector2df));
+	trianglesCount = gridWidth * gridHeight * 2;
+	triangles = (int*)malloc(trianglesCount * 3 * sizeof(int));
+	int t = 0;
+	for(int j = 0; j < gridHeight; j++)
+	{
+		for(int i = 0; i < gridWidth; i++)
+		{
+			triangles[t+0] = (i+0) + ((j+0) * (gridWidth+1));
+			triangles[t+1] = (i+1) + ((j+0) * (gridWidth+1));
+			triangles[t+2] = (i+0) + ((j+1) * (gridWidth+1));
+			t += 3;
+			triangles[t+0] = (i+1) + ((j+0) * (gridWidth+1));
+			triangles[t+1] = (i+1) + ((j+1) * (gridWidth+1));
+			triangles[t+2] = (i+0) + ((j+1) * (gridWidth+1));
+			t += 3;
+		}
+	}
+	tilesWidth = (frameWidth + CALIBRATION_MESH_TILE_SIZE - 1) / CALIBRATION_MESH_TILE_SIZE;
+	tilesHeight = (frameHeight + CALIBRATION_MESH_TILE_SIZE - 1) / CALIBRATION_MESH_TILE_SIZE;
+	int tilesCount = tilesWidth * tilesHeight;
+	tileBuckets = (int*)malloc((tilesCount + 1) * sizeof(int));
+	memset(tileBuckets,0,(tilesCount + 1) * sizeof(int));
+	//first pass counts triangles of each tile, second one fills buckets in mesh order
+	for (int pass=0;pass<2;pass++)
+	{
+		if (pass == 1)
+		{
+			for (int i=0;i<tilesCount;i++)
+				tileBuckets[i+1] += tileBuckets[i];
+			bucketTriangles = (int*)malloc((tileBuckets[tilesCount] > 0 ? tileBuckets[tilesCount] : 1) * sizeof(int));
+		}
+		for (int t=0;t<trianglesCount*3;t+=3)
+		{
+			int left,top,right,bottom;
+			if (!getTriangleBounds(t,&left,&top,&right,&bottom))
+				continue;
+			for (int y=top/CALIBRATION_MESH_TILE_SIZE;y<=bottom/CALIBRATION_MESH_TILE_SIZE;y++)
+			{
+				for (int x=left/CALIBRATION_MESH_TILE_SIZE;x<=right/CALIBRATION_MESH_TILE_SIZE;x++)
+				{
+					if (pass == 0)
+						tileBuckets[y * tilesWidth + x + 1]++;
+					else
+						bucketTriangles[tileBuckets[y * tilesWidth + x]++] = t;
+				}
+			}
+		}
+	}
+	//filling moved every bucket start to the start of next bucket
+	for (int i=tilesCount;i>0;i--)
+		tileBuckets[i] = tileBuckets[i-1];
+	tileBuckets[0] = 0;
+}
+
+void ofxCalibrationMesh::setCameraPoint(int index,const vector2df& point)
+{
+	cameraPoints[index] = point;
+	revision++;
+}
+
+bool ofxCalibrationMesh::getTriangleBounds(int triangle,int* left,int* top,int* right,int* bottom)
+{
+	const vector2df& A = screenPoints[triangles[triangle+0]];
+	const vector2df& B = screenPoints[triangles[triangle+1]];
+	const vector2df& C = screenPoints[triangles[triangle+2]];
+	float minX = A.X < B.X ? A.X : B.X;
+	minX = minX < C.X ? minX : C.X;
+	float maxX = A.X > B.X ? A.X : B.X;
+	maxX = maxX > C.X ? maxX : C.X;
+	float minY = A.Y < B.Y ? A.Y : B.Y;
+	minY = minY < C.Y ? minY : C.Y;
+	float maxY = A.Y > B.Y ? A.Y : B.Y;
+	maxY = maxY > C.Y ? maxY : C.Y;
+	//one pixel margin keeps pixels which pass inside test only by rounding
+	*left = (int)floor(minX) - 1;
+	*top = (int)floor(minY) - 1;
+	*right = (int)ceil(maxX) + 1;
+	*bottom = (int)ceil(maxY) + 1;
+	if (*left < 0)
+		*left = 0;
+	if (*top < 0)
+		*top = 0;
+	if (*right >= frameWidth)
+		*right = frameWidth - 1;
+	if (*bottom >= frameHeight)
+		*bottom = frameHeight - 1;
+	return (*left <= *right) && (*top <= *bottom);
+}
+
+void ofxCalibrationMesh::getRowSpan(int triangle,int y,int* left,int* right)
+{
+	//triangle is clipped to band of one row around y, its extreme columns are on band borders or nodes
+	float bandTop = (float)(y - 1);
+	float bandBottom = (float)(y + 1);
+	float minX = 0.0f,maxX = 0.0f;
+	bool isEmpty = true;
+	for (int i=0;i<3;i++)
+	{
+		const vector2df& P = screenPoints[triangles[triangle + i]];
+		const vector2df& Q = screenPoints[triangles[triangle + (i + 1) % 3]];
+		float low = P.Y < Q.Y ? P.Y : Q.Y;
+		float high = P.Y > Q.Y ? P.Y : Q.Y;
+		if ((high < bandTop) || (low > bandBottom))
+			continue;
+		float x[2];
+		if (P.Y == Q.Y)
+		{
+			x[0] = P.X;
+			x[1] = Q.X;
+		}
+		else
+		{
+			float from = low > bandTop ? low : bandTop;
+			float to = high < bandBottom ? high : bandBottom;
+			x[0] = P.X + (from - P.Y) * (Q.X - P.X) / (Q.Y - P.Y);
+			x[1] = P.X + (to - P.Y) * (Q.X - P.X) / (Q.Y - P.Y);
+		}
+		for (int j=0;j<2;j++)
+		{
+			if (isEmpty || (x[j] < minX))
+				minX = x[j];
+			if (isEmpty || (x[j] > maxX))
+				maxX = x[j];
+			isEmpty = false;
+		}
+	}
+	if (isEmpty)
+	{
+		*left = 1;
+		*right = 0;
+		return;
+	}
+	*left = (int)floor(minX) - 1;
+	*right = (int)ceil(maxX) + 1;
+}
+
+bool ofxCalibrationMesh::getPointTiles(int index,int* left,int* top,int* right,int* bottom)
+{
+	bool isFound = false;
+	for (int t=0;t<trianglesCount*3;t+=3)
+	{
+		if ((triangles[t] != index) && (triangles[t+1] != index) && (triangles[t+2] != index))
+			continue;
+		int triangleLeft,triangleTop,triangleRight,triangleBottom;
+		if (!getTriangleBounds(t,&triangleLeft,&triangleTop,&triangleRight,&triangleBottom))
+			continue;
+		if ((!isFound) || (triangleLeft < *left))
+			*left = triangleLeft;
+		if ((!isFound) || (triangleTop < *top))
+			*top = triangleTop;
+		if ((!isFound) || (triangleRight > *right))
+			*right = triangleRight;
+		if ((!isFound) || (triangleBottom > *bottom))
+			*bottom = triangleBottom;
+		isFound = true;
+	}
+	if (isFound)
+	{
+		*left /= CALIBRATION_MESH_TILE_SIZE;
+		*top /= CALIBRATION_MESH_TILE_SIZE;
+		*right /= CALIBRATION_MESH_TILE_SIZE;
+		*bottom /= CALIBRATION_MESH_TILE_SIZE;
+	}
+	return isFound;
+}
+
+bool ofxCalibrationMesh::isPointInTriangle(const vector2df& point,int triangle,const vector2df* points)
+{
+	vector2df a = points[triangles[triangle]];
+	vector2df b = points[triangles[triangle+1]];
+	vector2df c = points[triangles[triangle+2]];
+	return (vector2df::isOnSameSide(point,a, b,c) && vector2df::isOnSameSide(point,b, a,c) && vector2df::isOnSameSide(point, c, a, b));
+}
+
+int ofxCalibrationMesh::findTriangle(const vector2df& point)
+{
+	if ((point.X < 0.0f) || (point.Y < 0.0f) || (point.X >= frameWidth) || (point.Y >= frameHeight))
+		return -1;
+	int tile = ((int)point.Y / CALIBRATION_MESH_TILE_SIZE) * tilesWidth + (int)point.X / CALIBRATION_MESH_TILE_SIZE;
+	for (int i=tileBuckets[tile];i<tileBuckets[tile+1];i++)
+	{
+		if (isPointInTriangle(point,bucketTriangles[i],screenPoints))
+			return bucketTriangles[i];
+	}
+	return -1;
+}
+
+void ofxCalibrationMesh::interpolate(int triangle,const vector2df& point,const vector2df* from,const vector2df* to,float* x,float* y)
+{
+	vector2df pt = point;
+	vector2df A = from[triangles[triangle+0]];
+	vector2df B = from[triangles[triangle+1]];
+	vector2df C = from[triangles[triangle+2]];
+
+	float total_area = (A.X - B.X) * (A.Y - C.Y) - (A.Y - B.Y) * (A.X - C.X);
+	if (total_area == 0.0f)
+	{
+		*x = to[triangles[triangle+0]].X;
+		*y = to[triangles[triangle+0]].Y;
+		return;
+	}
+	float area_A = (pt.X - B.X) * (pt.Y - C.Y) - (pt.Y - B.Y) * (pt.X - C.X);
+	float area_B = (A.X - pt.X) * (A.Y - C.Y) - (A.Y - pt.Y) * (A.X - C.X);
+	float bary_A = area_A / total_area;
+	float bary_B = area_B / total_area;
+	float bary_C = 1.0f - bary_A - bary_B;
+
+	vector2df sA = to[triangles[triangle+0]];
+	vector2df sB = to[triangles[triangle+1]];
+	vector2df sC = to[triangles[triangle+2]];
+
+	vector2df transformedPos;
+
+	transformedPos = (sA*bary_A) + (sB*bary_B) + (sC*bary_C);
+
+	*x = transformedPos.X;
+	*y = transformedPos.Y;
+}
+
+void ofxCalibrationMesh::transformPoint(int triangle,const vector2df& point,float* x,float* y)
+{
+	interpolate(triangle,point,screenPoints,cameraPoints,x,y);
+}
+
+bool ofxCalibrationMesh::getCameraBounds(int x,int y,int width,int height,int* left,int* top,int* right,int* bottom)
+{
+	if ((triangles == NULL) || (width <= 0) || (height <= 0))
+		return false;
+	//mapping is affine in each triangle, so camera extremes are at nodes inside rectangle or on its border pixels
+	int lastX = x + width - 1;
+	int lastY = y + height - 1;
+	int pointsCount = getPointsCount();
+	float minX = 0.0f,minY = 0.0f,maxX = 0.0f,maxY = 0.0f;
+	bool isFound = false;
+	for (int i=0;i<pointsCount+2*(width+height);i++)
+	{
+		float cameraX,cameraY;
+		if (i < pointsCount)
+		{
+			const vector2df& point = screenPoints[i];
+			if ((point.X < x) || (point.Y < y) || (point.X > lastX) || (point.Y > lastY))
+				continue;
+			cameraX = cameraPoints[i].X;
+			cameraY = cameraPoints[i].Y;
+		}
+		else
+		{
+			//top and bottom rows, then left and right columns
+			int border = i - pointsCount;
+			vector2df point;
+			if (border < 2 * width)
+				point = vector2df((float)(x + border % width),(float)(border < width ? y : lastY));
+			else
+				point = vector2df((float)(border - 2 * width < height ? x : lastX),(float)(y + (border - 2 * width) % height));
+			int triangle = findTriangle(point);
+			if (triangle < 0)
+				continue;
+			transformPoint(triangle,point,&cameraX,&cameraY);
+		}
+		if ((!isFound) || (cameraX < minX))
+			minX = cameraX;
+		if ((!isFound) || (cameraY < minY))
+			minY = cameraY;
+		if ((!isFound) || (cameraX > maxX))
+			maxX = cameraX;
+		if ((!isFound) || (cameraY > maxY))
+			maxY = cameraY;
+		isFound = true;
+	}
+	if (!isFound)
+		return false;
+	*left = (int)floor(minX);
+	*top = (int)floor(minY);
+	*right = (int)ceil(maxX);
+	*bottom = (int)ceil(maxY);
+	return true;
+}
+
+bool ofxCalibrationMesh::mapCameraPoint(int triangle,const vector2df& point,float* x,float* y)
+{
+	interpolate(triangle,point,cameraPoints,screenPoints,x,y);
+	return isPointInTriangle(point,triangle,cameraPoints);
+}
+
+float ofxCalibrationMesh::getAreaScale()
+{
+	float screenArea = 0.0f,cameraArea = 0.0f;
+	for (int i=0;i<trianglesCount;i++)
+	{
+		const vector2df* points[2] = { screenPoints, cameraPoints };
+		float areas[2];
+		for (int j=0;j<2;j++)
+		{
+			vector2df a = points[j][triangles[i*3]];
+			vector2df b = points[j][triangles[i*3+1]];
+			vector2df c = points[j][triangles[i*3+2]];
+			areas[j] = fabs((b.X - a.X) * (c.Y - a.Y) - (b.Y - a.Y) * (c.X - a.X));
+		}
+		screenArea += areas[0];
+		cameraArea += areas[1];
+	}
+	return cameraArea > 0.0f ? screenArea / cameraArea : 1.0f;
+}
+
+void ofxCalibrationMesh::mapTile(int tile,float* cameraX,float* cameraY,int* owners)
+{
+	int tileLeft = (tile % tilesWidth) * CALIBRATION_MESH_TILE_SIZE;
+	int tileTop = (tile / tilesWidth) * CALIBRATION_MESH_TILE_SIZE;
+	int tileRight = tileLeft + CALIBRATION_MESH_TILE_SIZE - 1 < frameWidth ? tileLeft + CALIBRATION_MESH_TILE_SIZE - 1 : frameWidth - 1;
+	int tileBottom = tileTop + CALIBRATION_MESH_TILE_SIZE - 1 < frameHeight ? tileTop + CALIBRATION_MESH_TILE_SIZE - 1 : frameHeight - 1;
+	for (int i=0;i<CALIBRATION_MESH_TILE_SIZE*CALIBRATION_MESH_TILE_SIZE;i++)
+		owners[i] = -1;
+	//triangles are rasterized in mesh order and don't take pixels of previous ones
+	for (int i=tileBuckets[tile];i<tileBuckets[tile+1];i++)
+	{
+		int t = bucketTriangles[i];
+		int left,top,right,bottom;
+		getTriangleBounds(t,&left,&top,&right,&bottom);
+		top = top > tileTop ? top : tileTop;
+		bottom = bottom < tileBottom ? bottom : tileBottom;
+		for (int y=top;y<=bottom;y++)
+		{
+			getRowSpan(t,y,&left,&right);
+			left = left > tileLeft ? left : tileLeft;
+			right = right < tileRight ? right : tileRight;
+			int* rowOwners = owners + (y - tileTop) * CALIBRATION_MESH_TILE_SIZE - tileLeft;
+			for (int x=left;x<=right;x++)
+			{
+				if ((rowOwners[x] < 0) && isPointInTriangle(vector2df((float)x,(float)y),t,screenPoints))
+					rowOwners[x] = t;
+			}
+		}
+	}
+	for (int y=tileTop;y<=tileBottom;y++)
+	{
+		for (int x=tileLeft;x<=tileRight;x++)
+		{
+			int i = (y - tileTop) * CALIBRATION_MESH_TILE_SIZE + x - tileLeft;
+			if (owners[i] >= 0)
+				transformPoint(owners[i],vector2df((float)x,(float)y),&cameraX[i],&cameraY[i]);
+			else
+				cameraX[i] = cameraY[i] = 0.0f;
+		}
+	}
+}
@@ -8,20 +8,72 @@
 *
 */
 #include "ofxMultiplexer.h"
+#if defined(OFX_SSE2)
+	#include <emmintrin.h>
+#endif
 
 ofxMultiplexer::ofxMultiplexer()
 {
-	offsetMap = NULL;
-	weightMap = NULL;
+	remapRecords = NULL;
+	cameraMeshes = NULL;
 	stitchedFrame = NULL;
+	stitchedFrames = NULL;
+	stitchedFrameLeases = NULL;
+	stitchedFramesCount = 0;
+	stitchedSources = NULL;
+	unchangedCameras = NULL;
+	changeThreshold = -1;
+	referenceFrames = NULL;
+	referenceSources = NULL;
+	cameraChangedTiles = NULL;
+	cameraTilesWidth = NULL;
+	cameraTilesHeight = NULL;
+	cameraFirstTileRows = NULL;
+	changedTilesWidth = changedTilesHeight = 0;
+	tileSources = NULL;
+	isTileSourcesValid = false;
+	changedTiles = NULL;
+	staleTiles = NULL;
+	deliveredTiles = NULL;
+	isEveryTileChanged = true;
+	backgroundSubtraction = false;
+	isBackgroundLearning = false;
+	backgroundLearnRate = 0.0f;
+	backgroundTrackDark = false;
+	backgroundNoiseFloor = MULTIPLEXER_BACKGROUND_NOISE_FLOOR;
+	backgroundModels = NULL;
+	backgroundFrames = NULL;
+	subtractedFrames = NULL;
+	subtractedSources = NULL;
+	remapSources = NULL;
+	cameraActiveTiles = NULL;
+	activeTiles = NULL;
+	foregroundTiles = NULL;
+	clearedTiles = NULL;
+	latestStitchedFrame = 0;
+	stitchedQueue = NULL;
+	stitchedQueueFirst = stitchedQueueLength = 0;
+	stitchingQueueDepth = 0;
+	dropPolicy = MULTIPLEXER_DROP_OLDEST;
+	stitchingThreadEnabled = true;
+	stitchingThreadRunning = false;
+	stitchedFramesCounter = droppedStitchedFrames = 0;
 	cameraFrames = NULL;
-	cameraMap = NULL;
+	sourceFrames = NULL;
 	cameraFramesWidth = NULL;
 	cameraFramesHeight = NULL;
 	cameras = NULL;
 	blackCapturingMode = NULL;
 	cameraCalibrationPoints = NULL;
+	recordingStreams = NULL;
+	stitchedRecordingStream = -1;
+	bilinearMode = false;
 	calibratingMode = false;
+	syncPolicy = MULTIPLEXER_SYNC_LATEST;
+	syncDeadline = 20;
+	isSyncWaiting = false;
+	syncWaitStartTime = 0;
+	cameraSkews = NULL;
 }
 
 ofxMultiplexer::~ofxMultiplexer()
@@ -31,7 +83,11 @@ ofxMultiplexer::~ofxMultiplexer()
 
 void ofxMultiplexer::setIsCalibrationMode(bool isCalibrating)
 {
+	stitchingLock.lock();
+	if (calibratingMode != isCalibrating)
+		invalidateStitchedSources();
 	calibratingMode = isCalibrating;
+	stitchingLock.unlock();
 }
 
 void ofxMultiplexer::getIsCalibrationMode(bool* isCalibrating)
@@ -57,35 +113,46 @@ void ofxMultiplexer::setCalibrationPointsToCamera(int index,vector2df* calibrati
 			newPoint.Y = calibrationPoints[i].Y;
 			cameraBasesCalibration[newCameraIndex]->calibrationPoints.push_back(newPoint);
 		}
+		//remap program is changed in place, stitching thread waits till it's done
+		stitchingLock.lock();
+		updateCameraMesh(index,cameraBasesCalibration[newCameraIndex]);
+		isTileSourcesValid = false;
+		invalidateStitchedSources();
+		stitchingLock.unlock();
 	}
 }
 
 void ofxMultiplexer::initializeMultiplexer()
 {
 	deinitializeMultiplexer();
-	stitchedFrame = (unsigned char*)malloc(stitchedFrameWidth * stitchedFrameHeight * sizeof(unsigned char));
-	offsetMap = (unsigned int**)malloc(cameraGridWidth*cameraGridHeight * sizeof(unsigned int*));
-	weightMap = (float**)malloc(cameraGridWidth*cameraGridHeight * sizeof(float*));
+	stitchedFramesCount = _STITCHED_FRAMES_COUNT_ + stitchingQueueDepth;
+	stitchedFrames = (unsigned char**)malloc(stitchedFramesCount * sizeof(unsigned char*));
+	stitchedFrameLeases = (int*)malloc(stitchedFramesCount * sizeof(int));
+	stitchedQueue = (int*)malloc(stitchedFramesCount * sizeof(int));
+	for (int i=0;i<stitchedFramesCount;i++)
+	{
+		stitchedFrames[i] = (unsigned char*)malloc(stitchedFrameWidth * stitchedFrameHeight * sizeof(unsigned char));
+		memset(stitchedFrames[i],0,stitchedFrameWidth * stitchedFrameHeight * sizeof(unsigned char));
+		stitchedFrameLeases[i] = 0;
+	}
+	latestStitchedFrame = 0;
+	stitchedQueueFirst = stitchedQueueLength = 0;
+	stitchedFramesCounter = droppedStitchedFrames = 0;
 	cameraFrames = (unsigned char**)malloc(cameraGridWidth*cameraGridHeight * sizeof(unsigned char*));
+	sourceFrames = (unsigned char**)malloc(cameraGridWidth*cameraGridHeight * sizeof(unsigned char*));
+	stitchedSources = (unsigned long long*)malloc(stitchedFramesCount*cameraGridWidth*cameraGridHeight * sizeof(unsigned long long));
+	unchangedCameras = (bool*)malloc(cameraGridWidth*cameraGridHeight * sizeof(bool));
 	cameraCalibrationPoints = (vector2df**)malloc(cameraGridWidth*cameraGridHeight * sizeof(vector2df*));
 	blackCapturingMode = (bool*)malloc(cameraGridWidth*cameraGridHeight*sizeof(bool));
 	cameras = (ofxCameraBase**)malloc(cameraGridWidth*cameraGridHeight * sizeof(ofxCameraBase*));
-	cameraMap = (unsigned char**)malloc(4 * sizeof(unsigned char*));
 	cameraFramesWidth = (int*)malloc(cameraGridWidth*cameraGridHeight * sizeof(int));
 	cameraFramesHeight = (int*)malloc(cameraGridWidth*cameraGridHeight * sizeof(int));
-	for (int i=0;i<4;i++)
-	{
-		cameraMap[i] = (unsigned char*)malloc(stitchedFrameWidth*stitchedFrameHeight*sizeof(unsigned char));
-		memset((void*)cameraMap[i],NULL_CAMERA,stitchedFrameWidth*stitchedFrameHeight*sizeof(unsigned char));
-	}
+	cameraSkews = (ofxCameraSkew*)malloc(cameraGridWidth*cameraGridHeight * sizeof(ofxCameraSkew));
+	memset((void*)cameraSkews,0,cameraGridWidth*cameraGridHeight * sizeof(ofxCameraSkew));
 	for (int i=0;i<cameraGridWidth*cameraGridHeight;i++)
 	{
 		cameraCalibrationPoints[i] = (vector2df*)malloc((calibrationGridWidth+1)*(calibrationGridHeight+1)*sizeof(vector2df));
 		cameras[i] = NULL;
-		offsetMap[i] = (unsigned int*)malloc(stitchedFrameWidth * stitchedFrameHeight * sizeof(unsigned int));
-		memset(offsetMap[i],0,stitchedFrameWidth * stitchedFrameHeight * sizeof(unsigned int));
-		weightMap[i] = (float*)malloc(stitchedFrameWidth * stitchedFrameHeight * sizeof(float));
-		memset(weightMap[i],0,stitchedFrameWidth * stitchedFrameHeight * sizeof(float));
 		blackCapturingMode[i] = true;
 		int newCameraIndex = -1;
 		for (int j=0;j<cameraBasesCalibration.size();j++)
@@ -127,6 +194,7 @@ void ofxMultiplexer::initializeMultiplexer()
 			}
 			blackCapturingMode[i] = false;
 			cameras[i] = cameraBasesCalibration[newCameraIndex]->camera;
+			cameras[i]->setFrameListener(&frameNotifier);
 		}
 		else
 		{
@@ -146,8 +214,56 @@ void ofxMultiplexer::initializeMultiplexer()
 			}
 		}
 		cameraFrames[i] = (unsigned char*)malloc(cameraFramesWidth[i] * cameraFramesHeight[i] * sizeof(unsigned char));
-		memset(cameraFrames[i],1,cameraFramesWidth[i] * cameraFramesHeight[i] * sizeof(unsigned char));
+		memset(cameraFrames[i],0,cameraFramesWidth[i] * cameraFramesHeight[i] * sizeof(unsigned char));
+		sourceFrames[i] = cameraFrames[i];
 	}
+	//change detection compares camera tiles with reference frames, stitched tiles are tracked for each ring frame
+	changedTilesWidth = (stitchedFrameWidth + MULTIPLEXER_CHANGE_TILE_SIZE - 1) / MULTIPLEXER_CHANGE_TILE_SIZE;
+	changedTilesHeight = (stitchedFrameHeight + MULTIPLEXER_CHANGE_TILE_SIZE - 1) / MULTIPLEXER_CHANGE_TILE_SIZE;
+	int tilesCount = changedTilesWidth * changedTilesHeight;
+	referenceFrames = (unsigned char**)malloc(cameraGridWidth*cameraGridHeight * sizeof(unsigned char*));
+	referenceSources = (unsigned long long*)malloc(cameraGridWidth*cameraGridHeight * sizeof(unsigned long long));
+	cameraChangedTiles = (unsigned char**)malloc(cameraGridWidth*cameraGridHeight * sizeof(unsigned char*));
+	cameraTilesWidth = (int*)malloc(cameraGridWidth*cameraGridHeight * sizeof(int));
+	cameraTilesHeight = (int*)malloc(cameraGridWidth*cameraGridHeight * sizeof(int));
+	cameraFirstTileRows = (int*)malloc((cameraGridWidth*cameraGridHeight + 1) * sizeof(int));
+	for (int i=0;i<cameraGridWidth*cameraGridHeight;i++)
+	{
+		cameraTilesWidth[i] = (cameraFramesWidth[i] + MULTIPLEXER_CHANGE_TILE_SIZE - 1) / MULTIPLEXER_CHANGE_TILE_SIZE;
+		cameraTilesHeight[i] = (cameraFramesHeight[i] + MULTIPLEXER_CHANGE_TILE_SIZE - 1) / MULTIPLEXER_CHANGE_TILE_SIZE;
+		referenceFrames[i] = (unsigned char*)malloc(cameraFramesWidth[i] * cameraFramesHeight[i] * sizeof(unsigned char));
+		memset(referenceFrames[i],0,cameraFramesWidth[i] * cameraFramesHeight[i] * sizeof(unsigned char));
+		referenceSources[i] = MULTIPLEXER_SOURCE_UNKNOWN;
+		cameraChangedTiles[i] = (unsigned char*)malloc(cameraTilesWidth[i] * cameraTilesHeight[i] * sizeof(unsigned char));
+	}
+	tileSources = (short*)malloc(tilesCount * cameraGridWidth*cameraGridHeight * 4 * sizeof(short));
+	isTileSourcesValid = false;
+	changedTiles = (unsigned char*)malloc(tilesCount * sizeof(unsigned char));
+	staleTiles = (unsigned char*)malloc(stitchedFramesCount * tilesCount * sizeof(unsigned char));
+	deliveredTiles = (unsigned char*)malloc(stitchedFramesCount * tilesCount * sizeof(unsigned char));
+	memset(deliveredTiles,1,stitchedFramesCount * tilesCount * sizeof(unsigned char));
+	//background of each camera is black till it's learned, so subtraction keeps frames as they are
+	backgroundModels = new BackgroundModel[cameraGridWidth*cameraGridHeight];
+	backgroundFrames = (unsigned char**)malloc(cameraGridWidth*cameraGridHeight * sizeof(unsigned char*));
+	subtractedFrames = (unsigned char**)malloc(cameraGridWidth*cameraGridHeight * sizeof(unsigned char*));
+	subtractedSources = (unsigned long long*)malloc(cameraGridWidth*cameraGridHeight * sizeof(unsigned long long));
+	remapSources = (unsigned char**)malloc(cameraGridWidth*cameraGridHeight * sizeof(unsigned char*));
+	cameraActiveTiles = (unsigned char**)malloc(cameraGridWidth*cameraGridHeight * sizeof(unsigned char*));
+	for (int i=0;i<cameraGridWidth*cameraGridHeight;i++)
+	{
+		int pixelsCount = cameraFramesWidth[i] * cameraFramesHeight[i];
+		backgroundModels[i].allocate(cameraFramesWidth[i],cameraFramesHeight[i]);
+		backgroundFrames[i] = (unsigned char*)malloc(pixelsCount * sizeof(unsigned char));
+		memset(backgroundFrames[i],0,pixelsCount * sizeof(unsigned char));
+		subtractedFrames[i] = (unsigned char*)malloc(pixelsCount * sizeof(unsigned char));
+		subtractedSources[i] = MULTIPLEXER_SOURCE_UNKNOWN;
+		remapSources[i] = sourceFrames[i];
+		cameraActiveTiles[i] = (unsigned char*)malloc(cameraTilesWidth[i] * cameraTilesHeight[i] * sizeof(unsigned char));
+	}
+	activeTiles = (unsigned char*)malloc(tilesCount * sizeof(unsigned char));
+	foregroundTiles = (unsigned char*)malloc(tilesCount * sizeof(unsigned char));
+	clearedTiles = (unsigned char*)malloc(stitchedFramesCount * tilesCount * sizeof(unsigned char));
+	isBackgroundLearning = false;
 	actualStitchedFrameWidth = stitchedFrameWidth;
 	actualStitchedFrameHeight = stitchedFrameHeight;
 	actualCameraGridWidth = cameraGridWidth;
@@ -155,46 +271,115 @@ void ofxMultiplexer::initializeMultiplexer()
 	actualCalibrationGridWidth = calibrationGridWidth;
 	actualCalibrationGridHeight = calibrationGridHeight;
 	computeDistortion();
+	invalidateStitchedSources();
+	startStitchingThread();
 }
 
 void ofxMultiplexer::deinitializeMultiplexer()
 {
-	if (stitchedFrame != NULL)
-		free(stitchedFrame);
-	if (offsetMap != NULL)
+	stopStitchingThread();
+	//frame sizes and cameras of recording are valid only for current configuration
+	stopRecording();
+	remapProgram.clear();
+	if (cameraMeshes != NULL)
+		delete[] cameraMeshes;
+	cameraMeshes = NULL;
+	if (stitchedFrames != NULL)
+	{
+		for (int i=0;i<stitchedFramesCount;i++)
+			free(stitchedFrames[i]);
+		free(stitchedFrames);
+		free(stitchedFrameLeases);
+		free(stitchedQueue);
+	}
+	stitchedFrames = NULL;
+	stitchedFrameLeases = NULL;
+	stitchedQueue = NULL;
+	stitchedFramesCount = 0;
+	stitchedQueueLength = 0;
+	stitchedFrame = NULL;
+	if (cameraFrames != NULL)
 	{
 		for (int i=0;i<actualCameraGridWidth*actualCameraGridHeight;i++)
-			free(offsetMap[i]);
-		free(offsetMap);
+			free(cameraFrames[i]);
+		free(cameraFrames);
 	}
-	if (weightMap != NULL)
+	if (sourceFrames != NULL)
+		free(sourceFrames);
+	if (stitchedSources != NULL)
+		free(stitchedSources);
+	stitchedSources = NULL;
+	if (unchangedCameras != NULL)
+		free(unchangedCameras);
+	unchangedCameras = NULL;
+	if (referenceFrames != NULL)
 	{
 		for (int i=0;i<actualCameraGridWidth*actualCameraGridHeight;i++)
-			free(weightMap[i]);
-		free(weightMap);
+		{
+			free(referenceFrames[i]);
+			free(cameraChangedTiles[i]);
+		}
+		free(referenceFrames);
+		free(referenceSources);
+		free(cameraChangedTiles);
+		free(cameraTilesWidth);
+		free(cameraTilesHeight);
+		free(cameraFirstTileRows);
+		free(tileSources);
+		free(changedTiles);
+		free(staleTiles);
+		free(deliveredTiles);
 	}
-	if (cameraFrames != NULL)
+	referenceFrames = NULL;
+	referenceSources = NULL;
+	cameraChangedTiles = NULL;
+	cameraTilesWidth = cameraTilesHeight = NULL;
+	cameraFirstTileRows = NULL;
+	tileSources = NULL;
+	changedTiles = staleTiles = deliveredTiles = NULL;
+	if (backgroundModels != NULL)
 	{
 		for (int i=0;i<actualCameraGridWidth*actualCameraGridHeight;i++)
-			free(cameraFrames[i]);
-		free(cameraFrames);
+		{
+			free(backgroundFrames[i]);
+			free(subtractedFrames[i]);
+			free(cameraActiveTiles[i]);
+		}
+		delete[] backgroundModels;
+		free(backgroundFrames);
+		free(subtractedFrames);
+		free(subtractedSources);
+		free(remapSources);
+		free(cameraActiveTiles);
+		free(activeTiles);
+		free(foregroundTiles);
+		free(clearedTiles);
 	}
+	backgroundModels = NULL;
+	backgroundFrames = subtractedFrames = remapSources = NULL;
+	subtractedSources = NULL;
+	cameraActiveTiles = NULL;
+	activeTiles = foregroundTiles = clearedTiles = NULL;
 	if (cameraCalibrationPoints != NULL)
 	{
 		for (int i=0;i<actualCameraGridWidth*actualCameraGridHeight;i++)
 			free(cameraCalibrationPoints[i]);
 		free(cameraCalibrationPoints);
 	}
-	if (cameraMap != NULL)
-	{
-		for (int i=0;i<4;i++)
-			free(cameraMap[i]);
-		free(cameraMap);
-	}
 	if (blackCapturingMode!=NULL)
 		free(blackCapturingMode);
+	if (cameraSkews != NULL)
+		free(cameraSkews);
+	cameraSkews = NULL;
 	if (cameras!=NULL)
+	{
+		for (int i=0;i<actualCameraGridWidth*actualCameraGridHeight;i++)
+		{
+			if (cameras[i]!=NULL)
+				cameras[i]->setFrameListener(NULL);
+		}
 		free(cameras);
+	}
 	if (cameraFramesHeight == NULL)
 		free(cameraFramesHeight);
 	if (cameraFramesWidth == NULL)
@@ -244,117 +429,910 @@ void ofxMultiplexer::clearAllCameraBase()
 
 void ofxMultiplexer::startStreamingFromCamera(int index)
 {
+	stitchingLock.lock();
 	if (index<actualCameraGridWidth*actualCameraGridHeight)
 		blackCapturingMode[index] = (cameras[index]==NULL);
+	stitchingLock.unlock();
 }
 
 void ofxMultiplexer::pauseStreamingFromCamera(int index)
 {
+	stitchingLock.lock();
 	if (index<actualCameraGridWidth*actualCameraGridHeight)
 		blackCapturingMode[index] = true;
+	stitchingLock.unlock();
 }
 
 void ofxMultiplexer::startStreamingFromAllCameras()
 {
+	stitchingLock.lock();
 	for (int i=0;i<actualCameraGridWidth*actualCameraGridHeight;i++)
 	{
 		blackCapturingMode[i] = (cameras[i]==NULL);
 		if (!blackCapturingMode[i])
 			cameras[i]->resumeCamera();
 	}
+	stitchingLock.unlock();
 }
 
 void ofxMultiplexer::pauseStreamingFromAllCameras()
 {
+	stitchingLock.lock();
 	for (int i=0;i<actualCameraGridWidth*actualCameraGridHeight;i++)
 		blackCapturingMode[i] = true;
+	stitchingLock.unlock();
 }
 
-void ofxMultiplexer::updateStitchedFrame()
+bool ofxMultiplexer::IsAnyCameraFrameReady(void* instance)
 {
-	int size = actualStitchedFrameWidth*actualStitchedFrameHeight;
-	int threadsCount = actualCameraGridWidth*actualCameraGridHeight > 4 ? 4 : actualCameraGridWidth*actualCameraGridHeight;
-	#pragma omp parallel num_threads(threadsCount)
+	ofxMultiplexer *pThis = (ofxMultiplexer*)instance;
+	//new frames which nearest policy would hold back don't make new stitched frame
+	bool isNearestSync = pThis->syncPolicy == MULTIPLEXER_SYNC_NEAREST;
+	unsigned long long reference = isNearestSync ? pThis->getSyncReference() : 0;
+	for (int i=0;i<pThis->actualCameraGridWidth*pThis->actualCameraGridHeight;i++)
 	{
-		#pragma omp for
-		for (int i=0;i<actualCameraGridWidth*actualCameraGridHeight;i++)
-		{	
-			if (blackCapturingMode[i])
-				memset(cameraFrames[i],0,cameraFramesWidth[i]*cameraFramesHeight[i]*sizeof(unsigned char));
-			else
-				cameras[i]->getCameraFrame(cameraFrames[i]);
+		if ((!pThis->blackCapturingMode[i]) && (pThis->cameras[i]->isCapturedNewFrame()))
+		{
+			if ((!isNearestSync) || pThis->isNewFrameNearer(i,reference))
+				return true;
 		}
 	}
-	if (interleaveMode)
+	return false;
+}
+
+bool ofxMultiplexer::IsEveryCameraFrameReady(void* instance)
+{
+	ofxMultiplexer *pThis = (ofxMultiplexer*)instance;
+	for (int i=0;i<pThis->actualCameraGridWidth*pThis->actualCameraGridHeight;i++)
+	{
+		if ((!pThis->blackCapturingMode[i]) && (!pThis->cameras[i]->isCapturedNewFrame()))
+			return false;
+	}
+	return true;
+}
+
+unsigned long long ofxMultiplexer::getSyncReference()
+{
+	unsigned long long now = ofxGetTickMicroseconds();
+	unsigned long long reference = 0;
+	for (int i=0;i<actualCameraGridWidth*actualCameraGridHeight;i++)
+	{
+		if (blackCapturingMode[i])
+			continue;
+		unsigned long long timestamp;
+		if (!cameras[i]->peekNewFrameTimestamp(&timestamp))
+			timestamp = cameras[i]->getLatestFrameTimestamp();
+		//camera which is late more than deadline doesn't hold back the others
+		if ((timestamp == 0) || (timestamp + (unsigned long long)syncDeadline * 1000 < now))
+			continue;
+		if ((reference == 0) || (timestamp < reference))
+			reference = timestamp;
+	}
+	return reference;
+}
+
+bool ofxMultiplexer::isNewFrameNearer(int cameraPosition,unsigned long long reference)
+{
+	unsigned long long newTimestamp;
+	if (!cameras[cameraPosition]->peekNewFrameTimestamp(&newTimestamp))
+		return false;
+	unsigned long long usedTimestamp = cameras[cameraPosition]->getLatestFrameTimestamp();
+	if ((reference == 0) || (usedTimestamp == 0))
+		return true;
+	unsigned long long newDistance = newTimestamp > reference ? newTimestamp - reference : reference - newTimestamp;
+	unsigned long long usedDistance = usedTimestamp > reference ? usedTimestamp - reference : reference - usedTimestamp;
+	return newDistance <= usedDistance;
+}
+
+bool ofxMultiplexer::isAnyCameraStreaming()
+{
+	if (cameras == NULL)
+		return false;
+	for (int i=0;i<actualCameraGridWidth*actualCameraGridHeight;i++)
+	{
+		if (!blackCapturingMode[i])
+			return true;
+	}
+	return false;
+}
+
+bool ofxMultiplexer::waitForNewFrame(unsigned int timeout)
+{
+	if (stitchingThreadRunning)
+		return stitchedNotifier.waitFor(&ofxMultiplexer::IsStitchedFrameQueued,this,timeout);
+	return waitForCameraFrames(timeout);
+}
+
+bool ofxMultiplexer::waitForCameraFrames(unsigned int timeout)
+{
+	if (cameras == NULL)
+		return false;
+	//black frame is stitched at once when there is nothing to wait for
+	if (!isAnyCameraStreaming())
+		return true;
+	if (!frameNotifier.waitFor(&ofxMultiplexer::IsAnyCameraFrameReady,this,timeout))
+		return false;
+	//the first new frame starts deadline for the other cameras
+	if (syncPolicy == MULTIPLEXER_SYNC_WAIT)
 	{
-		if (!calibratingMode)
+		if (timeout > 0)
+			frameNotifier.waitFor(&ofxMultiplexer::IsEveryCameraFrameReady,this,syncDeadline);
+		else
 		{
-			#pragma omp parallel num_threads(threadsCount)
+			unsigned int now = ofxGetTickMilliseconds();
+			if (!isSyncWaiting)
 			{
-				#pragma omp for
-				for (int i=0;i<size;i++)
-				{
-					if (cameraMap[1][i] == NULL_CAMERA)
-					{
-						stitchedFrame[i] = cameraFrames[cameraMap[0][i]][offsetMap[cameraMap[0][i]][i]];
-					}
-					else
-					{
-						float result = ((float)cameraFrames[cameraMap[0][i]][offsetMap[cameraMap[0][i]][i]]*weightMap[cameraMap[0][i]][i]) + ((float)cameraFrames[cameraMap[1][i]][offsetMap[cameraMap[1][i]][i]]*weightMap[cameraMap[1][i]][i]);
-						if(cameraMap[2][i]!=NULL_CAMERA)
-							result+=((float)cameraFrames[cameraMap[2][i]][offsetMap[cameraMap[2][i]][i]]*weightMap[cameraMap[2][i]][i]);
-						if(cameraMap[3][i]!=NULL_CAMERA)
-							result+=((float)cameraFrames[cameraMap[3][i]][offsetMap[cameraMap[3][i]][i]]*weightMap[cameraMap[3][i]][i]);
-						if (result>255.0f)
-							result = 255.0f;
-						stitchedFrame[i] = (unsigned char)(result);
-					}
-				}
+				isSyncWaiting = true;
+				syncWaitStartTime = now;
 			}
+			if ((!IsEveryCameraFrameReady(this)) && (now - syncWaitStartTime < syncDeadline))
+				return false;
+			isSyncWaiting = false;
+		}
+	}
+	return true;
+}
+
+void ofxMultiplexer::updateStitchedFrame()
+{
+	if (!stitchingThreadRunning)
+	{
+		stitchFrame(false);
+		return;
+	}
+	//previous latest frame becomes free when it isn't leased
+	stitchedFramesLock.lock();
+	if (stitchedQueueLength > 0)
+	{
+		latestStitchedFrame = stitchedQueue[stitchedQueueFirst];
+		stitchedQueueFirst = (stitchedQueueFirst + 1) % stitchedFramesCount;
+		stitchedQueueLength--;
+	}
+	stitchedFramesLock.unlock();
+	stitchedNotifier.notify();
+}
+
+unsigned char* ofxMultiplexer::getFreeStitchedFrame()
+{
+	if (stitchedFrames == NULL)
+		return NULL;
+	for (int i=1;i<stitchedFramesCount;i++)
+	{
+		int nextFrame = (latestStitchedFrame + i) % stitchedFramesCount;
+		bool isQueued = false;
+		for (int j=0;j<stitchedQueueLength;j++)
+			isQueued |= stitchedQueue[(stitchedQueueFirst + j) % stitchedFramesCount] == nextFrame;
+		if ((stitchedFrameLeases[nextFrame] == 0) && (!isQueued))
+			return stitchedFrames[nextFrame];
+	}
+	return NULL;
+}
+
+void ofxMultiplexer::stitchFrame(bool isQueued)
+{
+	//frame is stitched to ring frame which is neither latest, queued nor leased, it's skipped when there is no such frame
+	stitchedFramesLock.lock();
+	stitchedFrame = NULL;
+	bool isDroppedFrameKept = false;
+	if (isQueued && (stitchedQueueLength >= stitchingQueueDepth))
+	{
+		//full queue drops its oldest frame, it's stitched again
+		int droppedFrame = stitchedQueue[stitchedQueueFirst];
+		stitchedFrame = stitchedFrames[droppedFrame];
+		stitchedQueueFirst = (stitchedQueueFirst + 1) % stitchedFramesCount;
+		stitchedQueueLength--;
+		droppedStitchedFrames++;
+		//its changes are delivered with the next queued frame or with itself
+		if (stitchedQueueLength > 0)
+			mergeDeliveredTiles(droppedFrame,stitchedQueue[stitchedQueueFirst]);
+		else
+			isDroppedFrameKept = true;
+	}
+	else
+		stitchedFrame = getFreeStitchedFrame();
+	stitchedFramesLock.unlock();
+	if (stitchedFrame == NULL)
+		return;
+	bool isRecordingFrames = recorder.isRecording();
+	unsigned long long timestamp = isRecordingFrames ? ofxGetTickMicroseconds() : 0;
+	updateSourceFrames(timestamp);
+	//calibration shows cameras as they are
+	bool isSubtractingBackground = backgroundSubtraction && (!calibratingMode);
+	if (isSubtractingBackground)
+		subtractBackgrounds();
+	else
+		memcpy(remapSources,sourceFrames,actualCameraGridWidth*actualCameraGridHeight * sizeof(unsigned char*));
+	int frameIndex = 0;
+	while (stitchedFrames[frameIndex] != stitchedFrame)
+		frameIndex++;
+	updateUnchangedCameras(frameIndex);
+	int tilesCount = changedTilesWidth * changedTilesHeight;
+	ofxRemapSkip skip = { unchangedCameras, NULL, changedTilesWidth, MULTIPLEXER_CHANGE_TILE_SIZE, actualStitchedFrameWidth };
+	bool isDetectingChanges = (changeThreshold >= 0) && remapProgram.isBuilt();
+	if (isDetectingChanges)
+	{
+		detectChanges();
+		//every ring frame misses changed tiles till it's stitched again
+		for (int i=0;i<stitchedFramesCount;i++)
+		{
+			unsigned char* frameTiles = staleTiles + i * tilesCount;
+			for (int j=0;j<tilesCount;j++)
+				frameTiles[j] |= changedTiles[j];
 		}
+		skip.tiles = staleTiles + frameIndex * tilesCount;
+	}
+	if (isSubtractingBackground && remapProgram.isBuilt())
+		skip.tiles = clearInactiveTiles(frameIndex,skip.tiles);
+	bool isAnyTileStale = true;
+	if (skip.tiles != NULL)
+	{
+		int staleTilesCount = 0;
+		for (int i=0;i<tilesCount;i++)
+			staleTilesCount += skip.tiles[i];
+		isAnyTileStale = staleTilesCount > 0;
+		//walking tiles of runs costs more than it saves when all of them are stale
+		if (staleTilesCount == tilesCount)
+			skip.tiles = NULL;
+	}
+	//ring frame without stale tiles already has content of sources
+	if (isAnyTileStale && calibratingMode)
+		remapProgram.executeCalibration(remapSources,stitchedFrame,&skip);
+	else if (isAnyTileStale)
+		remapProgram.execute(remapSources,stitchedFrame,&skip);
+	if (isDetectingChanges)
+		memset(staleTiles + frameIndex * tilesCount,0,tilesCount * sizeof(unsigned char));
+	if (isRecordingFrames)
+		recorder.pushFrame(stitchedRecordingStream,stitchedFrame,timestamp);
+	stitchedFramesLock.lock();
+	if (isDetectingChanges)
+	{
+		unsigned char* frameTiles = deliveredTiles + frameIndex * tilesCount;
+		for (int i=0;i<tilesCount;i++)
+			frameTiles[i] = isDroppedFrameKept ? (frameTiles[i] | changedTiles[i]) : changedTiles[i];
+	}
+	if (isQueued)
+		stitchedQueue[(stitchedQueueFirst + stitchedQueueLength++) % stitchedFramesCount] = frameIndex;
+	else
+		latestStitchedFrame = frameIndex;
+	stitchedFramesCounter++;
+	stitchedFramesLock.unlock();
+	if (isQueued)
+		stitchedNotifier.notify();
+}
+
+unsigned long long ofxMultiplexer::getSourceIdentity(int cameraPosition)
+{
+	if (sourceFrames[cameraPosition] == cameraFrames[cameraPosition])
+		return MULTIPLEXER_SOURCE_BLACK;
+	unsigned long long timestamp = cameras[cameraPosition]->getLatestFrameTimestamp();
+	return timestamp != 0 ? timestamp : MULTIPLEXER_SOURCE_UNKNOWN;
+}
+
+void ofxMultiplexer::updateUnchangedCameras(int frameIndex)
+{
+	int camerasCount = actualCameraGridWidth*actualCameraGridHeight;
+	unsigned long long* frameSources = stitchedSources + frameIndex * camerasCount;
+	for (int i=0;i<camerasCount;i++)
+	{
+		//paused, missing and slower cameras have the same source as when this ring frame was stitched last time
+		unsigned long long source = getSourceIdentity(i);
+		unchangedCameras[i] = (source != MULTIPLEXER_SOURCE_UNKNOWN) && (frameSources[i] == source);
+		frameSources[i] = source;
+	}
+}
+
+void ofxMultiplexer::invalidateStitchedSources()
+{
+	if (stitchedSources == NULL)
+		return;
+	for (int i=0;i<stitchedFramesCount*actualCameraGridWidth*actualCameraGridHeight;i++)
+		stitchedSources[i] = MULTIPLEXER_SOURCE_UNKNOWN;
+	memset(staleTiles,1,stitchedFramesCount * changedTilesWidth * changedTilesHeight * sizeof(unsigned char));
+	isEveryTileChanged = true;
+	for (int i=0;i<actualCameraGridWidth*actualCameraGridHeight;i++)
+		subtractedSources[i] = MULTIPLEXER_SOURCE_UNKNOWN;
+	memset(clearedTiles,0,stitchedFramesCount * changedTilesWidth * changedTilesHeight * sizeof(unsigned char));
+}
+
+//sum of absolute differences of tile pixels
+static unsigned int getTileDifference(const unsigned char* first,const unsigned char* second,int width,int columns,int rows)
+{
+#if defined(OFX_SSE2)
+	if (columns == MULTIPLEXER_CHANGE_TILE_SIZE)
+	{
+		__m128i sums = _mm_setzero_si128();
+		for (int y=0;y<rows;y++)
+			sums = _mm_add_epi64(sums,_mm_sad_epu8(_mm_loadu_si128((const __m128i*)(first + y * width)),_mm_loadu_si128((const __m128i*)(second + y * width))));
+		return (unsigned int)(_mm_cvtsi128_si32(sums) + _mm_cvtsi128_si32(_mm_srli_si128(sums,8)));
+	}
+#endif
+	unsigned int sum = 0;
+	for (int y=0;y<rows;y++)
+	{
+		for (int x=0;x<columns;x++)
+			sum += abs((int)first[y * width + x] - (int)second[y * width + x]);
+	}
+	return sum;
+}
+
+void ofxMultiplexer::detectRowChanges(int cameraPosition,int tileRow)
+{
+	int width = cameraFramesWidth[cameraPosition];
+	int top = tileRow * MULTIPLEXER_CHANGE_TILE_SIZE;
+	int rows = cameraFramesHeight[cameraPosition] - top < MULTIPLEXER_CHANGE_TILE_SIZE ? cameraFramesHeight[cameraPosition] - top : MULTIPLEXER_CHANGE_TILE_SIZE;
+	unsigned char* tiles = cameraChangedTiles[cameraPosition] + tileRow * cameraTilesWidth[cameraPosition];
+	for (int i=0;i<cameraTilesWidth[cameraPosition];i++)
+	{
+		int left = i * MULTIPLEXER_CHANGE_TILE_SIZE;
+		int columns = width - left < MULTIPLEXER_CHANGE_TILE_SIZE ? width - left : MULTIPLEXER_CHANGE_TILE_SIZE;
+		const unsigned char* source = remapSources[cameraPosition] + top * width + left;
+		unsigned char* reference = referenceFrames[cameraPosition] + top * width + left;
+		//reference keeps content of tile from its last change, so slow drift is found too
+		tiles[i] = getTileDifference(source,reference,width,columns,rows) > (unsigned int)(changeThreshold * columns * rows) ? 1 : 0;
+		if (tiles[i] == 0)
+			continue;
+		for (int y=0;y<rows;y++)
+			memcpy(reference + y * width,source + y * width,columns * sizeof(unsigned char));
+	}
+}
+
+void ofxMultiplexer::DetectCameraChanges(void* instance,int first,int last,int /*participant*/)
+{
+	ofxMultiplexer *pThis = (ofxMultiplexer*)instance;
+	int camera = 0;
+	for (int i=first;i<last;i++)
+	{
+		while (i >= pThis->cameraFirstTileRows[camera + 1])
+			camera++;
+		pThis->detectRowChanges(camera,i - pThis->cameraFirstTileRows[camera]);
+	}
+}
+
+void ofxMultiplexer::detectChanges()
+{
+	int camerasCount = actualCameraGridWidth*actualCameraGridHeight;
+	//camera with the same source as in the last comparison has no changes
+	int rowsCount = 0;
+	for (int i=0;i<camerasCount;i++)
+	{
+		unsigned long long source = getSourceIdentity(i);
+		cameraFirstTileRows[i] = rowsCount;
+		if ((source == MULTIPLEXER_SOURCE_UNKNOWN) || (source != referenceSources[i]))
+			rowsCount += cameraTilesHeight[i];
 		else
+			memset(cameraChangedTiles[i],0,cameraTilesWidth[i] * cameraTilesHeight[i] * sizeof(unsigned char));
+		referenceSources[i] = source;
+	}
+	cameraFirstTileRows[camerasCount] = rowsCount;
+	ofxThreadPool::getShared()->parallelFor(rowsCount,1,&ofxMultiplexer::DetectCameraChanges,this);
+	if (isEveryTileChanged)
+	{
+		memset(changedTiles,1,changedTilesWidth * changedTilesHeight * sizeof(unsigned char));
+		isEveryTileChanged = false;
+		return;
+	}
+	mapCameraTiles(cameraChangedTiles,changedTiles);
+}
+
+void ofxMultiplexer::updateTileSources()
+{
+	if (isTileSourcesValid)
+		return;
+	remapProgram.getTileSources(actualStitchedFrameWidth,MULTIPLEXER_CHANGE_TILE_SIZE,changedTilesWidth,changedTilesHeight,tileSources);
+	isTileSourcesValid = true;
+}
+
+void ofxMultiplexer::mapCameraTiles(unsigned char** cameraTiles,unsigned char* tiles)
+{
+	updateTileSources();
+	int camerasCount = actualCameraGridWidth*actualCameraGridHeight;
+	for (int i=0;i<changedTilesWidth*changedTilesHeight;i++)
+	{
+		bool isFlagged = false;
+		for (int j=0;(j<camerasCount) && (!isFlagged);j++)
 		{
-			#pragma omp parallel num_threads(threadsCount)
+			const short* bounds = tileSources + (i * camerasCount + j) * 4;
+			for (int y=bounds[1];(y<=bounds[3]) && (!isFlagged);y++)
 			{
-				#pragma omp for
-				for (int i=0;i<size;i++)
-				{
-					if (cameraMap[1][i] == NULL_CAMERA)
-					{
-						stitchedFrame[i] = cameraFrames[cameraMap[0][i]][offsetMap[cameraMap[0][i]][i]];
-					}
-					else
-					{
-						unsigned char result = 0;
-						for (int j=0;j<4;j++)
-						{
-							if ((cameraMap[j][i] != NULL_CAMERA)&& (cameraFrames[cameraMap[j][i]][offsetMap[cameraMap[j][i]][i]]!=0))
-								result = cameraFrames[cameraMap[j][i]][offsetMap[cameraMap[j][i]][i]];
-						}
-						stitchedFrame[i] = result;
-					}
-				}
+				for (int x=bounds[0];x<=bounds[2];x++)
+					isFlagged |= cameraTiles[j][y * cameraTilesWidth[j] + x] != 0;
 			}
 		}
+		tiles[i] = isFlagged ? 1 : 0;
 	}
-	else
+}
+
+//subtracts background from tile of frame, returns its brightest subtracted pixel
+static unsigned char subtractTile(const unsigned char* source,const unsigned char* background,unsigned char* subtracted,int width,int columns,int rows,bool isTrackDark)
+{
+#if defined(OFX_SSE2)
+	if (columns == MULTIPLEXER_CHANGE_TILE_SIZE)
+	{
+		__m128i maximum = _mm_setzero_si128();
+		for (int y=0;y<rows;y++)
+		{
+			__m128i sourcePixels = _mm_loadu_si128((const __m128i*)(source + y * width));
+			__m128i backgroundPixels = _mm_loadu_si128((const __m128i*)(background + y * width));
+			__m128i pixels = isTrackDark ? _mm_subs_epu8(backgroundPixels,sourcePixels) : _mm_subs_epu8(sourcePixels,backgroundPixels);
+			_mm_storeu_si128((__m128i*)(subtracted + y * width),pixels);
+			maximum = _mm_max_epu8(maximum,pixels);
+		}
+		maximum = _mm_max_epu8(maximum,_mm_srli_si128(maximum,8));
+		maximum = _mm_max_epu8(maximum,_mm_srli_si128(maximum,4));
+		maximum = _mm_max_epu8(maximum,_mm_srli_si128(maximum,2));
+		maximum = _mm_max_epu8(maximum,_mm_srli_si128(maximum,1));
+		return (unsigned char)(_mm_cvtsi128_si32(maximum) & 0xFF);
+	}
+#endif
+	unsigned char maximum = 0;
+	for (int y=0;y<rows;y++)
+	{
+		for (int x=0;x<columns;x++)
+		{
+			int pixel = isTrackDark ? (int)background[y * width + x] - (int)source[y * width + x] : (int)source[y * width + x] - (int)background[y * width + x];
+			subtracted[y * width + x] = pixel > 0 ? (unsigned char)pixel : 0;
+			if (subtracted[y * width + x] > maximum)
+				maximum = subtracted[y * width + x];
+		}
+	}
+	return maximum;
+}
+
+void ofxMultiplexer::subtractRowBackground(int cameraPosition,int tileRow)
+{
+	int width = cameraFramesWidth[cameraPosition];
+	int top = tileRow * MULTIPLEXER_CHANGE_TILE_SIZE;
+	int rows = cameraFramesHeight[cameraPosition] - top < MULTIPLEXER_CHANGE_TILE_SIZE ? cameraFramesHeight[cameraPosition] - top : MULTIPLEXER_CHANGE_TILE_SIZE;
+	const unsigned char* source = sourceFrames[cameraPosition] + top * width;
+	unsigned char* background = backgroundFrames[cameraPosition] + top * width;
+	//dynamic background follows every new frame before it's subtracted, as ProcessFilters does
+	if (backgroundLearnRate > 0.0f)
+		backgroundModels[cameraPosition].updateRows(sourceFrames[cameraPosition],width,backgroundFrames[cameraPosition],width,backgroundLearnRate,top,rows);
+	unsigned char* tiles = cameraActiveTiles[cameraPosition] + tileRow * cameraTilesWidth[cameraPosition];
+	for (int i=0;i<cameraTilesWidth[cameraPosition];i++)
+	{
+		int left = i * MULTIPLEXER_CHANGE_TILE_SIZE;
+		int columns = width - left < MULTIPLEXER_CHANGE_TILE_SIZE ? width - left : MULTIPLEXER_CHANGE_TILE_SIZE;
+		unsigned char maximum = subtractTile(source + left,background + left,subtractedFrames[cameraPosition] + top * width + left,width,columns,rows,backgroundTrackDark);
+		tiles[i] = maximum > backgroundNoiseFloor ? 1 : 0;
+	}
+}
+
+void ofxMultiplexer::SubtractCameraBackgrounds(void* instance,int first,int last,int /*participant*/)
+{
+	ofxMultiplexer *pThis = (ofxMultiplexer*)instance;
+	int camera = 0;
+	for (int i=first;i<last;i++)
+	{
+		while (i >= pThis->cameraFirstTileRows[camera + 1])
+			camera++;
+		pThis->subtractRowBackground(camera,i - pThis->cameraFirstTileRows[camera]);
+	}
+}
+
+void ofxMultiplexer::subtractBackgrounds()
+{
+	int camerasCount = actualCameraGridWidth*actualCameraGridHeight;
+	if (isBackgroundLearning)
+	{
+		for (int i=0;i<camerasCount;i++)
+		{
+			if (sourceFrames[i] == cameraFrames[i])
+				continue;
+			backgroundModels[i].learn(sourceFrames[i],cameraFramesWidth[i],backgroundFrames[i],cameraFramesWidth[i]);
+		}
+		isBackgroundLearning = false;
+		//every camera region is subtracted and stitched again
+		invalidateStitchedSources();
+	}
+	//camera with the same source as in the last subtraction keeps its subtracted frame, black camera stays black
+	int rowsCount = 0;
+	for (int i=0;i<camerasCount;i++)
+	{
+		unsigned long long source = getSourceIdentity(i);
+		cameraFirstTileRows[i] = rowsCount;
+		if (source == MULTIPLEXER_SOURCE_BLACK)
+		{
+			remapSources[i] = cameraFrames[i];
+			memset(cameraActiveTiles[i],0,cameraTilesWidth[i] * cameraTilesHeight[i] * sizeof(unsigned char));
+		}
+		else
+		{
+			remapSources[i] = subtractedFrames[i];
+			if ((source == MULTIPLEXER_SOURCE_UNKNOWN) || (source != subtractedSources[i]))
+				rowsCount += cameraTilesHeight[i];
+		}
+		subtractedSources[i] = source;
+	}
+	cameraFirstTileRows[camerasCount] = rowsCount;
+	ofxThreadPool::getShared()->parallelFor(rowsCount,1,&ofxMultiplexer::SubtractCameraBackgrounds,this);
+}
+
+const unsigned char* ofxMultiplexer::clearInactiveTiles(int frameIndex,const unsigned char* frameStaleTiles)
+{
+	mapCameraTiles(cameraActiveTiles,activeTiles);
+	unsigned char* frameClearedTiles = clearedTiles + frameIndex * changedTilesWidth * changedTilesHeight;
+	for (int i=0;i<changedTilesWidth*changedTilesHeight;i++)
+	{
+		bool isStale = (frameStaleTiles == NULL) || (frameStaleTiles[i] != 0);
+		foregroundTiles[i] = (isStale && (activeTiles[i] != 0)) ? 1 : 0;
+		if (foregroundTiles[i] != 0)
+			frameClearedTiles[i] = 0;
+		if ((!isStale) || (activeTiles[i] != 0) || (frameClearedTiles[i] != 0))
+			continue;
+		frameClearedTiles[i] = 1;
+		//remap would give pixels at noise floor or below, cleared tile is the same within it
+		int left = (i % changedTilesWidth) * MULTIPLEXER_CHANGE_TILE_SIZE;
+		int top = (i / changedTilesWidth) * MULTIPLEXER_CHANGE_TILE_SIZE;
+		int columns = actualStitchedFrameWidth - left < MULTIPLEXER_CHANGE_TILE_SIZE ? actualStitchedFrameWidth - left : MULTIPLEXER_CHANGE_TILE_SIZE;
+		int rows = actualStitchedFrameHeight - top < MULTIPLEXER_CHANGE_TILE_SIZE ? actualStitchedFrameHeight - top : MULTIPLEXER_CHANGE_TILE_SIZE;
+		for (int y=0;y<rows;y++)
+			memset(stitchedFrame + (top + y) * actualStitchedFrameWidth + left,0,columns * sizeof(unsigned char));
+	}
+	return foregroundTiles;
+}
+
+void ofxMultiplexer::mergeDeliveredTiles(int fromFrame,int toFrame)
+{
+	if (deliveredTiles == NULL)
+		return;
+	int tilesCount = changedTilesWidth * changedTilesHeight;
+	for (int i=0;i<tilesCount;i++)
+		deliveredTiles[toFrame * tilesCount + i] |= deliveredTiles[fromFrame * tilesCount + i];
+}
+
+void ofxMultiplexer::setChangeThreshold(int threshold)
+{
+	stitchingLock.lock();
+	//tiles skipped while detection was off aren't known
+	if ((threshold >= 0) && (changeThreshold < 0))
+		invalidateStitchedSources();
+	changeThreshold = threshold;
+	stitchingLock.unlock();
+}
+
+void ofxMultiplexer::setBackgroundSubtraction(bool isEnabled)
+{
+	if (backgroundSubtraction == isEnabled)
+		return;
+	stitchingLock.lock();
+	//stitched frames hold the other kind of content
+	invalidateStitchedSources();
+	backgroundSubtraction = isEnabled;
+	stitchingLock.unlock();
+}
+
+void ofxMultiplexer::learnBackground()
+{
+	stitchingLock.lock();
+	isBackgroundLearning = true;
+	stitchingLock.unlock();
+}
+
+void ofxMultiplexer::setBackgroundLearnRate(float rate)
+{
+	if (backgroundLearnRate == rate)
+		return;
+	stitchingLock.lock();
+	backgroundLearnRate = rate;
+	stitchingLock.unlock();
+}
+
+void ofxMultiplexer::setBackgroundFreeze(const int* rectangles,int count)
+{
+	stitchingLock.lock();
+	if (backgroundModels != NULL)
 	{
-		#pragma omp parallel num_threads(threadsCount)
+		for (int i=0;i<actualCameraGridWidth*actualCameraGridHeight;i++)
 		{
-			#pragma omp for
-			for (int i=0;i<size;i++)
+			backgroundModels[i].clearFreeze();
+			if ((cameraMeshes == NULL) || (!cameraMeshes[i].isBuilt()))
+				continue;
+			for (int j=0;j<count;j++)
 			{
-				stitchedFrame[i] = cameraFrames[cameraMap[0][i]][offsetMap[cameraMap[0][i]][i]];
+				const int* rectangle = rectangles + j * 4;
+				int left,top,right,bottom;
+				if (cameraMeshes[i].getCameraBounds(rectangle[0],rectangle[1],rectangle[2],rectangle[3],&left,&top,&right,&bottom))
+					backgroundModels[i].freeze(left,top,right - left + 1,bottom - top + 1);
 			}
 		}
 	}
+	stitchingLock.unlock();
+}
+
+void ofxMultiplexer::setBackgroundTrackDark(bool isTrackDark)
+{
+	if (backgroundTrackDark == isTrackDark)
+		return;
+	stitchingLock.lock();
+	invalidateStitchedSources();
+	backgroundTrackDark = isTrackDark;
+	stitchingLock.unlock();
+}
+
+void ofxMultiplexer::setBackgroundNoiseFloor(int noiseFloor)
+{
+	if (backgroundNoiseFloor == noiseFloor)
+		return;
+	stitchingLock.lock();
+	invalidateStitchedSources();
+	backgroundNoiseFloor = noiseFloor;
+	stitchingLock.unlock();
+}
+
+const unsigned char* ofxMultiplexer::getChangedTiles(int* tilesWidth,int* tilesHeight)
+{
+	*tilesWidth = changedTilesWidth;
+	*tilesHeight = changedTilesHeight;
+	if ((changeThreshold < 0) || (deliveredTiles == NULL))
+		return NULL;
+	return deliveredTiles + latestStitchedFrame * changedTilesWidth * changedTilesHeight;
+}
+
+void ofxMultiplexer::StitchingThread(void* instance)
+{
+	ofxMultiplexer *pThis = (ofxMultiplexer*)instance;
+	while (pThis->stitchingThreadRunning)
+	{
+		//full queue is kept till consumer takes a frame
+		if ((pThis->dropPolicy == MULTIPLEXER_DROP_NEWEST) && (!pThis->stitchedNotifier.waitFor(&ofxMultiplexer::IsStitchingQueueFree,pThis,MULTIPLEXER_STITCHING_TIMEOUT)))
+			continue;
+		bool isStreaming = pThis->isAnyCameraStreaming();
+		if ((!pThis->waitForCameraFrames(MULTIPLEXER_STITCHING_TIMEOUT)) || (!pThis->stitchingThreadRunning))
+			continue;
+		pThis->stitchingLock.lock();
+		pThis->stitchFrame(true);
+		pThis->stitchingLock.unlock();
+		//there are no camera frames to wait for, black frame is stitched again after timeout
+		if (!isStreaming)
+			ofxSleepMilliseconds(MULTIPLEXER_STITCHING_TIMEOUT);
+	}
+}
+
+bool ofxMultiplexer::IsStitchedFrameQueued(void* instance)
+{
+	ofxMultiplexer *pThis = (ofxMultiplexer*)instance;
+	pThis->stitchedFramesLock.lock();
+	bool isQueued = pThis->stitchedQueueLength > 0;
+	pThis->stitchedFramesLock.unlock();
+	return isQueued;
+}
+
+bool ofxMultiplexer::IsStitchingQueueFree(void* instance)
+{
+	ofxMultiplexer *pThis = (ofxMultiplexer*)instance;
+	pThis->stitchedFramesLock.lock();
+	bool isFree = pThis->stitchedQueueLength < pThis->stitchingQueueDepth;
+	pThis->stitchedFramesLock.unlock();
+	return isFree || (!pThis->stitchingThreadRunning);
+}
+
+void ofxMultiplexer::startStitchingThread()
+{
+	if (stitchingThreadRunning || (!stitchingThreadEnabled) || (stitchingQueueDepth <= 0) || (stitchedFrames == NULL))
+		return;
+	stitchingThreadRunning = true;
+	stitchingThread.start(&ofxMultiplexer::StitchingThread,this);
+}
+
+void ofxMultiplexer::stopStitchingThread()
+{
+	if (!stitchingThreadRunning)
+		return;
+	stitchingThreadRunning = false;
+	stitchedNotifier.notify();
+	stitchingThread.join();
+	//queue isn't taken anymore, consumer keeps the newest stitched frame
+	stitchedFramesLock.lock();
+	if (stitchedQueueLength > 0)
+	{
+		latestStitchedFrame = stitchedQueue[(stitchedQueueFirst + stitchedQueueLength - 1) % stitchedFramesCount];
+		for (int i=0;i<stitchedQueueLength-1;i++)
+			mergeDeliveredTiles(stitchedQueue[(stitchedQueueFirst + i) % stitchedFramesCount],latestStitchedFrame);
+	}
+	stitchedQueueLength = 0;
+	stitchedFramesLock.unlock();
+}
+
+void ofxMultiplexer::setStitchingQueue(int depth,MULTIPLEXER_DROP_POLICY policy)
+{
+	stitchingQueueDepth = depth > 0 ? depth : 0;
+	dropPolicy = policy;
+}
+
+void ofxMultiplexer::getStitchingQueue(int* depth,MULTIPLEXER_DROP_POLICY* policy)
+{
+	*depth = stitchingQueueDepth;
+	*policy = dropPolicy;
+}
+
+void ofxMultiplexer::setStitchingThreadEnabled(bool isEnabled)
+{
+	stitchingThreadEnabled = isEnabled;
+	if (isEnabled)
+		startStitchingThread();
+	else
+		stopStitchingThread();
+}
+
+void ofxMultiplexer::getStitchingStatistics(unsigned int* stitchedFrames,unsigned int* droppedFrames)
+{
+	stitchedFramesLock.lock();
+	*stitchedFrames = stitchedFramesCounter;
+	*droppedFrames = droppedStitchedFrames;
+	stitchedFramesLock.unlock();
+}
+
+void ofxMultiplexer::updateSourceFrames(unsigned long long timestamp)
+{
+	bool isRecordingFrames = recorder.isRecording();
+	bool isNearestSync = syncPolicy == MULTIPLEXER_SYNC_NEAREST;
+	unsigned long long reference = isNearestSync ? getSyncReference() : 0;
+	for (int i=0;i<actualCameraGridWidth*actualCameraGridHeight;i++)
+	{	
+		//frame being stitched is kept when new one is farther from reference (camera read slot stays the same)
+		if (isNearestSync && (!blackCapturingMode[i]) && (sourceFrames[i] != cameraFrames[i]) && (!isNewFrameNearer(i,reference)))
+			continue;
+		bool isNewFrame = isRecordingFrames && (!blackCapturingMode[i]) && cameras[i]->isCapturedNewFrame();
+		sourceFrames[i] = blackCapturingMode[i] ? NULL : cameras[i]->getLatestCameraFrame();
+		//black frame is cleared once by initializeMultiplexer, nothing writes to it
+		if (sourceFrames[i] == NULL)
+			sourceFrames[i] = cameraFrames[i];
+		//recorder copies frame to its own slot, writing is done by recorder thread
+		else if (isNewFrame)
+			recorder.pushFrame(recordingStreams[i],sourceFrames[i],timestamp);
+	}
+	updateSkewStatistics();
+}
+
+void ofxMultiplexer::updateSkewStatistics()
+{
+	unsigned long long newestTimestamp = 0;
+	for (int i=0;i<actualCameraGridWidth*actualCameraGridHeight;i++)
+	{
+		if ((sourceFrames[i] != cameraFrames[i]) && (cameras[i]->getLatestFrameTimestamp() > newestTimestamp))
+			newestTimestamp = cameras[i]->getLatestFrameTimestamp();
+	}
+	for (int i=0;i<actualCameraGridWidth*actualCameraGridHeight;i++)
+	{
+		unsigned long long timestamp = sourceFrames[i] != cameraFrames[i] ? cameras[i]->getLatestFrameTimestamp() : 0;
+		if (timestamp == 0)
+			continue;
+		ofxCameraSkew* skew = &cameraSkews[i];
+		skew->last = newestTimestamp - timestamp;
+		skew->total += skew->last;
+		if (skew->last > skew->max)
+			skew->max = skew->last;
+		skew->framesCount++;
+	}
+}
+
+void ofxMultiplexer::setSyncPolicy(MULTIPLEXER_SYNC_POLICY policy,unsigned int deadline)
+{
+	syncPolicy = policy;
+	syncDeadline = deadline;
+}
+
+void ofxMultiplexer::getSyncPolicy(MULTIPLEXER_SYNC_POLICY* policy,unsigned int* deadline)
+{
+	*policy = syncPolicy;
+	*deadline = syncDeadline;
+}
+
+void ofxMultiplexer::getCameraSkew(int cameraPosition,unsigned int* lastSkew,unsigned int* averageSkew,unsigned int* maxSkew)
+{
+	*lastSkew = *averageSkew = *maxSkew = 0;
+	if ((cameraSkews == NULL) || (cameraSkews[cameraPosition].framesCount == 0))
+		return;
+	*lastSkew = (unsigned int)cameraSkews[cameraPosition].last;
+	*averageSkew = (unsigned int)(cameraSkews[cameraPosition].total / cameraSkews[cameraPosition].framesCount);
+	*maxSkew = (unsigned int)cameraSkews[cameraPosition].max;
+}
+
+void ofxMultiplexer::resetSkewStatistics()
+{
+	if (cameraSkews != NULL)
+		memset((void*)cameraSkews,0,actualCameraGridWidth*actualCameraGridHeight * sizeof(ofxCameraSkew));
+}
+
+void ofxMultiplexer::updateCameraFrames()
+{
+	if (cameras == NULL)
+		return;
+	updateSourceFrames(recorder.isRecording() ? ofxGetTickMicroseconds() : 0);
+}
+
+const unsigned char* ofxMultiplexer::getCameraFrame(int cameraPosition,int* width,int* height)
+{
+	*width = cameraFramesWidth[cameraPosition];
+	*height = cameraFramesHeight[cameraPosition];
+	return sourceFrames[cameraPosition];
+}
+
+ofxCalibrationMesh* ofxMultiplexer::getCameraMesh(int cameraPosition)
+{
+	if ((cameraMeshes == NULL) || (!cameraMeshes[cameraPosition].isBuilt()))
+		return NULL;
+	return &cameraMeshes[cameraPosition];
+}
+
+void ofxMultiplexer::remapFrames(unsigned char** frames,unsigned char* frameData)
+{
+	remapProgram.execute(frames,frameData,NULL);
+}
+
+bool ofxMultiplexer::startRecording(const std::string& fileName,int slotsCount)
+{
+	if ((cameras == NULL) || recorder.isRecording())
+		return false;
+	//stitching thread pushes frames to recording streams, they are set up while it waits
+	stitchingLock.lock();
+	recordingStreams = (int*)malloc(actualCameraGridWidth*actualCameraGridHeight*sizeof(int));
+	for (int i=0;i<actualCameraGridWidth*actualCameraGridHeight;i++)
+		recordingStreams[i] = cameras[i] != NULL ? recorder.addStream(cameras[i]->getCameraGUID(),cameraFramesWidth[i],cameraFramesHeight[i],1,RAW_STREAM_CAMERA) : -1;
+	GUID stitchedGUID;
+	memset((void*)&stitchedGUID,0,sizeof(GUID));
+	stitchedRecordingStream = recorder.addStream(stitchedGUID,actualStitchedFrameWidth,actualStitchedFrameHeight,1,RAW_STREAM_STITCHED);
+	bool isStarted = recorder.start(fileName,slotsCount);
+	stitchingLock.unlock();
+	if (!isStarted)
+	{
+		stopRecording();
+		return false;
+	}
+	return true;
+}
+
+void ofxMultiplexer::stopRecording()
+{
+	stitchingLock.lock();
+	recorder.stop();
+	if (recordingStreams != NULL)
+		free(recordingStreams);
+	recordingStreams = NULL;
+	stitchedRecordingStream = -1;
+	stitchingLock.unlock();
+}
+
+void ofxMultiplexer::getRecordingStatistics(unsigned int* writtenFrames,unsigned int* droppedFrames)
+{
+	*writtenFrames = recorder.getWrittenFramesCount();
+	*droppedFrames = recorder.getDroppedFramesCount();
 }
 
 void ofxMultiplexer::getStitchedFrame(int* width,int* height,unsigned char* frameData)
 {
 	*width = actualStitchedFrameWidth;
 	*height = actualStitchedFrameHeight;
-	memcpy(frameData,stitchedFrame,actualStitchedFrameWidth*actualStitchedFrameHeight*sizeof(unsigned char));
+	const unsigned char* latestFrame = leaseStitchedFrame(width,height);
+	if (latestFrame != NULL)
+		memcpy(frameData,latestFrame,actualStitchedFrameWidth*actualStitchedFrameHeight*sizeof(unsigned char));
+	releaseStitchedFrame(latestFrame);
+}
+
+const unsigned char* ofxMultiplexer::leaseStitchedFrame(int* width,int* height)
+{
+	*width = actualStitchedFrameWidth;
+	*height = actualStitchedFrameHeight;
+	stitchedFramesLock.lock();
+	unsigned char* latestFrame = stitchedFrames != NULL ? stitchedFrames[latestStitchedFrame] : NULL;
+	if (latestFrame != NULL)
+		stitchedFrameLeases[latestStitchedFrame]++;
+	stitchedFramesLock.unlock();
+	return latestFrame;
+}
+
+void ofxMultiplexer::releaseStitchedFrame(const unsigned char* frameData)
+{
+	if (frameData == NULL)
+		return;
+	stitchedFramesLock.lock();
+	for (int i=0;i<stitchedFramesCount;i++)
+	{
+		if ((stitchedFrames[i] == frameData) && (stitchedFrameLeases[i] > 0))
+			stitchedFrameLeases[i]--;
+	}
+	stitchedFramesLock.unlock();
 }
 
 void ofxMultiplexer::setCameraGridSize(int width,int height)
@@ -395,29 +1373,171 @@ void ofxMultiplexer::getStitchedFrameSize(int* width,int* height)
 
 void ofxMultiplexer::computeDistortion()
 {
+	int cameraCount = actualCameraGridWidth*actualCameraGridHeight;
+	//meshes are kept for updates of calibration points
+	if (cameraMeshes != NULL)
+		delete[] cameraMeshes;
+	cameraMeshes = new ofxCalibrationMesh[cameraCount];
+	unsigned long long key = computeRemapKey();
+	if (loadRemapCache(key))
+		return;
+	int size = actualStitchedFrameWidth*actualStitchedFrameHeight;
+	//records are needed only till they are compiled to remap program
+	remapRecords = (ofxRemapRecord*)malloc(size * sizeof(ofxRemapRecord));
 	computeCameraMaps();
-	for (int i=0;i<actualCameraGridWidth*actualCameraGridHeight;i++)
+	int* origins = (int*)malloc(cameraCount * 2 * sizeof(int));
+	for (int i=0;i<cameraCount;i++)
 	{
-		vector2df* calibrations = (vector2df*)malloc((actualCalibrationGridWidth+1)*(actualCalibrationGridHeight+1)*sizeof(vector2df));
-		for (int j=0;j<(actualCalibrationGridWidth+1)*(actualCalibrationGridHeight+1);j++)
-		{
-			calibrations[j].X = cameraCalibrationPoints[i][j].X;
-			calibrations[j].Y = cameraCalibrationPoints[i][j].Y;
-		}
-		computeOffsetMap(offsetMap[i],calibrations,i);
-		computeWeightMap(weightMap[i],calibrations,i);
-		free(calibrations);
+		getCameraOrigin(i,&origins[i * 2],&origins[i * 2 + 1]);
+		computeCameraMesh(i,origins[i * 2],origins[i * 2 + 1]);
+		computeOffsetMap(i);
+		computeWeightMap(i);
+	}
+	remapProgram.build(remapRecords,size,interleaveMode,bilinearMode,cameraFramesWidth,cameraCount);
+	printRemapStatistics();
+	free(remapRecords);
+	remapRecords = NULL;
+	saveRemapCache(key,origins);
+	free(origins);
+}
+
+//64 bit FNV-1a
+static unsigned long long hashBytes(unsigned long long hash,const void* data,unsigned int size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (unsigned int i=0;i<size;i++)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001B3ULL;
+	}
+	return hash;
+}
+
+unsigned long long ofxMultiplexer::computeRemapKey()
+{
+	int cameraCount = actualCameraGridWidth*actualCameraGridHeight;
+	int parameters[10] = { REMAP_CACHE_VERSION, actualStitchedFrameWidth, actualStitchedFrameHeight, actualCameraGridWidth, actualCameraGridHeight,
+		actualCalibrationGridWidth, actualCalibrationGridHeight, interleaveMode ? 1 : 0, bilinearMode ? 1 : 0, (int)sizeof(ofxRemapRun) };
+	unsigned long long key = hashBytes(0xCBF29CE484222325ULL,parameters,sizeof(parameters));
+	for (int i=0;i<cameraCount;i++)
+	{
+		int frameSize[2] = { cameraFramesWidth[i], cameraFramesHeight[i] };
+		key = hashBytes(key,frameSize,sizeof(frameSize));
+		key = hashBytes(key,cameraCalibrationPoints[i],(actualCalibrationGridWidth+1)*(actualCalibrationGridHeight+1)*sizeof(vector2df));
+	}
+	return key;
+}
+
+bool ofxMultiplexer::loadRemapCache(unsigned long long key)
+{
+	if (remapCacheFileName.empty())
+		return false;
+	ofxMappedFile file;
+	if (!file.openForReading(remapCacheFileName))
+		return false;
+	int cameraCount = actualCameraGridWidth*actualCameraGridHeight;
+	unsigned long long originsSize = cameraCount * 2 * sizeof(int);
+	ofxRemapCacheHeader header;
+	if (file.getSize() < sizeof(header))
+		return false;
+	memcpy(&header,file.getData(),sizeof(header));
+	if ((header.magic != REMAP_CACHE_MAGIC) || (header.version != REMAP_CACHE_VERSION) || (header.key != key) ||
+		(header.camerasCount != cameraCount) || (file.getSize() != sizeof(header) + originsSize + header.programSize))
+		return false;
+	bool isLoaded = remapProgram.deserialize(file.getData() + sizeof(header) + originsSize,header.programSize,actualStitchedFrameWidth*actualStitchedFrameHeight,cameraFramesWidth,cameraFramesHeight,cameraCount);
+	if (!isLoaded)
+		return false;
+	const int* origins = (const int*)(file.getData() + sizeof(header));
+	for (int i=0;i<cameraCount;i++)
+		computeCameraMesh(i,origins[i * 2],origins[i * 2 + 1]);
+	printf("Remap table: %u KB in %d runs loaded from %s\n",remapProgram.getFootprint() / 1024,remapProgram.getRunsCount(),remapCacheFileName.c_str());
+	return true;
+}
+
+void ofxMultiplexer::saveRemapCache(unsigned long long key,const int* origins)
+{
+	if (remapCacheFileName.empty())
+		return;
+	int cameraCount = actualCameraGridWidth*actualCameraGridHeight;
+	ofxRemapCacheHeader header;
+	header.magic = REMAP_CACHE_MAGIC;
+	header.version = REMAP_CACHE_VERSION;
+	header.key = key;
+	header.camerasCount = cameraCount;
+	header.programSize = remapProgram.getSerializedSize();
+	unsigned int originsSize = cameraCount * 2 * sizeof(int);
+	unsigned int fileSize = sizeof(header) + originsSize + header.programSize;
+	ofxMappedFile file;
+	unsigned char* data = file.openForWriting(remapCacheFileName) ? file.mapRegion(0,fileSize) : NULL;
+	if (data == NULL)
+	{
+		printf("Remap table: can't write %s\n",remapCacheFileName.c_str());
+		return;
 	}
+	memcpy(data,&header,sizeof(header));
+	memcpy(data + sizeof(header),origins,originsSize);
+	remapProgram.serialize(data + sizeof(header) + originsSize);
+	file.truncate(fileSize);
+	file.close();
+}
+
+void ofxMultiplexer::printRemapStatistics()
+{
+	int size = actualStitchedFrameWidth*actualStitchedFrameHeight;
+	int cameraCount = actualCameraGridWidth*actualCameraGridHeight;
+	//camera map planes and offset and weight maps of every camera which were kept before
+	unsigned long long mapsSize = (unsigned long long)size * (4 * sizeof(unsigned char) + cameraCount * (sizeof(unsigned int) + sizeof(float)));
+	//bytes of these maps read by stitching of one frame: camera planes and offset (and weight if blended) of each source
+	unsigned long long mapsStreamed = 0;
+	for (int i=0;i<size;i++)
+	{
+		int count = 0;
+		while ((count < REMAP_MAX_SOURCES) && (remapRecords[i].cameras[count] != NULL_CAMERA))
+			count++;
+		if ((!interleaveMode) || (count <= 1))
+			mapsStreamed += (interleaveMode ? 2 : 1) * sizeof(unsigned char) + sizeof(unsigned int);
+		else
+			mapsStreamed += 4 * sizeof(unsigned char) + count * (sizeof(unsigned int) + sizeof(float));
+	}
+	unsigned long long programSize = remapProgram.getFootprint();
+	//maps and program are read sequentially, so each cache line of them is filled once per frame
+	long long savedLines = ((long long)mapsStreamed - (long long)programSize) / 64;
+	printf("Remap table: %llu KB in %d runs, %d blended pixels (maps took %llu KB, %llu KB read per frame)\n",programSize / 1024,remapProgram.getRunsCount(),remapProgram.getBlendedPixelsCount(),mapsSize / 1024,mapsStreamed / 1024);
+	printf("Remap table: about %lld cache line fills less per stitched frame\n",savedLines);
+}
+
+int ofxMultiplexer::getRecordSlot(int pixel,int camera)
+{
+	for (int i=0;i<REMAP_MAX_SOURCES;i++)
+	{
+		if (remapRecords[pixel].cameras[i] == camera)
+			return i;
+	}
+	return -1;
+}
+
+float ofxMultiplexer::getRecordWeight(int pixel,int camera)
+{
+	int slot = getRecordSlot(pixel,camera);
+	return slot >= 0 ? remapRecords[pixel].weights[slot] : 0.0f;
+}
+
+void ofxMultiplexer::setRecordWeight(int pixel,int camera,float weight)
+{
+	int slot = getRecordSlot(pixel,camera);
+	if (slot >= 0)
+		remapRecords[pixel].weights[slot] = weight;
 }
 
 void ofxMultiplexer::computeCameraMaps()
 {
-	if (cameraMap == NULL)
+	if (remapRecords == NULL)
 		return;
 	int size = actualStitchedFrameWidth*actualStitchedFrameHeight;
 	int cameraCount = actualCameraGridWidth * actualCameraGridHeight;
-	for (int i=0;i<4;i++)
-		memset(cameraMap[i],NULL_CAMERA,actualStitchedFrameWidth*actualStitchedFrameHeight*sizeof(unsigned char));
+	memset((void*)remapRecords,0,size*sizeof(ofxRemapRecord));
+	for (int i=0;i<size;i++)
+		memset(remapRecords[i].cameras,NULL_CAMERA,REMAP_MAX_SOURCES*sizeof(unsigned char));
 	if (interleaveMode)
 	{
 		int globalCalibrationGridWidth = actualCalibrationGridWidth * actualCameraGridWidth - actualCameraGridWidth + 1;
@@ -440,9 +1560,10 @@ void ofxMultiplexer::computeCameraMaps()
 				{
 					for (int k=0;k<4;k++)
 					{
-						if (cameraMap[k][i] == NULL_CAMERA)
+						if (remapRecords[i].cameras[k] == NULL_CAMERA)
 						{
-							cameraMap[k][i] = (unsigned char)j;
+							remapRecords[i].cameras[k] = (unsigned char)j;
+							remapRecords[i].weights[k] = 1.0f;
 							break;
 						}
 					}
@@ -465,275 +1586,356 @@ void ofxMultiplexer::computeCameraMaps()
 			if (y >= cameraGridHeight)
 				y = cameraGridHeight - 1;
 			int index = y * cameraGridWidth + x;
-			cameraMap[0][i]=(unsigned char)index;
+			remapRecords[i].cameras[0]=(unsigned char)index;
+			remapRecords[i].weights[0] = 1.0f;
 		}
 	}
 }
 
-void ofxMultiplexer::computeWeightMap(float* cameraWeightMap,vector2df* calibrationPoints,int cameraPosition)
+//distance to the nearest marked pixel before and after each pixel of lines going step apart, -1 when there is none
+static void computeMarkDistances(const unsigned char* marks,int size,int step,int* before,int* after)
 {
-	if (cameraWeightMap == NULL)
-		cameraWeightMap = (float*)malloc(actualStitchedFrameWidth * actualStitchedFrameHeight * sizeof(float));
-	int size = actualStitchedFrameWidth*actualStitchedFrameHeight;
 	for (int i=0;i<size;i++)
-		cameraWeightMap[i] = ((cameraMap[0][i] == cameraPosition) || 
-			(cameraMap[1][i] == cameraPosition) || 
-			(cameraMap[2][i] == cameraPosition) || 
-			(cameraMap[3][i] == cameraPosition)) ? 1.0f : 0.0f;		
+	{
+		if (i < step)
+			before[i] = -1;
+		else
+			before[i] = marks[i-step] ? 1 : (before[i-step] >= 0 ? before[i-step] + 1 : -1);
+	}
+	for (int i=size-1;i>=0;i--)
+	{
+		if (i + step >= size)
+			after[i] = -1;
+		else
+			after[i] = marks[i+step] ? 1 : (after[i+step] >= 0 ? after[i+step] + 1 : -1);
+	}
+}
+
+//Overlap weights fall with distance to the nearest pixel of less overlapped area: along the row within
+//one cell (the row scan runs over the frame in scan order, so it continues on neighbouring rows) or along
+//the column within one cell, row wins on the same distance. Distances to marked pixels are computed
+//in linear passes instead of scanning neighbourhood of each pixel.
+void ofxMultiplexer::computeWeightMap(int cameraPosition)
+{
+	//weights start at 1.0 given by computeCameraMaps
+	int size = actualStitchedFrameWidth*actualStitchedFrameHeight;
+	if (!interleaveMode)
+		return;
+	//rows out of camera have no pixels to weight or to measure distance to, so only rows of camera are processed
+	int first = 0,last = size - 1;
+	while ((first < size) && (getRecordSlot(first,cameraPosition) < 0))
+		first++;
+	while ((last > first) && (getRecordSlot(last,cameraPosition) < 0))
+		last--;
+	if (first >= size)
+		return;
+	first -= first % actualStitchedFrameWidth;
+	last += actualStitchedFrameWidth - 1 - last % actualStitchedFrameWidth;
+	int bandSize = last - first + 1;
 	int globalCalibrationGridWidth = actualCalibrationGridWidth * actualCameraGridWidth - actualCameraGridWidth + 1;
 	int globalCalibrationGridHeight = actualCalibrationGridHeight * actualCameraGridHeight - actualCameraGridHeight + 1;
 	float calibrationGridCellWidth = ((float)actualStitchedFrameWidth) / globalCalibrationGridWidth;
 	float calibrationGridCellHeight = ((float)actualStitchedFrameHeight) / globalCalibrationGridHeight;
 	float horizontalOffset =  1.0f / calibrationGridCellWidth;
 	float verticalOffset = 1.0f / calibrationGridCellHeight;
-	if (interleaveMode)
+	//searched neighbourhood: whole cell to both sides in row, whole cell up and less than cell down in column
+	int rowRange = (int)calibrationGridCellWidth;
+	int upRange = (int)calibrationGridCellHeight;
+	int downRange = (int)ceil(calibrationGridCellHeight) - 1;
+	//marks and distances of pixel i are at i - first
+	unsigned char* marks = (unsigned char*)malloc(bandSize * sizeof(unsigned char));
+	int* left = (int*)malloc(bandSize * sizeof(int));
+	int* right = (int*)malloc(bandSize * sizeof(int));
+	int* up = (int*)malloc(bandSize * sizeof(int));
+	int* down = (int*)malloc(bandSize * sizeof(int));
+	//pixels shared by this and one more camera get weight by distance to pixels of this camera only
+	for (int i=first;i<=last;i++)
 	{
-		for (int i=0;i<size;i++)
+		marks[i-first] = (remapRecords[i].cameras[0] == cameraPosition) &&
+			(remapRecords[i].cameras[1] == NULL_CAMERA) &&
+			(remapRecords[i].cameras[2] == NULL_CAMERA) &&
+			(remapRecords[i].cameras[3] == NULL_CAMERA);
+	}
+	computeMarkDistances(marks,bandSize,1,left,right);
+	computeMarkDistances(marks,bandSize,actualStitchedFrameWidth,up,down);
+	for (int i=first;i<=last;i++)
+	{
+		if (((remapRecords[i].cameras[0] == cameraPosition) || 
+			(remapRecords[i].cameras[1] == cameraPosition)) &&
+			(remapRecords[i].cameras[1] != NULL_CAMERA) &&
+			(remapRecords[i].cameras[2] == NULL_CAMERA) &&
+			(remapRecords[i].cameras[3] == NULL_CAMERA))
 		{
-			if (((cameraMap[0][i] == cameraPosition) || 
-				(cameraMap[1][i] == cameraPosition)) &&
-				(cameraMap[1][i] != NULL_CAMERA) &&
-				(cameraMap[2][i] == NULL_CAMERA) &&
-				(cameraMap[3][i] == NULL_CAMERA))
+			int distance = -1;
+			bool isVertical = false;
+			if ((left[i-first] >= 0) && (left[i-first] <= rowRange))
+				distance = left[i-first];
+			if ((right[i-first] >= 0) && (right[i-first] <= rowRange) && ((distance < 0) || (right[i-first] < distance)))
+				distance = right[i-first];
+			if ((up[i-first] >= 0) && (up[i-first] <= upRange) && ((distance < 0) || (up[i-first] < distance)))
 			{
-				unsigned int distance = INF;
-				int closestX = 0;
-				int closestY = 0;
-				int X = i % actualStitchedFrameWidth;
-				int Y = i / actualStitchedFrameWidth;
-				for (int x=-calibrationGridCellWidth;x<=calibrationGridCellWidth;x++)
-				{
-					if ((X+x+(Y*actualStitchedFrameWidth)>=0) && (X+x+(Y*actualStitchedFrameWidth)<size))
-					{
-						if ((cameraMap[0][X+x+(Y*actualStitchedFrameWidth)] == cameraPosition) && 
-							(cameraMap[1][X+x+(Y*actualStitchedFrameWidth)] == NULL_CAMERA) &&
-							(cameraMap[2][X+x+(Y*actualStitchedFrameWidth)] == NULL_CAMERA) &&
-							(cameraMap[3][X+x+(Y*actualStitchedFrameWidth)] == NULL_CAMERA))
-							{
-								if (abs(x)<distance)
-								{
-									distance = (unsigned int)abs(x);
-									closestX = X+x;
-									closestY = Y;
-								}
-							}
-					}
-				}
-				
-				for (int y=-calibrationGridCellHeight;y<calibrationGridCellHeight;y++)
-				{
-					if ((X+((Y+y)*actualStitchedFrameWidth)>=0) && (X+((Y+y)*actualStitchedFrameWidth)<size))
-					{
-						if ((cameraMap[0][X+((Y+y)*actualStitchedFrameWidth)] == cameraPosition) && 
-							(cameraMap[1][X+((Y+y)*actualStitchedFrameWidth)] == NULL_CAMERA) &&
-							(cameraMap[2][X+((Y+y)*actualStitchedFrameWidth)] == NULL_CAMERA) &&
-							(cameraMap[3][X+((Y+y)*actualStitchedFrameWidth)] == NULL_CAMERA))
-							{
-								if (abs(y)<distance)
-								{
-									distance = (unsigned int)abs(y);
-									closestX = X;
-									closestY = Y+y;
-								}
-							}
-					}
-				}
-				if (distance!=INF)
-				{
-					if (closestX == X)
-						cameraWeightMap[i] = (verticalOffset * (calibrationGridCellHeight-distance));
-					else
-						if (closestY == Y)
-							cameraWeightMap[i] = (horizontalOffset * (calibrationGridCellWidth-distance));
-						else
-							cameraWeightMap[i] = 0.0f;
-				}
-				else
-					cameraWeightMap[i] = 0.0f;
+				distance = up[i-first];
+				isVertical = true;
 			}
-		}
-		for (int i=0;i<size;i++)
-		{
-			if (((cameraMap[0][i] == cameraPosition) || 
-				(cameraMap[1][i] == cameraPosition) ||
-				(cameraMap[2][i] == cameraPosition) ||
-				(cameraMap[3][i] == cameraPosition)) &&
-				((cameraMap[0][i] != NULL_CAMERA) &&
-				(cameraMap[1][i] != NULL_CAMERA) &&
-				(cameraMap[2][i] != NULL_CAMERA) &&
-				(cameraMap[3][i] != NULL_CAMERA)))
+			if ((down[i-first] >= 0) && (down[i-first] <= downRange) && ((distance < 0) || (down[i-first] < distance)))
 			{
-				unsigned int distance = INF;
-				int closestX = 0;
-				int closestY = 0;
-				int X = i % actualStitchedFrameWidth;
-				int Y = i / actualStitchedFrameWidth;
-				float result = 0.0f;
-				for (int x=-calibrationGridCellWidth;x<=calibrationGridCellWidth;x++)
-				{
-					if ((X+x+(Y*actualStitchedFrameWidth)>=0) && (X+x+(Y*actualStitchedFrameWidth)<size))
-					{
-					if (((cameraMap[0][X+x+(Y*actualStitchedFrameWidth)] == cameraPosition) || 
-						(cameraMap[1][X+x+(Y*actualStitchedFrameWidth)] == cameraPosition)) &&
-						((cameraMap[0][X+x+(Y*actualStitchedFrameWidth)] != NULL_CAMERA) &&
-						(cameraMap[1][X+x+(Y*actualStitchedFrameWidth)] != NULL_CAMERA) &&
-						(cameraMap[2][X+x+(Y*actualStitchedFrameWidth)] == NULL_CAMERA) &&
-						(cameraMap[3][X+x+(Y*actualStitchedFrameWidth)] == NULL_CAMERA)))
-						{
-							if (abs(x)<distance)
-							{
-								distance = (unsigned int)abs(x);
-								closestX = X+x;
-								closestY = Y;
-							}
-						}
-					}
-				}
-				if (distance!=INF)
-					result = cameraWeightMap[closestX+closestY*actualStitchedFrameWidth];
-				distance = INF;
-				for (int y=-calibrationGridCellHeight;y<calibrationGridCellHeight;y++)
-				{
-					if ((X+(Y+y)*actualStitchedFrameWidth>=0) && (X+(Y+y)*actualStitchedFrameWidth<size))
-					{
-					if (((cameraMap[0][X+((Y+y)*actualStitchedFrameWidth)] == cameraPosition) || 
-						(cameraMap[1][X+((Y+y)*actualStitchedFrameWidth)] == cameraPosition)) &&
-						((cameraMap[0][X+((Y+y)*actualStitchedFrameWidth)] != NULL_CAMERA) &&
-						(cameraMap[1][X+((Y+y)*actualStitchedFrameWidth)] != NULL_CAMERA) &&
-						(cameraMap[2][X+((Y+y)*actualStitchedFrameWidth)] == NULL_CAMERA) &&
-						(cameraMap[3][X+((Y+y)*actualStitchedFrameWidth)] == NULL_CAMERA)))
-						{
-							if (abs(y)<distance)
-							{
-								distance = (unsigned int)abs(y);
-								closestX = X;
-								closestY = Y+y;
-							}
-						}
-					}
-				}
-				cameraWeightMap[i] = result * cameraWeightMap[closestX+closestY*actualStitchedFrameWidth];
+				distance = down[i-first];
+				isVertical = true;
 			}
+			if (distance < 0)
+				setRecordWeight(i,cameraPosition,0.0f);
+			else if (isVertical)
+				setRecordWeight(i,cameraPosition,(verticalOffset * (calibrationGridCellHeight-(float)distance)));
+			else
+				setRecordWeight(i,cameraPosition,(horizontalOffset * (calibrationGridCellWidth-(float)distance)));
 		}
 	}
-}
-
-void ofxMultiplexer::computeOffsetMap(unsigned int* cameraOffsetMap,vector2df* calibrationPoints,int cameraPosition)
-{
-	vector2df* screenPoints = (vector2df*)malloc((actualCalibrationGridWidth+1) * (actualCalibrationGridHeight+1) * sizeof(vector2df));
-	vector2df* cameraPoints = (vector2df*)malloc((actualCalibrationGridWidth+1) * (actualCalibrationGridHeight+1) * sizeof(vector2df));
-	int* triangles = (int*)malloc((actualCalibrationGridWidth+1)*(actualCalibrationGridHeight+1)*6*sizeof(int));
-
-	int t = 0;
-	for(int j = 0; j < actualCalibrationGridHeight; j++)
+	//pixels shared by four cameras get product of weights of the nearest pixels shared by two cameras
+	for (int i=first;i<=last;i++)
 	{
-		for(int i = 0; i < actualCalibrationGridWidth; i++)
+		marks[i-first] = ((remapRecords[i].cameras[0] == cameraPosition) || 
+			(remapRecords[i].cameras[1] == cameraPosition)) &&
+			((remapRecords[i].cameras[0] != NULL_CAMERA) &&
+			(remapRecords[i].cameras[1] != NULL_CAMERA) &&
+			(remapRecords[i].cameras[2] == NULL_CAMERA) &&
+			(remapRecords[i].cameras[3] == NULL_CAMERA));
+	}
+	computeMarkDistances(marks,bandSize,1,left,right);
+	computeMarkDistances(marks,bandSize,actualStitchedFrameWidth,up,down);
+	for (int i=first;i<=last;i++)
+	{
+		if (((remapRecords[i].cameras[0] == cameraPosition) || 
+			(remapRecords[i].cameras[1] == cameraPosition) ||
+			(remapRecords[i].cameras[2] == cameraPosition) ||
+			(remapRecords[i].cameras[3] == cameraPosition)) &&
+			((remapRecords[i].cameras[0] != NULL_CAMERA) &&
+			(remapRecords[i].cameras[1] != NULL_CAMERA) &&
+			(remapRecords[i].cameras[2] != NULL_CAMERA) &&
+			(remapRecords[i].cameras[3] != NULL_CAMERA)))
 		{
-			triangles[t+0] = (i+0) + ((j+0) * (actualCalibrationGridWidth+1));
-			triangles[t+1] = (i+1) + ((j+0) * (actualCalibrationGridWidth+1));
-			triangles[t+2] = (i+0) + ((j+1) * (actualCalibrationGridWidth+1));
-			t += 3;
-			triangles[t+0] = (i+1) + ((j+0) * (actualCalibrationGridWidth+1));
-			triangles[t+1] = (i+1) + ((j+1) * (actualCalibrationGridWidth+1));
-			triangles[t+2] = (i+0) + ((j+1) * (actualCalibrationGridWidth+1));
-			t += 3;
+			float result = 0.0f;
+			int closest = -1;
+			if ((left[i-first] >= 0) && (left[i-first] <= rowRange))
+				closest = i - left[i-first];
+			if ((right[i-first] >= 0) && (right[i-first] <= rowRange) && ((closest < 0) || (right[i-first] < i - closest)))
+				closest = i + right[i-first];
+			if (closest >= 0)
+				result = getRecordWeight(closest,cameraPosition);
+			if ((up[i-first] >= 0) && (up[i-first] <= upRange))
+				closest = i - up[i-first] * actualStitchedFrameWidth;
+			if ((down[i-first] >= 0) && (down[i-first] <= downRange) && (((up[i-first] < 0) || (up[i-first] > upRange)) || (down[i-first] < up[i-first])))
+				closest = i + down[i-first] * actualStitchedFrameWidth;
+			//without any neighbour result is zero, pixel 0 is only multiplied by it
+			setRecordWeight(i,cameraPosition,result * getRecordWeight(closest >= 0 ? closest : 0,cameraPosition));
 		}
 	}
+	free(marks);
+	free(left);
+	free(right);
+	free(up);
+	free(down);
+}
 
+void ofxMultiplexer::getCameraOrigin(int cameraPosition,int* left,int* top)
+{
 	int size = actualStitchedFrameWidth * actualStitchedFrameHeight;
-	int LeftX = 0;
-	int TopY = 0;
+	*left = 0;
+	*top = 0;
 	for (int i=0;i<size;i++)
 	{
-		if ((cameraMap[0][i] == cameraPosition) ||
-			(cameraMap[1][i] == cameraPosition) ||
-			(cameraMap[2][i] == cameraPosition) ||
-			(cameraMap[3][i] == cameraPosition))
+		if ((remapRecords[i].cameras[0] == cameraPosition) ||
+			(remapRecords[i].cameras[1] == cameraPosition) ||
+			(remapRecords[i].cameras[2] == cameraPosition) ||
+			(remapRecords[i].cameras[3] == cameraPosition))
 		{
-			LeftX = i % actualStitchedFrameWidth;
-			TopY = i / actualStitchedFrameWidth;
+			*left = i % actualStitchedFrameWidth;
+			*top = i / actualStitchedFrameWidth;
 			break;
 		}
 	}
+}
+
+void ofxMultiplexer::computeCameraMesh(int cameraPosition,int left,int top)
+{
+	vector2df* screenPoints = (vector2df*)malloc((actualCalibrationGridWidth+1) * (actualCalibrationGridHeight+1) * sizeof(vector2df));
 	int globalCalibrationGridWidth = (interleaveMode ?  actualCalibrationGridWidth * actualCameraGridWidth - actualCameraGridWidth + 1 : actualCalibrationGridWidth * actualCameraGridWidth);
 	int globalCalibrationGridHeight = (interleaveMode ? actualCalibrationGridHeight * actualCameraGridHeight - actualCameraGridHeight + 1 : actualCalibrationGridHeight * actualCameraGridHeight);
 	float calibrationGridCellWidth = ((float)actualStitchedFrameWidth) / globalCalibrationGridWidth;
 	float calibrationGridCellHeight = ((float)actualStitchedFrameHeight) / globalCalibrationGridHeight;
-	int cameraX = cameraPosition % actualCameraGridWidth;
-	int cameraY = cameraPosition / actualCameraGridWidth;
-	cameraX *= (interleaveMode  ? (actualCalibrationGridWidth-1) : actualCalibrationGridWidth);
-	cameraY *= (interleaveMode  ? (actualCalibrationGridHeight-1) : actualCalibrationGridHeight);
 	int P = 0;
 	for (int j=0;j<=actualCalibrationGridHeight;j++)
 	{
 		for (int i=0;i<=actualCalibrationGridWidth;i++)
 		{
-			screenPoints[P].X = (float)(calibrationGridCellWidth * i + LeftX);
-			screenPoints[P].Y = (float)(calibrationGridCellHeight * j + TopY);
+			screenPoints[P].X = (float)(calibrationGridCellWidth * i + left);
+			screenPoints[P].Y = (float)(calibrationGridCellHeight * j + top);
 			P++;
 		}
 	}
-	memcpy((void*)cameraPoints,calibrationPoints,(actualCalibrationGridWidth+1) * (actualCalibrationGridHeight+1) * sizeof(vector2df));
-	memset(cameraOffsetMap,0,actualStitchedFrameWidth * actualStitchedFrameHeight * sizeof(unsigned int));
-	
-	int T = 0;
-	for (int j=0;j<actualStitchedFrameHeight;j++)
-	{
-		for (int i=0;i<actualStitchedFrameWidth;i++)
-		{
-			unsigned int transformedX = i;
-			unsigned int transformedY = j;
-			if ((cameraMap[0][i+j*actualStitchedFrameWidth] != cameraPosition)&&
-				(cameraMap[1][i+j*actualStitchedFrameWidth] != cameraPosition)&&
-				(cameraMap[2][i+j*actualStitchedFrameWidth] != cameraPosition)&&
-				(cameraMap[3][i+j*actualStitchedFrameWidth] != cameraPosition))
-				transformedX = transformedY = 0;
-			else
-				cameraToScreenSpace(transformedX,transformedY,screenPoints,cameraPoints,triangles);
-			if (transformedX >= cameraFramesWidth[cameraPosition])
-				transformedX=cameraFramesWidth[cameraPosition]-1;
-			if (transformedY >= cameraFramesHeight[cameraPosition])
-				transformedY = cameraFramesHeight[cameraPosition]-1;
- 			cameraOffsetMap[T] = transformedX+transformedY*cameraFramesWidth[cameraPosition];
-			T++;
-		}
-	}
+	cameraMeshes[cameraPosition].build(actualCalibrationGridWidth,actualCalibrationGridHeight,screenPoints,cameraCalibrationPoints[cameraPosition],actualStitchedFrameWidth,actualStitchedFrameHeight);
 	free(screenPoints);
-	free(cameraPoints);
-	free(triangles);
 }
 
-void ofxMultiplexer::cameraToScreenSpace(unsigned int &x, unsigned int &y,vector2df* screenPoints,vector2df* cameraPoints,int* triangles)
+void ofxMultiplexer::computeOffsetMap(int cameraPosition)
 {
-	vector2df pt((float)x, (float)y);
-	int t = findTriangleWithin(pt,screenPoints,triangles);
-	if(t != -1)
-	{
-		vector2df A = screenPoints[triangles[t+0]];
-		vector2df B = screenPoints[triangles[t+1]];
-		vector2df C = screenPoints[triangles[t+2]];
+	remapTiles(cameraPosition,NULL,cameraMeshes[cameraPosition].getTilesWidth()*cameraMeshes[cameraPosition].getTilesHeight());
+}
 
-		float total_area = (A.X - B.X) * (A.Y - C.Y) - (A.Y - B.Y) * (A.X - C.X);
-		float area_A = (pt.X - B.X) * (pt.Y - C.Y) - (pt.Y - B.Y) * (pt.X - C.X);
-		float area_B = (A.X - pt.X) * (A.Y - C.Y) - (A.Y - pt.Y) * (A.X - C.X);
-		float bary_A = area_A / total_area;
-		float bary_B = area_B / total_area;
-		float bary_C = 1.0f - bary_A - bary_B;
-		
-		vector2df sA = cameraPoints[triangles[t+0]];
-		vector2df sB = cameraPoints[triangles[t+1]];
-		vector2df sC = cameraPoints[triangles[t+2]];
+struct ofxTilesRemapping
+{
+	ofxMultiplexer* multiplexer;
+	int cameraPosition;
+	//tiles to remap, NULL for all tiles
+	const int* tiles;
+	//camera positions and owner triangles of tile pixels for each pool participant
+	float* cameraX;
+	float* cameraY;
+	int* owners;
+};
 
-		vector2df transformedPos;
+//first of two bilinear taps around camera position and fixed point fraction between them.
+//Pixel centers are half pixel after their positions, as nearest remap truncates positions. Frame needs two pixels at least
+static unsigned int toBilinearTap(float position,int size,unsigned short* fraction)
+{
+	float center = position - 0.5f;
+	if (center < 0.0f)
+		center = 0.0f;
+	if (center > (float)(size - 1))
+		center = (float)(size - 1);
+	int first = (int)center;
+	if (first > size - 2)
+		first = size - 2;
+	int fixedFraction = (int)((center - first) * (1 << REMAP_FRACTION_BITS) + 0.5f);
+	if ((fixedFraction == (1 << REMAP_FRACTION_BITS)) && (first < size - 2))
+	{
+		first++;
+		fixedFraction = 0;
+	}
+	*fraction = (unsigned short)(fixedFraction < (1 << REMAP_FRACTION_BITS) ? fixedFraction : (1 << REMAP_FRACTION_BITS) - 1);
+	return (unsigned int)first;
+}
 
-		transformedPos = (sA*bary_A) + (sB*bary_B) + (sC*bary_C);
+void ofxMultiplexer::RemapTiles(void* instance,int first,int last,int participant)
+{
+	ofxTilesRemapping* remapping = (ofxTilesRemapping*)instance;
+	ofxMultiplexer* pThis = remapping->multiplexer;
+	int cameraPosition = remapping->cameraPosition;
+	ofxCalibrationMesh& mesh = pThis->cameraMeshes[cameraPosition];
+	float* cameraX = remapping->cameraX + participant * CALIBRATION_MESH_TILE_SIZE * CALIBRATION_MESH_TILE_SIZE;
+	float* cameraY = remapping->cameraY + participant * CALIBRATION_MESH_TILE_SIZE * CALIBRATION_MESH_TILE_SIZE;
+	int frameWidth = pThis->cameraFramesWidth[cameraPosition];
+	int frameHeight = pThis->cameraFramesHeight[cameraPosition];
+	int* owners = remapping->owners + participant * CALIBRATION_MESH_TILE_SIZE * CALIBRATION_MESH_TILE_SIZE;
+	for (int i=first;i<last;i++)
+	{
+		int tile = remapping->tiles != NULL ? remapping->tiles[i] : i;
+		mesh.mapTile(tile,cameraX,cameraY,owners);
+		int tileLeft = (tile % mesh.getTilesWidth()) * CALIBRATION_MESH_TILE_SIZE;
+		int tileTop = (tile / mesh.getTilesWidth()) * CALIBRATION_MESH_TILE_SIZE;
+		for (int y=0;(y<CALIBRATION_MESH_TILE_SIZE) && (tileTop+y<pThis->actualStitchedFrameHeight);y++)
+		{
+			for (int x=0;(x<CALIBRATION_MESH_TILE_SIZE) && (tileLeft+x<pThis->actualStitchedFrameWidth);x++)
+			{
+				unsigned int offset;
+				unsigned short fraction = 0;
+				if (pThis->bilinearMode)
+				{
+					unsigned short fractionX,fractionY;
+					unsigned int firstX = toBilinearTap(cameraX[y * CALIBRATION_MESH_TILE_SIZE + x],frameWidth,&fractionX);
+					unsigned int firstY = toBilinearTap(cameraY[y * CALIBRATION_MESH_TILE_SIZE + x],frameHeight,&fractionY);
+					offset = firstX + firstY * frameWidth;
+					fraction = fractionX | (fractionY << REMAP_FRACTION_BITS);
+				}
+				else
+				{
+					unsigned int transformedX = (unsigned int)cameraX[y * CALIBRATION_MESH_TILE_SIZE + x];
+					unsigned int transformedY = (unsigned int)cameraY[y * CALIBRATION_MESH_TILE_SIZE + x];
+					if (transformedX >= (unsigned int)frameWidth)
+						transformedX = frameWidth-1;
+					if (transformedY >= (unsigned int)frameHeight)
+						transformedY = frameHeight-1;
+					offset = transformedX+transformedY*frameWidth;
+				}
+				int pixel = (tileTop + y) * pThis->actualStitchedFrameWidth + tileLeft + x;
+				//records while distortion is computed, compiled program when calibration points are updated.
+				//Pixels not covered by this camera have no record or source of it
+				if (pThis->remapRecords != NULL)
+				{
+					int slot = pThis->getRecordSlot(pixel,cameraPosition);
+					if (slot >= 0)
+					{
+						pThis->remapRecords[pixel].offsets[slot] = offset;
+						pThis->remapRecords[pixel].fractions[slot] = fraction;
+					}
+				}
+				else
+					pThis->remapProgram.setSourceOffset(pixel,cameraPosition,offset,fraction);
+			}
+		}
+	}
+}
+
+void ofxMultiplexer::remapTiles(int cameraPosition,const int* tiles,int tilesCount)
+{
+	int participantsCount = ofxThreadPool::getShared()->getParticipantsCount();
+	int tileSize = CALIBRATION_MESH_TILE_SIZE * CALIBRATION_MESH_TILE_SIZE;
+	ofxTilesRemapping remapping;
+	remapping.multiplexer = this;
+	remapping.cameraPosition = cameraPosition;
+	remapping.tiles = tiles;
+	remapping.cameraX = (float*)malloc(participantsCount * tileSize * sizeof(float));
+	remapping.cameraY = (float*)malloc(participantsCount * tileSize * sizeof(float));
+	remapping.owners = (int*)malloc(participantsCount * tileSize * sizeof(int));
+	ofxThreadPool::getShared()->parallelFor(tilesCount,1,&ofxMultiplexer::RemapTiles,&remapping);
+	free(remapping.cameraX);
+	free(remapping.cameraY);
+	free(remapping.owners);
+}
 
-		x = (unsigned int)transformedPos.X;
-		y = (unsigned int)transformedPos.Y;
+void ofxMultiplexer::updateCameraMesh(int cameraPosition,ofxCameraBaseCalibration* calibration)
+{
+	int pointsCount = (actualCalibrationGridWidth+1)*(actualCalibrationGridHeight+1);
+	if ((cameraMeshes == NULL) || (!remapProgram.isBuilt()) || (cameraPosition >= actualCameraGridWidth*actualCameraGridHeight) ||
+		(calibration->calibrationPoints.size() != pointsCount))
 		return;
+	ofxCalibrationMesh& mesh = cameraMeshes[cameraPosition];
+	int tilesCount = mesh.getTilesWidth() * mesh.getTilesHeight();
+	bool* isDirtyTile = (bool*)malloc(tilesCount * sizeof(bool));
+	memset(isDirtyTile,0,tilesCount * sizeof(bool));
+	//only pixels of triangles around moved point change their offsets
+	for (int i=0;i<pointsCount;i++)
+	{
+		vector2df point;
+		point.X = calibration->calibrationPoints[i].X * cameraFramesWidth[cameraPosition];
+		point.Y = calibration->calibrationPoints[i].Y * cameraFramesHeight[cameraPosition];
+		if ((point.X == mesh.getCameraPoint(i).X) && (point.Y == mesh.getCameraPoint(i).Y))
+			continue;
+		cameraCalibrationPoints[cameraPosition][i] = point;
+		mesh.setCameraPoint(i,point);
+		int left,top,right,bottom;
+		if (mesh.getPointTiles(i,&left,&top,&right,&bottom))
+		{
+			for (int y=top;y<=bottom;y++)
+			{
+				for (int x=left;x<=right;x++)
+					isDirtyTile[y * mesh.getTilesWidth() + x] = true;
+			}
+		}
+	}
+	int* dirtyTiles = (int*)malloc(tilesCount * sizeof(int));
+	int dirtyTilesCount = 0;
+	for (int i=0;i<tilesCount;i++)
+	{
+		if (isDirtyTile[i])
+			dirtyTiles[dirtyTilesCount++] = i;
+	}
+	if (dirtyTilesCount > 0)
+	{
+		remapTiles(cameraPosition,dirtyTiles,dirtyTilesCount);
+		printf("Remap table: %d of %d tiles of camera %d updated\n",dirtyTilesCount,tilesCount,cameraPosition);
 	}
-	x = 0;
-	y = 0;
+	free(dirtyTiles);
+	free(isDirtyTile);
 }
 
 void ofxMultiplexer::setInterleaveMode(bool isInterlaveMode)
@@ -746,17 +1948,12 @@ void ofxMultiplexer::getInterleaveMode(bool* isInterleaveMode)
 	*isInterleaveMode = interleaveMode;
 }
 
-bool ofxMultiplexer::isPointInTriangle(vector2df p, vector2df a, vector2df b, vector2df c)
+void ofxMultiplexer::setBilinearMode(bool isBilinearMode)
 {
-	return (vector2df::isOnSameSide(p,a, b,c) && vector2df::isOnSameSide(p,b, a,c) && vector2df::isOnSameSide(p, c, a, b));
+	bilinearMode = isBilinearMode;
 }
 
-int ofxMultiplexer::findTriangleWithin(vector2df pt,vector2df* screenPoints,int* triangles)
+void ofxMultiplexer::getBilinearMode(bool* isBilinearMode)
 {
-	for(int t = 0; t < actualCalibrationGridWidth * actualCalibrationGridHeight * 6; t += 3)
-	{
-		if(isPointInTriangle(pt, screenPoints[triangles[t]], screenPoints[triangles[t+1]], screenPoints[triangles[t+2]]) )
-			return t;
-	}
-	return -1;
-}
\ No newline at end of file
+	*isBilinearMode = bilinearMode;
+}
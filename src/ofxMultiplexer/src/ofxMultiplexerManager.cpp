@@ -18,6 +18,14 @@ ofxMultiplexerManager::ofxMultiplexerManager()
 	stitchedFrameWidth = 640;
 	stitchedFrameHeight = 480;
 	interleaveMode = false;
+	bilinearMode = false;
+	syncPolicy = MULTIPLEXER_SYNC_LATEST;
+	syncDeadline = 20;
+	stitchingQueueDepth = 1;
+	dropPolicy = MULTIPLEXER_DROP_OLDEST;
+	changeThreshold = 2;
+	backgroundSubtraction = false;
+	backgroundNoiseFloor = MULTIPLEXER_BACKGROUND_NOISE_FLOOR;
 	isMultiplexerNeedToUpdate = true;
 }
 ofxMultiplexerManager::~ofxMultiplexerManager()
@@ -154,6 +162,12 @@ void ofxMultiplexerManager::applySettingsToMultiplexer()
 	cameraMultiplexer->setCameraGridSize(cameraGridWidth,cameraGridHeight);
 	cameraMultiplexer->setStitchedFrameSize(stitchedFrameWidth,stitchedFrameHeight);
 	cameraMultiplexer->setInterleaveMode(interleaveMode);
+	cameraMultiplexer->setBilinearMode(bilinearMode);
+	cameraMultiplexer->setSyncPolicy(syncPolicy,syncDeadline);
+	cameraMultiplexer->setStitchingQueue(stitchingQueueDepth,dropPolicy);
+	cameraMultiplexer->setChangeThreshold(changeThreshold);
+	cameraMultiplexer->setBackgroundSubtraction(backgroundSubtraction);
+	cameraMultiplexer->setBackgroundNoiseFloor(backgroundNoiseFloor);
 	cameraMultiplexer->clearAllCameraBase();
 	for (int i=0;i<cameraBasesCalibration.size();i++)
 		cameraMultiplexer->addCameraBase(cameraBasesCalibration[i]);
@@ -165,6 +179,8 @@ void ofxMultiplexerManager::startMulticamManager()
 {
 	enumerateCameras();
 	readSettingsFromXML();
+	//remap computed for last settings is loaded instead of computing it on every start
+	cameraMultiplexer->setRemapCacheFileName(ofToDataPath("xml/multiplexer_remap.bin"));
 	applySettingsToMultiplexer();
 
 }
@@ -314,6 +330,21 @@ void ofxMultiplexerManager::readSettingsFromXML(char* fileName)
 		calibrationGridWidth	= xmlSettings->getValue("MULTIPLEXER:CALIBRATIONGRID:WIDTH", 4);
 		calibrationGridHeight	= xmlSettings->getValue("MULTIPLEXER:CALIBRATIONGRID:HEIGHT", 3);
 		interleaveMode			= xmlSettings->getValue("MULTIPLEXER:INTERLEAVE", 0);
+		bilinearMode			= xmlSettings->getValue("MULTIPLEXER:BILINEAR", 0);
+		std::string syncPolicyName = xmlSettings->getValue("MULTIPLEXER:SYNC:POLICY", "LATEST");
+		syncDeadline			= xmlSettings->getValue("MULTIPLEXER:SYNC:DEADLINE", 20);
+		if (syncPolicyName == "NEAREST")
+			syncPolicy = MULTIPLEXER_SYNC_NEAREST;
+		else if (syncPolicyName == "WAIT")
+			syncPolicy = MULTIPLEXER_SYNC_WAIT;
+		else
+			syncPolicy = MULTIPLEXER_SYNC_LATEST;
+		stitchingQueueDepth		= xmlSettings->getValue("MULTIPLEXER:STITCHING:QUEUE", 1);
+		std::string dropPolicyName = xmlSettings->getValue("MULTIPLEXER:STITCHING:DROP", "OLDEST");
+		dropPolicy = dropPolicyName == "NEWEST" ? MULTIPLEXER_DROP_NEWEST : MULTIPLEXER_DROP_OLDEST;
+		changeThreshold			= xmlSettings->getValue("MULTIPLEXER:CHANGES:THRESHOLD", 2);
+		backgroundSubtraction	= xmlSettings->getValue("MULTIPLEXER:BACKGROUND:SUBTRACT", 0) != 0;
+		backgroundNoiseFloor	= xmlSettings->getValue("MULTIPLEXER:BACKGROUND:NOISEFLOOR", MULTIPLEXER_BACKGROUND_NOISE_FLOOR);
 		xmlSettings->pushTag("MULTIPLEXER", 0);
 		xmlSettings->pushTag("CAMERAS", 0);
 		int numCamerasTags = xmlSettings->getNumTags("CAMERA");
@@ -379,6 +410,14 @@ void ofxMultiplexerManager::saveSettingsToXML(char* fileName)
 		xmlSettings->setValue("CALIBRATIONGRID:WIDTH",calibrationGridWidth);
 		xmlSettings->setValue("CALIBRATIONGRID:HEIGHT",calibrationGridHeight);
 		xmlSettings->setValue("INTERLEAVE",interleaveMode);
+		xmlSettings->setValue("BILINEAR",bilinearMode);
+		xmlSettings->setValue("SYNC:POLICY",syncPolicy == MULTIPLEXER_SYNC_NEAREST ? "NEAREST" : (syncPolicy == MULTIPLEXER_SYNC_WAIT ? "WAIT" : "LATEST"));
+		xmlSettings->setValue("SYNC:DEADLINE",(int)syncDeadline);
+		xmlSettings->setValue("STITCHING:QUEUE",stitchingQueueDepth);
+		xmlSettings->setValue("STITCHING:DROP",dropPolicy == MULTIPLEXER_DROP_NEWEST ? "NEWEST" : "OLDEST");
+		xmlSettings->setValue("CHANGES:THRESHOLD",changeThreshold);
+		xmlSettings->setValue("BACKGROUND:SUBTRACT",backgroundSubtraction ? 1 : 0);
+		xmlSettings->setValue("BACKGROUND:NOISEFLOOR",backgroundNoiseFloor);
 		xmlSettings->setValue("CAMERAS","",0);
 		xmlSettings->pushTag("CAMERAS", 0);
 		//if (cameraGridWidth*cameraGridHeight == cameraBasesCalibration.size())
@@ -495,6 +534,7 @@ void ofxMultiplexerManager::enumerateCameras()
 {
 	for (int i=0;i<allowdedCameraTypes.size();i++)
 	{
+		#ifdef TARGET_WIN32
 		if (allowdedCameraTypes[i] == PS3)
 		{
 			ofxCameraBase* cam = (ofxCameraBase*)(new ofxPS3());
@@ -560,11 +600,25 @@ void ofxMultiplexerManager::enumerateCameras()
 			}
 			delete cam;
 		}
+		#endif
+		if (allowdedCameraTypes[i] == RECORDED)
+		{
+			ofxCameraBase* cam = (ofxCameraBase*)(new ofxRecordedCamera());
+			int cameraCount = 0;
+			GUID* cameraGUIDs = cam->getBaseCameraGuids(&cameraCount);
+			for (int j=0;j<cameraCount;j++)
+			{
+				ofxCameraBase* newCam = (ofxCameraBase*)(new ofxRecordedCamera());
+				newCam->initializeWithGUID(cameraGUIDs[j]);
+				cameraBases.push_back(newCam);
+			}
+			delete cam;
+		}
 	}
 	for (int i=0;i<cameraBases.size();i++)
 	{
-		cameraBases[i]->startCamera();
 		cameraBases[i]->pauseCamera();
+		cameraBases[i]->startCamera();
 	}
 }
 
@@ -579,3 +633,75 @@ bool ofxMultiplexerManager::getInterleaveMode()
 {
 	return interleaveMode;
 }
+
+void ofxMultiplexerManager::setBilinearMode(bool isBilinearMode)
+{
+	if (isBilinearMode!=bilinearMode)
+		isMultiplexerNeedToUpdate = true;
+	bilinearMode = isBilinearMode;
+}
+
+bool ofxMultiplexerManager::getBilinearMode()
+{
+	return bilinearMode;
+}
+
+void ofxMultiplexerManager::setSyncPolicy(MULTIPLEXER_SYNC_POLICY policy,unsigned int deadline)
+{
+	syncPolicy = policy;
+	syncDeadline = deadline;
+	//policy doesn't change stitching, so multiplexer gets it at once
+	if (cameraMultiplexer != NULL)
+		cameraMultiplexer->setSyncPolicy(syncPolicy,syncDeadline);
+}
+
+void ofxMultiplexerManager::getSyncPolicy(MULTIPLEXER_SYNC_POLICY* policy,unsigned int* deadline)
+{
+	*policy = syncPolicy;
+	*deadline = syncDeadline;
+}
+
+void ofxMultiplexerManager::setStitchingQueue(int depth,MULTIPLEXER_DROP_POLICY policy)
+{
+	//ring of stitched frames is allocated by initialization of multiplexer
+	if ((depth != stitchingQueueDepth) || (policy != dropPolicy))
+		isMultiplexerNeedToUpdate = true;
+	stitchingQueueDepth = depth;
+	dropPolicy = policy;
+}
+
+void ofxMultiplexerManager::getStitchingQueue(int* depth,MULTIPLEXER_DROP_POLICY* policy)
+{
+	*depth = stitchingQueueDepth;
+	*policy = dropPolicy;
+}
+
+void ofxMultiplexerManager::setChangeThreshold(int threshold)
+{
+	changeThreshold = threshold;
+	//threshold doesn't change buffers, so multiplexer gets it at once
+	if (cameraMultiplexer != NULL)
+		cameraMultiplexer->setChangeThreshold(changeThreshold);
+}
+
+int ofxMultiplexerManager::getChangeThreshold()
+{
+	return changeThreshold;
+}
+
+void ofxMultiplexerManager::setBackgroundSubtraction(bool isEnabled,int noiseFloor)
+{
+	backgroundSubtraction = isEnabled;
+	backgroundNoiseFloor = noiseFloor;
+	if (cameraMultiplexer != NULL)
+	{
+		cameraMultiplexer->setBackgroundSubtraction(backgroundSubtraction);
+		cameraMultiplexer->setBackgroundNoiseFloor(backgroundNoiseFloor);
+	}
+}
+
+void ofxMultiplexerManager::getBackgroundSubtraction(bool* isEnabled,int* noiseFloor)
+{
+	*isEnabled = backgroundSubtraction;
+	*noiseFloor = backgroundNoiseFloor;
+}
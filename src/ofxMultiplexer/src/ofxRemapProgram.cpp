@@ -0,0 +1,659 @@
+#include "ofxRemapProgram.h"
+#include "ofxThreadPool.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(OFX_SSE2)
+	#include <emmintrin.h>
+#endif
+
+ofxRemapProgram::ofxRemapProgram()
+{
+	runs = NULL;
+	sources = NULL;
+	weights = NULL;
+	fractions = NULL;
+	frameWidths = NULL;
+	camerasCount = 0;
+	runsCount = sourcesCount = weightsCount = 0;
+	blendedPixelsCount = 0;
+}
+
+ofxRemapProgram::~ofxRemapProgram()
+{
+	clear();
+}
+
+void ofxRemapProgram::clear()
+{
+	if (runs != NULL)
+		free(runs);
+	if (sources != NULL)
+		free(sources);
+	if (weights != NULL)
+		free(weights);
+	if (fractions != NULL)
+		free(fractions);
+	if (frameWidths != NULL)
+		free(frameWidths);
+	runs = NULL;
+	sources = NULL;
+	weights = NULL;
+	fractions = NULL;
+	frameWidths = NULL;
+	camerasCount = 0;
+	runsCount = sourcesCount = weightsCount = 0;
+	blendedPixelsCount = 0;
+}
+
+unsigned int ofxRemapProgram::getFootprint()
+{
+	return runsCount * sizeof(ofxRemapRun) + sourcesCount * sizeof(unsigned int) + weightsCount * sizeof(short) +
+		(fractions != NULL ? sourcesCount * sizeof(unsigned short) : 0);
+}
+
+unsigned int ofxRemapProgram::getSerializedSize()
+{
+	return 5 * sizeof(int) + getFootprint();
+}
+
+void ofxRemapProgram::setFrameWidths(const int* widths,int count)
+{
+	frameWidths = (int*)malloc(count * sizeof(int));
+	memcpy(frameWidths,widths,count * sizeof(int));
+	camerasCount = count;
+}
+
+void ofxRemapProgram::serialize(unsigned char* data)
+{
+	int counts[5] = { runsCount, sourcesCount, weightsCount, blendedPixelsCount, fractions != NULL ? 1 : 0 };
+	memcpy(data,counts,sizeof(counts));
+	data += sizeof(counts);
+	memcpy(data,runs,runsCount * sizeof(ofxRemapRun));
+	data += runsCount * sizeof(ofxRemapRun);
+	memcpy(data,sources,sourcesCount * sizeof(unsigned int));
+	data += sourcesCount * sizeof(unsigned int);
+	memcpy(data,weights,weightsCount * sizeof(short));
+	data += weightsCount * sizeof(short);
+	if (fractions != NULL)
+		memcpy(data,fractions,sourcesCount * sizeof(unsigned short));
+}
+
+bool ofxRemapProgram::deserialize(const unsigned char* data,unsigned int size,int pixelsCount,const int* frameWidths,const int* frameHeights,int camerasCount)
+{
+	clear();
+	int counts[5];
+	if (size < sizeof(counts))
+		return false;
+	memcpy(counts,data,sizeof(counts));
+	data += sizeof(counts);
+	if ((counts[0] <= 0) || (counts[1] < counts[0]) || (counts[2] < 0) || (counts[3] < 0) || (counts[4] < 0) || (counts[4] > 1) ||
+		(size != sizeof(counts) + counts[0] * sizeof(ofxRemapRun) + counts[1] * (sizeof(unsigned int) + counts[4] * sizeof(unsigned short)) + counts[2] * sizeof(short)))
+		return false;
+	runs = (ofxRemapRun*)malloc(counts[0] * sizeof(ofxRemapRun));
+	sources = (unsigned int*)malloc(counts[1] * sizeof(unsigned int));
+	weights = (short*)malloc((counts[2] > 0 ? counts[2] : 1) * sizeof(short));
+	memcpy(runs,data,counts[0] * sizeof(ofxRemapRun));
+	data += counts[0] * sizeof(ofxRemapRun);
+	memcpy(sources,data,counts[1] * sizeof(unsigned int));
+	data += counts[1] * sizeof(unsigned int);
+	memcpy(weights,data,counts[2] * sizeof(short));
+	data += counts[2] * sizeof(short);
+	if (counts[4] != 0)
+	{
+		fractions = (unsigned short*)malloc(counts[1] * sizeof(unsigned short));
+		memcpy(fractions,data,counts[1] * sizeof(unsigned short));
+	}
+	setFrameWidths(frameWidths,camerasCount);
+	runsCount = counts[0];
+	sourcesCount = counts[1];
+	weightsCount = counts[2];
+	blendedPixelsCount = counts[3];
+	//execute doesn't check anything: runs must cover output in order and stay inside of sources and weights,
+	//sources (with their right and bottom taps if bilinear) must stay inside of camera frames
+	bool isValid = runs[runsCount-1].start + runs[runsCount-1].length == (unsigned int)pixelsCount;
+	for (int i=0;isValid && (i<runsCount);i++)
+	{
+		const ofxRemapRun& run = runs[i];
+		isValid = ((run.sourcesCount == 1) || (run.sourcesCount == 2) || (run.sourcesCount == 4)) &&
+			(run.start == (i > 0 ? runs[i-1].start + runs[i-1].length : 0)) &&
+			(run.firstSource + run.length * run.sourcesCount <= (unsigned int)sourcesCount) &&
+			((run.sourcesCount == 1) || (run.firstWeight + run.length * run.sourcesCount <= (unsigned int)weightsCount)) &&
+			((run.sourcesCount > 1) || (run.camera < camerasCount));
+	}
+	for (int i=0;isValid && (i<sourcesCount);i++)
+	{
+		unsigned int camera = sources[i] >> REMAP_CAMERA_SHIFT;
+		unsigned int offset = sources[i] & REMAP_OFFSET_MASK;
+		isValid = (camera < (unsigned int)camerasCount) && (offset < (unsigned int)(frameWidths[camera] * frameHeights[camera]));
+		if (isValid && (fractions != NULL))
+			isValid = (offset % frameWidths[camera] + 1 < (unsigned int)frameWidths[camera]) && (offset / frameWidths[camera] + 1 < (unsigned int)frameHeights[camera]);
+	}
+	if (!isValid)
+		clear();
+	return isValid;
+}
+
+static short toFixedWeight(float weight)
+{
+	float fixedWeight = weight * (1 << REMAP_WEIGHT_BITS) + 0.5f;
+	if (fixedWeight < 0.0f)
+		return 0;
+	if (fixedWeight > 32767.0f)
+		return 32767;
+	return (short)fixedWeight;
+}
+
+//number of sources of output pixel in program (1, 2 or 4)
+static int getSourcesCount(const ofxRemapRecord& record,bool isBlending)
+{
+	if ((!isBlending) || (record.cameras[1] == REMAP_NULL_CAMERA))
+		return 1;
+	return (record.cameras[2] != REMAP_NULL_CAMERA) || (record.cameras[3] != REMAP_NULL_CAMERA) ? 4 : 2;
+}
+
+void ofxRemapProgram::build(const ofxRemapRecord* records,int size,bool isBlending,bool isBilinear,const int* frameWidths,int camerasCount)
+{
+	clear();
+	if (size <= 0)
+		return;
+	setFrameWidths(frameWidths,camerasCount);
+	//first pass counts runs, sources and weights, second one fills them
+	for (int pass=0;pass<2;pass++)
+	{
+		if (pass == 1)
+		{
+			runs = (ofxRemapRun*)malloc(runsCount * sizeof(ofxRemapRun));
+			sources = (unsigned int*)malloc(sourcesCount * sizeof(unsigned int));
+			weights = (short*)malloc((weightsCount > 0 ? weightsCount : 1) * sizeof(short));
+			if (isBilinear)
+				fractions = (unsigned short*)malloc(sourcesCount * sizeof(unsigned short));
+			runsCount = sourcesCount = weightsCount = 0;
+		}
+		ofxRemapRun run;
+		run.length = 0;
+		for (int i=0;i<size;i++)
+		{
+			const ofxRemapRecord& record = records[i];
+			int count = getSourcesCount(record,isBlending);
+			bool isSameRun = (run.length > 0) && (run.sourcesCount == count) && (run.length < REMAP_MAX_RUN_LENGTH) &&
+				((count > 1) || (run.camera == record.cameras[0]));
+			if (!isSameRun)
+			{
+				if ((run.length > 0) && (pass == 1))
+					runs[runsCount] = run;
+				if (run.length > 0)
+					runsCount++;
+				run.start = i;
+				run.length = 0;
+				run.firstSource = sourcesCount;
+				run.firstWeight = weightsCount;
+				run.sourcesCount = (unsigned char)count;
+				run.camera = record.cameras[0];
+			}
+			if (pass == 1)
+			{
+				for (int j=0;j<count;j++)
+				{
+					//padding repeats the third source, so the last non-black source stays the same
+					int k = record.cameras[j] != REMAP_NULL_CAMERA ? j : j - 1;
+					sources[sourcesCount + j] = ((unsigned int)record.cameras[k] << REMAP_CAMERA_SHIFT) | (record.offsets[k] & REMAP_OFFSET_MASK);
+					if (count > 1)
+						weights[weightsCount + j] = k == j ? toFixedWeight(record.weights[k]) : 0;
+					if (isBilinear)
+						fractions[sourcesCount + j] = record.fractions[k];
+				}
+				if (count > 1)
+					blendedPixelsCount++;
+			}
+			sourcesCount += count;
+			if (count > 1)
+				weightsCount += count;
+			run.length++;
+		}
+		if (pass == 1)
+			runs[runsCount] = run;
+		runsCount++;
+	}
+}
+
+bool ofxRemapProgram::setSourceOffset(int pixel,int camera,unsigned int offset,unsigned short fraction)
+{
+	//runs cover output pixels in order
+	int first = 0,last = runsCount - 1;
+	while (first < last)
+	{
+		int middle = (first + last + 1) / 2;
+		if (runs[middle].start <= (unsigned int)pixel)
+			first = middle;
+		else
+			last = middle - 1;
+	}
+	if ((runsCount == 0) || (pixel - (int)runs[first].start >= runs[first].length))
+		return false;
+	const ofxRemapRun& run = runs[first];
+	int firstSource = run.firstSource + (pixel - run.start) * run.sourcesCount;
+	unsigned int* pixelSources = sources + firstSource;
+	bool isFound = false;
+	//padding source of 3 camera pixels is replaced too
+	for (int j=0;j<run.sourcesCount;j++)
+	{
+		if ((pixelSources[j] >> REMAP_CAMERA_SHIFT) == (unsigned int)camera)
+		{
+			pixelSources[j] = ((unsigned int)camera << REMAP_CAMERA_SHIFT) | (offset & REMAP_OFFSET_MASK);
+			if (fractions != NULL)
+				fractions[firstSource + j] = fraction;
+			isFound = true;
+		}
+	}
+	return isFound;
+}
+
+void ofxRemapProgram::getTileSources(int width,int tileSize,int tilesWidth,int tilesHeight,short* bounds)
+{
+	for (int i=0;i<tilesWidth*tilesHeight*camerasCount;i++)
+	{
+		short* tileBounds = bounds + i * 4;
+		tileBounds[0] = tileBounds[1] = 0x7FFF;
+		tileBounds[2] = tileBounds[3] = -1;
+	}
+	//bilinear sources read one more column and row
+	int taps = fractions != NULL ? 1 : 0;
+	for (int i=0;i<runsCount;i++)
+	{
+		const ofxRemapRun& run = runs[i];
+		for (int k=0;k<run.length;k++)
+		{
+			int pixel = run.start + k;
+			int tile = (pixel / width / tileSize) * tilesWidth + (pixel % width) / tileSize;
+			for (int j=0;j<run.sourcesCount;j++)
+			{
+				unsigned int source = sources[run.firstSource + k * run.sourcesCount + j];
+				int camera = source >> REMAP_CAMERA_SHIFT;
+				int offset = source & REMAP_OFFSET_MASK;
+				if (camera >= camerasCount)
+					continue;
+				short* tileBounds = bounds + (tile * camerasCount + camera) * 4;
+				int x = offset % frameWidths[camera];
+				int y = offset / frameWidths[camera];
+				short left = (short)(x / tileSize),top = (short)(y / tileSize);
+				short right = (short)((x + taps) / tileSize),bottom = (short)((y + taps) / tileSize);
+				if (left < tileBounds[0])
+					tileBounds[0] = left;
+				if (top < tileBounds[1])
+					tileBounds[1] = top;
+				if (right > tileBounds[2])
+					tileBounds[2] = right;
+				if (bottom > tileBounds[3])
+					tileBounds[3] = bottom;
+			}
+		}
+	}
+}
+
+#define REMAP_PIXEL(source) (sourceFrames[(source) >> REMAP_CAMERA_SHIFT][(source) & REMAP_OFFSET_MASK])
+
+#define REMAP_FRACTION_ONE (1 << REMAP_FRACTION_BITS)
+#define REMAP_FRACTION_MASK (REMAP_FRACTION_ONE - 1)
+#define REMAP_FRACTION_HALF (1 << (REMAP_FRACTION_BITS - 1))
+
+//taps are interpolated in rows first, both steps are rounded to 8 bits so they fit 16 bit lanes of SSE2 path
+static inline int interpolateTaps(const unsigned char* taps,int width,unsigned short fraction)
+{
+	int x = fraction & REMAP_FRACTION_MASK;
+	int y = fraction >> REMAP_FRACTION_BITS;
+	int top = (taps[0] * (REMAP_FRACTION_ONE - x) + taps[1] * x + REMAP_FRACTION_HALF) >> REMAP_FRACTION_BITS;
+	int bottom = (taps[width] * (REMAP_FRACTION_ONE - x) + taps[width+1] * x + REMAP_FRACTION_HALF) >> REMAP_FRACTION_BITS;
+	return (top * (REMAP_FRACTION_ONE - y) + bottom * y + REMAP_FRACTION_HALF) >> REMAP_FRACTION_BITS;
+}
+
+//nearest source pixel when fraction is NULL, bilinear one otherwise
+static inline int fetchPixel(unsigned int source,const unsigned short* fraction,unsigned char** sourceFrames,const int* frameWidths)
+{
+	if (fraction == NULL)
+		return REMAP_PIXEL(source);
+	return interpolateTaps(&REMAP_PIXEL(source),frameWidths[source >> REMAP_CAMERA_SHIFT],*fraction);
+}
+
+static void gatherCopy(const unsigned int* pixelSources,const unsigned char* frame,unsigned char* dst,int length)
+{
+	int k = 0;
+	for (;k+4<=length;k+=4)
+	{
+		dst[k] = frame[pixelSources[k] & REMAP_OFFSET_MASK];
+		dst[k+1] = frame[pixelSources[k+1] & REMAP_OFFSET_MASK];
+		dst[k+2] = frame[pixelSources[k+2] & REMAP_OFFSET_MASK];
+		dst[k+3] = frame[pixelSources[k+3] & REMAP_OFFSET_MASK];
+	}
+	for (;k<length;k++)
+		dst[k] = frame[pixelSources[k] & REMAP_OFFSET_MASK];
+}
+
+static void interpolateScalar(const unsigned int* pixelSources,const unsigned short* pixelFractions,const unsigned char* frame,int width,unsigned char* dst,int from,int length)
+{
+	for (int k=from;k<length;k++)
+		dst[k] = (unsigned char)interpolateTaps(frame + (pixelSources[k] & REMAP_OFFSET_MASK),width,pixelFractions[k]);
+}
+
+//sum of weighted sources is truncated and saturated like the float blending was
+static void blendScalar(const unsigned int* pixelSources,const short* pixelWeights,const unsigned short* pixelFractions,unsigned char** sourceFrames,const int* frameWidths,unsigned char* dst,int from,int length,int count)
+{
+	for (int k=from;k<length;k++)
+	{
+		int sum = 0;
+		for (int j=0;j<count;j++)
+			sum += fetchPixel(pixelSources[k * count + j],pixelFractions != NULL ? &pixelFractions[k * count + j] : NULL,sourceFrames,frameWidths) * pixelWeights[k * count + j];
+		sum >>= REMAP_WEIGHT_BITS;
+		dst[k] = (unsigned char)(sum > 255 ? 255 : sum);
+	}
+}
+
+#if defined(OFX_SSE2)
+
+static inline __m128i gatherEight(const unsigned int* s,unsigned char** sourceFrames)
+{
+	return _mm_setr_epi16(REMAP_PIXEL(s[0]),REMAP_PIXEL(s[1]),REMAP_PIXEL(s[2]),REMAP_PIXEL(s[3]),REMAP_PIXEL(s[4]),REMAP_PIXEL(s[5]),REMAP_PIXEL(s[6]),REMAP_PIXEL(s[7]));
+}
+
+//one step of interpolateTaps for eight pixels, pairs have first tap in low byte and second one in high byte
+static inline __m128i interpolatePairs(__m128i pairs,__m128i fraction)
+{
+	__m128i first = _mm_and_si128(pairs,_mm_set1_epi16(0xFF));
+	__m128i second = _mm_srli_epi16(pairs,8);
+	__m128i sum = _mm_add_epi16(_mm_mullo_epi16(first,_mm_sub_epi16(_mm_set1_epi16(REMAP_FRACTION_ONE),fraction)),_mm_mullo_epi16(second,fraction));
+	return _mm_srli_epi16(_mm_add_epi16(sum,_mm_set1_epi16(REMAP_FRACTION_HALF)),REMAP_FRACTION_BITS);
+}
+
+//eight bilinear pixels as 16 bit values from tap pairs of their top and bottom rows, gives exactly the same results as interpolateTaps
+static inline __m128i interpolateRows(__m128i tops,__m128i bottoms,const unsigned short* f)
+{
+	__m128i fraction = _mm_loadu_si128((const __m128i*)f);
+	__m128i x = _mm_and_si128(fraction,_mm_set1_epi16(REMAP_FRACTION_MASK));
+	__m128i y = _mm_srli_epi16(fraction,REMAP_FRACTION_BITS);
+	__m128i top = interpolatePairs(tops,x);
+	__m128i bottom = interpolatePairs(bottoms,x);
+	return interpolatePairs(_mm_or_si128(top,_mm_slli_epi16(bottom,8)),y);
+}
+
+#define REMAP_TAPS(taps) ((taps)[0] | ((taps)[1] << 8))
+
+static inline __m128i interpolateEight(const unsigned int* s,const unsigned short* f,unsigned char** sourceFrames,const int* frameWidths)
+{
+	const unsigned char* taps[8];
+	int widths[8];
+	for (int i=0;i<8;i++)
+	{
+		taps[i] = &REMAP_PIXEL(s[i]);
+		widths[i] = frameWidths[s[i] >> REMAP_CAMERA_SHIFT];
+	}
+	__m128i tops = _mm_setr_epi16(REMAP_TAPS(taps[0]),REMAP_TAPS(taps[1]),REMAP_TAPS(taps[2]),REMAP_TAPS(taps[3]),
+		REMAP_TAPS(taps[4]),REMAP_TAPS(taps[5]),REMAP_TAPS(taps[6]),REMAP_TAPS(taps[7]));
+	__m128i bottoms = _mm_setr_epi16(REMAP_TAPS(taps[0]+widths[0]),REMAP_TAPS(taps[1]+widths[1]),REMAP_TAPS(taps[2]+widths[2]),REMAP_TAPS(taps[3]+widths[3]),
+		REMAP_TAPS(taps[4]+widths[4]),REMAP_TAPS(taps[5]+widths[5]),REMAP_TAPS(taps[6]+widths[6]),REMAP_TAPS(taps[7]+widths[7]));
+	return interpolateRows(tops,bottoms,f);
+}
+
+static inline __m128i fetchEight(const unsigned int* s,const unsigned short* f,unsigned char** sourceFrames,const int* frameWidths)
+{
+	return f == NULL ? gatherEight(s,sourceFrames) : interpolateEight(s,f,sourceFrames,frameWidths);
+}
+
+//single source run reads one camera, so its frame and row stride are the same for all pixels
+static int interpolateCopy(const unsigned int* pixelSources,const unsigned short* pixelFractions,const unsigned char* frame,int width,unsigned char* dst,int length)
+{
+	int k = 0;
+	for (;k+8<=length;k+=8)
+	{
+		const unsigned int* s = pixelSources + k;
+		const unsigned char* taps[8];
+		for (int i=0;i<8;i++)
+			taps[i] = frame + (s[i] & REMAP_OFFSET_MASK);
+		__m128i tops = _mm_setr_epi16(REMAP_TAPS(taps[0]),REMAP_TAPS(taps[1]),REMAP_TAPS(taps[2]),REMAP_TAPS(taps[3]),
+			REMAP_TAPS(taps[4]),REMAP_TAPS(taps[5]),REMAP_TAPS(taps[6]),REMAP_TAPS(taps[7]));
+		__m128i bottoms = _mm_setr_epi16(REMAP_TAPS(taps[0]+width),REMAP_TAPS(taps[1]+width),REMAP_TAPS(taps[2]+width),REMAP_TAPS(taps[3]+width),
+			REMAP_TAPS(taps[4]+width),REMAP_TAPS(taps[5]+width),REMAP_TAPS(taps[6]+width),REMAP_TAPS(taps[7]+width));
+		__m128i result = interpolateRows(tops,bottoms,pixelFractions + k);
+		_mm_storel_epi64((__m128i*)(dst+k),_mm_packus_epi16(result,result));
+	}
+	return k;
+}
+
+#undef REMAP_TAPS
+
+static inline void storeEight(unsigned char* dst,__m128i sumLow,__m128i sumHigh)
+{
+	__m128i result = _mm_packs_epi32(_mm_srai_epi32(sumLow,REMAP_WEIGHT_BITS),_mm_srai_epi32(sumHigh,REMAP_WEIGHT_BITS));
+	_mm_storel_epi64((__m128i*)dst,_mm_packus_epi16(result,result));
+}
+
+//two sources per pixel: pixels and weights are interleaved, so madd gives sum of each pixel
+static int blendTwo(const unsigned int* pixelSources,const short* pixelWeights,const unsigned short* pixelFractions,unsigned char** sourceFrames,const int* frameWidths,unsigned char* dst,int length)
+{
+	int k = 0;
+	for (;k+8<=length;k+=8)
+	{
+		const unsigned int* s = pixelSources + k * 2;
+		const short* w = pixelWeights + k * 2;
+		const unsigned short* f = pixelFractions != NULL ? pixelFractions + k * 2 : NULL;
+		__m128i sumLow = _mm_madd_epi16(fetchEight(s,f,sourceFrames,frameWidths),_mm_loadu_si128((const __m128i*)w));
+		__m128i sumHigh = _mm_madd_epi16(fetchEight(s+8,f != NULL ? f+8 : NULL,sourceFrames,frameWidths),_mm_loadu_si128((const __m128i*)(w+8)));
+		storeEight(dst+k,sumLow,sumHigh);
+	}
+	return k;
+}
+
+//four sources per pixel: madd gives two partial sums of each pixel, they are added after deinterleaving
+static inline __m128i addPartialSums(__m128i a,__m128i b)
+{
+	__m128 first = _mm_shuffle_ps(_mm_castsi128_ps(a),_mm_castsi128_ps(b),_MM_SHUFFLE(2,0,2,0));
+	__m128 second = _mm_shuffle_ps(_mm_castsi128_ps(a),_mm_castsi128_ps(b),_MM_SHUFFLE(3,1,3,1));
+	return _mm_add_epi32(_mm_castps_si128(first),_mm_castps_si128(second));
+}
+
+static int blendFour(const unsigned int* pixelSources,const short* pixelWeights,const unsigned short* pixelFractions,unsigned char** sourceFrames,const int* frameWidths,unsigned char* dst,int length)
+{
+	int k = 0;
+	for (;k+8<=length;k+=8)
+	{
+		__m128i partial[4];
+		for (int j=0;j<4;j++)
+		{
+			const unsigned short* f = pixelFractions != NULL ? pixelFractions + k * 4 + j * 8 : NULL;
+			partial[j] = _mm_madd_epi16(fetchEight(pixelSources + k * 4 + j * 8,f,sourceFrames,frameWidths),_mm_loadu_si128((const __m128i*)(pixelWeights + k * 4 + j * 8)));
+		}
+		storeEight(dst+k,addPartialSums(partial[0],partial[1]),addPartialSums(partial[2],partial[3]));
+	}
+	return k;
+}
+
+#else
+
+//scalar code does every pixel
+static int interpolateCopy(const unsigned int*,const unsigned short*,const unsigned char*,int,unsigned char*,int)
+{
+	return 0;
+}
+
+static int blendTwo(const unsigned int*,const short*,const unsigned short*,unsigned char**,const int*,unsigned char*,int)
+{
+	return 0;
+}
+
+static int blendFour(const unsigned int*,const short*,const unsigned short*,unsigned char**,const int*,unsigned char*,int)
+{
+	return 0;
+}
+
+#endif
+
+void ofxRemapProgram::executeRun(const ofxRemapRun& run,unsigned char** sourceFrames,unsigned char* stitchedFrame)
+{
+	const unsigned int* pixelSources = sources + run.firstSource;
+	const short* pixelWeights = weights + run.firstWeight;
+	const unsigned short* pixelFractions = fractions != NULL ? fractions + run.firstSource : NULL;
+	unsigned char* dst = stitchedFrame + run.start;
+	int length = run.length;
+	if ((run.sourcesCount == 1) && (pixelFractions == NULL))
+		gatherCopy(pixelSources,sourceFrames[run.camera],dst,length);
+	else if (run.sourcesCount == 1)
+		interpolateScalar(pixelSources,pixelFractions,sourceFrames[run.camera],frameWidths[run.camera],dst,interpolateCopy(pixelSources,pixelFractions,sourceFrames[run.camera],frameWidths[run.camera],dst,length),length);
+	else if (run.sourcesCount == 2)
+		blendScalar(pixelSources,pixelWeights,pixelFractions,sourceFrames,frameWidths,dst,blendTwo(pixelSources,pixelWeights,pixelFractions,sourceFrames,frameWidths,dst,length),length,2);
+	else
+		blendScalar(pixelSources,pixelWeights,pixelFractions,sourceFrames,frameWidths,dst,blendFour(pixelSources,pixelWeights,pixelFractions,sourceFrames,frameWidths,dst,length),length,4);
+}
+
+void ofxRemapProgram::executeCalibrationRun(const ofxRemapRun& run,unsigned char** sourceFrames,unsigned char* stitchedFrame)
+{
+	const unsigned int* pixelSources = sources + run.firstSource;
+	const unsigned short* pixelFractions = fractions != NULL ? fractions + run.firstSource : NULL;
+	unsigned char* dst = stitchedFrame + run.start;
+	int count = run.sourcesCount;
+	if ((count == 1) && (pixelFractions == NULL))
+	{
+		gatherCopy(pixelSources,sourceFrames[run.camera],dst,run.length);
+		return;
+	}
+	for (int k=0;k<run.length;k++)
+	{
+		unsigned char result = 0;
+		for (int j=0;j<count;j++)
+		{
+			unsigned char pixel = (unsigned char)fetchPixel(pixelSources[k * count + j],pixelFractions != NULL ? &pixelFractions[k * count + j] : NULL,sourceFrames,frameWidths);
+			if (pixel != 0)
+				result = pixel;
+		}
+		dst[k] = result;
+	}
+}
+
+#undef REMAP_PIXEL
+
+//runs are shared with pool workers in chunks of this many
+#define REMAP_RUNS_GRAIN 8
+
+struct ofxRemapExecution
+{
+	ofxRemapProgram* program;
+	unsigned char** sourceFrames;
+	unsigned char* stitchedFrame;
+	const ofxRemapSkip* skip;
+};
+
+static inline bool isRunSkipped(const ofxRemapRun& run,const ofxRemapSkip* skip)
+{
+	return (skip != NULL) && (skip->cameras != NULL) && (run.sourcesCount == 1) && skip->cameras[run.camera];
+}
+
+void ofxRemapProgram::executeRunPart(const ofxRemapRun& run,unsigned int start,unsigned int end,unsigned char** sourceFrames,unsigned char* stitchedFrame,bool isCalibration)
+{
+	//pixels of run have the same number of sources, blended ones have weight for each of them
+	unsigned int offset = start - run.start;
+	ofxRemapRun part = run;
+	part.start = start;
+	part.length = (unsigned short)(end - start);
+	part.firstSource += offset * run.sourcesCount;
+	if (run.sourcesCount > 1)
+		part.firstWeight += offset * run.sourcesCount;
+	if (isCalibration)
+		executeCalibrationRun(part,sourceFrames,stitchedFrame);
+	else
+		executeRun(part,sourceFrames,stitchedFrame);
+}
+
+void ofxRemapProgram::executeRunTiles(const ofxRemapRun& run,unsigned char** sourceFrames,unsigned char* stitchedFrame,const ofxRemapSkip* skip,bool isCalibration)
+{
+	unsigned int width = skip->width;
+	unsigned int tileSize = skip->tileSize;
+	unsigned int end = run.start + run.length;
+	//position is followed by column and tile without dividing for every tile
+	unsigned int x = run.start % width;
+	unsigned int y = run.start / width;
+	unsigned int tileX = x / tileSize;
+	const unsigned char* tilesRow = skip->tiles + (y / tileSize) * skip->tilesWidth;
+	//run inside one row without skipped tile is executed at once, without any is skipped at once
+	if (x + run.length <= width)
+	{
+		unsigned int tilesCount = (x + run.length - 1) / tileSize - tileX + 1;
+		if (memchr(tilesRow + tileX,0,tilesCount) == NULL)
+		{
+			executeRunPart(run,run.start,end,sourceFrames,stitchedFrame,isCalibration);
+			return;
+		}
+		if (memchr(tilesRow + tileX,1,tilesCount) == NULL)
+			return;
+	}
+	//parts of run in dirty tiles next to each other are executed at once
+	unsigned int dirtyStart = run.start;
+	unsigned int position = run.start;
+	while (position < end)
+	{
+		//part of run inside one tile ends at the next tile column or at the end of row
+		unsigned int columnEnd = (tileX + 1) * tileSize < width ? (tileX + 1) * tileSize : width;
+		unsigned int partEnd = position + columnEnd - x;
+		if (partEnd > end)
+			partEnd = end;
+		if (tilesRow[tileX] == 0)
+		{
+			if (dirtyStart < position)
+				executeRunPart(run,dirtyStart,position,sourceFrames,stitchedFrame,isCalibration);
+			dirtyStart = partEnd;
+		}
+		x += partEnd - position;
+		position = partEnd;
+		tileX++;
+		if (x >= width)
+		{
+			x = 0;
+			tileX = 0;
+			y++;
+			tilesRow = skip->tiles + (y / tileSize) * skip->tilesWidth;
+		}
+	}
+	if (dirtyStart < end)
+		executeRunPart(run,dirtyStart,end,sourceFrames,stitchedFrame,isCalibration);
+}
+
+void ofxRemapProgram::ExecuteRuns(void* instance,int first,int last,int /*participant*/)
+{
+	ofxRemapExecution* execution = (ofxRemapExecution*)instance;
+	ofxRemapProgram* pThis = execution->program;
+	const ofxRemapSkip* skip = execution->skip;
+	for (int i=first;i<last;i++)
+	{
+		if (isRunSkipped(pThis->runs[i],skip))
+			continue;
+		if ((skip != NULL) && (skip->tiles != NULL))
+			pThis->executeRunTiles(pThis->runs[i],execution->sourceFrames,execution->stitchedFrame,skip,false);
+		else
+			pThis->executeRun(pThis->runs[i],execution->sourceFrames,execution->stitchedFrame);
+	}
+}
+
+void ofxRemapProgram::ExecuteCalibrationRuns(void* instance,int first,int last,int /*participant*/)
+{
+	ofxRemapExecution* execution = (ofxRemapExecution*)instance;
+	ofxRemapProgram* pThis = execution->program;
+	const ofxRemapSkip* skip = execution->skip;
+	for (int i=first;i<last;i++)
+	{
+		if (isRunSkipped(pThis->runs[i],skip))
+			continue;
+		if ((skip != NULL) && (skip->tiles != NULL))
+			pThis->executeRunTiles(pThis->runs[i],execution->sourceFrames,execution->stitchedFrame,skip,true);
+		else
+			pThis->executeCalibrationRun(pThis->runs[i],execution->sourceFrames,execution->stitchedFrame);
+	}
+}
+
+void ofxRemapProgram::execute(unsigned char** sourceFrames,unsigned char* stitchedFrame,const ofxRemapSkip* skip)
+{
+	ofxRemapExecution execution = { this, sourceFrames, stitchedFrame, skip };
+	ofxThreadPool::getShared()->parallelFor(runsCount,REMAP_RUNS_GRAIN,&ofxRemapProgram::ExecuteRuns,&execution);
+}
+
+void ofxRemapProgram::executeCalibration(unsigned char** sourceFrames,unsigned char* stitchedFrame,const ofxRemapSkip* skip)
+{
+	ofxRemapExecution execution = { this, sourceFrames, stitchedFrame, skip };
+	ofxThreadPool::getShared()->parallelFor(runsCount,REMAP_RUNS_GRAIN,&ofxRemapProgram::ExecuteCalibrationRuns,&execution);
+}
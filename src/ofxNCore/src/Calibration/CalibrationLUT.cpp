@@ -0,0 +1,198 @@
+/*
+*  CalibrationLUT.cpp
+*
+*  Created on 17/10/26.
+*  Copyright 2026 NUI Group. All rights reserved.
+*
+*/
+
+#include "CalibrationLUT.h"
+#include "ofxCameraBasePlatform.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#if defined(OFX_SSE2)
+	#include <emmintrin.h>
+#endif
+
+CalibrationLUT::CalibrationLUT()
+{
+	nodes = NULL;
+	frameWidth = frameHeight = 0;
+	step = 1;
+	invStep = 1.0f;
+	nodesWidth = nodesHeight = 0;
+}
+
+CalibrationLUT::~CalibrationLUT()
+{
+	clear();
+}
+
+void CalibrationLUT::clear()
+{
+	if (nodes != NULL)
+		free(nodes);
+	nodes = NULL;
+	nodesWidth = nodesHeight = 0;
+}
+
+void CalibrationLUT::build(ofxCalibrationMesh* mesh,int frameWidth,int frameHeight,int step)
+{
+	clear();
+	this->frameWidth = frameWidth;
+	this->frameHeight = frameHeight;
+	this->step = step > 0 ? step : 1;
+	invStep = 1.0f / this->step;
+	//the last node is at the last pixel or behind it
+	nodesWidth = (frameWidth - 1) / this->step + 2;
+	nodesHeight = (frameHeight - 1) / this->step + 2;
+	nodes = (float*)malloc(nodesWidth * nodesHeight * 4 * sizeof(float));
+	memset(nodes,0,nodesWidth * nodesHeight * 4 * sizeof(float));
+	int trianglesCount = mesh->getTrianglesCount();
+	const int* triangles = mesh->getTriangles();
+	const vector2df* cameraPoints = mesh->getCameraPoints();
+	//triangles are rasterized in mesh order and don't take nodes of previous ones, as remap of mesh does
+	for (int t=0;t<trianglesCount*3;t+=3)
+	{
+		const vector2df& A = cameraPoints[triangles[t+0]];
+		const vector2df& B = cameraPoints[triangles[t+1]];
+		const vector2df& C = cameraPoints[triangles[t+2]];
+		float left = A.X < B.X ? A.X : B.X;
+		left = (left < C.X ? left : C.X) * invStep;
+		float top = A.Y < B.Y ? A.Y : B.Y;
+		top = (top < C.Y ? top : C.Y) * invStep;
+		float right = A.X > B.X ? A.X : B.X;
+		right = (right > C.X ? right : C.X) * invStep;
+		float bottom = A.Y > B.Y ? A.Y : B.Y;
+		bottom = (bottom > C.Y ? bottom : C.Y) * invStep;
+		if ((right < 0.0f) || (bottom < 0.0f) || (left > nodesWidth - 1) || (top > nodesHeight - 1))
+			continue;
+		int firstX = left > 0.0f ? (int)left : 0;
+		int firstY = top > 0.0f ? (int)top : 0;
+		int lastX = right < nodesWidth - 1 ? (int)ceil(right) : nodesWidth - 1;
+		int lastY = bottom < nodesHeight - 1 ? (int)ceil(bottom) : nodesHeight - 1;
+		for (int y=firstY;y<=lastY;y++)
+		{
+			for (int x=firstX;x<=lastX;x++)
+			{
+				float* node = nodes + (y * nodesWidth + x) * 4;
+				float screenX,screenY;
+				if ((node[2] != 0.0f) || (!mesh->mapCameraPoint(t,vector2df((float)(x * this->step),(float)(y * this->step)),&screenX,&screenY)))
+					continue;
+				node[0] = screenX;
+				node[1] = screenY;
+				node[2] = 1.0f;
+			}
+		}
+	}
+	if (trianglesCount <= 0)
+		return;
+	//the rest is extrapolated, so points leaving calibrated area a bit still move smoothly
+	vector2df* centers = (vector2df*)malloc(trianglesCount * sizeof(vector2df));
+	for (int i=0;i<trianglesCount;i++)
+		centers[i] = (cameraPoints[triangles[i*3]] + cameraPoints[triangles[i*3+1]] + cameraPoints[triangles[i*3+2]]) / 3.0f;
+	for (int y=0;y<nodesHeight;y++)
+	{
+		for (int x=0;x<nodesWidth;x++)
+		{
+			float* node = nodes + (y * nodesWidth + x) * 4;
+			if (node[2] != 0.0f)
+				continue;
+			vector2df point((float)(x * this->step),(float)(y * this->step));
+			int nearest = 0;
+			for (int i=1;i<trianglesCount;i++)
+			{
+				if (point.getDistanceFromSQ(centers[i]) < point.getDistanceFromSQ(centers[nearest]))
+					nearest = i;
+			}
+			mesh->mapCameraPoint(nearest * 3,point,&node[0],&node[1]);
+		}
+	}
+	free(centers);
+}
+
+bool CalibrationLUT::map(float x,float y,float* screenX,float* screenY)
+{
+	//points outside of frame use the border cell, its fractions go out of 0..1 and extrapolate it
+	float gridX = x * invStep;
+	float gridY = y * invStep;
+	float maxX = (float)(nodesWidth - 2);
+	float maxY = (float)(nodesHeight - 2);
+	float cellX = (float)(int)(gridX > 0.0f ? (gridX < maxX ? gridX : maxX) : 0.0f);
+	float cellY = (float)(int)(gridY > 0.0f ? (gridY < maxY ? gridY : maxY) : 0.0f);
+	float fractionX = gridX - cellX;
+	float fractionY = gridY - cellY;
+	const float* topLeft = nodes + ((int)cellY * nodesWidth + (int)cellX) * 4;
+	const float* bottomLeft = topLeft + nodesWidth * 4;
+	float result[3];
+	for (int i=0;i<3;i++)
+	{
+		float top = topLeft[i] + (topLeft[i+4] - topLeft[i]) * fractionX;
+		float bottom = bottomLeft[i] + (bottomLeft[i+4] - bottomLeft[i]) * fractionX;
+		result[i] = top + (bottom - top) * fractionY;
+	}
+	*screenX = result[0];
+	*screenY = result[1];
+	return (result[2] >= 0.5f) && (x >= 0.0f) && (y >= 0.0f) && (x < frameWidth) && (y < frameHeight);
+}
+
+int CalibrationLUT::mapPoints(float* points,int count,int stride,unsigned char* inside)
+{
+	int insideCount = 0;
+	int i = 0;
+#if defined(OFX_SSE2)
+	//cells of four points are found at once, each point is then interpolated in x,y,coverage lanes
+	//with the same operations as map, so both give the same results
+	__m128 invSteps = _mm_set1_ps(invStep);
+	__m128 zero = _mm_setzero_ps();
+	__m128 maxX = _mm_set1_ps((float)(nodesWidth - 2));
+	__m128 maxY = _mm_set1_ps((float)(nodesHeight - 2));
+	__m128 rowNodes = _mm_set1_ps((float)nodesWidth);
+	for (;i+4<=count;i+=4)
+	{
+		float* p = points + i * stride;
+		__m128 x = _mm_setr_ps(p[0],p[stride],p[stride*2],p[stride*3]);
+		__m128 y = _mm_setr_ps(p[1],p[stride+1],p[stride*2+1],p[stride*3+1]);
+		__m128 gridX = _mm_mul_ps(x,invSteps);
+		__m128 gridY = _mm_mul_ps(y,invSteps);
+		__m128 cellX = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_max_ps(_mm_min_ps(gridX,maxX),zero)));
+		__m128 cellY = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_max_ps(_mm_min_ps(gridY,maxY),zero)));
+		int offsets[4];
+		float fractionsX[4],fractionsY[4],positionsX[4],positionsY[4];
+		_mm_storeu_si128((__m128i*)offsets,_mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(cellY,rowNodes),cellX)));
+		_mm_storeu_ps(fractionsX,_mm_sub_ps(gridX,cellX));
+		_mm_storeu_ps(fractionsY,_mm_sub_ps(gridY,cellY));
+		_mm_storeu_ps(positionsX,x);
+		_mm_storeu_ps(positionsY,y);
+		for (int j=0;j<4;j++)
+		{
+			const float* topLeft = nodes + offsets[j] * 4;
+			const float* bottomLeft = topLeft + nodesWidth * 4;
+			__m128 fractionX = _mm_set1_ps(fractionsX[j]);
+			__m128 topLeftNode = _mm_loadu_ps(topLeft);
+			__m128 bottomLeftNode = _mm_loadu_ps(bottomLeft);
+			__m128 top = _mm_add_ps(topLeftNode,_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(topLeft + 4),topLeftNode),fractionX));
+			__m128 bottom = _mm_add_ps(bottomLeftNode,_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(bottomLeft + 4),bottomLeftNode),fractionX));
+			float result[4];
+			_mm_storeu_ps(result,_mm_add_ps(top,_mm_mul_ps(_mm_sub_ps(bottom,top),_mm_set1_ps(fractionsY[j]))));
+			float* point = p + j * stride;
+			point[0] = result[0];
+			point[1] = result[1];
+			bool isInside = (result[2] >= 0.5f) && (positionsX[j] >= 0.0f) && (positionsY[j] >= 0.0f) && (positionsX[j] < frameWidth) && (positionsY[j] < frameHeight);
+			if (inside != NULL)
+				inside[i + j] = isInside ? 1 : 0;
+			insideCount += isInside ? 1 : 0;
+		}
+	}
+#endif
+	for (;i<count;i++)
+	{
+		float* point = points + i * stride;
+		bool isInside = map(point[0],point[1],&point[0],&point[1]);
+		if (inside != NULL)
+			inside[i] = isInside ? 1 : 0;
+		insideCount += isInside ? 1 : 0;
+	}
+	return insideCount;
+}
@@ -0,0 +1,39 @@
+/*
+*  CalibrationLUT.h
+*
+*  Created on 17/10/26.
+*  Copyright 2026 NUI Group. All rights reserved.
+*
+*/
+
+#ifndef CALIBRATION_LUT_H
+#define CALIBRATION_LUT_H
+
+#include "ofxCalibrationMesh.h"
+
+//Camera frame to screen lookup table of one camera. Nodes are every step pixels of camera frame (step 1 is dense),
+//point is bilinear between four nodes around it. Nodes take triangles and interpolation of calibration mesh, nodes
+//outside of mesh are extrapolated from the triangle with the nearest center
+class CalibrationLUT
+{
+	public:
+		CalibrationLUT();
+		~CalibrationLUT();
+		void build(ofxCalibrationMesh* mesh,int frameWidth,int frameHeight,int step);
+		void clear();
+		bool isBuilt() { return nodes != NULL; }
+		//false when point is outside of calibrated area, screen position is extrapolated then
+		bool map(float x,float y,float* screenX,float* screenY);
+		//x,y pairs every stride floats (2 for vector2df, 3 for ofPoint) are mapped in place. When inside isn't NULL,
+		//it gets 1 for points of calibrated area and 0 for the others. Returns count of points inside
+		int mapPoints(float* points,int count,int stride,unsigned char* inside);
+	private:
+		int frameWidth,frameHeight;
+		int step;
+		float invStep;
+		int nodesWidth,nodesHeight;
+		//screen x, screen y, coverage (1 inside of grid, 0 outside) and padding of each node, so node is one SSE load
+		float* nodes;
+};
+
+#endif
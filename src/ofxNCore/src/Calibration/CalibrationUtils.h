@@ -14,7 +14,9 @@
 //Used other calibration
 #include "rect2d.h"
 #include "vector2d.h"
-#include "windows.h"
+#ifdef _WIN32
+	#include "windows.h"
+#endif
 #include "memory.h"
 #include "ofMain.h"
 
@@ -0,0 +1,153 @@
+/*
+*  BackgroundModel.cpp
+*
+*
+*  Created on 17/10/26.
+*  Copyright 2026 NUI Group. All rights reserved.
+*
+*/
+
+#include "BackgroundModel.h"
+#include "ofxCameraBasePlatform.h"
+#include <stdlib.h>
+#include <string.h>
+#if defined(OFX_SSE2)
+	#include <emmintrin.h>
+#endif
+
+BackgroundModel::BackgroundModel()
+{
+	width = height = 0;
+	fractions = NULL;
+	freezeMask = NULL;
+	isFrozen = false;
+}
+
+BackgroundModel::~BackgroundModel()
+{
+	free(fractions);
+	free(freezeMask);
+}
+
+void BackgroundModel::allocate(int width,int height)
+{
+	if ((width == this->width) && (height == this->height) && (fractions != NULL))
+		return;
+	free(fractions);
+	free(freezeMask);
+	this->width = width;
+	this->height = height;
+	fractions = (unsigned short*)malloc(width * height * sizeof(unsigned short));
+	freezeMask = (unsigned char*)malloc(width * height);
+	if ((fractions == NULL) || (freezeMask == NULL))
+	{
+		free(fractions);
+		free(freezeMask);
+		fractions = NULL;
+		freezeMask = NULL;
+		this->width = this->height = 0;
+		return;
+	}
+	memset(fractions,0,width * height * sizeof(unsigned short));
+	memset(freezeMask,0,width * height);
+	isFrozen = false;
+}
+
+void BackgroundModel::learn(const unsigned char* frame,int frameStep,unsigned char* background,int backgroundStep)
+{
+	if (fractions == NULL)
+		return;
+	for (int y = 0;y < height;y++)
+		memcpy(background + y * backgroundStep,frame + y * frameStep,width);
+	memset(fractions,0,width * height * sizeof(unsigned short));
+}
+
+void BackgroundModel::update(const unsigned char* frame,int frameStep,unsigned char* background,int backgroundStep,float rate)
+{
+	updateRows(frame,frameStep,background,backgroundStep,rate,0,height);
+}
+
+void BackgroundModel::updateRows(const unsigned char* frame,int frameStep,unsigned char* background,int backgroundStep,float rate,int firstRow,int rowsCount)
+{
+	if (fractions == NULL)
+		return;
+	//rate in 1/65536, tiny rates still learn
+	int fixedRate = (int)(rate * 65536.0f + 0.5f);
+	if ((fixedRate < 1) && (rate > 0.0f))
+		fixedRate = 1;
+	if (fixedRate > BACKGROUND_MODEL_MAX_RATE)
+		fixedRate = BACKGROUND_MODEL_MAX_RATE;
+	if (fixedRate <= 0)
+		return;
+	int lastRow = firstRow + rowsCount < height ? firstRow + rowsCount : height;
+	for (int y = firstRow < 0 ? 0 : firstRow;y < lastRow;y++)
+		updateRow(frame + y * frameStep,background + y * backgroundStep,fractions + y * width,isFrozen ? freezeMask + y * width : NULL,fixedRate);
+}
+
+//background b (level + fraction) moves by (frame - b) * rate rounded towards zero, so it never overshoots the frame
+//and level reaches frame value from both sides: b += (frame - level) * rate - ((fraction * rate) >> 16)
+void BackgroundModel::updateRow(const unsigned char* frame,unsigned char* background,unsigned short* fractions,const unsigned char* mask,int rate)
+{
+	int x = 0;
+#if defined(OFX_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i rates = _mm_set1_epi16((short)rate);
+	//madd pairs of (frame - level, fraction part) with (rate, -1)
+	const __m128i coefficients = _mm_set1_epi32((int)(0xFFFF0000u | (unsigned int)rate));
+	for (;x + 16 <= width;x += 16)
+	{
+		__m128i frames = _mm_loadu_si128((const __m128i*)(frame + x));
+		__m128i levels = _mm_loadu_si128((const __m128i*)(background + x));
+		__m128i learned = _mm_set1_epi8((char)0xFF);
+		if (mask != NULL)
+			learned = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(mask + x)),zero);
+		__m128i halves[2];
+		for (int i = 0;i < 2;i++)
+		{
+			__m128i frame16 = i == 0 ? _mm_unpacklo_epi8(frames,zero) : _mm_unpackhi_epi8(frames,zero);
+			__m128i level16 = i == 0 ? _mm_unpacklo_epi8(levels,zero) : _mm_unpackhi_epi8(levels,zero);
+			__m128i learned16 = i == 0 ? _mm_unpacklo_epi8(learned,learned) : _mm_unpackhi_epi8(learned,learned);
+			__m128i fraction = _mm_loadu_si128((const __m128i*)(fractions + x + i * 8));
+			__m128i difference = _mm_and_si128(_mm_sub_epi16(frame16,level16),learned16);
+			__m128i fractionPart = _mm_and_si128(_mm_mulhi_epu16(fraction,rates),learned16);
+			__m128i low = _mm_add_epi32(_mm_unpacklo_epi16(fraction,level16),_mm_madd_epi16(_mm_unpacklo_epi16(difference,fractionPart),coefficients));
+			__m128i high = _mm_add_epi32(_mm_unpackhi_epi16(fraction,level16),_mm_madd_epi16(_mm_unpackhi_epi16(difference,fractionPart),coefficients));
+			//low 16 bits sign extended pack back to the same bits
+			_mm_storeu_si128((__m128i*)(fractions + x + i * 8),_mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(low,16),16),_mm_srai_epi32(_mm_slli_epi32(high,16),16)));
+			halves[i] = _mm_packs_epi32(_mm_srli_epi32(low,16),_mm_srli_epi32(high,16));
+		}
+		_mm_storeu_si128((__m128i*)(background + x),_mm_packus_epi16(halves[0],halves[1]));
+	}
+#endif
+	for (;x < width;x++)
+	{
+		if ((mask != NULL) && (mask[x] != 0))
+			continue;
+		int value = (background[x] << 16) + fractions[x] + (frame[x] - background[x]) * rate - ((fractions[x] * rate) >> 16);
+		background[x] = (unsigned char)(value >> 16);
+		fractions[x] = (unsigned short)(value & 0xFFFF);
+	}
+}
+
+void BackgroundModel::clearFreeze()
+{
+	if (!isFrozen)
+		return;
+	memset(freezeMask,0,width * height);
+	isFrozen = false;
+}
+
+void BackgroundModel::freeze(int x,int y,int width,int height)
+{
+	if (freezeMask == NULL)
+		return;
+	int left = x < 0 ? 0 : x;
+	int top = y < 0 ? 0 : y;
+	int right = x + width > this->width ? this->width : x + width;
+	int bottom = y + height > this->height ? this->height : y + height;
+	if ((left >= right) || (top >= bottom))
+		return;
+	for (int row = top;row < bottom;row++)
+		memset(freezeMask + row * this->width + left,0xFF,right - left);
+	isFrozen = true;
+}
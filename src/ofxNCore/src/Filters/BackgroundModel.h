@@ -0,0 +1,48 @@
+/*
+*  BackgroundModel.h
+*
+*  Dynamic background of 8 bit frames, running average kept in fixed point. Integer part of each
+*  pixel is the 8 bit background image itself, only 16 bit fractions are kept here, so one pass
+*  over the frame both learns it and leaves the background ready for subtraction.
+*
+*  Created on 17/10/26.
+*  Copyright 2026 NUI Group. All rights reserved.
+*
+*/
+
+#ifndef BACKGROUND_MODEL_H
+#define BACKGROUND_MODEL_H
+
+//learn rate is kept in 16 bit fraction, rates above this one are clamped to it
+#define BACKGROUND_MODEL_MAX_RATE 32767
+
+class BackgroundModel
+{
+public:
+	BackgroundModel();
+	~BackgroundModel();
+	void allocate(int width,int height);
+	//background becomes the frame
+	void learn(const unsigned char* frame,int frameStep,unsigned char* background,int backgroundStep);
+	//background moves towards the frame by rate (1 is whole way), pixels set in freeze mask keep their value
+	void update(const unsigned char* frame,int frameStep,unsigned char* background,int backgroundStep,float rate);
+	//the same for rowsCount rows from firstRow only (frame and background are still whole), so bands of frame
+	//can be updated on different threads
+	void updateRows(const unsigned char* frame,int frameStep,unsigned char* background,int backgroundStep,float rate,int firstRow,int rowsCount);
+	//freeze mask is cleared before blobs of each frame are set to it
+	void clearFreeze();
+	void freeze(int x,int y,int width,int height);
+	//non zero pixels aren't learned, call setFrozen after writing to it
+	unsigned char* getFreezeMask() { return freezeMask; }
+	void setFrozen() { isFrozen = true; }
+private:
+	void updateRow(const unsigned char* frame,unsigned char* background,unsigned short* fractions,const unsigned char* mask,int rate);
+	int width,height;
+	//fractions of background pixels in 1/65536
+	unsigned short* fractions;
+	unsigned char* freezeMask;
+	//freeze mask is skipped (and not cleared) when nothing is frozen
+	bool isFrozen;
+};
+
+#endif
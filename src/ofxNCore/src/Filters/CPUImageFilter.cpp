@@ -12,6 +12,64 @@
 #include "ofxCvGrayscaleImage.h"
 #include "ofxCvFloatImage.h"
 
+//--------------------------------------------------------------------------------
+CPUImageFilter::~CPUImageFilter() {
+	dropLease();
+	if( leasedImage != NULL )
+		cvReleaseImageHeader( &leasedImage );
+}
+
+//--------------------------------------------------------------------------------
+void CPUImageFilter::setFromLeasedPixels( const unsigned char* _pixels ) {
+	if( !bAllocated ) {
+		ofLog(OF_LOG_ERROR, "in setFromLeasedPixels, image is not allocated");
+		return;
+	}
+	if( (leasedImage == NULL) || (leasedImage->width != width) || (leasedImage->height != height) ) {
+		if( leasedImage != NULL )
+			cvReleaseImageHeader( &leasedImage );
+		leasedImage = cvCreateImageHeader( cvSize(width, height), IPL_DEPTH_8U, 1 );
+	}
+	//pixels are never written through leased image
+	cvSetData( leasedImage, (void*)_pixels, width );
+	if( ownImage == NULL )
+		ownImage = cvImage;
+	cvImage = leasedImage;
+	flagImageChanged();
+}
+
+//--------------------------------------------------------------------------------
+void CPUImageFilter::dropLease() {
+	if( ownImage == NULL )
+		return;
+	cvImage = ownImage;
+	ownImage = NULL;
+	flagImageChanged();
+}
+
+//--------------------------------------------------------------------------------
+IplImage* CPUImageFilter::getTargetCvImage() {
+	dropLease();
+	return cvImage;
+}
+
+//--------------------------------------------------------------------------------
+void CPUImageFilter::mirror( bool bFlipVertically, bool bFlipHorizontally ) {
+	if( !isLeased() ) {
+		ofxCvGrayscaleImage::mirror( bFlipVertically, bFlipHorizontally );
+		return;
+	}
+	int flipMode = 0;
+	if( bFlipVertically && !bFlipHorizontally ) flipMode = 0;
+	else if( !bFlipVertically && bFlipHorizontally ) flipMode = 1;
+	else if( bFlipVertically && bFlipHorizontally ) flipMode = -1;
+	else return;
+	//flip from leased pixels straight to own image, no copy and no swap
+	IplImage* source = cvImage;
+	cvFlip( source, getTargetCvImage(), flipMode );
+	flagImageChanged();
+}
+
 //--------------------------------------------------------------------------------
 void CPUImageFilter::amplify ( CPUImageFilter& mom, float level ) {
 
@@ -23,21 +81,42 @@ void CPUImageFilter::amplify ( CPUImageFilter& mom, float level ) {
 
 void CPUImageFilter::highpass ( float blur1, float blur2 ) {
 
-	//Blur Original Image
-	if(blur1 > 0)
-	cvSmooth( cvImage, cvImageTemp, CV_BLUR , (blur1 * 2) + 1);
+	//Blur, subtraction and noise blur in one pass, it reads leased pixels and writes own image
+	if(blur1 > 0){
+		IplImage* source = cvImage;
+		IplImage* target = getTargetCvImage();
+		rowFilters.highpass( (unsigned char*)source->imageData, source->widthStep, (unsigned char*)target->imageData, target->widthStep,
+			width, height, (int)blur1, blur2 > 0 ? (int)blur2 : -1 );
+		flagImageChanged();
+		return;
+	}
 
-	//Original Image - Blur Image = Highpass Image
+	//Original Image - Temp Image, there is no blurred image without blur
 	cvSub( cvImage, cvImageTemp, cvImageTemp );
 
 	//Blur Highpass to remove noise
 	if(blur2 > 0)
-	cvSmooth( cvImageTemp, cvImageTemp, CV_BLUR , (blur2 * 2) + 1);
+	rowFilters.blur( (unsigned char*)cvImageTemp->imageData, cvImageTemp->widthStep, (unsigned char*)cvImageTemp->imageData, cvImageTemp->widthStep,
+		width, height, (int)blur2 );
 
 	swapTemp();
 	flagImageChanged();
 }
 
+//--------------------------------------------------------------------------------
+void CPUImageFilter::blur( int value ) {
+	if( value % 2 == 0 ) {
+		ofLog(OF_LOG_NOTICE, "in blur, value not odd -> will add 1 to cover your back");
+		value++;
+	}
+	//same as cvSmooth CV_BLUR, result goes to own image when pixels are leased
+	IplImage* source = cvImage;
+	IplImage* target = getTargetCvImage();
+	rowFilters.blur( (unsigned char*)source->imageData, source->widthStep, (unsigned char*)target->imageData, target->widthStep,
+		width, height, value / 2 );
+	flagImageChanged();
+}
+
 //--------------------------------------------------------------------------------
 void CPUImageFilter::operator =	( unsigned char* _pixels ) {
     setFromPixels( _pixels, width, height );
@@ -11,12 +11,14 @@
 #define CPUImageFilter_H
 
 #include "ofxCvGrayscaleImage.h"
+#include "RowFilters.h"
 
 class CPUImageFilter : public ofxCvGrayscaleImage {
 
   public:
 
-    CPUImageFilter(){};
+    CPUImageFilter(){ leasedImage = NULL; ownImage = NULL; };
+    ~CPUImageFilter();
 
     void operator = ( unsigned char* _pixels );
     void operator = ( const ofxCvGrayscaleImage& mom );
@@ -27,6 +29,24 @@ class CPUImageFilter : public ofxCvGrayscaleImage {
 	void amplify( CPUImageFilter& mom, float level );
 	//picks out light spots from image
 	void highpass(float blur1, float blur2 );
+	//box blur of running sums, its cost doesn't grow with value
+	void blur( int value=3 );
+
+	//wraps leased pixels without copying. They are only read, first operation writing
+	//the image must take its target from getTargetCvImage (or be mirror)
+	void setFromLeasedPixels( const unsigned char* _pixels );
+	bool isLeased() { return ownImage != NULL; }
+	//own image becomes current again, its content is not updated
+	void dropLease();
+	//own image as target of operation reading getCvImage, lease is dropped
+	IplImage* getTargetCvImage();
+	void mirror( bool bFlipVertically, bool bFlipHorizontally );
+
+  private:
+	IplImage* leasedImage;
+	//own image while cvImage points to leased pixels
+	IplImage* ownImage;
+	RowFilters rowFilters;
 };
 
 #endif
@@ -18,6 +18,17 @@
 
 #define CAMERA_EXPOSURE_TIME  2200.0f
 
+//stages of CPU filters drawn by GUI
+#define FILTER_PREVIEW_SOURCE 0
+#define FILTER_PREVIEW_BACKGROUND 1
+#define FILTER_PREVIEW_SMOOTH 2
+#define FILTER_PREVIEW_HIGHPASS 3
+#define FILTER_PREVIEW_AMPLIFY 4
+#define FILTER_PREVIEW_RESULT 5
+#define FILTER_PREVIEW_STAGES 6
+//milliseconds between snapshots of stage drawn by GUI
+#define FILTER_PREVIEW_INTERVAL 33
+
 class Filters {
   
 	public:
@@ -35,6 +46,9 @@ class Filters {
 		highpassAmp = 0;
 		fLearnRate = 1;
 		bDynamicTH = false;
+		bBackgroundSubtracted = false;
+		changedTiles = NULL;
+		changedTilesWidth = changedTilesHeight = changedTileSize = 0;
 		data = NULL;
 		thresholder = NULL;
 		data = NULL;
@@ -43,6 +57,13 @@ class Filters {
 		showProcessedFrame = true;
 		fiducial_tile_size = 32;
 		drawAllData = true;
+		for (int i = 0; i < FILTER_PREVIEW_STAGES; i++)
+		{
+			previewWidths[i] = previewHeights[i] = 0;
+			previewIntervals[i] = FILTER_PREVIEW_INTERVAL;
+			previewTimes[i] = 0;
+			bPreviewRequested[i] = bPreviewDue[i] = false;
+		}
 
 	  }
     bool drawAllData;
@@ -77,6 +98,12 @@ class Filters {
     bool bThreshold;
 	bool bTrackDark;
     bool bLearnBakground;
+	//frames come with background already subtracted (by multiplexer), learning and subtraction are skipped
+	bool bBackgroundSubtracted;
+	//tiles of frame changed since previous one (tile size in pixels), rows of unchanged tiles keep their filtered result.
+	//NULL when whole frame is filtered
+	const unsigned char* changedTiles;
+	int changedTilesWidth, changedTilesHeight, changedTileSize;
 	bool bMiniMode;
 	unsigned int backHistogram[256];
 
@@ -93,10 +120,69 @@ class Filters {
     ofxCvGrayscaleImage grayDiff;
     ofxCvGrayscaleImage highpassImg;
     ofxCvGrayscaleImage amplifyImg;
-	ofxCvShortImage		floatBgImg;
 	
 	ofxCvGrayscaleImage normalizedImg;
 
+	//Stage images are snapshots for drawing, they are taken only when GUI asks for them. Request holds
+	//until the first frame processed at least interval (milliseconds) after the last snapshot of stage
+	int previewWidths[FILTER_PREVIEW_STAGES];
+	int previewHeights[FILTER_PREVIEW_STAGES];
+	int previewIntervals[FILTER_PREVIEW_STAGES];
+	int previewTimes[FILTER_PREVIEW_STAGES];
+	bool bPreviewRequested[FILTER_PREVIEW_STAGES];
+	//stages snapshot from frame being processed
+	bool bPreviewDue[FILTER_PREVIEW_STAGES];
+
+	//image of stage is sampled down to width x height (it's never bigger than frame)
+	void requestPreview(int stage, int width, int height, int interval){
+		previewWidths[stage] = width < camWidth ? width : camWidth;
+		previewHeights[stage] = height < camHeight ? height : camHeight;
+		previewIntervals[stage] = interval;
+		bPreviewRequested[stage] = true;
+	}
+
+	//decides which stages are snapshot from the next frame, their images get requested size. Resizing
+	//recreates textures, so it's called on GL thread
+	void updatePreviews(){
+		int time = ofGetElapsedTimeMillis();
+		for (int i = 0; i < FILTER_PREVIEW_STAGES; i++){
+			bPreviewDue[i] = bPreviewRequested[i] && ((time - previewTimes[i]) >= previewIntervals[i]);
+			if (!bPreviewDue[i]) continue;
+			bPreviewRequested[i] = false;
+			previewTimes[i] = time;
+			ofxCvGrayscaleImage* image = getPreviewImage(i);
+			if ((image != NULL) && ((image->width != previewWidths[i]) || (image->height != previewHeights[i]))){
+				image->clear();
+				image->allocate(previewWidths[i], previewHeights[i]);
+			}
+		}
+	}
+
+	//background is drawn from learned image, it has no snapshot
+	ofxCvGrayscaleImage* getPreviewImage(int stage){
+		ofxCvGrayscaleImage* images[FILTER_PREVIEW_STAGES] = {&grayImg, NULL, &subtractBg, &highpassImg, &amplifyImg, &grayDiff};
+		return images[stage];
+	}
+
+	//nearest pixels of frame sampled to image of stage when it's due
+	void takePreview(int stage, const unsigned char* pixels, int width, int height, int step){
+		ofxCvGrayscaleImage* image = getPreviewImage(stage);
+		if (!bPreviewDue[stage] || (image == NULL)) return;
+		IplImage* preview = image->getCvImage();
+		for (int y = 0; y < preview->height; y++){
+			const unsigned char* row = pixels + (y * height / preview->height) * step;
+			unsigned char* previewRow = (unsigned char*)preview->imageData + y * preview->widthStep;
+			for (int x = 0; x < preview->width; x++)
+				previewRow[x] = row[x * width / preview->width];
+		}
+		image->flagImageChanged();
+	}
+
+	void takePreview(int stage, ofxCvImage& img){
+		IplImage* frame = img.getCvImage();
+		takePreview(stage, (unsigned char*)frame->imageData, frame->width, frame->height, frame->widthStep);
+	}
+
     //GPU
     GLuint			gpuBGTex;
     GLuint			gpuSourceTex;
@@ -121,6 +207,9 @@ class Filters {
     virtual void applyGPUFilters() = 0;
     virtual void drawGPU() = 0;
 	virtual void updateSettings() {}
+	//pixels of blobs aren't learned into dynamic background of next frame
+	virtual void clearBackgroundFreeze() {}
+	virtual void freezeBackground(const ofRectangle& rect) {}
 };
 
 
@@ -61,6 +61,8 @@ class ProcessFiducialFilters : public Filters {
 		if (data==NULL)
 			data = (unsigned char*)malloc(img.width*img.height*sizeof(unsigned char));
 		tiled_bernsen_threshold(thresholder,data,img.getPixels(),1,img.width,img.height,fiducial_tile_size,fiducialThreshold);
+		//thresholded frame replaces leased one
+		img.dropLease();
 		img.setFromPixels(data,img.width,img.height);
    		if (showProcessedFrame)
 			if(!bMiniMode)	grayDiff = img; //for drawing
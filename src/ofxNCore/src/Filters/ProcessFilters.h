@@ -11,6 +11,8 @@
 #define PROCESS_FILTERS_H_
 
 #include "Filters.h"
+#include "RowFilters.h"
+#include "BackgroundModel.h"
 
 class ProcessFilters : public Filters {
 
@@ -31,7 +33,7 @@ class ProcessFilters : public Filters {
         grayDiff.allocate(camWidth, camHeight);		//Difference Image between Background and Source
         highpassImg.allocate(camWidth, camHeight);  //Highpass Image
         amplifyImg.allocate(camWidth, camHeight);		//Amplied Image
-        floatBgImg.allocate(camWidth, camHeight);	//ofxShortImage used for simple dynamic background subtraction
+        backgroundModel.allocate(camWidth, camHeight);	//fixed point running average of dynamic background
         //GPU Setup
 		gpuReadBackBuffer = new unsigned char[camWidth*camHeight*3];
         gpuReadBackImageGS.allocate(camWidth, camHeight);
@@ -71,18 +73,15 @@ class ProcessFilters : public Filters {
 /****************************************************************
  *	CPU Filters
  ****************************************************************/
-     void applyCPUFilters(CPUImageFilter& img){
-
-        //Set Mirroring Horizontal/Vertical
-        if(bVerticalMirror || bHorizontalMirror) img.mirror(bVerticalMirror, bHorizontalMirror);
-
-        if(!bMiniMode) grayImg = img; //for drawing
+    //learns background and subtracts it from img
+    void subtractBackground(CPUImageFilter& img){
+        IplImage* source = img.getCvImage();
+        IplImage* background = grayBg.getCvImage();
         //Dynamic background with learn rate
         if(bDynamicBG){
-            floatBgImg.addWeighted( img, fLearnRate);
-			//grayBg = floatBgImg;  // not yet implemented
-			 cvConvertScale( floatBgImg.getCvImage(), grayBg.getCvImage(), 255.0f/65535.0f, 0 );       
-			 grayBg.flagImageChanged();
+            //learns straight into grayBg, pixels under blobs of last frame are frozen
+            backgroundModel.update((unsigned char*)source->imageData, source->widthStep, (unsigned char*)background->imageData, background->widthStep, fLearnRate);
+            grayBg.flagImageChanged();
         }
 
         //recapature the background until image/camera is fully exposed
@@ -90,39 +89,134 @@ class ProcessFilters : public Filters {
 
         //Capture full background
         if (bLearnBakground == true){
-            floatBgImg = img;
-			//grayBg = floatBgImg;  // not yet implemented
-			cvConvertScale( floatBgImg.getCvImage(), grayBg.getCvImage(), 255.0f/65535.0f, 0 );       
-			grayBg.flagImageChanged();
+            backgroundModel.learn((unsigned char*)source->imageData, source->widthStep, (unsigned char*)background->imageData, background->widthStep);
+            grayBg.flagImageChanged();
             bLearnBakground = false;
         }
 
 		//Background Subtraction
         //img.absDiff(grayBg, img); 		
+		//img may still wrap leased frame, subtraction is its first write and goes to own image
 		if(bTrackDark)
-			cvSub(grayBg.getCvImage(), img.getCvImage(), img.getCvImage());
+			cvSub(background, source, img.getTargetCvImage());
 		else
-			cvSub(img.getCvImage(), grayBg.getCvImage(), img.getCvImage());
+			cvSub(source, background, img.getTargetCvImage());
 
 		img.flagImageChanged();
+    }
+
+    //blobs found in this frame aren't learned into dynamic background of the next one
+    void clearBackgroundFreeze(){
+        backgroundModel.clearFreeze();
+    }
+
+    void freezeBackground(const ofRectangle& rect){
+        backgroundModel.freeze((int)rect.x, (int)rect.y, (int)rect.width, (int)rect.height);
+    }
+
+    //all filters in one pass over rows, false when they have to run one by one
+    bool applyRowFilters(CPUImageFilter& img){
+        //highpass of not blurred image subtracts whatever is left in temp image
+        if(bHighpass && highpassBlur <= 0) return false;
+
+        //recapature the background until image/camera is fully exposed
+        if((ofGetElapsedTimeMillis() - exposureStartTime) < CAMERA_EXPOSURE_TIME) bLearnBakground = true;
+        bool bLearning = !bBackgroundSubtracted && (bDynamicBG || bLearnBakground);
+
+        //background is learned from whole mirrored frame, own image can't be flipped vertically row by row
+        bool bMirror = bVerticalMirror || bHorizontalMirror;
+        if(bMirror && (bLearning || (bVerticalMirror && !img.isLeased()))){
+            img.mirror(bVerticalMirror, bHorizontalMirror);
+            bMirror = false;
+        }
+        if(bLearning){
+            takePreview(FILTER_PREVIEW_SOURCE, img); //for drawing
+            subtractBackground(img);
+        }
+
+        RowFiltersSettings settings;
+        settings.isVerticalMirror = bMirror && bVerticalMirror;
+        settings.isHorizontalMirror = bMirror && bHorizontalMirror;
+        IplImage* background = grayBg.getCvImage();
+        settings.background = (bLearning || bBackgroundSubtracted) ? NULL : (unsigned char*)background->imageData;
+        settings.backgroundStep = background->widthStep;
+        settings.isTrackDark = bTrackDark;
+        settings.smoothRadius = bSmooth ? smooth : -1;
+        settings.highpassRadius = bHighpass ? highpassBlur : -1;
+        settings.noiseRadius = highpassNoise > 0 ? highpassNoise : -1;
+        settings.amplifyLevel = bAmplify ? highpassAmp : -1;
+        settings.threshold = bDynamicTH ? -1 : threshold;
+        //own image keeps rows of unchanged tiles only when it's target of leased frame and nothing else writes to it
+        bool bChangedOnly = (changedTiles != NULL) && img.isLeased() && !bLearning && !bDynamicTH;
+        settings.changedTiles = bChangedOnly ? changedTiles : NULL;
+        settings.tilesWidth = changedTilesWidth;
+        settings.tilesHeight = changedTilesHeight;
+        settings.tileSize = changedTileSize;
+        //for drawing, only stages due in this frame
+        setRowPreview(settings.previews[ROW_FILTERS_SOURCE_PREVIEW], FILTER_PREVIEW_SOURCE, !bLearning);
+        setRowPreview(settings.previews[ROW_FILTERS_SMOOTH_PREVIEW], FILTER_PREVIEW_SMOOTH, bSmooth);
+        setRowPreview(settings.previews[ROW_FILTERS_HIGHPASS_PREVIEW], FILTER_PREVIEW_HIGHPASS, bHighpass);
+        setRowPreview(settings.previews[ROW_FILTERS_AMPLIFY_PREVIEW], FILTER_PREVIEW_AMPLIFY, bAmplify);
+        setRowPreview(settings.previews[ROW_FILTERS_RESULT_PREVIEW], FILTER_PREVIEW_RESULT, !bDynamicTH);
+
+        //leased frame is read and result goes to own image, otherwise rows are filtered in place
+        IplImage* source = img.getCvImage();
+        IplImage* target = img.getTargetCvImage();
+        rowFilters.apply((unsigned char*)source->imageData, source->widthStep, (unsigned char*)target->imageData, target->widthStep,
+            source->width, source->height, settings);
+        img.flagImageChanged();
+        int stages[ROW_FILTERS_PREVIEWS] = {FILTER_PREVIEW_SOURCE, FILTER_PREVIEW_SMOOTH, FILTER_PREVIEW_HIGHPASS, FILTER_PREVIEW_AMPLIFY, FILTER_PREVIEW_RESULT};
+        for(int i = 0; i < ROW_FILTERS_PREVIEWS; i++)
+            if(settings.previews[i].pixels != NULL) getPreviewImage(stages[i])->flagImageChanged();
+
+        if(bDynamicTH){
+            img.adaptiveThreshold(threshold, -threshSize);
+            takePreview(FILTER_PREVIEW_RESULT, img); //for drawing
+        }
+        return true;
+    }
+
+    //row filters sample frame to image of stage when it's on and due
+    void setRowPreview(RowFiltersPreview& preview, int stage, bool bStage){
+        IplImage* image = getPreviewImage(stage)->getCvImage();
+        preview.pixels = (bStage && bPreviewDue[stage]) ? (unsigned char*)image->imageData : NULL;
+        preview.step = image->widthStep;
+        preview.width = image->width;
+        preview.height = image->height;
+    }
+
+     //stages due for preview are decided by updatePreviews on GL thread before, filters may run on pool
+     void applyCPUFilters(CPUImageFilter& img){
+
+        //fused filters unless some of them depend on full frame images
+        if(applyRowFilters(img)) return;
+
+        //Set Mirroring Horizontal/Vertical
+        if(bVerticalMirror || bHorizontalMirror) img.mirror(bVerticalMirror, bHorizontalMirror);
+
+        takePreview(FILTER_PREVIEW_SOURCE, img); //for drawing
+		if(bBackgroundSubtracted){
+			//leased frame is only moved to own image, following filters may write to it
+			IplImage* source = img.getCvImage();
+			if(img.isLeased()) cvCopy(source, img.getTargetCvImage());
+			img.flagImageChanged();
+		}
+		else subtractBackground(img);
     
 		
 		if(bSmooth){//Smooth
             img.blur((smooth * 2) + 1); //needs to be an odd number
-            if(!bMiniMode)
-            subtractBg = img; //for drawing
+            takePreview(FILTER_PREVIEW_SMOOTH, img); //for drawing
         }
 
         if(bHighpass){//HighPass
             img.highpass(highpassBlur, highpassNoise);
-            if(!bMiniMode)
-            highpassImg = img; //for drawing
+            takePreview(FILTER_PREVIEW_HIGHPASS, img); //for drawing
         }
 
         if(bAmplify){//Amplify
             img.amplify(img, highpassAmp);
-            if(!bMiniMode)
-            amplifyImg = img; //for drawing
+            takePreview(FILTER_PREVIEW_AMPLIFY, img); //for drawing
         }
 
 		if (bDynamicTH)
@@ -130,8 +224,7 @@ class ProcessFilters : public Filters {
 		else
 			img.threshold(threshold); //Threshold
 
-        if(!bMiniMode)
-        grayDiff = img; //for drawing
+        takePreview(FILTER_PREVIEW_RESULT, img); //for drawing
 	
     }
 
@@ -194,6 +287,17 @@ class ProcessFilters : public Filters {
  ****************************************************************/
     void draw()
     {
+		//stages are snapshot at the size they are drawn, by frames coming after this repaint
+		if (drawAllData)
+		{
+			requestPreview(FILTER_PREVIEW_SOURCE, 326, 246, FILTER_PREVIEW_INTERVAL);
+			requestPreview(FILTER_PREVIEW_RESULT, 326, 246, FILTER_PREVIEW_INTERVAL);
+		}
+		requestPreview(FILTER_PREVIEW_BACKGROUND, 129, 96, FILTER_PREVIEW_INTERVAL);
+		if (bSmooth) requestPreview(FILTER_PREVIEW_SMOOTH, 129, 96, FILTER_PREVIEW_INTERVAL);
+		if (bHighpass) requestPreview(FILTER_PREVIEW_HIGHPASS, 129, 96, FILTER_PREVIEW_INTERVAL);
+		if (bAmplify) requestPreview(FILTER_PREVIEW_AMPLIFY, 129, 96, FILTER_PREVIEW_INTERVAL);
+
 		// SEE ofxNCoreVision: MAIN_TOP_OFFSET
 		if (drawAllData)
 		{
@@ -201,7 +305,7 @@ class ProcessFilters : public Filters {
 			grayDiff.draw(250+335, 25, 326, 246);
 		}
 		//
-        floatBgImg.draw(250+137*0, 365, 129, 96);
+        grayBg.draw(250+137*0, 365, 129, 96);
         subtractBg.draw(250+137*1, 365, 129, 96);
         highpassImg.draw(250+137*2, 365, 129, 96);
 		amplifyImg.draw(250+137*3, 365, 129, 96);
@@ -218,5 +322,10 @@ class ProcessFilters : public Filters {
         gpuReadBackImageGS.draw(500, 1200, 320, 240);
 			/**/
     }
+
+  private:
+
+    RowFilters rowFilters;
+    BackgroundModel backgroundModel;
 };
 #endif
@@ -0,0 +1,590 @@
+/*
+*  RowFilters.cpp
+*
+*
+*  Created on 17/10/26.
+*  Copyright 2026 NUI Group. All rights reserved.
+*
+*/
+
+#include "RowFilters.h"
+#include "ofxThreadPool.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#if defined(OFX_SSE2)
+	#include <emmintrin.h>
+#endif
+
+//cvRound of OpenCV rounds halves to even
+static int roundValue(double value)
+{
+	double rounded = floor(value + 0.5);
+	if ((rounded - value == 0.5) && (fmod(rounded,2.0) != 0.0))
+		rounded -= 1.0;
+	return (int)rounded;
+}
+
+RowFilters::RowFilters()
+{
+	source = NULL;
+	sourceStep = 0;
+	target = NULL;
+	targetStep = 0;
+	width = height = 0;
+	memset(&settings,0,sizeof(settings));
+	boxesCount = 0;
+	finalTable = NULL;
+	stripes = NULL;
+	stripesCapacity = stripesCount = 0;
+	stripeBounds = NULL;
+	stripeBoundsCapacity = 0;
+	changedRows = NULL;
+	changedRowsCapacity = 0;
+	sourceCopy = NULL;
+	sourceCopySize = 0;
+	for (int i = 0;i < ROW_FILTERS_PREVIEWS;i++)
+	{
+		previewRows[i] = previewColumns[i] = NULL;
+		previewWidths[i] = previewHeights[i] = 0;
+		previewFrameWidths[i] = previewFrameHeights[i] = 0;
+	}
+	tablesAmplifyLevel = tablesThreshold = -1;
+	updateTables();
+}
+
+RowFilters::~RowFilters()
+{
+	for (int i = 0;i < stripesCapacity;i++)
+		clearStripe(stripes[i]);
+	free(stripes);
+	free(stripeBounds);
+	free(changedRows);
+	free(sourceCopy);
+	for (int i = 0;i < ROW_FILTERS_PREVIEWS;i++)
+	{
+		free(previewRows[i]);
+		free(previewColumns[i]);
+	}
+}
+
+void RowFilters::clearStripe(Stripe& stripe)
+{
+	free(stripe.mirroredRow);
+	free(stripe.subtractedRow);
+	stripe.mirroredRow = stripe.subtractedRow = NULL;
+	for (int i = 0;i < ROW_FILTERS_MAX_BOXES;i++)
+	{
+		BoxRows& rows = stripe.boxes[i];
+		free(rows.rows);
+		free(rows.sums);
+		free(rows.columnSums);
+		free(rows.output);
+		rows.rows = NULL;
+		rows.sums = NULL;
+		rows.columnSums = NULL;
+		rows.output = NULL;
+		rows.capacity = 0;
+	}
+	stripe.allocatedWidth = 0;
+}
+
+void RowFilters::allocateStripes(int count)
+{
+	if (count <= stripesCapacity)
+		return;
+	//buffers of stripe are allocated by its participant when it needs them
+	Stripe* allocated = (Stripe*)malloc(count*sizeof(Stripe));
+	if (stripesCapacity > 0)
+		memcpy(allocated,stripes,stripesCapacity*sizeof(Stripe));
+	memset(allocated + stripesCapacity,0,(count - stripesCapacity)*sizeof(Stripe));
+	free(stripes);
+	stripes = allocated;
+	stripesCapacity = count;
+}
+
+void RowFilters::allocateStripe(Stripe& stripe)
+{
+	if (stripe.allocatedWidth < width)
+	{
+		clearStripe(stripe);
+		stripe.mirroredRow = (unsigned char*)malloc(width);
+		stripe.subtractedRow = (unsigned char*)malloc(width);
+		for (int i = 0;i < ROW_FILTERS_MAX_BOXES;i++)
+		{
+			stripe.boxes[i].columnSums = (int*)malloc(width*sizeof(int));
+			stripe.boxes[i].output = (unsigned char*)malloc(width);
+		}
+		stripe.allocatedWidth = width;
+	}
+	for (int i = 0;i < boxesCount;i++)
+	{
+		BoxRows& rows = stripe.boxes[i];
+		if (rows.capacity < boxes[i].ringSize * width)
+		{
+			free(rows.rows);
+			free(rows.sums);
+			rows.capacity = boxes[i].ringSize * width;
+			rows.rows = (unsigned char*)malloc(rows.capacity);
+			rows.sums = (int*)malloc(rows.capacity*sizeof(int));
+		}
+		rows.nextRow = -1;
+	}
+}
+
+void RowFilters::setupBox(int radius,bool isHighpass,int preview)
+{
+	Box& box = boxes[boxesCount++];
+	box.radius = radius;
+	box.isHighpass = isHighpass;
+	box.preview = preview;
+	//window of 2 * radius + 1 rows and the row leaving it
+	box.ringSize = 2 * radius + 2;
+	int kernel = 2 * radius + 1;
+	box.scale = 1.0 / (kernel * kernel);
+	box.isFloatScale = radius <= ROW_FILTERS_MAX_FLOAT_RADIUS;
+}
+
+void RowFilters::updateTables()
+{
+	if ((tablesAmplifyLevel == settings.amplifyLevel) && (tablesThreshold == settings.threshold))
+		return;
+	tablesAmplifyLevel = settings.amplifyLevel;
+	tablesThreshold = settings.threshold;
+	//cvMul of 8 bit images computes in float
+	float scale = tablesAmplifyLevel / 128.0f;
+	for (int i = 0;i < 256;i++)
+	{
+		float value = scale * (float)i * (float)i;
+		int amplified = roundValue(value);
+		amplifyTable[i] = amplified > 255 ? 255 : (unsigned char)amplified;
+		thresholdTable[i] = i > tablesThreshold ? 255 : 0;
+	}
+	for (int i = 0;i < 256;i++)
+		outputTable[i] = thresholdTable[amplifyTable[i]];
+}
+
+void RowFilters::updatePreviews()
+{
+	for (int i = 0;i < ROW_FILTERS_PREVIEWS;i++)
+	{
+		const RowFiltersPreview& preview = settings.previews[i];
+		if ((preview.pixels == NULL) || ((previewWidths[i] == preview.width) && (previewHeights[i] == preview.height) &&
+			(previewFrameWidths[i] == width) && (previewFrameHeights[i] == height)))
+			continue;
+		free(previewRows[i]);
+		free(previewColumns[i]);
+		previewRows[i] = (int*)malloc(height*sizeof(int));
+		previewColumns[i] = (int*)malloc(preview.width*sizeof(int));
+		for (int y = 0;y < height;y++)
+			previewRows[i][y] = -1;
+		for (int y = 0;y < preview.height;y++)
+			previewRows[i][y * height / preview.height] = y;
+		for (int x = 0;x < preview.width;x++)
+			previewColumns[i][x] = x * width / preview.width;
+		previewWidths[i] = preview.width;
+		previewHeights[i] = preview.height;
+		previewFrameWidths[i] = width;
+		previewFrameHeights[i] = height;
+	}
+}
+
+void RowFilters::takePreview(Stripe& stripe,int preview,int y,const unsigned char* row,const unsigned char* table)
+{
+	//rows read around stripe are drawn by their own stripes
+	const RowFiltersPreview& image = settings.previews[preview];
+	if ((image.pixels == NULL) || (y < stripe.first) || (y >= stripe.last) || (previewRows[preview][y] < 0))
+		return;
+	unsigned char* pixels = image.pixels + previewRows[preview][y] * image.step;
+	const int* columns = previewColumns[preview];
+	if (table != NULL)
+	{
+		for (int x = 0;x < image.width;x++)
+			pixels[x] = table[row[columns[x]]];
+	}
+	else
+	{
+		for (int x = 0;x < image.width;x++)
+			pixels[x] = row[columns[x]];
+	}
+}
+
+const unsigned char* RowFilters::getSourceRow(Stripe& stripe,int y)
+{
+	const unsigned char* row = source + (settings.isVerticalMirror ? height - 1 - y : y) * sourceStep;
+	if (settings.isHorizontalMirror)
+	{
+		for (int x = 0;x < width;x++)
+			stripe.mirroredRow[x] = row[width - 1 - x];
+		row = stripe.mirroredRow;
+	}
+	takePreview(stripe,ROW_FILTERS_SOURCE_PREVIEW,y,row,NULL);
+	if (settings.background == NULL)
+		return row;
+	//saturated as cvSub
+	const unsigned char* background = settings.background + y * settings.backgroundStep;
+	unsigned char* subtractedRow = stripe.subtractedRow;
+	if (settings.isTrackDark)
+	{
+		for (int x = 0;x < width;x++)
+			subtractedRow[x] = background[x] > row[x] ? background[x] - row[x] : 0;
+	}
+	else
+	{
+		for (int x = 0;x < width;x++)
+			subtractedRow[x] = row[x] > background[x] ? row[x] - background[x] : 0;
+	}
+	return subtractedRow;
+}
+
+void RowFilters::loadBoxRow(Stripe& stripe,int index,int y)
+{
+	Box& box = boxes[index];
+	BoxRows& rows = stripe.boxes[index];
+	const unsigned char* input = getStageRow(stripe,index - 1,y);
+	int slot = (y % box.ringSize) * width;
+	if (box.isHighpass)
+		memcpy(rows.rows + slot,input,width);
+	//running sum along row, pixels outside of it are the border pixels (BORDER_REPLICATE)
+	int* sums = rows.sums + slot;
+	int radius = box.radius;
+	int last = width - 1;
+	int sum = input[0] * (radius + 1);
+	for (int x = 1;x <= radius;x++)
+		sum += input[x < last ? x : last];
+	//left border, inside and right border of row
+	int x = 0;
+	int left = radius < width ? radius : width;
+	for (;x < left;x++)
+	{
+		sums[x] = sum;
+		int added = x + radius + 1;
+		sum += input[added < last ? added : last] - input[0];
+	}
+	int right = last - radius;
+	for (;x < right;x++)
+	{
+		sums[x] = sum;
+		sum += input[x + radius + 1] - input[x - radius];
+	}
+	for (;x < width;x++)
+	{
+		sums[x] = sum;
+		sum += input[last] - input[x - radius];
+	}
+}
+
+#if defined(OFX_SSE2)
+//rounded means of 8 column sums as 16 bit values, converted as cvRound does (to nearest even)
+static inline __m128i getMeans(const int* sums,bool isFloatScale,__m128 floatScale,__m128d doubleScale)
+{
+	__m128i low = _mm_loadu_si128((const __m128i*)sums);
+	__m128i high = _mm_loadu_si128((const __m128i*)(sums + 4));
+	if (isFloatScale)
+	{
+		low = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(low),floatScale));
+		high = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(high),floatScale));
+	}
+	else
+	{
+		low = _mm_unpacklo_epi64(_mm_cvtpd_epi32(_mm_mul_pd(_mm_cvtepi32_pd(low),doubleScale)),
+			_mm_cvtpd_epi32(_mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(low,8)),doubleScale)));
+		high = _mm_unpacklo_epi64(_mm_cvtpd_epi32(_mm_mul_pd(_mm_cvtepi32_pd(high),doubleScale)),
+			_mm_cvtpd_epi32(_mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(high,8)),doubleScale)));
+	}
+	return _mm_packs_epi32(low,high);
+}
+#endif
+
+const unsigned char* RowFilters::getBoxRow(Stripe& stripe,int index,int y)
+{
+	Box& box = boxes[index];
+	BoxRows& rows = stripe.boxes[index];
+	int radius = box.radius;
+	int* columnSums = rows.columnSums;
+	if (rows.nextRow < 0)
+	{
+		//window of the first row is summed, rows outside of frame are its border rows
+		int top = y - radius > 0 ? y - radius : 0;
+		int bottom = y + radius < height - 1 ? y + radius : height - 1;
+		for (int i = top;i <= bottom;i++)
+			loadBoxRow(stripe,index,i);
+		memset(columnSums,0,width*sizeof(int));
+		for (int i = y - radius;i <= y + radius;i++)
+		{
+			int row = i < top ? top : (i > bottom ? bottom : i);
+			const int* sums = rows.sums + (row % box.ringSize) * width;
+			for (int x = 0;x < width;x++)
+				columnSums[x] += sums[x];
+		}
+	}
+	else
+	{
+		//following rows move the window by one row
+		int added = y + radius;
+		if (added < height)
+			loadBoxRow(stripe,index,added);
+		else
+			added = height - 1;
+		int removed = y - radius - 1;
+		if (removed < 0)
+			removed = 0;
+		const int* addedSums = rows.sums + (added % box.ringSize) * width;
+		const int* removedSums = rows.sums + (removed % box.ringSize) * width;
+		int x = 0;
+#if defined(OFX_SSE2)
+		for (;x + 4 <= width;x += 4)
+		{
+			__m128i difference = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(addedSums + x)),_mm_loadu_si128((const __m128i*)(removedSums + x)));
+			__m128i sums = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(columnSums + x)),difference);
+			_mm_storeu_si128((__m128i*)(columnSums + x),sums);
+		}
+#endif
+		for (;x < width;x++)
+			columnSums[x] += addedSums[x] - removedSums[x];
+	}
+	rows.nextRow = y + 1;
+	//mean is rounded as by box filter of OpenCV, sum of odd kernel is never halfway between two values
+	unsigned char* output = rows.output;
+	const unsigned char* center = rows.rows + (y % box.ringSize) * width;
+	double scale = box.scale;
+	int x = 0;
+#if defined(OFX_SSE2)
+	//float is exact for small boxes (error of product stays below 1 / (2 * area)), saturation is done by packing
+	__m128 floatScale = _mm_set1_ps((float)scale);
+	__m128d doubleScale = _mm_set1_pd(scale);
+	__m128i zero = _mm_setzero_si128();
+	if (box.isHighpass)
+	{
+		for (;x + 8 <= width;x += 8)
+		{
+			__m128i means = getMeans(columnSums + x,box.isFloatScale,floatScale,doubleScale);
+			__m128i values = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(center + x)),zero),means);
+			_mm_storel_epi64((__m128i*)(output + x),_mm_packus_epi16(values,values));
+		}
+	}
+	else
+	{
+		for (;x + 8 <= width;x += 8)
+		{
+			__m128i means = getMeans(columnSums + x,box.isFloatScale,floatScale,doubleScale);
+			_mm_storel_epi64((__m128i*)(output + x),_mm_packus_epi16(means,means));
+		}
+	}
+#endif
+	if (box.isHighpass)
+	{
+		for (;x < width;x++)
+		{
+			int value = center[x] - (int)(columnSums[x] * scale + 0.5);
+			output[x] = value > 0 ? (unsigned char)value : 0;
+		}
+	}
+	else
+	{
+		for (;x < width;x++)
+			output[x] = (unsigned char)(int)(columnSums[x] * scale + 0.5);
+	}
+	if (box.preview >= 0)
+		takePreview(stripe,box.preview,y,output,NULL);
+	return output;
+}
+
+void RowFilters::filterStripe(Stripe& stripe,int first,int last)
+{
+	allocateStripe(stripe);
+	stripe.first = first;
+	stripe.last = last;
+	bool isAmplified = settings.amplifyLevel >= 0;
+	for (int y = first;y < last;y++)
+	{
+		const unsigned char* row = getStageRow(stripe,boxesCount - 1,y);
+		unsigned char* targetRow = target + y * targetStep;
+		if (isAmplified)
+			takePreview(stripe,ROW_FILTERS_AMPLIFY_PREVIEW,y,row,amplifyTable);
+		if (finalTable != NULL)
+		{
+			for (int x = 0;x < width;x++)
+				targetRow[x] = finalTable[row[x]];
+		}
+		else if (row != targetRow)
+			memcpy(targetRow,row,width);
+		takePreview(stripe,ROW_FILTERS_RESULT_PREVIEW,y,targetRow,NULL);
+	}
+}
+
+void RowFilters::StripesTask(void* instance,int first,int last,int participant)
+{
+	RowFilters* pThis = (RowFilters*)instance;
+	for (int i = first;i < last;i++)
+		pThis->filterStripe(pThis->stripes[participant],pThis->stripeBounds[2 * i],pThis->stripeBounds[2 * i + 1]);
+}
+
+int RowFilters::markChangedRows(int haloRows)
+{
+	if (changedRowsCapacity < height)
+	{
+		free(changedRows);
+		changedRowsCapacity = height;
+		changedRows = (unsigned char*)malloc(changedRowsCapacity);
+	}
+	memset(changedRows,0,height);
+	for (int i = 0;i < settings.tilesHeight;i++)
+	{
+		const unsigned char* tiles = settings.changedTiles + i * settings.tilesWidth;
+		int x = 0;
+		while ((x < settings.tilesWidth) && (tiles[x] == 0))
+			x++;
+		if (x == settings.tilesWidth)
+			continue;
+		//source rows of tile row, flipped to frame rows, and rows whose blurs read them
+		int top = i * settings.tileSize;
+		int bottom = top + settings.tileSize < height ? top + settings.tileSize : height;
+		if (settings.isVerticalMirror)
+		{
+			int flippedTop = height - bottom;
+			bottom = height - top;
+			top = flippedTop;
+		}
+		top = top - haloRows > 0 ? top - haloRows : 0;
+		bottom = bottom + haloRows < height ? bottom + haloRows : height;
+		memset(changedRows + top,1,bottom - top);
+	}
+	int rowsCount = 0;
+	for (int y = 0;y < height;y++)
+		rowsCount += changedRows[y];
+	return rowsCount;
+}
+
+void RowFilters::splitStripes(int rowsCount,bool isChangedOnly)
+{
+	//runs of changed rows are cut to stripes, so there may be more stripes than participants
+	int capacity = 2 * (height + stripesCount);
+	if (stripeBoundsCapacity < capacity)
+	{
+		free(stripeBounds);
+		stripeBoundsCapacity = capacity;
+		stripeBounds = (int*)malloc(stripeBoundsCapacity*sizeof(int));
+	}
+	if (!isChangedOnly)
+	{
+		for (int i = 0;i < stripesCount;i++)
+		{
+			stripeBounds[2 * i] = i * height / stripesCount;
+			stripeBounds[2 * i + 1] = (i + 1) * height / stripesCount;
+		}
+		return;
+	}
+	int stripeRows = (rowsCount + stripesCount - 1) / stripesCount;
+	int count = 0;
+	int y = 0;
+	while (y < height)
+	{
+		if (changedRows[y] == 0)
+		{
+			y++;
+			continue;
+		}
+		int last = y;
+		while ((last < height) && (changedRows[last] != 0) && (last - y < stripeRows))
+			last++;
+		stripeBounds[2 * count] = y;
+		stripeBounds[2 * count + 1] = last;
+		count++;
+		y = last;
+	}
+	stripesCount = count;
+}
+
+void RowFilters::apply(const unsigned char* source,int sourceStep,unsigned char* target,int targetStep,int width,int height,const RowFiltersSettings& settings)
+{
+	this->source = source;
+	this->sourceStep = sourceStep;
+	this->target = target;
+	this->targetStep = targetStep;
+	this->width = width;
+	this->height = height;
+	this->settings = settings;
+	updateTables();
+	updatePreviews();
+	//highpass preview is the noise blur when there is one
+	boxesCount = 0;
+	if (settings.smoothRadius >= 0)
+		setupBox(settings.smoothRadius,false,ROW_FILTERS_SMOOTH_PREVIEW);
+	if (settings.highpassRadius >= 0)
+		setupBox(settings.highpassRadius,true,settings.noiseRadius >= 0 ? -1 : ROW_FILTERS_HIGHPASS_PREVIEW);
+	if ((settings.highpassRadius >= 0) && (settings.noiseRadius >= 0))
+		setupBox(settings.noiseRadius,false,ROW_FILTERS_HIGHPASS_PREVIEW);
+	//amplify and threshold are one table, amplified image is drawn through its own table
+	bool isAmplified = settings.amplifyLevel >= 0;
+	bool isThresholded = settings.threshold >= 0;
+	finalTable = NULL;
+	if (isAmplified)
+		finalTable = isThresholded ? outputTable : amplifyTable;
+	else if (isThresholded)
+		finalTable = thresholdTable;
+	//stripe reads rows of all blurs around it
+	int haloRows = 0;
+	for (int i = 0;i < boxesCount;i++)
+		haloRows += boxes[i].radius;
+	int stripeRows = haloRows > ROW_FILTERS_MIN_STRIPE_ROWS ? haloRows : ROW_FILTERS_MIN_STRIPE_ROWS;
+	ofxThreadPool* pool = ofxThreadPool::getShared();
+	int participantsCount = pool->getParticipantsCount();
+	//target keeps previous result only when it isn't source, skipped rows wouldn't be drawn to previews
+	bool isChangedOnly = (settings.changedTiles != NULL) && (source != target) && (settings.tileSize > 0) &&
+		(settings.tilesWidth == (width + settings.tileSize - 1) / settings.tileSize) &&
+		(settings.tilesHeight == (height + settings.tileSize - 1) / settings.tileSize);
+	for (int i = 0;i < ROW_FILTERS_PREVIEWS;i++)
+	{
+		if (settings.previews[i].pixels != NULL)
+			isChangedOnly = false;
+	}
+	int rowsCount = isChangedOnly ? markChangedRows(haloRows) : height;
+	if (rowsCount == 0)
+		return;
+	stripesCount = rowsCount / stripeRows;
+	if (stripesCount > participantsCount)
+		stripesCount = participantsCount;
+	if (stripesCount < 1)
+		stripesCount = 1;
+	allocateStripes(participantsCount);
+	splitStripes(rowsCount,isChangedOnly && (rowsCount < height));
+	if (stripesCount == 1)
+	{
+		filterStripe(stripes[0],stripeBounds[0],stripeBounds[1]);
+		return;
+	}
+	if ((source == target) && (haloRows > 0))
+	{
+		if (sourceCopySize < sourceStep * height)
+		{
+			free(sourceCopy);
+			sourceCopySize = sourceStep * height;
+			sourceCopy = (unsigned char*)malloc(sourceCopySize);
+		}
+		memcpy(sourceCopy,source,sourceStep * height);
+		this->source = sourceCopy;
+	}
+	pool->parallelFor(stripesCount,1,&RowFilters::StripesTask,this);
+}
+
+void RowFilters::blur(const unsigned char* source,int sourceStep,unsigned char* target,int targetStep,int width,int height,int radius)
+{
+	RowFiltersSettings settings;
+	memset(&settings,0,sizeof(settings));
+	settings.smoothRadius = radius;
+	settings.highpassRadius = settings.noiseRadius = -1;
+	settings.amplifyLevel = settings.threshold = -1;
+	apply(source,sourceStep,target,targetStep,width,height,settings);
+}
+
+void RowFilters::highpass(const unsigned char* source,int sourceStep,unsigned char* target,int targetStep,int width,int height,int radius,int noiseRadius)
+{
+	RowFiltersSettings settings;
+	memset(&settings,0,sizeof(settings));
+	settings.smoothRadius = -1;
+	settings.highpassRadius = radius;
+	settings.noiseRadius = noiseRadius;
+	settings.amplifyLevel = settings.threshold = -1;
+	apply(source,sourceStep,target,targetStep,width,height,settings);
+}
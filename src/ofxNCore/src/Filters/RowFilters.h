@@ -0,0 +1,168 @@
+/*
+*  RowFilters.h
+*
+*  CPU filter chain of ProcessFilters (mirror, background subtraction, smooth, highpass, amplify and threshold)
+*  fused to one pass over the frame. Rows flow through stages which keep only a few rows each, box blurs
+*  keep running sums of them. Results are the same as of the OpenCV filters one by one.
+*
+*  Created on 17/10/26.
+*  Copyright 2026 NUI Group. All rights reserved.
+*
+*/
+
+#ifndef ROW_FILTERS_H
+#define ROW_FILTERS_H
+
+//smooth, highpass blur and highpass noise blur
+#define ROW_FILTERS_MAX_BOXES 3
+//box means are computed in float up to this radius, sums of bigger boxes need double to be rounded exactly
+#define ROW_FILTERS_MAX_FLOAT_RADIUS 31
+
+//stages drawn by GUI
+#define ROW_FILTERS_SOURCE_PREVIEW 0
+#define ROW_FILTERS_SMOOTH_PREVIEW 1
+#define ROW_FILTERS_HIGHPASS_PREVIEW 2
+#define ROW_FILTERS_AMPLIFY_PREVIEW 3
+#define ROW_FILTERS_RESULT_PREVIEW 4
+#define ROW_FILTERS_PREVIEWS 5
+//stripes filtered in parallel are at least this high and not lower than rows read around them
+#define ROW_FILTERS_MIN_STRIPE_ROWS 32
+
+//image of stage for drawing, frame is sampled down to its size (nearest pixels). It mustn't be bigger than frame
+struct RowFiltersPreview
+{
+	//NULL when stage isn't drawn from this frame
+	unsigned char* pixels;
+	int step;
+	int width,height;
+};
+
+//filters of one frame, stages which are off are skipped
+struct RowFiltersSettings
+{
+	bool isVerticalMirror,isHorizontalMirror;
+	//background subtracted from mirrored source, NULL when source is already subtracted
+	const unsigned char* background;
+	int backgroundStep;
+	bool isTrackDark;
+	//box blur radii (kernel is 2 * radius + 1), negative when stage is off. Highpass subtracts its blur
+	//from input and blurs the difference by noise radius
+	int smoothRadius;
+	int highpassRadius;
+	int noiseRadius;
+	//amplify level is negative when it's off, negative threshold leaves amplified image
+	int amplifyLevel;
+	int threshold;
+	//stage results for drawing, indexed by ROW_FILTERS_..._PREVIEW
+	RowFiltersPreview previews[ROW_FILTERS_PREVIEWS];
+	//flags of tilesWidth x tilesHeight tiles (tileSize pixels) of source changed since previous frame, which was filtered
+	//to target with the same settings and background. Rows which read only unchanged tiles keep their result in target.
+	//NULL filters whole frame, so do frames filtered in place or with previews
+	const unsigned char* changedTiles;
+	int tilesWidth,tilesHeight,tileSize;
+};
+
+class RowFilters
+{
+public:
+	RowFilters();
+	~RowFilters();
+	//Horizontal stripes of frame are filtered in parallel on shared thread pool, each stripe starts with rows of
+	//its neighbours which its blurs read, so result is the same as of one pass. Target may be source when there
+	//is no vertical mirror. With changed tiles only stripes of rows reading them are filtered
+	void apply(const unsigned char* source,int sourceStep,unsigned char* target,int targetStep,int width,int height,const RowFiltersSettings& settings);
+	//cvSmooth CV_BLUR of 2 * radius + 1 pixels, cost doesn't depend on radius
+	void blur(const unsigned char* source,int sourceStep,unsigned char* target,int targetStep,int width,int height,int radius);
+	//source minus its blur, the difference is blurred by noise radius unless it's negative
+	void highpass(const unsigned char* source,int sourceStep,unsigned char* target,int targetStep,int width,int height,int radius,int noiseRadius);
+private:
+	struct Box
+	{
+		int radius;
+		//output is input minus its blur (saturated)
+		bool isHighpass;
+		//index of preview of output, negative when it has none
+		int preview;
+		int ringSize;
+		double scale;
+		bool isFloatScale;
+	};
+	//rows of box in one stripe
+	struct BoxRows
+	{
+		//rows of input (highpass) and their horizontal sums, row y is at y % ringSize
+		unsigned char* rows;
+		int* sums;
+		int capacity;
+		int* columnSums;
+		unsigned char* output;
+		int nextRow;
+	};
+	//buffers of participant of thread pool, it filters stripes one by one
+	struct Stripe
+	{
+		//rows [first,last) are written, rows around them are only read
+		int first,last;
+		int allocatedWidth;
+		unsigned char* mirroredRow;
+		unsigned char* subtractedRow;
+		BoxRows boxes[ROW_FILTERS_MAX_BOXES];
+	};
+	static void StripesTask(void* instance,int first,int last,int participant);
+	void setupBox(int radius,bool isHighpass,int preview);
+	void updateTables();
+	//preview rows and columns sampled from frame
+	void updatePreviews();
+	//samples row of frame to preview when it's one of its rows, through table when it isn't NULL
+	void takePreview(Stripe& stripe,int preview,int y,const unsigned char* row,const unsigned char* table);
+	void allocateStripes(int count);
+	void allocateStripe(Stripe& stripe);
+	void clearStripe(Stripe& stripe);
+	void filterStripe(Stripe& stripe,int first,int last);
+	//flags frame rows which read rows of changed tiles, returns their count
+	int markChangedRows(int haloRows);
+	//bounds of stripes of about rowsCount / stripesCount rows, over flagged rows only when isChangedOnly is set
+	void splitStripes(int rowsCount,bool isChangedOnly);
+	//mirrored and subtracted source row, source row itself when there is nothing to do with it
+	const unsigned char* getSourceRow(Stripe& stripe,int y);
+	//rows of box are taken in order starting at first row
+	const unsigned char* getBoxRow(Stripe& stripe,int index,int y);
+	const unsigned char* getStageRow(Stripe& stripe,int index,int y) { return index < 0 ? getSourceRow(stripe,y) : getBoxRow(stripe,index,y); }
+	void loadBoxRow(Stripe& stripe,int index,int y);
+	const unsigned char* source;
+	int sourceStep;
+	unsigned char* target;
+	int targetStep;
+	int width,height;
+	RowFiltersSettings settings;
+	Box boxes[ROW_FILTERS_MAX_BOXES];
+	int boxesCount;
+	//table of last stage, NULL when it copies rows
+	const unsigned char* finalTable;
+	Stripe* stripes;
+	int stripesCapacity;
+	int stripesCount;
+	//first and last row of each stripe
+	int* stripeBounds;
+	int stripeBoundsCapacity;
+	//frame rows filtered by frame with changed tiles
+	unsigned char* changedRows;
+	int changedRowsCapacity;
+	//copy of frame filtered in place by more stripes, they would read rows already written by their neighbours
+	unsigned char* sourceCopy;
+	int sourceCopySize;
+	//preview row of each frame row (-1 for rows which aren't sampled) and frame column of each preview column
+	int* previewRows[ROW_FILTERS_PREVIEWS];
+	int* previewColumns[ROW_FILTERS_PREVIEWS];
+	int previewWidths[ROW_FILTERS_PREVIEWS];
+	int previewHeights[ROW_FILTERS_PREVIEWS];
+	int previewFrameWidths[ROW_FILTERS_PREVIEWS];
+	int previewFrameHeights[ROW_FILTERS_PREVIEWS];
+	//amplify, threshold and both of them, tables are rebuilt when their levels change
+	unsigned char amplifyTable[256];
+	unsigned char thresholdTable[256];
+	unsigned char outputTable[256];
+	int tablesAmplifyLevel,tablesThreshold;
+};
+
+#endif
@@ -26,6 +26,9 @@ void ofxNCoreVision::_setup(ofEventArgs &e)
 
 	//Load Settings from config file
 	loadXMLSettings();
+	//stitching and frame processing share workers of this pool
+	ofxThreadPool::getShared()->setWorkersCount(workersCount);
+	printf("Thread pool: %d workers\n",ofxThreadPool::getShared()->getWorkersCount());
 
 	if(debugMode)
 	{
@@ -181,7 +184,12 @@ void ofxNCoreVision::loadXMLSettings()
 		supportedCameraTypes.push_back(KINECT);
 	if (XML.getValue("CONFIG:MULTIPLEXER:CAMERATYPES:DIRECTSHOW", 0))
 		supportedCameraTypes.push_back(DIRECTSHOW);
+	if (XML.getValue("CONFIG:MULTIPLEXER:CAMERATYPES:RECORDED", 0))
+		supportedCameraTypes.push_back(RECORDED);
 	videoFileName				= XML.getValue("CONFIG:VIDEO:FILENAME", "test_videos/RearDI.m4v");
+	recordingFolder				= XML.getValue("CONFIG:RECORDING:OUTPUTFOLDER", "recordings/");
+	recordingSlots				= XML.getValue("CONFIG:RECORDING:SLOTS", 64);
+	workersCount				= XML.getValue("CONFIG:THREADS:WORKERS", 0);
 	bcamera						= XML.getValue("CONFIG:SOURCE","VIDEO") == "MULTIPLEXER";
 	maxBlobs					= XML.getValue("CONFIG:BLOBS:MAXNUMBER", 20);
 	bShowLabels					= XML.getValue("CONFIG:BOOLEAN:LABELS",0);
@@ -200,6 +208,7 @@ void ofxNCoreVision::loadXMLSettings()
 	//MODES
 	bGPUMode					= XML.getValue("CONFIG:BOOLEAN:GPU", 0);
 	bMiniMode                   = XML.getValue("CONFIG:BOOLEAN:MINIMODE",0);
+	bPerCameraDetection			= XML.getValue("CONFIG:BOOLEAN:PERCAMERADETECTION",0);
 	//CONTROLS
 	tracker.MOVEMENT_FILTERING	= XML.getValue("CONFIG:INT:MINMOVEMENT",0);
 	MIN_BLOB_SIZE				= XML.getValue("CONFIG:INT:MINBLOBSIZE",2);
@@ -294,6 +303,14 @@ void ofxNCoreVision::saveSettings()
 			break;
 		}
 	XML.setValue("CONFIG:MULTIPLEXER:CAMERATYPES:DIRECTSHOW", isSupported);
+	isSupported = 0;
+	for (int i=0;i<supportedCameraTypes.size();i++)
+		if (supportedCameraTypes[i] == RECORDED)
+		{
+			isSupported = 1;
+			break;
+		}
+	XML.setValue("CONFIG:MULTIPLEXER:CAMERATYPES:RECORDED", isSupported);
 	XML.setValue("CONFIG:SOURCE", bcamera ? "MULTIPLEXER" : "VIDEO");
 	XML.setValue("CONFIG:BOOLEAN:PRESSURE",bShowPressure);
 	XML.setValue("CONFIG:BOOLEAN:LABELS",bShowLabels);
@@ -321,6 +338,7 @@ void ofxNCoreVision::saveSettings()
 	XML.setValue("CONFIG:INT:MAXTEMPAREA", maxTempArea);
 	XML.setValue("CONFIG:INT:THRESHOLDSIZE", filter->threshSize);
 	XML.setValue("CONFIG:BOOLEAN:MINIMODE", bMiniMode);
+	XML.setValue("CONFIG:BOOLEAN:PERCAMERADETECTION", bPerCameraDetection);
 	XML.setValue("CONFIG:BOOLEAN:TUIO",bTUIOMode);
 	XML.setValue("CONFIG:BOOLEAN:WINTOUCH",bWinTouch);
 	XML.setValue("CONFIG:BOOLEAN:TRACKFINGERS",contourFinder.bTrackFingers);
@@ -346,7 +364,6 @@ void ofxNCoreVision::initDevice()
 	if(debugMode) if((stream = freopen(fileName, "a", stdout)) == NULL){}
 	if (bcamera)
 	{
-		#ifdef TARGET_WIN32
 		multiplexerManager = new ofxMultiplexerManager();
 		for (int i=0;i<supportedCameraTypes.size();i++)
 		{
@@ -359,7 +376,6 @@ void ofxNCoreVision::initDevice()
 		multiplexerManager->setMultiplexer(multiplexer);
 		multiplexerManager->startMulticamManager();
 		interleaveMode = multiplexerManager->getInterleaveMode();
-		#endif
 	}
 	else
 	{
@@ -376,6 +392,104 @@ void ofxNCoreVision::initDevice()
         }
 	}
 }
+
+void ofxNCoreVision::ProcessingTask(void* instance,int first,int last,int /*participant*/)
+{
+	ofxNCoreVision *pThis = (ofxNCoreVision*)instance;
+	for (int i=first;i<last;i++)
+	{
+		if (i == 0)
+		{
+			if (pThis->bProcessingReused)
+				continue;
+			pThis->filter->applyCPUFilters( pThis->processedImg );
+			pThis->contourFinder.findContours(pThis->processedImg,  (pThis->MIN_BLOB_SIZE * 2) + 1, ((pThis->camWidth * pThis->camHeight) * .4) * (pThis->MAX_BLOB_SIZE * .001), pThis->maxBlobs, false);
+		}
+		else
+		{
+			pThis->filter_fiducial->applyCPUFilters( pThis->processedImg_fiducial );
+			if (pThis->contourFinder.bTrackFiducials)
+				pThis->fidfinder.findFiducials( pThis->processedImg_fiducial );
+		}
+	}
+}
+
+bool ofxNCoreVision::isPerCameraDetection()
+{
+	if ((!bPerCameraDetection) || (!bcamera) || (multiplexer == NULL) || bGPUMode || calib.calibrating)
+		return false;
+	if (contourFinder.bTrackObjects || contourFinder.bTrackFiducials || bFidtrackInterface)
+		return false;
+	bool isCalibrating = false;
+	multiplexer->getIsCalibrationMode(&isCalibrating);
+	if (isCalibrating)
+		return false;
+	//detector follows changes of cameras, it can't start till camera meshes are computed
+	return multicamDetector.isSetUp(multiplexer) || multicamDetector.setup(multiplexer,&templates);
+}
+
+bool ofxNCoreVision::isProcessingReusable(bool bCameraDetection)
+{
+	int settings[PROCESSING_SETTINGS_COUNT] = { filter->bVerticalMirror, filter->bHorizontalMirror, filter->bTrackDark,
+		filter->bSmooth, filter->smooth, filter->bHighpass, filter->highpassBlur, filter->highpassNoise, filter->bAmplify,
+		filter->highpassAmp, filter->threshold, filter->bDynamicTH, filter->threshSize, bMiniMode, MIN_BLOB_SIZE, MAX_BLOB_SIZE,
+		maxBlobs, camWidth, camHeight, contourFinder.bTrackFingers, contourFinder.bTrackObjects, bGPUMode, bPerCameraDetection, bcamera, bCameraDetection };
+	bool isSameSettings = memcmp(settings,processingSettings,sizeof(settings)) == 0;
+	memcpy(processingSettings,settings,sizeof(settings));
+	filter->changedTiles = NULL;
+	//per camera detection doesn't write processed image, so frame after it can't keep anything
+	if ((!isSameSettings) || (!bcamera) || (multiplexer == NULL) || bGPUMode || bCameraDetection)
+		return false;
+	//learned background changes filtered image even when camera frame is the same
+	if (filter->bDynamicBG || filter->bLearnBakground || ((ofGetElapsedTimeMillis() - filter->exposureStartTime) < CAMERA_EXPOSURE_TIME))
+		return false;
+	int tilesWidth = 0,tilesHeight = 0;
+	const unsigned char* changedTiles = multiplexer->getChangedTiles(&tilesWidth,&tilesHeight);
+	if (changedTiles == NULL)
+		return false;
+	for (int i=0;i<tilesWidth*tilesHeight;i++)
+	{
+		if (changedTiles[i] != 0)
+		{
+			//contours are found again, filter keeps rows of unchanged tiles
+			filter->changedTiles = changedTiles;
+			filter->changedTilesWidth = tilesWidth;
+			filter->changedTilesHeight = tilesHeight;
+			filter->changedTileSize = MULTIPLEXER_CHANGE_TILE_SIZE;
+			return false;
+		}
+	}
+	return true;
+}
+
+void ofxNCoreVision::updateMultiplexerBackground()
+{
+	if (filter->bLearnBakground || ((ofGetElapsedTimeMillis() - filter->exposureStartTime) < CAMERA_EXPOSURE_TIME))
+		multiplexer->learnBackground();
+	filter->bLearnBakground = false;
+	multiplexer->setBackgroundLearnRate(filter->bDynamicBG ? filter->fLearnRate : 0.0f);
+	multiplexer->setBackgroundTrackDark(filter->bTrackDark);
+}
+
+void ofxNCoreVision::freezeMultiplexerBackground()
+{
+	//blobs are found in mirrored stitched frame, multiplexer maps rectangles of unmirrored one to cameras
+	std::vector<int> rectangles;
+	if (filter->bDynamicBG)
+	{
+		for (int i = 0; i < contourFinder.nBlobs; i++)
+		{
+			const ofRectangle& rect = contourFinder.blobs[i].boundingRect;
+			int x = (int)rect.x, y = (int)rect.y, width = (int)rect.width, height = (int)rect.height;
+			rectangles.push_back(filter->bHorizontalMirror ? (int)camWidth - x - width : x);
+			rectangles.push_back(filter->bVerticalMirror ? (int)camHeight - y - height : y);
+			rectangles.push_back(width);
+			rectangles.push_back(height);
+		}
+	}
+	multiplexer->setBackgroundFreeze(rectangles.empty() ? NULL : &rectangles[0], (int)rectangles.size() / 4);
+}
+
 /******************************************************************************
 * The update function runs continuously. Use it to update states and variables
 *****************************************************************************/
@@ -384,9 +498,9 @@ void ofxNCoreVision::_update(ofEventArgs &e)
 	if(debugMode) if((stream = freopen(fileName, "a", stdout)) == NULL){}
 
 	bNewFrame = false;
+	bool bCameraDetection = false;
 	if (bcamera)
 	{
-	#ifdef TARGET_WIN32
 		if (calib.calibrating)
 		{
 			if (calib.shouldStart)
@@ -397,9 +511,20 @@ void ofxNCoreVision::_update(ofEventArgs &e)
 			else
 				multiplexerManager->updateCalibrationStatus();
 		}
-		multiplexer->updateStitchedFrame();
-		bNewFrame = true;
-	#endif	
+		bCameraDetection = isPerCameraDetection();
+		//frames are taken from cameras by stitching thread or by this thread, never by both (stopping joins stitching thread).
+		//GUI previews get copies (ofxCameraBase::getCameraFrame), so they don't take frames from either
+		multiplexer->setStitchingThreadEnabled(!bCameraDetection);
+		//GL thread only polls, waiting for cameras is left to stitching thread
+		if (multiplexer->waitForNewFrame(0))
+		{
+			//camera frames are processed without stitching them
+			if (bCameraDetection)
+				multiplexer->updateCameraFrames();
+			else
+				multiplexer->updateStitchedFrame();
+			bNewFrame = true;
+		}
 	}
 	else //if video
 	{
@@ -428,6 +553,11 @@ void ofxNCoreVision::_update(ofEventArgs &e)
 		}//End calculation
 
 		float beforeTime = ofGetElapsedTimeMillis();
+		bProcessingReused = isProcessingReusable(bCameraDetection);
+		//per camera detection has its own backgrounds in camera frames
+		filter->bBackgroundSubtracted = bcamera && (!bCameraDetection) && multiplexer->getBackgroundSubtraction();
+		if (filter->bBackgroundSubtracted)
+			updateMultiplexerBackground();
 
 		if (bGPUMode)
 		{
@@ -442,17 +572,24 @@ void ofxNCoreVision::_update(ofEventArgs &e)
 					fidfinder.findFiducials( filter_fiducial->gpuReadBackImageGS );
 			}
 		}
+		else if (bCameraDetection)
+		{
+			multicamDetector.detect(filter,&contourFinder,(MIN_BLOB_SIZE * 2) + 1, ((camWidth * camHeight) * .4) * (MAX_BLOB_SIZE * .001), maxBlobs);
+			if (!bMiniMode)
+				multicamDetector.updatePreview(filter);
+		}
 		else
 		{
 			grabFrameToCPU();
-			filter->applyCPUFilters( processedImg );
-			contourFinder.findContours(processedImg,  (MIN_BLOB_SIZE * 2) + 1, ((camWidth * camHeight) * .4) * (MAX_BLOB_SIZE * .001), maxBlobs, false);
-			if(contourFinder.bTrackFiducials || bFidtrackInterface)
-			{
-				filter_fiducial->applyCPUFilters( processedImg_fiducial );
-				if (contourFinder.bTrackFiducials)
-					fidfinder.findFiducials( processedImg_fiducial );
-			}
+			//blob and fiducial chains only read the leased frame, so they run on pool side by side
+			int tasksCount = (contourFinder.bTrackFiducials || bFidtrackInterface) ? 2 : 1;
+			//stages drawn by GUI are snapshot only from some frames
+			if (!bProcessingReused)
+				filter->updatePreviews();
+			if (tasksCount == 2)
+				filter_fiducial->updatePreviews();
+			ofxThreadPool::getShared()->parallelFor(tasksCount,1,&ofxNCoreVision::ProcessingTask,this);
+			releaseLeasedFrame();
 		}
 
 		//If Object tracking or Finger tracking is enabled
@@ -480,6 +617,16 @@ void ofxNCoreVision::_update(ofEventArgs &e)
 			}
 		}//End Background Learning rate
 
+		//Blobs aren't learned into dynamic background (camera backgrounds are frozen by multicam detector)
+		filter->clearBackgroundFreeze();
+		if (filter->bDynamicBG && !bCameraDetection && !bGPUMode)
+		{
+			for (int i = 0; i < contourFinder.nBlobs; i++)
+				filter->freezeBackground(contourFinder.blobs[i].boundingRect);
+		}
+		if (filter->bBackgroundSubtracted)
+			freezeMultiplexerBackground();
+
 		//Sending TUIO messages
 		if (myTUIO.bOSCMode || myTUIO.bTCPMode || myTUIO.bBinaryMode)
 		{
@@ -499,22 +646,19 @@ void ofxNCoreVision::getPixels()
 {
 	if (bcamera)
 	{
-		#ifdef TARGET_WIN32
-			if (multiplexer!=NULL)
-			{
-				int w,h;
-				if (capturedData == NULL)
-				{
-					multiplexer->getStitchedFrameSize(&w,&h);
-					camWidth = w;
-					camHeight = h;
-					capturedData = (unsigned char*)malloc(w*h*sizeof(unsigned char));
-				}
-				multiplexer->getStitchedFrame(&w,&h,capturedData);
-				processedImg.setFromPixels(capturedData, camWidth, camHeight);
-				if(contourFinder.bTrackFiducials || bFidtrackInterface){processedImg_fiducial.setFromPixels(capturedData, camWidth, camHeight);}
-			}
-		#endif
+		if (multiplexer!=NULL)
+		{
+			int w,h;
+			releaseLeasedFrame();
+			leasedFrame = multiplexer->leaseStitchedFrame(&w,&h);
+			if (leasedFrame == NULL)
+				return;
+			camWidth = w;
+			camHeight = h;
+			//filters read leased frame and write their first result to own images
+			processedImg.setFromLeasedPixels(leasedFrame);
+			if(contourFinder.bTrackFiducials || bFidtrackInterface){processedImg_fiducial.setFromLeasedPixels(leasedFrame);}
+		}
 	}
 	else
 	{
@@ -533,6 +677,18 @@ void ofxNCoreVision::grabFrameToCPU()
 	getPixels();
 }
 
+//Give leased stitched frame back to multiplexer, processed images must not wrap it anymore
+void ofxNCoreVision::releaseLeasedFrame()
+{
+	if (leasedFrame == NULL)
+		return;
+	processedImg.dropLease();
+	processedImg_fiducial.dropLease();
+	if (multiplexer != NULL)
+		multiplexer->releaseStitchedFrame(leasedFrame);
+	leasedFrame = NULL;
+}
+
 //Grab frame from GPU
 void ofxNCoreVision::grabFrameToGPU(GLuint target)
 {
@@ -542,21 +698,19 @@ void ofxNCoreVision::grabFrameToGPU(GLuint target)
 		glEnable(GL_TEXTURE_2D);
 		//glPixelStorei(1);
 		glBindTexture(GL_TEXTURE_2D, target);
-		#ifdef TARGET_WIN32
 		if(multiplexer!=NULL)
 		{
 			int w,h;
-			if (capturedData == NULL)
+			const unsigned char* frame = multiplexer->leaseStitchedFrame(&w,&h);
+			if (frame != NULL)
 			{
-				multiplexer->getStitchedFrameSize(&w,&h);
 				camWidth = w;
 				camHeight = h;
-				capturedData = (unsigned char*)malloc(w*h*sizeof(unsigned char));
-			}	 
-			multiplexer->getStitchedFrame(&w,&h,capturedData);
-			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, camWidth, camHeight, GL_LUMINANCE, GL_UNSIGNED_BYTE, capturedData);
+				//texture upload copies frame, so lease is released at once
+				glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, camWidth, camHeight, GL_LUMINANCE, GL_UNSIGNED_BYTE, frame);
+			}
+			multiplexer->releaseStitchedFrame(frame);
 		}
-		#endif
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 		glBindTexture(GL_TEXTURE_2D,0);
@@ -665,19 +819,30 @@ void ofxNCoreVision::drawFullMode()
 		str6+= ofToString(contourFinder.nBlobs,0)+", "+ofToString(contourFinder.nObjects,0)+", "+ofToString(fidfinder.fiducialsList.size(),0)+"\n";
 		string str7 = "";
 		string str8 = "";
+		string str9 = "";
 		if (bcamera)
 		{
 			int tWidth,tHeight;
 			str7 = "Camera Grid:\n";
 			multiplexer->getCameraGridSize(&tWidth,&tHeight);
 			str7+= ofToString(tWidth,0)+"x"+ofToString(tHeight,0)+"\n";
+			//the worst camera against the newest frame of stitched frame
+			unsigned int lastSkew,averageSkew,maxSkew,worstAverageSkew = 0,worstMaxSkew = 0;
+			for (int i=0;i<tWidth*tHeight;i++)
+			{
+				multiplexer->getCameraSkew(i,&lastSkew,&averageSkew,&maxSkew);
+				worstAverageSkew = MAX(worstAverageSkew,averageSkew);
+				worstMaxSkew = MAX(worstMaxSkew,maxSkew);
+			}
 			str8 = "Calibration Grid:\n";
 			multiplexer->getCalibrationGridSize(&tWidth,&tHeight);
 			str8+= ofToString(tWidth,0)+"x"+ofToString(tHeight,0)+"\n";
+			str9 = "Camera Skew:\n";
+			str9+= ofToString(worstAverageSkew / 1000.0f,1)+"/"+ofToString(worstMaxSkew / 1000.0f,1)+" ms\n";
 		}
 		
 		ofSetHexColor(0x555555);
-		verdana.drawString(  str3 + str4+str4a+str6 + str1 +  str2 + "\n\n\n" + str7 + str8 , DEBUG_TEXT_OFFSET_X1, DEBUG_TEXT_OFFSET_Y1);
+		verdana.drawString(  str3 + str4+str4a+str6 + str1 +  str2 + "\n\n\n" + str7 + str8 + str9 , DEBUG_TEXT_OFFSET_X1, DEBUG_TEXT_OFFSET_Y1);
 
 		// REMOVED + str5 
  
@@ -984,6 +1149,29 @@ void ofxNCoreVision::_keyPressed(ofKeyEventArgs &e)
 				saveSettings();
 			}
 			break;
+		case 'e':
+			if (bcamera && (multiplexer != NULL) && !bMultiCamsInterface)
+			{
+				if (multiplexer->isRecording())
+				{
+					unsigned int writtenFrames,droppedFrames;
+					multiplexer->stopRecording();
+					multiplexer->getRecordingStatistics(&writtenFrames,&droppedFrames);
+					printf("Recording stopped: %u frames written, %u dropped\n",writtenFrames,droppedFrames);
+				}
+				else
+				{
+					char fileName[64];
+					sprintf(fileName,"capture_%04d%02d%02d_%02d%02d%02d.raw",ofGetYear(),ofGetMonth(),ofGetDay(),ofGetHours(),ofGetMinutes(),ofGetSeconds());
+					if (!ofDirectory::doesDirectoryExist(recordingFolder))
+						ofDirectory::createDirectory(recordingFolder,true,true);
+					if (multiplexer->startRecording(ofToDataPath(recordingFolder + fileName),recordingSlots))
+						printf("Recording to %s\n",fileName);
+					else
+						printf("Recording to %s failed\n",fileName);
+				}
+			}
+			break;
 		case 'l':
 			bShowLabels ? bShowLabels = false : bShowLabels = true;
 			controls->update(appPtr->trackedPanel_ids, kofxGui_Set_Bool, &appPtr->bShowLabels, sizeof(bool));
@@ -1187,7 +1375,6 @@ void ofxNCoreVision::_exit(ofEventArgs &e)
 	
 	// AlexP
 	// C++ guarantees that operator delete checks its argument for null-ness
-    #ifdef TARGET_WIN32
 	if (multiplexer!=NULL)
 	{
 		delete multiplexer;	multiplexer = NULL;
@@ -1196,7 +1383,6 @@ void ofxNCoreVision::_exit(ofEventArgs &e)
 	{
 		delete multiplexerManager; multiplexerManager = NULL;
 	}
-	#endif
 	delete vidPlayer; vidPlayer = NULL;
 	delete filter;		filter = NULL;
 	// -------------------------------- SAVE STATE ON EXIT
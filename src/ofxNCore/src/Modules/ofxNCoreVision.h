@@ -13,10 +13,9 @@
 
 //Main
 #include "ofMain.h"
-#ifdef TARGET_WIN32
-	#include "ofxMultiplexerManager.h"
-	#include "ofxMultiplexer.h"
-#endif
+#include "ofxMultiplexerManager.h"
+#include "ofxMultiplexer.h"
+#include "ofxThreadPool.h"
 #include "ofxOpenCv.h"
 //#include "ofxDirList.h"
 //#include "ofxVectorMath.h"
@@ -33,6 +32,9 @@
 #define MAIN_WINDOW_WIDTH  320.0f
 #define MAIN_WINDOW_HEIGHT 240.0f
 
+// settings which results of blob filters and contours depend on
+#define PROCESSING_SETTINGS_COUNT 25
+
 // MAIN AREA POSITIONS
 #define MAIN_AREA_X 760
 #define MAIN_AREA_Y 30
@@ -216,6 +218,9 @@ public:
 		bMiniMode = 0;
 		bDrawOutlines = 1;
 		bGPUMode = 0;
+		bPerCameraDetection = false;
+		bProcessingReused = false;
+		memset(processingSettings,-1,sizeof(processingSettings));
 		bTUIOMode = 0;
 		bFidMode = 0;
 		bMulticamDialog = false;
@@ -224,6 +229,8 @@ public:
 		camRate = 30;
 		camWidth = 320;
 		camHeight = 240;
+		recordingSlots = 64;
+		workersCount = 0;
 		//ints/floats
 		backgroundLearnRate = .01;
 		MIN_BLOB_SIZE = 2;
@@ -241,7 +248,7 @@ public:
         #else
             bStandaloneMode = false;
         #endif
-			capturedData = NULL;
+			leasedFrame = NULL;
 		bMultiCamsInterface = false;
 		camsGrid = NULL;
 		devGrid = NULL;
@@ -292,6 +299,17 @@ public:
 	void getPixels();
 	void grabFrameToCPU();
 	void grabFrameToGPU(GLuint target);
+	//0 - blob filters and contours, 1 - fiducial filters and fiducials (thread pool routine)
+	static void ProcessingTask(void* instance,int first,int last,int participant);
+	//blobs are found in camera frames when enabled and nothing needs stitched frame (calibration, objects, fiducials, GPU)
+	bool isPerCameraDetection();
+	//blobs of previous frame are kept when no tile of stitched frame has changed and background and settings are the same.
+	//When some tiles changed, filter gets them and keeps rows of the others from previous frame
+	bool isProcessingReusable(bool bCameraDetection);
+	//background learning of filter goes to multiplexer when it subtracts background of cameras before stitching
+	void updateMultiplexerBackground();
+	//blobs aren't learned into background of multiplexer either
+	void freezeMultiplexerBackground();
 
 	//drawing
 	void drawFingerOutlines();
@@ -307,16 +325,16 @@ public:
 	//Getters
 	std::map<int, Blob> getBlobs();
 	std::map<int, Blob> getObjects();
-	unsigned char* capturedData;
+	//stitched frame leased by getPixels, it's wrapped by processed images till releaseLeasedFrame
+	const unsigned char* leasedFrame;
+	void releaseLeasedFrame();
 
 	void updateMainPanels();
 
 	/***************************************************************
 	 *					Video Capture Devices
 	 ***************************************************************/
-	#ifdef TARGET_WIN32
-		ofxMultiplexer* multiplexer; 
-	#endif
+	ofxMultiplexer* multiplexer; 
     ofVideoPlayer*	vidPlayer;
 	vector<CAMERATYPE> supportedCameraTypes;
 	ofxMultiplexerManager* multiplexerManager;
@@ -356,6 +374,9 @@ public:
 	bool				bAutoBackground;
 	//modes
 	bool				bGPUMode;
+	bool				bPerCameraDetection;
+	bool				bProcessingReused;
+	int					processingSettings[PROCESSING_SETTINGS_COUNT];
 
 	//Area slider variables
 	int					minTempArea;
@@ -420,6 +441,11 @@ public:
 	 *						Private Stuff
 	 ****************************************************************/
 	string				videoFileName;
+	//raw recording of multiplexer frames ('e' key)
+	string				recordingFolder;
+	int					recordingSlots;
+	//workers of shared thread pool, 0 - by processors count
+	int					workersCount;
 
 	int					maxBlobs;
 
@@ -432,6 +458,7 @@ public:
 
 	//Blob Finder
 	ContourFinder		contourFinder;
+	MulticamDetector	multicamDetector;
 
 	//Image filters
 	Filters*			filter;
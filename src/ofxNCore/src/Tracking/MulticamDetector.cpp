@@ -0,0 +1,393 @@
+/*
+*  MulticamDetector.cpp
+*
+*
+*  Created on 17/10/26.
+*  Copyright 2026 NUI Group. All rights reserved.
+*
+*/
+
+#include "MulticamDetector.h"
+#include "ofxThreadPool.h"
+
+MulticamDetector::MulticamDetector()
+{
+	multiplexer = NULL;
+	camerasCount = 0;
+	stitchedWidth = stitchedHeight = 0;
+	frameWidths = frameHeights = NULL;
+	cameraFilters = NULL;
+	cameraImages = NULL;
+	cameraFinders = NULL;
+	cameraMeshes = NULL;
+	cameraLUTs = NULL;
+	lutRevisions = NULL;
+	areaScales = NULL;
+	minAreas = maxAreas = NULL;
+	maxBlobs = 0;
+	isVerticalMirror = isHorizontalMirror = false;
+	previewSources = NULL;
+	previewFrame = NULL;
+}
+
+MulticamDetector::~MulticamDetector()
+{
+	clear();
+}
+
+bool MulticamDetector::setup(ofxMultiplexer* multiplexer,TemplateUtils* templates)
+{
+	clear();
+	int gridWidth,gridHeight;
+	multiplexer->getCameraGridSize(&gridWidth,&gridHeight);
+	for (int i=0;i<gridWidth*gridHeight;i++)
+	{
+		if (multiplexer->getCameraMesh(i) == NULL)
+			return false;
+	}
+	this->multiplexer = multiplexer;
+	camerasCount = gridWidth*gridHeight;
+	multiplexer->getStitchedFrameSize(&stitchedWidth,&stitchedHeight);
+	frameWidths = (int*)malloc(camerasCount*sizeof(int));
+	frameHeights = (int*)malloc(camerasCount*sizeof(int));
+	cameraFilters = (ProcessFilters**)malloc(camerasCount*sizeof(ProcessFilters*));
+	cameraImages = (CPUImageFilter**)malloc(camerasCount*sizeof(CPUImageFilter*));
+	cameraFinders = (ContourFinder**)malloc(camerasCount*sizeof(ContourFinder*));
+	cameraMeshes = (ofxCalibrationMesh**)malloc(camerasCount*sizeof(ofxCalibrationMesh*));
+	cameraLUTs = (CalibrationLUT**)malloc(camerasCount*sizeof(CalibrationLUT*));
+	lutRevisions = (unsigned int*)malloc(camerasCount*sizeof(unsigned int));
+	areaScales = (float*)malloc(camerasCount*sizeof(float));
+	minAreas = (int*)malloc(camerasCount*sizeof(int));
+	maxAreas = (int*)malloc(camerasCount*sizeof(int));
+	previewSources = (unsigned char**)malloc(camerasCount*sizeof(unsigned char*));
+	previewFrame = (unsigned char*)malloc(stitchedWidth*stitchedHeight*sizeof(unsigned char));
+	for (int i=0;i<camerasCount;i++)
+	{
+		multiplexer->getCameraFrame(i,&frameWidths[i],&frameHeights[i]);
+		cameraMeshes[i] = multiplexer->getCameraMesh(i);
+		cameraLUTs[i] = new CalibrationLUT();
+		cameraFilters[i] = new ProcessFilters();
+		cameraFilters[i]->allocate(frameWidths[i],frameHeights[i]);
+		cameraImages[i] = new CPUImageFilter();
+		cameraImages[i]->allocate(frameWidths[i],frameHeights[i]);
+		cameraImages[i]->setUseTexture(false);
+		cameraFinders[i] = new ContourFinder();
+		cameraFinders[i]->setTemplateUtils(templates);
+	}
+	printf("Per camera detection for %i cameras\n",camerasCount);
+	return true;
+}
+
+void MulticamDetector::clear()
+{
+	for (int i=0;i<camerasCount;i++)
+	{
+		delete cameraFilters[i];
+		delete cameraImages[i];
+		delete cameraFinders[i];
+		delete cameraLUTs[i];
+	}
+	if (frameWidths != NULL)
+	{
+		free(frameWidths);
+		free(frameHeights);
+		free(cameraFilters);
+		free(cameraImages);
+		free(cameraFinders);
+		free(cameraMeshes);
+		free(cameraLUTs);
+		free(lutRevisions);
+		free(areaScales);
+		free(minAreas);
+		free(maxAreas);
+		free(previewSources);
+		free(previewFrame);
+	}
+	frameWidths = frameHeights = NULL;
+	cameraFilters = NULL;
+	cameraImages = NULL;
+	cameraFinders = NULL;
+	cameraMeshes = NULL;
+	cameraLUTs = NULL;
+	lutRevisions = NULL;
+	areaScales = NULL;
+	minAreas = maxAreas = NULL;
+	previewSources = NULL;
+	previewFrame = NULL;
+	camerasCount = 0;
+	multiplexer = NULL;
+}
+
+bool MulticamDetector::isSetUp(ofxMultiplexer* multiplexer)
+{
+	if ((this->multiplexer == NULL) || (this->multiplexer != multiplexer))
+		return false;
+	int gridWidth,gridHeight,width,height;
+	multiplexer->getCameraGridSize(&gridWidth,&gridHeight);
+	multiplexer->getStitchedFrameSize(&width,&height);
+	if ((gridWidth*gridHeight != camerasCount) || (width != stitchedWidth) || (height != stitchedHeight))
+		return false;
+	for (int i=0;i<camerasCount;i++)
+	{
+		multiplexer->getCameraFrame(i,&width,&height);
+		if ((width != frameWidths[i]) || (height != frameHeights[i]) || (multiplexer->getCameraMesh(i) != cameraMeshes[i]))
+			return false;
+	}
+	return true;
+}
+
+void MulticamDetector::detect(Filters* filter,ContourFinder* contourFinder,int minArea,int maxArea,int maxBlobs)
+{
+	isVerticalMirror = filter->bVerticalMirror;
+	isHorizontalMirror = filter->bHorizontalMirror;
+	this->maxBlobs = maxBlobs;
+	//stages drawn by GUI are snapshot by camera filters in full size, so they can be stitched
+	filter->updatePreviews();
+	for (int i=0;i<camerasCount;i++)
+	{
+		ProcessFilters* cameraFilter = cameraFilters[i];
+		for (int stage=0;stage<FILTER_PREVIEW_STAGES;stage++)
+		{
+			if (filter->bPreviewDue[stage])
+				cameraFilter->requestPreview(stage,frameWidths[i],frameHeights[i],0);
+		}
+		cameraFilter->updatePreviews();
+		//blobs are mirrored in stitched frame
+		cameraFilter->bVerticalMirror = false;
+		cameraFilter->bHorizontalMirror = false;
+		cameraFilter->bMiniMode = filter->bMiniMode;
+		cameraFilter->threshold = filter->threshold;
+		cameraFilter->threshSize = filter->threshSize;
+		cameraFilter->smooth = filter->smooth;
+		cameraFilter->highpassBlur = filter->highpassBlur;
+		cameraFilter->highpassNoise = filter->highpassNoise;
+		cameraFilter->highpassAmp = filter->highpassAmp;
+		cameraFilter->fLearnRate = filter->fLearnRate;
+		cameraFilter->bDynamicBG = filter->bDynamicBG;
+		cameraFilter->bDynamicTH = filter->bDynamicTH;
+		cameraFilter->bSmooth = filter->bSmooth;
+		cameraFilter->bHighpass = filter->bHighpass;
+		cameraFilter->bAmplify = filter->bAmplify;
+		cameraFilter->bTrackDark = filter->bTrackDark;
+		if (filter->bLearnBakground)
+			cameraFilter->bLearnBakground = true;
+		ContourFinder* cameraFinder = cameraFinders[i];
+		cameraFinder->bTrackFingers = contourFinder->bTrackFingers;
+		//object templates are sizes in stitched frame, objects are found in it only
+		cameraFinder->bTrackObjects = false;
+		cameraFinder->bTrackFiducials = false;
+		areaScales[i] = cameraMeshes[i]->getAreaScale();
+		updateLUT(i);
+		minAreas[i] = (int)(minArea / areaScales[i]);
+		maxAreas[i] = (int)(maxArea / areaScales[i]);
+	}
+	//background is learned by camera filters
+	filter->bLearnBakground = false;
+	ofxThreadPool::getShared()->parallelFor(camerasCount,1,&MulticamDetector::DetectionTask,this);
+	candidates.clear();
+	candidateCameras.clear();
+	borderDistances.clear();
+	for (int i=0;i<camerasCount;i++)
+	{
+		ContourFinder* cameraFinder = cameraFinders[i];
+		for (int j=0;j<cameraFinder->nBlobs;j++)
+		{
+			Blob blob = cameraFinder->blobs[j];
+			float borderDistance = MIN(MIN(blob.centroid.x,frameWidths[i] - blob.centroid.x),MIN(blob.centroid.y,frameHeights[i] - blob.centroid.y));
+			if (!mapBlob(i,&blob))
+				continue;
+			candidates.push_back(blob);
+			candidateCameras.push_back(i);
+			borderDistances.push_back(borderDistance);
+		}
+	}
+	//pairs of blobs from different cameras, removed blob gets camera -1
+	for (int i=0;i<(int)candidates.size();i++)
+	{
+		for (int j=i+1;(j<(int)candidates.size()) && (candidateCameras[i] >= 0);j++)
+		{
+			if ((candidateCameras[j] < 0) || (candidateCameras[j] == candidateCameras[i]))
+				continue;
+			if (isDuplicate(candidates[i],candidates[j]))
+			{
+				if (borderDistances[j] > borderDistances[i])
+					candidateCameras[i] = -1;
+				else
+					candidateCameras[j] = -1;
+			}
+			else if (isTouching(candidates[i],candidates[j]))
+			{
+				mergeBlob(&candidates[i],candidates[j]);
+				candidateCameras[j] = -1;
+			}
+		}
+	}
+	contourFinder->blobs.clear();
+	contourFinder->objects.clear();
+	for (int i=0;i<(int)candidates.size();i++)
+	{
+		if (candidateCameras[i] >= 0)
+			contourFinder->blobs.push_back(candidates[i]);
+	}
+	contourFinder->nBlobs = contourFinder->blobs.size();
+	contourFinder->nObjects = 0;
+}
+
+void MulticamDetector::DetectionTask(void* instance,int first,int last,int /*participant*/)
+{
+	MulticamDetector *pThis = (MulticamDetector*)instance;
+	for (int i=first;i<last;i++)
+	{
+		int width,height;
+		CPUImageFilter* image = pThis->cameraImages[i];
+		//camera frame is only read, filters write to own image of camera
+		image->setFromLeasedPixels(pThis->multiplexer->getCameraFrame(i,&width,&height));
+		pThis->cameraFilters[i]->applyCPUFilters(*image);
+		image->dropLease();
+		ContourFinder* cameraFinder = pThis->cameraFinders[i];
+		cameraFinder->findContours(*image,pThis->minAreas[i],pThis->maxAreas[i],pThis->maxBlobs,false);
+		//camera backgrounds don't learn blobs of camera
+		ProcessFilters* cameraFilter = pThis->cameraFilters[i];
+		cameraFilter->clearBackgroundFreeze();
+		if (cameraFilter->bDynamicBG)
+		{
+			for (int j=0;j<cameraFinder->nBlobs;j++)
+				cameraFilter->freezeBackground(cameraFinder->blobs[j].boundingRect);
+		}
+	}
+}
+
+void MulticamDetector::mirrorPoint(float* x,float* y)
+{
+	if (isHorizontalMirror)
+		*x = stitchedWidth - 1 - *x;
+	if (isVerticalMirror)
+		*y = stitchedHeight - 1 - *y;
+}
+
+void MulticamDetector::updateLUT(int camera)
+{
+	ofxCalibrationMesh* mesh = cameraMeshes[camera];
+	if (cameraLUTs[camera]->isBuilt() && (lutRevisions[camera] == mesh->getRevision()))
+		return;
+	cameraLUTs[camera]->build(mesh,frameWidths[camera],frameHeights[camera],MULTICAM_LUT_STEP);
+	lutRevisions[camera] = mesh->getRevision();
+}
+
+bool MulticamDetector::mapBlob(int camera,Blob* blob)
+{
+	CalibrationLUT* lut = cameraLUTs[camera];
+	float x,y;
+	if (!lut->map(blob->centroid.x,blob->centroid.y,&x,&y))
+		return false;
+	mirrorPoint(&x,&y);
+	blob->centroid.x = x;
+	blob->centroid.y = y;
+	float left = x,top = y,right = x,bottom = y;
+	//contour may leave mesh a bit, it's extrapolated then
+	if (blob->nPts > 0)
+		lut->mapPoints(&blob->pts[0].x,blob->nPts,sizeof(ofPoint) / sizeof(float),NULL);
+	for (int i=0;i<blob->nPts;i++)
+	{
+		x = blob->pts[i].x;
+		y = blob->pts[i].y;
+		mirrorPoint(&x,&y);
+		blob->pts[i].x = x;
+		blob->pts[i].y = y;
+		left = MIN(left,x);
+		top = MIN(top,y);
+		right = MAX(right,x);
+		bottom = MAX(bottom,y);
+	}
+	blob->boundingRect.x = left;
+	blob->boundingRect.y = top;
+	blob->boundingRect.width = right - left + 1;
+	blob->boundingRect.height = bottom - top + 1;
+	float scale = sqrtf(areaScales[camera]);
+	lut->map(blob->angleBoundingRect.x,blob->angleBoundingRect.y,&x,&y);
+	mirrorPoint(&x,&y);
+	blob->angleBoundingRect.x = x;
+	blob->angleBoundingRect.y = y;
+	blob->angleBoundingRect.width *= scale;
+	blob->angleBoundingRect.height *= scale;
+	blob->area *= areaScales[camera];
+	blob->length *= scale;
+	return true;
+}
+
+bool MulticamDetector::isDuplicate(const Blob& first,const Blob& second)
+{
+	const ofRectangle& a = first.boundingRect;
+	const ofRectangle& b = second.boundingRect;
+	float width = MIN(a.x + a.width,b.x + b.width) - MAX(a.x,b.x);
+	float height = MIN(a.y + a.height,b.y + b.height) - MAX(a.y,b.y);
+	if ((width <= 0) || (height <= 0))
+		return false;
+	//overlap covers most of the smaller blob
+	return width*height*2 > MIN(a.width*a.height,b.width*b.height);
+}
+
+bool MulticamDetector::isTouching(const Blob& first,const Blob& second)
+{
+	const ofRectangle& a = first.boundingRect;
+	const ofRectangle& b = second.boundingRect;
+	float width = MIN(a.x + a.width,b.x + b.width) - MAX(a.x,b.x) + MULTICAM_BLOB_MARGIN;
+	float height = MIN(a.y + a.height,b.y + b.height) - MAX(a.y,b.y) + MULTICAM_BLOB_MARGIN;
+	return (width > 0) && (height > 0);
+}
+
+void MulticamDetector::mergeBlob(Blob* target,const Blob& source)
+{
+	float area = target->area + source.area;
+	if (area > 0)
+	{
+		target->centroid.x = (target->centroid.x * target->area + source.centroid.x * source.area) / area;
+		target->centroid.y = (target->centroid.y * target->area + source.centroid.y * source.area) / area;
+	}
+	float left = MIN(target->boundingRect.x,source.boundingRect.x);
+	float top = MIN(target->boundingRect.y,source.boundingRect.y);
+	float right = MAX(target->boundingRect.x + target->boundingRect.width,source.boundingRect.x + source.boundingRect.width);
+	float bottom = MAX(target->boundingRect.y + target->boundingRect.height,source.boundingRect.y + source.boundingRect.height);
+	target->boundingRect.x = left;
+	target->boundingRect.y = top;
+	target->boundingRect.width = right - left;
+	target->boundingRect.height = bottom - top;
+	target->angleBoundingRect.x = target->centroid.x;
+	target->angleBoundingRect.y = target->centroid.y;
+	target->angleBoundingRect.width = target->boundingRect.height;
+	target->angleBoundingRect.height = target->boundingRect.width;
+	target->angle = 0;
+	target->area = area;
+	target->length += source.length;
+	target->pts.insert(target->pts.end(),source.pts.begin(),source.pts.end());
+	target->nPts = target->pts.size();
+}
+
+void MulticamDetector::updatePreview(Filters* filter)
+{
+	bool isStageOn[FILTER_PREVIEW_STAGES] = {true,true,filter->bSmooth,filter->bHighpass,filter->bAmplify,true};
+	for (int stage=0;stage<FILTER_PREVIEW_STAGES;stage++)
+	{
+		//only stages snapshot by camera filters in last detect
+		if ((!isStageOn[stage]) || (!filter->bPreviewDue[stage]))
+			continue;
+		for (int i=0;i<camerasCount;i++)
+		{
+			ProcessFilters* cameraFilter = cameraFilters[i];
+			ofxCvGrayscaleImage* stages[FILTER_PREVIEW_STAGES] = {&cameraFilter->grayImg,&cameraFilter->grayBg,&cameraFilter->subtractBg,&cameraFilter->highpassImg,&cameraFilter->amplifyImg,&cameraFilter->grayDiff};
+			previewSources[i] = stages[stage]->getPixels();
+		}
+		multiplexer->remapFrames(previewSources,previewFrame);
+		if (stage == FILTER_PREVIEW_BACKGROUND)
+		{
+			//background preview is drawn from background image
+			filter->grayBg.setFromPixels(previewFrame,stitchedWidth,stitchedHeight);
+			if (isVerticalMirror || isHorizontalMirror)
+				filter->grayBg.mirror(isVerticalMirror,isHorizontalMirror);
+			continue;
+		}
+		filter->takePreview(stage,previewFrame,stitchedWidth,stitchedHeight,stitchedWidth);
+		if (isVerticalMirror || isHorizontalMirror)
+			filter->getPreviewImage(stage)->mirror(isVerticalMirror,isHorizontalMirror);
+	}
+}
@@ -0,0 +1,78 @@
+/*
+*  MulticamDetector.h
+*
+*  Filters and finds contours in every camera frame of multiplexer instead of the stitched frame.
+*  Only found blobs are mapped through calibration meshes to stitched frame, blobs seen by more
+*  cameras in overlap (or split by seam between them) become one blob.
+*
+*  Created on 17/10/26.
+*  Copyright 2026 NUI Group. All rights reserved.
+*
+*/
+
+#ifndef MULTICAM_DETECTOR_H
+#define MULTICAM_DETECTOR_H
+
+#include "ofMain.h"
+#include "ofxMultiplexer.h"
+#include "ContourFinder.h"
+#include "../Filters/ProcessFilters.h"
+#include "../Calibration/CalibrationLUT.h"
+
+//blobs of different cameras closer than this (in stitched pixels) are the same blob
+#define MULTICAM_BLOB_MARGIN 2.0f
+//camera pixels between nodes of camera to stitched frame lookup tables
+#define MULTICAM_LUT_STEP 2
+
+class MulticamDetector
+{
+public:
+	MulticamDetector();
+	~MulticamDetector();
+	//filters and contour finders for each camera of multiplexer, false when its meshes aren't computed yet
+	bool setup(ofxMultiplexer* multiplexer,TemplateUtils* templates);
+	void clear();
+	//false when cameras or their frame sizes differ from setup
+	bool isSetUp(ofxMultiplexer* multiplexer);
+	//camera frames taken by multiplexer->updateCameraFrames are processed on shared thread pool, blobs are merged
+	//to contour finder as if they were found in stitched frame. Settings are taken from filter, areas are stitched pixels
+	void detect(Filters* filter,ContourFinder* contourFinder,int minArea,int maxArea,int maxBlobs);
+	//filter images of stages due for drawing stitched from camera filters of last detect
+	void updatePreview(Filters* filter);
+private:
+	static void DetectionTask(void* instance,int first,int last,int participant);
+	//lookup table of camera is rebuilt when its mesh has changed
+	void updateLUT(int camera);
+	//blob of camera is moved to stitched frame, false when its centroid is outside of camera mesh
+	bool mapBlob(int camera,Blob* blob);
+	void mirrorPoint(float* x,float* y);
+	//the same blob seen by two cameras, blob of camera closer to its frame border is dropped
+	bool isDuplicate(const Blob& first,const Blob& second);
+	bool isTouching(const Blob& first,const Blob& second);
+	void mergeBlob(Blob* target,const Blob& source);
+	ofxMultiplexer* multiplexer;
+	int camerasCount;
+	int stitchedWidth,stitchedHeight;
+	int* frameWidths;
+	int* frameHeights;
+	ProcessFilters** cameraFilters;
+	CPUImageFilter** cameraImages;
+	ContourFinder** cameraFinders;
+	ofxCalibrationMesh** cameraMeshes;
+	CalibrationLUT** cameraLUTs;
+	unsigned int* lutRevisions;
+	float* areaScales;
+	//areas of current detection in camera pixels
+	int* minAreas;
+	int* maxAreas;
+	int maxBlobs;
+	bool isVerticalMirror,isHorizontalMirror;
+	//mapped blobs of all cameras, their cameras and distances of camera centroids to frame border
+	vector<Blob> candidates;
+	vector<int> candidateCameras;
+	vector<float> borderDistances;
+	unsigned char** previewSources;
+	unsigned char* previewFrame;
+};
+
+#endif
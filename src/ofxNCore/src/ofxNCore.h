@@ -42,6 +42,8 @@
 
 //Used for tracking algo
 #include "Tracking/Tracking.h"
+//Blobs found in camera frames instead of stitched frame
+#include "Tracking/MulticamDetector.h"
 //Object Trackin
 #include "Templates/TemplateUtils.h"
 
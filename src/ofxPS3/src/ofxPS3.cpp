@@ -285,7 +285,6 @@ DWORD WINAPI ofxPS3::SettingsThread(LPVOID instance)
 
 ofxPS3::ofxPS3() 
 {
-	cameraFrame = 0;
 	ps3EyeCamera = NULL;
 	settingsGUIThread = NULL;
 	isSettedDefaultSettings = false;
@@ -303,9 +302,9 @@ void ofxPS3::callSettingsDialog()
 }
 
 
-void ofxPS3::getNewFrame(unsigned char* newFrame)
+bool ofxPS3::getNewFrame(unsigned char* newFrame)
 {
-	CLEyeCameraGetFrame(ps3EyeCamera,(PBYTE)newFrame, 1000);
+	return CLEyeCameraGetFrame(ps3EyeCamera,(PBYTE)newFrame, 1000);
 }
 
 CAMERA_BASE_FEATURE* ofxPS3::getSupportedFeatures(int* featuresCount)
@@ -377,6 +376,19 @@ void ofxPS3::cameraDeinitializationLogic()
 	ps3EyeCamera = NULL;
 }
 
+void ofxPS3::cameraPauseLogic()
+{
+	//idle camera doesn't stream over USB
+	if (ps3EyeCamera != NULL)
+		CLEyeCameraStop(ps3EyeCamera);
+}
+
+void ofxPS3::cameraResumeLogic()
+{
+	if (ps3EyeCamera != NULL)
+		CLEyeCameraStart(ps3EyeCamera);
+}
+
 void ofxPS3::setCameraFeature(CAMERA_BASE_FEATURE featureCode,int firstValue,int secondValue,bool isAuto,bool isEnabled)
 {
 	CLEyeCameraParameter deviceProperty = (CLEyeCameraParameter)0xFFFFFFFF;
@@ -0,0 +1,51 @@
+/*
+*  ofxMappedFile.h
+*
+*  Created on 17/10/26.
+*  Copyright 2026 NUI Group. All rights reserved.
+*
+*/
+#ifndef OFX_MAPPED_FILE_H
+#define OFX_MAPPED_FILE_H
+
+#include <string>
+#include "ofxCameraBasePlatform.h"
+
+//offsets of mapped regions are aligned to this (allocation granularity on Windows, multiple of page size elsewhere)
+#define MAPPED_FILE_GRANULARITY 65536
+//file written through mapped regions grows at least by this size
+#define MAPPED_FILE_GROWTH (64*1024*1024)
+
+//File mapped to memory (MapViewOfFile on Windows, mmap everywhere else).
+//Files opened for reading are mapped whole, files opened for writing are mapped region by region.
+class ofxMappedFile
+{
+public:
+	ofxMappedFile();
+	~ofxMappedFile();
+	bool openForReading(const std::string& fileName);
+	//creates new (or truncates existing) file
+	bool openForWriting(const std::string& fileName);
+	void close();
+	bool isOpened();
+	//whole file when opened for reading
+	unsigned char* getData() { return view; }
+	unsigned long long getSize() { return size; }
+	//maps length bytes at offset for writing and unmaps previous region, file grows when needed
+	unsigned char* mapRegion(unsigned long long offset,unsigned int length);
+	//unmaps region and sets file size
+	bool truncate(unsigned long long fileSize);
+private:
+	void unmapView();
+	unsigned char* view;
+	unsigned long long viewSize;
+	unsigned long long size;
+#ifdef _WIN32
+	HANDLE fileHandle;
+	HANDLE mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+};
+
+#endif // OFX_MAPPED_FILE_H
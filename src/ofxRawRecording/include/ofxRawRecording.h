@@ -0,0 +1,163 @@
+/*
+*  ofxRawRecording.h
+*
+*  Created on 17/10/26.
+*  Copyright 2026 NUI Group. All rights reserved.
+*
+*/
+#ifndef OFX_RAW_RECORDING_H
+#define OFX_RAW_RECORDING_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "ofxCameraBasePlatform.h"
+#include "ofxFrameNotifier.h"
+#include "ofxMappedFile.h"
+
+//Raw recording container (little endian, all offsets from the beginning of file):
+//  fixed size header with stream descriptors,
+//  frame records (ofxRawFrameHeader + pixels), each aligned to RAW_RECORDING_ALIGNMENT,
+//  frame index (ofxRawFrameIndexEntry for every record), written when recording is closed.
+//When index is missing (recording was interrupted) records are found by scanning from the end of header.
+#define RAW_RECORDING_MAGIC 0x52564343 //"CCVR"
+#define RAW_FRAME_MAGIC 0x4D415246 //"FRAM"
+#define RAW_RECORDING_VERSION 1
+#define RAW_RECORDING_HEADER_SIZE 4096
+#define RAW_RECORDING_ALIGNMENT 16
+//16 cameras and stitched frame
+#define RAW_RECORDING_MAX_STREAMS 17
+//size of region which writer maps at once
+#define RAW_RECORDING_WINDOW_SIZE (16*1024*1024)
+
+//stream flags
+#define RAW_STREAM_CAMERA 0x0
+#define RAW_STREAM_STITCHED 0x1
+
+typedef struct ofxRawRecordingStream
+{
+	//camera identifier (zero for stitched stream)
+	GUID guid;
+	uint32_t width;
+	uint32_t height;
+	//bytes per pixel, grayscale recordings have 1
+	uint32_t depth;
+	uint32_t flags;
+} ofxRawRecordingStream;
+
+typedef struct ofxRawRecordingHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t headerSize;
+	uint32_t streamCount;
+	//offset and number of entries of frame index, 0 when index was not written
+	uint64_t indexOffset;
+	uint64_t indexCount;
+	ofxRawRecordingStream streams[RAW_RECORDING_MAX_STREAMS];
+} ofxRawRecordingHeader;
+
+typedef struct ofxRawFrameHeader
+{
+	uint32_t magic;
+	uint32_t stream;
+	//number of frame inside stream
+	uint32_t sequence;
+	//size of pixel data following this header
+	uint32_t size;
+	//capture time in microseconds
+	uint64_t timestamp;
+	uint64_t reserved;
+} ofxRawFrameHeader;
+
+typedef struct ofxRawFrameIndexEntry
+{
+	//offset of ofxRawFrameHeader
+	uint64_t offset;
+	uint64_t timestamp;
+	uint32_t stream;
+	uint32_t size;
+} ofxRawFrameIndexEntry;
+
+//size of frame record with pixel data and alignment padding
+inline uint64_t getRawFrameRecordSize(uint32_t dataSize)
+{
+	return ((uint64_t)sizeof(ofxRawFrameHeader) + dataSize + RAW_RECORDING_ALIGNMENT - 1) & ~(uint64_t)(RAW_RECORDING_ALIGNMENT - 1);
+}
+
+//Read-only access to recording, frames are returned straight from mapped file without copying
+class ofxRawRecordingReader
+{
+public:
+	ofxRawRecordingReader();
+	~ofxRawRecordingReader();
+	bool open(const std::string& fileName);
+	void close();
+	bool isOpened() { return header != NULL; }
+	int getStreamCount();
+	ofxRawRecordingStream* getStream(int stream);
+	int getFrameCount(int stream);
+	//returns pixels of frame, pointer is valid till recording is closed
+	const unsigned char* getFrame(int stream,int frame,unsigned long long* timestamp,unsigned int* size);
+	//earliest timestamp of all streams, start of recording
+	unsigned long long getFirstTimestamp();
+	//time from start of recording till end of its last frame (last timestamp plus mean frame spacing of its stream)
+	unsigned long long getDuration();
+	//true when frame index was missing and frames were found by scanning
+	bool isIndexRebuilt() { return indexRebuilt; }
+private:
+	bool readIndex();
+	void scanFrames();
+	void addFrame(uint64_t offset,ofxRawFrameHeader* frameHeader);
+private:
+	ofxMappedFile file;
+	ofxRawRecordingHeader* header;
+	bool indexRebuilt;
+	//per stream list of frames in recording order
+	std::vector<std::vector<ofxRawFrameIndexEntry> > frames;
+};
+
+//Append-only writer. Frames are copied to ring of slots by pushFrame and written to mapped file by writer thread,
+//so producer never waits for disk. When all slots are busy new frame is dropped.
+class ofxRawRecordingWriter
+{
+public:
+	ofxRawRecordingWriter();
+	~ofxRawRecordingWriter();
+	//streams are added before start, returns index of stream or -1
+	int addStream(GUID guid,int width,int height,int depth,unsigned int flags);
+	bool start(const std::string& fileName,int slotsCount);
+	//writes queued frames, frame index and closes file
+	void stop();
+	bool isRecording() { return isWriterRunning; }
+	//copies frame to free slot, returns false when frame was dropped. Should be called from one thread
+	bool pushFrame(int stream,const unsigned char* pixels,unsigned long long timestamp);
+	unsigned int getWrittenFramesCount() { return writtenFramesCount; }
+	unsigned int getDroppedFramesCount() { return droppedFramesCount; }
+private:
+	static void WriterThread(void* instance);
+	static bool IsSlotReady(void* instance);
+	void Write();
+	bool writeData(const void* data,unsigned int length);
+	bool writeHeader();
+private:
+	ofxMappedFile file;
+	ofxRawRecordingHeader header;
+	ofxCaptureThread writerThread;
+	volatile bool isWriterRunning;
+	//region of file which is mapped now
+	unsigned char* window;
+	unsigned long long windowOffset,writeOffset;
+	//ring of slots: producer fills slot pushedSlots % slotsCount, writer thread takes slot writtenSlots % slotsCount
+	int slotsCount;
+	unsigned int slotSize;
+	ofxRawFrameHeader* slotHeaders;
+	unsigned char* slotPixels;
+	ofxAtomicLong pushedSlots,writtenSlots;
+	ofxFrameNotifier slotNotifier;
+	unsigned int sequences[RAW_RECORDING_MAX_STREAMS];
+	std::vector<ofxRawFrameIndexEntry> index;
+	unsigned int writtenFramesCount,droppedFramesCount;
+};
+
+#endif // OFX_RAW_RECORDING_H
@@ -0,0 +1,75 @@
+/*
+*  ofxRecordedCamera.h
+*
+*  Created on 17/10/26.
+*  Copyright 2026 NUI Group. All rights reserved.
+*
+*/
+#ifndef OFX_RECORDED_CAMERA_H
+#define OFX_RECORDED_CAMERA_H
+
+#include "ofxCameraBase.h"
+#include "ofxRawRecording.h"
+
+//Playback clock shared by all cameras replaying one recording, so their streams stay aligned as they were recorded.
+//Time of recording maps to playback time as startTime + (timestamp - firstTimestamp of recording)
+typedef struct ofxRecordingEpoch
+{
+	int camerasCount;
+	bool isStarted;
+	unsigned long long startTime;
+} ofxRecordingEpoch;
+
+typedef enum
+{
+	//frames are delivered with camera framerate (SETTINGS:SENSOR:FRAMERATE), recorded timestamps only set start of
+	//each stream: frame n of stream is due at (first timestamp of stream - first timestamp of recording) + n/framerate
+	RECORDING_FREERUN,
+	//frames are delivered with recorded timestamps
+	RECORDING_REALTIME,
+	//frames are delivered without any waiting
+	RECORDING_FAST
+} RECORDING_PACING;
+
+//Camera which replays one stream of raw recording. File and pacing are set in app_settings.xml (CONFIG:RECORDING),
+//every stream of recording is enumerated as separate camera with stream number in GUID.Data1
+class ofxRecordedCamera : ofxCameraBase
+{
+public:
+	ofxRecordedCamera();
+	~ofxRecordedCamera();
+	void setCameraFeature(CAMERA_BASE_FEATURE featureCode,int firstValue,int secondValue,bool isAuto,bool isEnabled);
+	void getCameraFeature(CAMERA_BASE_FEATURE featureCode,int* firstValue,int* secondValue, bool* isAuto, bool* isEnabled,int* minValue,int* maxValue);
+	int getCameraBaseCount();
+	GUID* getBaseCameraGuids(int* camCount);
+	CAMERA_BASE_FEATURE* getSupportedFeatures(int* featuresCount);
+protected:
+	bool getNewFrame(unsigned char* newFrame);
+	void cameraInitializationLogic();
+	void cameraDeinitializationLogic();
+	void cameraResumeLogic();
+	void setCameraType();
+private:
+	void loadRecordingSettings();
+	void openEpoch();
+	void closeEpoch();
+	//time of frame from start of recording on playback clock
+	unsigned long long getFrameOffset(unsigned long long timestamp);
+	//false till frame is due, due time is its capture time on playback clock
+	bool waitForFrameTime(unsigned long long timestamp,unsigned long long* dueTime);
+private:
+	ofxRawRecordingReader reader;
+	std::string recordingFileName;
+	RECORDING_PACING pacing;
+	bool isLooped;
+	int stream,currentFrame;
+	//epoch of recording shared with other cameras, it's guarded by static lock
+	ofxRecordingEpoch* epoch;
+	unsigned long long firstTimestamp,streamOffset,duration;
+	//looped realtime playback adds duration of recording for every loop, freerun counts frames across loops
+	unsigned int loopsCount,deliveredFrames;
+	//after resume the whole epoch is moved, so playback continues from paused frame instead of catching up
+	bool isResyncNeeded;
+};
+
+#endif // OFX_RECORDED_CAMERA_H
@@ -0,0 +1,212 @@
+#include "ofxMappedFile.h"
+
+#ifndef _WIN32
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+ofxMappedFile::ofxMappedFile()
+{
+	view = NULL;
+	viewSize = 0;
+	size = 0;
+#ifdef _WIN32
+	fileHandle = INVALID_HANDLE_VALUE;
+	mappingHandle = NULL;
+#else
+	fileDescriptor = -1;
+#endif
+}
+
+ofxMappedFile::~ofxMappedFile()
+{
+	close();
+}
+
+#ifdef _WIN32
+
+bool ofxMappedFile::openForReading(const std::string& fileName)
+{
+	close();
+	fileHandle = CreateFileA(fileName.c_str(),GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER fileSize;
+	if ((!GetFileSizeEx(fileHandle,&fileSize)) || (fileSize.QuadPart == 0))
+	{
+		close();
+		return false;
+	}
+	mappingHandle = CreateFileMappingA(fileHandle,NULL,PAGE_READONLY,0,0,NULL);
+	if (mappingHandle == NULL)
+	{
+		close();
+		return false;
+	}
+	view = (unsigned char*)MapViewOfFile(mappingHandle,FILE_MAP_READ,0,0,0);
+	if (view == NULL)
+	{
+		close();
+		return false;
+	}
+	size = viewSize = fileSize.QuadPart;
+	return true;
+}
+
+bool ofxMappedFile::openForWriting(const std::string& fileName)
+{
+	close();
+	fileHandle = CreateFileA(fileName.c_str(),GENERIC_READ | GENERIC_WRITE,FILE_SHARE_READ,NULL,CREATE_ALWAYS,FILE_ATTRIBUTE_NORMAL,NULL);
+	return fileHandle != INVALID_HANDLE_VALUE;
+}
+
+bool ofxMappedFile::isOpened()
+{
+	return fileHandle != INVALID_HANDLE_VALUE;
+}
+
+unsigned char* ofxMappedFile::mapRegion(unsigned long long offset,unsigned int length)
+{
+	unmapView();
+	if ((mappingHandle == NULL) || (offset + length > size))
+	{
+		//mapping of bigger size extends file
+		unsigned long long newSize = size + MAPPED_FILE_GROWTH;
+		if (newSize < offset + length)
+			newSize = offset + length;
+		if (mappingHandle != NULL)
+			CloseHandle(mappingHandle);
+		mappingHandle = CreateFileMappingA(fileHandle,NULL,PAGE_READWRITE,(DWORD)(newSize >> 32),(DWORD)newSize,NULL);
+		if (mappingHandle == NULL)
+			return NULL;
+		size = newSize;
+	}
+	unsigned long long viewOffset = offset & ~(unsigned long long)(MAPPED_FILE_GRANULARITY - 1);
+	viewSize = offset + length - viewOffset;
+	view = (unsigned char*)MapViewOfFile(mappingHandle,FILE_MAP_WRITE,(DWORD)(viewOffset >> 32),(DWORD)viewOffset,(SIZE_T)viewSize);
+	if (view == NULL)
+		return NULL;
+	return view + (offset - viewOffset);
+}
+
+bool ofxMappedFile::truncate(unsigned long long fileSize)
+{
+	unmapView();
+	if (mappingHandle != NULL)
+		CloseHandle(mappingHandle);
+	mappingHandle = NULL;
+	LARGE_INTEGER position;
+	position.QuadPart = fileSize;
+	if ((!SetFilePointerEx(fileHandle,position,NULL,FILE_BEGIN)) || (!SetEndOfFile(fileHandle)))
+		return false;
+	size = fileSize;
+	return true;
+}
+
+void ofxMappedFile::unmapView()
+{
+	if (view != NULL)
+		UnmapViewOfFile(view);
+	view = NULL;
+	viewSize = 0;
+}
+
+void ofxMappedFile::close()
+{
+	unmapView();
+	if (mappingHandle != NULL)
+		CloseHandle(mappingHandle);
+	if (fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(fileHandle);
+	size = 0;
+	mappingHandle = NULL;
+	fileHandle = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool ofxMappedFile::openForReading(const std::string& fileName)
+{
+	close();
+	fileDescriptor = open(fileName.c_str(),O_RDONLY);
+	if (fileDescriptor < 0)
+		return false;
+	struct stat fileStat;
+	if ((fstat(fileDescriptor,&fileStat) != 0) || (fileStat.st_size == 0))
+	{
+		close();
+		return false;
+	}
+	void* mapping = mmap(NULL,fileStat.st_size,PROT_READ,MAP_SHARED,fileDescriptor,0);
+	if (mapping == MAP_FAILED)
+	{
+		close();
+		return false;
+	}
+	view = (unsigned char*)mapping;
+	size = viewSize = fileStat.st_size;
+	return true;
+}
+
+bool ofxMappedFile::openForWriting(const std::string& fileName)
+{
+	close();
+	fileDescriptor = open(fileName.c_str(),O_RDWR | O_CREAT | O_TRUNC,0644);
+	return fileDescriptor >= 0;
+}
+
+bool ofxMappedFile::isOpened()
+{
+	return fileDescriptor >= 0;
+}
+
+unsigned char* ofxMappedFile::mapRegion(unsigned long long offset,unsigned int length)
+{
+	unmapView();
+	if (offset + length > size)
+	{
+		unsigned long long newSize = size + MAPPED_FILE_GROWTH;
+		if (newSize < offset + length)
+			newSize = offset + length;
+		if (ftruncate(fileDescriptor,newSize) != 0)
+			return NULL;
+		size = newSize;
+	}
+	unsigned long long viewOffset = offset & ~(unsigned long long)(MAPPED_FILE_GRANULARITY - 1);
+	void* mapping = mmap(NULL,offset + length - viewOffset,PROT_READ | PROT_WRITE,MAP_SHARED,fileDescriptor,viewOffset);
+	if (mapping == MAP_FAILED)
+		return NULL;
+	view = (unsigned char*)mapping;
+	viewSize = offset + length - viewOffset;
+	return view + (offset - viewOffset);
+}
+
+bool ofxMappedFile::truncate(unsigned long long fileSize)
+{
+	unmapView();
+	if (ftruncate(fileDescriptor,fileSize) != 0)
+		return false;
+	size = fileSize;
+	return true;
+}
+
+void ofxMappedFile::unmapView()
+{
+	if (view != NULL)
+		munmap(view,viewSize);
+	view = NULL;
+	viewSize = 0;
+}
+
+void ofxMappedFile::close()
+{
+	unmapView();
+	if (fileDescriptor >= 0)
+		::close(fileDescriptor);
+	size = 0;
+	fileDescriptor = -1;
+}
+
+#endif
@@ -0,0 +1,365 @@
+#include "ofxRawRecording.h"
+
+ofxRawRecordingReader::ofxRawRecordingReader()
+{
+	header = NULL;
+	indexRebuilt = false;
+}
+
+ofxRawRecordingReader::~ofxRawRecordingReader()
+{
+	close();
+}
+
+bool ofxRawRecordingReader::open(const std::string& fileName)
+{
+	close();
+	if (!file.openForReading(fileName))
+		return false;
+	if (file.getSize() < RAW_RECORDING_HEADER_SIZE)
+	{
+		file.close();
+		return false;
+	}
+	ofxRawRecordingHeader* fileHeader = (ofxRawRecordingHeader*)file.getData();
+	if ((fileHeader->magic != RAW_RECORDING_MAGIC) || (fileHeader->version != RAW_RECORDING_VERSION) ||
+		(fileHeader->headerSize < RAW_RECORDING_HEADER_SIZE) || (fileHeader->headerSize > file.getSize()) ||
+		(fileHeader->streamCount > RAW_RECORDING_MAX_STREAMS))
+	{
+		file.close();
+		return false;
+	}
+	header = fileHeader;
+	frames.resize(header->streamCount);
+	indexRebuilt = !readIndex();
+	if (indexRebuilt)
+		scanFrames();
+	return true;
+}
+
+void ofxRawRecordingReader::close()
+{
+	header = NULL;
+	indexRebuilt = false;
+	frames.clear();
+	file.close();
+}
+
+bool ofxRawRecordingReader::readIndex()
+{
+	uint64_t fileSize = file.getSize();
+	if ((header->indexOffset < header->headerSize) || (header->indexOffset > fileSize) ||
+		(header->indexCount > (fileSize - header->indexOffset) / sizeof(ofxRawFrameIndexEntry)))
+		return false;
+	ofxRawFrameIndexEntry* index = (ofxRawFrameIndexEntry*)(file.getData() + header->indexOffset);
+	for (uint64_t i=0;i<header->indexCount;i++)
+	{
+		if ((index[i].stream >= header->streamCount) || (index[i].offset > header->indexOffset - sizeof(ofxRawFrameHeader)) ||
+			(index[i].size > header->indexOffset - index[i].offset - sizeof(ofxRawFrameHeader)))
+		{
+			for (int j=0;j<(int)frames.size();j++)
+				frames[j].clear();
+			return false;
+		}
+		frames[index[i].stream].push_back(index[i]);
+	}
+	return true;
+}
+
+void ofxRawRecordingReader::scanFrames()
+{
+	//records are written one after another, so first bad or truncated record is the end of recording
+	uint64_t fileSize = file.getSize();
+	uint64_t offset = header->headerSize;
+	while (offset + sizeof(ofxRawFrameHeader) <= fileSize)
+	{
+		ofxRawFrameHeader* frameHeader = (ofxRawFrameHeader*)(file.getData() + offset);
+		if ((frameHeader->magic != RAW_FRAME_MAGIC) || (frameHeader->stream >= header->streamCount))
+			break;
+		uint64_t recordSize = getRawFrameRecordSize(frameHeader->size);
+		if (recordSize > fileSize - offset)
+			break;
+		addFrame(offset,frameHeader);
+		offset += recordSize;
+	}
+}
+
+void ofxRawRecordingReader::addFrame(uint64_t offset,ofxRawFrameHeader* frameHeader)
+{
+	ofxRawFrameIndexEntry entry;
+	entry.offset = offset;
+	entry.timestamp = frameHeader->timestamp;
+	entry.stream = frameHeader->stream;
+	entry.size = frameHeader->size;
+	frames[entry.stream].push_back(entry);
+}
+
+int ofxRawRecordingReader::getStreamCount()
+{
+	return header != NULL ? header->streamCount : 0;
+}
+
+ofxRawRecordingStream* ofxRawRecordingReader::getStream(int stream)
+{
+	if ((stream < 0) || (stream >= getStreamCount()))
+		return NULL;
+	return &header->streams[stream];
+}
+
+int ofxRawRecordingReader::getFrameCount(int stream)
+{
+	if ((stream < 0) || (stream >= getStreamCount()))
+		return 0;
+	return frames[stream].size();
+}
+
+const unsigned char* ofxRawRecordingReader::getFrame(int stream,int frame,unsigned long long* timestamp,unsigned int* size)
+{
+	if ((frame < 0) || (frame >= getFrameCount(stream)))
+		return NULL;
+	ofxRawFrameIndexEntry* entry = &frames[stream][frame];
+	if (timestamp != NULL)
+		*timestamp = entry->timestamp;
+	if (size != NULL)
+		*size = entry->size;
+	return file.getData() + entry->offset + sizeof(ofxRawFrameHeader);
+}
+
+unsigned long long ofxRawRecordingReader::getFirstTimestamp()
+{
+	unsigned long long firstTimestamp = 0;
+	bool isFound = false;
+	for (int i=0;i<(int)frames.size();i++)
+	{
+		if ((!frames[i].empty()) && ((!isFound) || (frames[i].front().timestamp < firstTimestamp)))
+		{
+			firstTimestamp = frames[i].front().timestamp;
+			isFound = true;
+		}
+	}
+	return firstTimestamp;
+}
+
+unsigned long long ofxRawRecordingReader::getDuration()
+{
+	unsigned long long firstTimestamp = getFirstTimestamp();
+	unsigned long long duration = 0;
+	for (int i=0;i<(int)frames.size();i++)
+	{
+		int count = frames[i].size();
+		if (count == 0)
+			continue;
+		unsigned long long first = frames[i].front().timestamp,last = frames[i].back().timestamp;
+		unsigned long long end = last + (count > 1 && last > first ? (last - first) / (count - 1) : 0);
+		if (end - firstTimestamp > duration)
+			duration = end - firstTimestamp;
+	}
+	return duration;
+}
+
+ofxRawRecordingWriter::ofxRawRecordingWriter()
+{
+	memset((void*)&header,0,sizeof(ofxRawRecordingHeader));
+	isWriterRunning = false;
+	window = NULL;
+	windowOffset = writeOffset = 0;
+	slotsCount = 0;
+	slotSize = 0;
+	slotHeaders = NULL;
+	slotPixels = NULL;
+	pushedSlots = 0;
+	writtenSlots = 0;
+	writtenFramesCount = droppedFramesCount = 0;
+}
+
+ofxRawRecordingWriter::~ofxRawRecordingWriter()
+{
+	stop();
+}
+
+int ofxRawRecordingWriter::addStream(GUID guid,int width,int height,int depth,unsigned int flags)
+{
+	if (isWriterRunning || (header.streamCount >= RAW_RECORDING_MAX_STREAMS))
+		return -1;
+	ofxRawRecordingStream* stream = &header.streams[header.streamCount];
+	stream->guid = guid;
+	stream->width = width;
+	stream->height = height;
+	stream->depth = depth;
+	stream->flags = flags;
+	return header.streamCount++;
+}
+
+bool ofxRawRecordingWriter::start(const std::string& fileName,int slotsCount)
+{
+	if (isWriterRunning || (header.streamCount == 0) || (slotsCount <= 0))
+		return false;
+	if (!file.openForWriting(fileName))
+		return false;
+	header.magic = RAW_RECORDING_MAGIC;
+	header.version = RAW_RECORDING_VERSION;
+	header.headerSize = RAW_RECORDING_HEADER_SIZE;
+	//index is written by stop, till then readers rebuild it by scanning
+	header.indexOffset = 0;
+	header.indexCount = 0;
+	if (!writeHeader())
+	{
+		file.close();
+		return false;
+	}
+	writeOffset = RAW_RECORDING_HEADER_SIZE;
+	slotSize = 0;
+	for (unsigned int i=0;i<header.streamCount;i++)
+	{
+		unsigned int frameSize = header.streams[i].width * header.streams[i].height * header.streams[i].depth;
+		if (frameSize > slotSize)
+			slotSize = frameSize;
+	}
+	this->slotsCount = slotsCount;
+	slotHeaders = (ofxRawFrameHeader*)malloc(slotsCount * sizeof(ofxRawFrameHeader));
+	slotPixels = (unsigned char*)malloc(slotsCount * slotSize * sizeof(unsigned char));
+	pushedSlots = 0;
+	writtenSlots = 0;
+	memset((void*)sequences,0,RAW_RECORDING_MAX_STREAMS*sizeof(unsigned int));
+	index.clear();
+	writtenFramesCount = droppedFramesCount = 0;
+	isWriterRunning = true;
+	writerThread.start(&ofxRawRecordingWriter::WriterThread,this);
+	return true;
+}
+
+void ofxRawRecordingWriter::stop()
+{
+	if (!isWriterRunning)
+	{
+		header.streamCount = 0;
+		return;
+	}
+	isWriterRunning = false;
+	slotNotifier.notify();
+	writerThread.join();
+	unsigned long long indexOffset = writeOffset;
+	if ((index.size() == 0) || writeData(&index[0],index.size() * sizeof(ofxRawFrameIndexEntry)))
+	{
+		header.indexOffset = indexOffset;
+		header.indexCount = index.size();
+	}
+	else
+		writeOffset = indexOffset;
+	writeHeader();
+	//file was grown by mapping, cut zeros after last written byte
+	file.truncate(writeOffset);
+	file.close();
+	free(slotHeaders);
+	free(slotPixels);
+	slotHeaders = NULL;
+	slotPixels = NULL;
+	index.clear();
+	//streams are set again for next recording
+	header.streamCount = 0;
+}
+
+bool ofxRawRecordingWriter::pushFrame(int stream,const unsigned char* pixels,unsigned long long timestamp)
+{
+	if ((!isWriterRunning) || (stream < 0) || (stream >= (int)header.streamCount) || (pixels == NULL))
+		return false;
+	long pushed = ofxAtomicLoad(&pushedSlots);
+	if (pushed - ofxAtomicLoad(&writtenSlots) >= slotsCount)
+	{
+		droppedFramesCount++;
+		return false;
+	}
+	int slot = pushed % slotsCount;
+	ofxRawRecordingStream* streamInfo = &header.streams[stream];
+	ofxRawFrameHeader* frameHeader = &slotHeaders[slot];
+	frameHeader->magic = RAW_FRAME_MAGIC;
+	frameHeader->stream = stream;
+	frameHeader->sequence = sequences[stream]++;
+	frameHeader->size = streamInfo->width * streamInfo->height * streamInfo->depth;
+	frameHeader->timestamp = timestamp;
+	frameHeader->reserved = 0;
+	memcpy(slotPixels + slot * slotSize,pixels,frameHeader->size);
+	//atomic increment is full memory barrier, so slot is filled before writer thread sees it
+	ofxAtomicIncrement(&pushedSlots);
+	slotNotifier.notify();
+	return true;
+}
+
+void ofxRawRecordingWriter::WriterThread(void* instance)
+{
+	ofxRawRecordingWriter *pThis = (ofxRawRecordingWriter*)instance;
+	pThis->Write();
+}
+
+bool ofxRawRecordingWriter::IsSlotReady(void* instance)
+{
+	ofxRawRecordingWriter *pThis = (ofxRawRecordingWriter*)instance;
+	return (!pThis->isWriterRunning) || (ofxAtomicLoad(&pThis->pushedSlots) != ofxAtomicLoad(&pThis->writtenSlots));
+}
+
+void ofxRawRecordingWriter::Write()
+{
+	while (true)
+	{
+		slotNotifier.waitFor(&ofxRawRecordingWriter::IsSlotReady,this,OFX_INFINITE);
+		//queued frames are written even when recording is being stopped
+		bool isStopping = !isWriterRunning;
+		while (ofxAtomicLoad(&pushedSlots) != ofxAtomicLoad(&writtenSlots))
+		{
+			int slot = ofxAtomicLoad(&writtenSlots) % slotsCount;
+			ofxRawFrameHeader* frameHeader = &slotHeaders[slot];
+			ofxRawFrameIndexEntry entry;
+			entry.offset = writeOffset;
+			entry.timestamp = frameHeader->timestamp;
+			entry.stream = frameHeader->stream;
+			entry.size = frameHeader->size;
+			if (writeData(frameHeader,sizeof(ofxRawFrameHeader)) && writeData(slotPixels + slot * slotSize,frameHeader->size))
+			{
+				//padding is left as zeros of grown file
+				writeOffset = entry.offset + getRawFrameRecordSize(entry.size);
+				index.push_back(entry);
+				writtenFramesCount++;
+			}
+			else
+				writeOffset = entry.offset;
+			ofxAtomicIncrement(&writtenSlots);
+		}
+		if (isStopping)
+			break;
+	}
+}
+
+bool ofxRawRecordingWriter::writeData(const void* data,unsigned int length)
+{
+	const unsigned char* source = (const unsigned char*)data;
+	while (length > 0)
+	{
+		if ((window == NULL) || (writeOffset >= windowOffset + RAW_RECORDING_WINDOW_SIZE))
+		{
+			windowOffset = writeOffset & ~(unsigned long long)(MAPPED_FILE_GRANULARITY - 1);
+			window = file.mapRegion(windowOffset,RAW_RECORDING_WINDOW_SIZE);
+			if (window == NULL)
+				return false;
+		}
+		unsigned int chunk = (unsigned int)(windowOffset + RAW_RECORDING_WINDOW_SIZE - writeOffset);
+		if (chunk > length)
+			chunk = length;
+		memcpy(window + (writeOffset - windowOffset),source,chunk);
+		writeOffset += chunk;
+		source += chunk;
+		length -= chunk;
+	}
+	return true;
+}
+
+bool ofxRawRecordingWriter::writeHeader()
+{
+	//mapping of header replaces window
+	window = NULL;
+	unsigned char* headerRegion = file.mapRegion(0,RAW_RECORDING_HEADER_SIZE);
+	if (headerRegion == NULL)
+		return false;
+	memset(headerRegion,0,RAW_RECORDING_HEADER_SIZE);
+	memcpy(headerRegion,&header,sizeof(ofxRawRecordingHeader));
+	return true;
+}
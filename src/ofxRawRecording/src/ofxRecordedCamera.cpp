@@ -0,0 +1,249 @@
+/*
+*  ofxRecordedCamera.cpp
+*
+*  Created on 17/10/26.
+*  Copyright 2026 NUI Group. All rights reserved.
+*
+*/
+
+#include <map>
+#include "ofxRecordedCamera.h"
+
+//when playback is late more than this (pause, slow disk) clock is restarted instead of delivering burst of frames
+#define RECORDING_MAX_LAG 500000
+//longest sleep inside getNewFrame, so capture thread still reacts on pause and stop
+#define RECORDING_MAX_WAIT 10
+
+//epochs of opened recordings by file name
+static std::map<std::string,ofxRecordingEpoch> recordingEpochs;
+static ofxCaptureLock recordingEpochsLock;
+
+ofxRecordedCamera::ofxRecordedCamera()
+{
+	pacing = RECORDING_REALTIME;
+	isLooped = true;
+	stream = -1;
+	currentFrame = 0;
+	epoch = NULL;
+	firstTimestamp = streamOffset = duration = 0;
+	loopsCount = deliveredFrames = 0;
+	isResyncNeeded = false;
+}
+
+ofxRecordedCamera::~ofxRecordedCamera()
+{
+	deinitializeCamera();
+}
+
+void ofxRecordedCamera::setCameraType()
+{
+	cameraType = RECORDED;
+	cameraTypeName = "RECORDED";
+}
+
+void ofxRecordedCamera::loadRecordingSettings()
+{
+	ofxXmlSettings* xmlSettings = new ofxXmlSettings();
+	xmlSettings->loadFile("xml/app_settings.xml");
+	recordingFileName = xmlSettings->getValue("CONFIG:RECORDING:FILENAME", "recordings/session.raw");
+	std::string pacingName = xmlSettings->getValue("CONFIG:RECORDING:PACING", "REALTIME");
+	isLooped = xmlSettings->getValue("CONFIG:RECORDING:LOOP", 1) != 0;
+	delete xmlSettings;
+	if (pacingName == "FREERUN")
+		pacing = RECORDING_FREERUN;
+	else if (pacingName == "FAST")
+		pacing = RECORDING_FAST;
+	else
+		pacing = RECORDING_REALTIME;
+}
+
+void ofxRecordedCamera::cameraInitializationLogic()
+{
+	loadRecordingSettings();
+	if (!reader.open(ofToDataPath(recordingFileName)))
+		return;
+	stream = guid.Data1;
+	ofxRawRecordingStream* streamInfo = reader.getStream(stream);
+	if (streamInfo == NULL)
+	{
+		reader.close();
+		stream = -1;
+		return;
+	}
+	width = streamInfo->width;
+	height = streamInfo->height;
+	depth = streamInfo->depth;
+	isRaw = 0;
+	for (int i=0;i<cameraBaseSettings->propertyType.size();i++)
+		setCameraFeature(cameraBaseSettings->propertyType[i],cameraBaseSettings->propertyFirstValue[i],cameraBaseSettings->propertySecondValue[i],cameraBaseSettings->isPropertyAuto[i],cameraBaseSettings->isPropertyOn[i]);
+	currentFrame = 0;
+	firstTimestamp = reader.getFirstTimestamp();
+	duration = reader.getDuration();
+	unsigned long long streamTimestamp = 0;
+	streamOffset = 0;
+	if (reader.getFrame(stream,0,&streamTimestamp,NULL) != NULL)
+		streamOffset = streamTimestamp > firstTimestamp ? streamTimestamp - firstTimestamp : 0;
+	loopsCount = deliveredFrames = 0;
+	isResyncNeeded = false;
+	openEpoch();
+}
+
+void ofxRecordedCamera::cameraDeinitializationLogic()
+{
+	closeEpoch();
+	reader.close();
+	stream = -1;
+}
+
+void ofxRecordedCamera::cameraResumeLogic()
+{
+	isResyncNeeded = true;
+}
+
+void ofxRecordedCamera::openEpoch()
+{
+	recordingEpochsLock.lock();
+	std::map<std::string,ofxRecordingEpoch>::iterator found = recordingEpochs.find(recordingFileName);
+	if (found == recordingEpochs.end())
+	{
+		ofxRecordingEpoch newEpoch;
+		newEpoch.camerasCount = 0;
+		newEpoch.isStarted = false;
+		newEpoch.startTime = 0;
+		found = recordingEpochs.insert(std::make_pair(recordingFileName,newEpoch)).first;
+	}
+	epoch = &found->second;
+	epoch->camerasCount++;
+	recordingEpochsLock.unlock();
+}
+
+void ofxRecordedCamera::closeEpoch()
+{
+	if (epoch == NULL)
+		return;
+	recordingEpochsLock.lock();
+	//the next session starts its own clock
+	if (--epoch->camerasCount == 0)
+		recordingEpochs.erase(recordingFileName);
+	epoch = NULL;
+	recordingEpochsLock.unlock();
+}
+
+unsigned long long ofxRecordedCamera::getFrameOffset(unsigned long long timestamp)
+{
+	if (pacing == RECORDING_REALTIME)
+		return (unsigned long long)loopsCount * duration + (timestamp > firstTimestamp ? timestamp - firstTimestamp : 0);
+	if (framerate > 0)
+		return streamOffset + (unsigned long long)deliveredFrames * 1000000 / framerate;
+	return streamOffset;
+}
+
+bool ofxRecordedCamera::waitForFrameTime(unsigned long long timestamp,unsigned long long* dueTime)
+{
+	unsigned long long frameOffset = getFrameOffset(timestamp);
+	recordingEpochsLock.lock();
+	unsigned long long now = ofxGetTickMicroseconds();
+	//the first camera starts the clock so its frame is due now, others join it
+	if (!epoch->isStarted)
+	{
+		epoch->isStarted = true;
+		epoch->startTime = now > frameOffset ? now - frameOffset : 0;
+	}
+	*dueTime = epoch->startTime + frameOffset;
+	//late stream moves the whole epoch instead of delivering burst of frames, so streams stay aligned
+	if ((now > *dueTime + RECORDING_MAX_LAG) || (isResyncNeeded && (now > *dueTime)))
+	{
+		epoch->startTime += now - *dueTime;
+		*dueTime = now;
+	}
+	isResyncNeeded = false;
+	recordingEpochsLock.unlock();
+	if (now < *dueTime)
+	{
+		unsigned long long delay = (*dueTime - now + 999) / 1000;
+		ofxSleepMilliseconds(delay > RECORDING_MAX_WAIT ? RECORDING_MAX_WAIT : (unsigned int)delay);
+		if (ofxGetTickMicroseconds() < *dueTime)
+			return false;
+	}
+	return true;
+}
+
+bool ofxRecordedCamera::getNewFrame(unsigned char* newFrame)
+{
+	int frameCount = reader.getFrameCount(stream);
+	if (frameCount == 0)
+		return false;
+	if (currentFrame >= frameCount)
+	{
+		if (!isLooped)
+			return false;
+		currentFrame = 0;
+		loopsCount++;
+	}
+	unsigned long long timestamp = 0;
+	unsigned int frameSize = 0;
+	const unsigned char* frame = reader.getFrame(stream,currentFrame,&timestamp,&frameSize);
+	unsigned long long dueTime = 0;
+	if ((pacing != RECORDING_FAST) && (!waitForFrameTime(timestamp,&dueTime)))
+		return false;
+	currentFrame++;
+	deliveredFrames++;
+	if (frameSize < width*height*depth)
+		return false;
+	memcpy(newFrame,frame,width*height*depth*sizeof(unsigned char));
+	//replayed frame is captured when it's due, so recorded spacing of frames is kept (fast pacing stamps arrival)
+	captureTimestamp = dueTime;
+	return true;
+}
+
+CAMERA_BASE_FEATURE* ofxRecordedCamera::getSupportedFeatures(int* featuresCount)
+{
+	*featuresCount = 1;
+	CAMERA_BASE_FEATURE* features = (CAMERA_BASE_FEATURE*)malloc(*featuresCount * sizeof(CAMERA_BASE_FEATURE));
+	features[0] = BASE_FRAMERATE;
+	return features;
+}
+
+void ofxRecordedCamera::setCameraFeature(CAMERA_BASE_FEATURE featureCode,int firstValue,int secondValue,bool isAuto,bool isEnabled)
+{
+	if (featureCode == BASE_FRAMERATE)
+		framerate = firstValue;
+}
+
+void ofxRecordedCamera::getCameraFeature(CAMERA_BASE_FEATURE featureCode,int* firstValue,int* secondValue, bool* isAuto, bool* isEnabled,int* minValue,int* maxValue)
+{
+	*firstValue = 0;
+	*secondValue = 0;
+	*isAuto = false;
+	*isEnabled = false;
+	*minValue = 0;
+	*maxValue = 0;
+	if (featureCode == BASE_FRAMERATE)
+	{
+		*minValue = 1;
+		*maxValue = 1000;
+		*isEnabled = true;
+		*firstValue = framerate;
+	}
+}
+
+int ofxRecordedCamera::getCameraBaseCount()
+{
+	loadRecordingSettings();
+	ofxRawRecordingReader recording;
+	if (!recording.open(ofToDataPath(recordingFileName)))
+		return 0;
+	return recording.getStreamCount();
+}
+
+GUID* ofxRecordedCamera::getBaseCameraGuids(int* camCount)
+{
+	*camCount = getCameraBaseCount();
+	GUID* guids = (GUID*)malloc(*camCount * sizeof(GUID));
+	for (int i=0;i<*camCount;i++)
+	{
+		memset((void*)&guids[i],0,sizeof(GUID));
+		guids[i].Data1 = i;
+	}
+	return guids;
+}
@@ -0,0 +1,1563 @@
+/*
+*  KernelCheck.cpp
+*
+*  Standalone check of SIMD kernels against plain reference code, with their timings. It's built apart from ccv1.5
+*  together with sources it checks, from root of repository:
+*
+*  g++ -O2 -pthread -Isrc/ofxCameraBase/include -Isrc/ofxMultiplexer/include -Isrc/ofxNCore/src/Filters -Isrc/ofxNCore/src/Calibration
+*      tools/KernelCheck/KernelCheck.cpp src/ofxCameraBase/src/ofxBayerKernels.cpp src/ofxCameraBase/src/ofxCameraBasePlatform.cpp
+*      src/ofxCameraBase/src/ofxThreadPool.cpp src/ofxMultiplexer/src/ofxRemapProgram.cpp src/ofxNCore/src/Filters/RowFilters.cpp
+*      src/ofxMultiplexer/src/ofxCalibrationMesh.cpp src/ofxNCore/src/Calibration/CalibrationLUT.cpp
+*      src/ofxNCore/src/Filters/BackgroundModel.cpp -o KernelCheck
+*
+*  (VS2010 command prompt: cl /O2 /arch:SSE2 /EHsc with the same include directories and sources). Exit code is the
+*  number of failed checks.
+*
+*  Created on 17/10/26.
+*  Copyright 2026 NUI Group. All rights reserved.
+*
+*/
+
+#include "ofxCameraBasePlatform.h"
+#include "ofxBayerKernels.h"
+#include "ofxRemapProgram.h"
+#include "ofxThreadPool.h"
+#include "RowFilters.h"
+#include "CalibrationLUT.h"
+#include "BackgroundModel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+static int failuresCount = 0;
+static unsigned int randomState = 12345;
+
+//the same sequence on every platform
+static unsigned int getRandom()
+{
+	randomState = randomState * 1103515245 + 12345;
+	return (randomState >> 16) & 0x7FFF;
+}
+
+static void fillRandom(unsigned char* data,int size)
+{
+	for (int i=0;i<size;i++)
+		data[i] = (unsigned char)getRandom();
+}
+
+static void report(const char* name,int mismatchesCount)
+{
+	printf("%-48s %s",name,mismatchesCount == 0 ? "ok\n" : "FAILED");
+	if (mismatchesCount != 0)
+	{
+		printf(" (%d mismatches)\n",mismatchesCount);
+		failuresCount++;
+	}
+}
+
+//milliseconds per call, the best of a few rounds
+template <class Task> static double measure(Task& task,int callsCount)
+{
+	double best = 0.0;
+	for (int round=0;round<5;round++)
+	{
+		unsigned long long start = ofxGetTickMicroseconds();
+		for (int i=0;i<callsCount;i++)
+			task();
+		double time = (double)(ofxGetTickMicroseconds() - start) / (1000.0 * callsCount);
+		if ((round == 0) || (time < best))
+			best = time;
+	}
+	return best;
+}
+
+/****************************************************************
+ *	Bayer kernels
+ ****************************************************************/
+static int mirrorBayerIndex(int index,int size)
+{
+	if (size < 2)
+		return 0;
+	if (index < 0)
+		return -index;
+	if (index >= size)
+		return 2 * size - 2 - index;
+	return index;
+}
+
+//pixel by pixel definition of bayerToLuma
+static void bayerToLumaReference(const unsigned char* rawFrame,unsigned char* lumaFrame,int width,int height,int pixelStride,int bayerPattern)
+{
+	int redColumn = (bayerPattern == BAYER_GRBG) || (bayerPattern == BAYER_BGGR) ? 1 : 0;
+	int redRow = (bayerPattern == BAYER_GBRG) || (bayerPattern == BAYER_BGGR) ? 1 : 0;
+	#define SAMPLE(x,y) ((int)rawFrame[(mirrorBayerIndex(y,height) * width + mirrorBayerIndex(x,width)) * pixelStride])
+	for (int y=0;y<height;y++)
+	{
+		for (int x=0;x<width;x++)
+		{
+			int value;
+			if ((y & 1) == redRow)
+				value = (x & 1) == redColumn ? SAMPLE(x,y) : (SAMPLE(x-1,y) + SAMPLE(x+1,y)) >> 1;
+			else if ((x & 1) == redColumn)
+				value = (SAMPLE(x,y-1) + SAMPLE(x,y+1)) >> 1;
+			else
+				value = (SAMPLE(x-1,y-1) + SAMPLE(x+1,y-1) + SAMPLE(x-1,y+1) + SAMPLE(x+1,y+1)) >> 2;
+			lumaFrame[y * width + x] = (unsigned char)value;
+		}
+	}
+	#undef SAMPLE
+}
+
+//raw frame conversion of updateCurrentFrame before bayerToLuma, copied as it was except initial index (GRBG stores
+//after its row loop, compiler warns of it). Some patterns read a row above and below frame, so raw frame is given
+//inside of padding
+static void bayerToLumaBaseline(const unsigned char* rawCameraFrame,unsigned char* cameraFrame,int width,int height,int depth,int isRaw)
+{
+	int x,y,index = 0;
+	float r = 0.0f;
+	switch (isRaw)
+	{
+	case 1:		//RGGB
+		for (y=0;y<height;y++)
+		{
+			for (x=0;x<width;x++)
+			{
+				index = x + y * width;
+				if (x % 2)
+				{
+					if (y % 2)
+						r = ((float)rawCameraFrame[(x-1+(y-1)*width)*depth] + rawCameraFrame[(x-1+(y+1)*width)*depth] + rawCameraFrame[(x+1+(y-1)*width)*depth] + rawCameraFrame[(x+1+(y+1)*width)*depth]) * 0.25f;
+					else
+						r = ((float)rawCameraFrame[(x-1+y*width)*depth] + rawCameraFrame[(x+1+y*width)*depth]) * 0.5f;
+				}
+				else
+				{
+					if (y % 2)
+						r = ((float)rawCameraFrame[(x+(y-1)*width)*depth] + rawCameraFrame[(x+(y+1)*width)*depth]) * 0.5f;
+					else
+						r = rawCameraFrame[(x+y*width)*depth];
+				}
+				cameraFrame[index] = (unsigned char)r;
+			}
+		}
+		break;
+	case 2:		//GRBG
+		for (y=0;y<height;y++)
+		{
+			for (x=0;x<width;x++)
+			{
+				index = x + y * width;
+				if (x % 2)
+				{
+					if (y % 2)
+						r = ((float)rawCameraFrame[(x+(y-1)*width)*depth] + rawCameraFrame[(x+(y+1)*width)*depth]) * 0.5f;
+					else
+						r = rawCameraFrame[(x+y*width)*depth];
+				}
+				else
+				{
+					if (y % 2)
+					{
+						if (x != 0)
+							r = ((float)rawCameraFrame[(x-1+(y-1)*width)*depth] + rawCameraFrame[(x-1+(y+1)*width)*depth] + rawCameraFrame[(x+1+(y-1)*width)*depth] + rawCameraFrame[(x+1+(y+1)*width)*depth]) * 0.25f;
+						else
+							r = ((float)rawCameraFrame[(1+(y-1)*width)*depth] + rawCameraFrame[(1+(y+1)*width)*depth]) * 0.5f;
+					}
+					else
+					{
+						if (x != 0)
+							r = ((float)rawCameraFrame[(x-1+y*width)*depth] + rawCameraFrame[(x+1+y*width)*depth]) * 0.5f;
+						else
+							r = rawCameraFrame[(1+y*width)*depth];
+					}
+				}
+			}
+			cameraFrame[index] = (unsigned char)r;
+		}
+		break;
+	case 3: //GBRG
+		for (y=0;y<height;y++)
+		{
+			for (x=0;x<width;x++)
+			{
+				index = x + y * width;
+				if (x % 2)
+				{
+					if (y % 2)
+						r = ((float)rawCameraFrame[(x-1+y*width)*depth] + rawCameraFrame[(x+1+y*width)*depth]) * 0.5f;
+					else
+						if (y!=0)
+							r = ((float)rawCameraFrame[(x-1+(y-1)*width)*depth] + rawCameraFrame[(x-1+(y+1)*width)*depth] + rawCameraFrame[(x+1+(y-1)*width)*depth] + rawCameraFrame[(x+1+(y+1)*width)*depth]) * 0.25f;
+						else
+							r = ((float)rawCameraFrame[(x+1+width)*depth] + rawCameraFrame[(x-1+width)*depth]) * 0.5f;
+				}
+				else
+				{
+					if (y % 2)
+						r = rawCameraFrame[(x+y*width)*depth];
+					else
+						if (y!=0)
+							r = ((float)rawCameraFrame[(x+(y-1)*width)*depth] + rawCameraFrame[(x+(y+1)*width)*depth]) * 0.5f;
+						else
+							r = rawCameraFrame[(x+width)*depth];
+						
+				}
+				cameraFrame[index] = (unsigned char)r;
+			}
+		}
+		break;
+	case 4:		//BGGR
+		for (y=0;y<height;y++)
+		{
+			for (x=0;x<width;x++)
+			{
+				index = x + y * width;
+				if (x % 2)
+				{
+					if (y % 2)
+						r = rawCameraFrame[(x+y*width)*depth];
+					else
+						if (y!=0)
+							r = ((float)rawCameraFrame[(x+(y-1)*width)*depth] + rawCameraFrame[(x+(y+1)*width)*depth]) * 0.5f;
+						else
+							r = rawCameraFrame[(x+width)*depth];
+				}
+				else
+				{
+					if (y % 2)
+						if (x != 0)
+							r = ((float)rawCameraFrame[(x-1+y*width)*depth] + rawCameraFrame[(x+1+y*width)*depth]) * 0.5f;
+						else
+							r = rawCameraFrame[(1+y*width)*depth];
+					else
+						if (x!=0)
+							if (y!=0)
+								r = ((float)rawCameraFrame[(x-1+(y-1)*width)*depth] + rawCameraFrame[(x-1+(y+1)*width)*depth] + rawCameraFrame[(x+1+(y-1)*width)*depth] + rawCameraFrame[(x+1+(y+1)*width)*depth]) * 0.25f;
+							else
+								r = ((float)rawCameraFrame[(x-1+width)*depth] + rawCameraFrame[(x+1+width)*depth]) * 0.5f;
+						else
+							if (y!=0)
+								r = ((float)rawCameraFrame[(1+width*(y-1))*depth] + rawCameraFrame[(1+width*(y+1))*depth]) * 0.5f;
+							else
+								r = rawCameraFrame[(1+width)*depth];
+				}
+				cameraFrame[index] = (unsigned char)r;
+			}
+		}
+		break;
+	}
+}
+
+struct BayerTask
+{
+	const unsigned char* rawFrame;
+	unsigned char* lumaFrame;
+	unsigned char* rowsBuffer;
+	int width,height,pixelStride,bayerPattern;
+	bool isBaseline;
+	void operator()()
+	{
+		if (isBaseline)
+			bayerToLumaBaseline(rawFrame,lumaFrame,width,height,pixelStride,bayerPattern);
+		else
+			bayerToLuma(rawFrame,lumaFrame,width,height,pixelStride,bayerPattern,rowsBuffer);
+	}
+};
+
+static void checkBayerKernels()
+{
+	//odd sizes leave scalar tails and mirrored borders on every side
+	const int sizes[][2] = {{1,1},{2,3},{17,5},{33,9},{65,31},{640,480},{751,333}};
+	int mismatchesCount = 0;
+	for (int s=0;s<(int)(sizeof(sizes)/sizeof(sizes[0]));s++)
+	{
+		int width = sizes[s][0];
+		int height = sizes[s][1];
+		for (int pixelStride=1;pixelStride<=3;pixelStride+=2)
+		{
+			unsigned char* rawFrame = (unsigned char*)malloc(width * height * pixelStride);
+			unsigned char* expected = (unsigned char*)malloc(width * height);
+			unsigned char* actual = (unsigned char*)malloc(width * height);
+			unsigned char* rowsBuffer = (unsigned char*)malloc(getBayerRowsBufferSize(width));
+			fillRandom(rawFrame,width * height * pixelStride);
+			for (int pattern=BAYER_RGGB;pattern<=BAYER_BGGR;pattern++)
+			{
+				bayerToLumaReference(rawFrame,expected,width,height,pixelStride,pattern);
+				bayerToLuma(rawFrame,actual,width,height,pixelStride,pattern,rowsBuffer);
+				for (int i=0;i<width*height;i++)
+					mismatchesCount += expected[i] != actual[i] ? 1 : 0;
+			}
+			free(rawFrame);
+			free(expected);
+			free(actual);
+			free(rowsBuffer);
+		}
+	}
+	report("bayerToLuma equals reference",mismatchesCount);
+
+	//RGGB, as GRBG of baseline stores only the last pixel of each row
+	const int benchmarkSizes[][2] = {{320,240},{640,480},{1280,960}};
+	for (int s=0;s<3;s++)
+	{
+		for (int pixelStride=1;pixelStride<=3;pixelStride+=2)
+		{
+			BayerTask task;
+			task.width = benchmarkSizes[s][0];
+			task.height = benchmarkSizes[s][1];
+			task.pixelStride = pixelStride;
+			task.bayerPattern = BAYER_RGGB;
+			int padding = (task.width + 1) * pixelStride;
+			unsigned char* rawFrame = (unsigned char*)malloc(task.width * task.height * pixelStride + 2 * padding);
+			fillRandom(rawFrame,task.width * task.height * pixelStride + 2 * padding);
+			task.rawFrame = rawFrame + padding;
+			task.lumaFrame = (unsigned char*)malloc(task.width * task.height);
+			task.rowsBuffer = (unsigned char*)malloc(getBayerRowsBufferSize(task.width));
+			task.isBaseline = true;
+			double baselineTime = measure(task,10);
+			task.isBaseline = false;
+			double kernelTime = measure(task,50);
+			printf("  bayerToLuma %4dx%-4d stride %d: %7.3f ms, baseline %7.3f ms\n",task.width,task.height,pixelStride,kernelTime,baselineTime);
+			free(rawFrame);
+			free(task.lumaFrame);
+			free(task.rowsBuffer);
+		}
+	}
+}
+
+/****************************************************************
+ *	Remap program
+ ****************************************************************/
+//the same rounding as build of program
+static int toReferenceWeight(float weight)
+{
+	float fixedWeight = weight * (1 << REMAP_WEIGHT_BITS) + 0.5f;
+	if (fixedWeight < 0.0f)
+		return 0;
+	return fixedWeight > 32767.0f ? 32767 : (int)fixedWeight;
+}
+
+//bilinear taps in floating point, both steps rounded half up to 8 bits
+static int interpolateReference(const unsigned char* taps,int width,unsigned short fraction)
+{
+	double x = (fraction & 0xFF) / 256.0;
+	double y = (fraction >> 8) / 256.0;
+	int top = (int)(taps[0] * (1.0 - x) + taps[1] * x + 0.5);
+	int bottom = (int)(taps[width] * (1.0 - x) + taps[width+1] * x + 0.5);
+	return (int)(top * (1.0 - y) + bottom * y + 0.5);
+}
+
+//output pixel of record: nearest or bilinear source, blended sources are summed in Q8 and truncated
+static unsigned char remapReference(const ofxRemapRecord& record,bool isBlending,bool isBilinear,unsigned char** frames,const int* frameWidths)
+{
+	int count = 1;
+	if (isBlending && (record.cameras[1] != REMAP_NULL_CAMERA))
+		count = REMAP_MAX_SOURCES;
+	int sum = 0;
+	for (int j=0;j<count;j++)
+	{
+		if (record.cameras[j] == REMAP_NULL_CAMERA)
+			continue;
+		const unsigned char* taps = frames[record.cameras[j]] + record.offsets[j];
+		int pixel = isBilinear ? interpolateReference(taps,frameWidths[record.cameras[j]],record.fractions[j]) : taps[0];
+		if (count == 1)
+			return (unsigned char)pixel;
+		sum += pixel * toReferenceWeight(record.weights[j]);
+	}
+	sum >>= REMAP_WEIGHT_BITS;
+	return (unsigned char)(sum > 255 ? 255 : sum);
+}
+
+static void checkRemapProgram()
+{
+	const int camerasCount = 3;
+	const int frameWidth = 96,frameHeight = 64;
+	const int outputSize = 20000;
+	int frameWidths[camerasCount];
+	unsigned char* frames[camerasCount];
+	for (int i=0;i<camerasCount;i++)
+	{
+		frameWidths[i] = frameWidth;
+		frames[i] = (unsigned char*)malloc(frameWidth * frameHeight);
+		fillRandom(frames[i],frameWidth * frameHeight);
+	}
+	//blocks of pixels with the same number of sources make runs long enough for vector code and its tails
+	ofxRemapRecord* records = (ofxRemapRecord*)malloc(outputSize * sizeof(ofxRemapRecord));
+	int blockLeft = 0,blockSources = 1;
+	for (int i=0;i<outputSize;i++)
+	{
+		if (blockLeft == 0)
+		{
+			blockLeft = 1 + getRandom() % 40;
+			blockSources = 1 + getRandom() % REMAP_MAX_SOURCES;
+		}
+		blockLeft--;
+		ofxRemapRecord& record = records[i];
+		for (int j=0;j<REMAP_MAX_SOURCES;j++)
+		{
+			record.cameras[j] = j < blockSources ? (unsigned char)((i / 64 + j) % camerasCount) : REMAP_NULL_CAMERA;
+			//last column and row are left for bilinear taps
+			record.offsets[j] = (getRandom() % (frameHeight - 1)) * frameWidth + getRandom() % (frameWidth - 1);
+			//fraction ends (0 and 255) are the worst cases of rounding
+			int x = getRandom() % 4 == 0 ? 255 * (getRandom() % 2) : getRandom() & 0xFF;
+			int y = getRandom() % 4 == 0 ? 255 * (getRandom() % 2) : getRandom() & 0xFF;
+			record.fractions[j] = (unsigned short)(x | (y << 8));
+			record.weights[j] = (getRandom() % 1000) / 999.0f;
+		}
+	}
+	unsigned char* expected = (unsigned char*)malloc(outputSize);
+	unsigned char* actual = (unsigned char*)malloc(outputSize);
+	for (int mode=0;mode<4;mode++)
+	{
+		bool isBlending = (mode & 1) != 0;
+		bool isBilinear = (mode & 2) != 0;
+		ofxRemapProgram program;
+		program.build(records,outputSize,isBlending,isBilinear,frameWidths,camerasCount);
+		for (int i=0;i<outputSize;i++)
+			expected[i] = remapReference(records[i],isBlending,isBilinear,frames,frameWidths);
+		memset(actual,0,outputSize);
+		program.execute(frames,actual,NULL);
+		int mismatchesCount = 0;
+		for (int i=0;i<outputSize;i++)
+			mismatchesCount += expected[i] != actual[i] ? 1 : 0;
+		char name[64];
+		sprintf(name,"remap %s%s equals reference",isBilinear ? "bilinear" : "nearest",isBlending ? " blended" : "");
+		report(name,mismatchesCount);
+	}
+	free(records);
+	free(expected);
+	free(actual);
+	for (int i=0;i<camerasCount;i++)
+		free(frames[i]);
+}
+
+//Cameras of grid seen through calibration meshes with moved inner nodes, neighbouring cameras share one cell of
+//calibration grid as in interleave mode. Stitched frame has scale pixels for each camera pixel
+#define SCENE_CELLS_WIDTH 4
+#define SCENE_CELLS_HEIGHT 3
+
+struct StitchScene
+{
+	int gridWidth,gridHeight;
+	int frameWidth,frameHeight;
+	int width,height;
+	float cellWidth,cellHeight;
+	ofxCalibrationMesh* meshes;
+};
+
+static void setupStitchScene(StitchScene& scene,int gridWidth,int gridHeight,int frameWidth,int frameHeight,float scale)
+{
+	scene.gridWidth = gridWidth;
+	scene.gridHeight = gridHeight;
+	scene.frameWidth = frameWidth;
+	scene.frameHeight = frameHeight;
+	scene.cellWidth = frameWidth * scale / SCENE_CELLS_WIDTH;
+	scene.cellHeight = frameHeight * scale / SCENE_CELLS_HEIGHT;
+	scene.width = (int)((gridWidth * (SCENE_CELLS_WIDTH - 1) + 1) * scene.cellWidth);
+	scene.height = (int)((gridHeight * (SCENE_CELLS_HEIGHT - 1) + 1) * scene.cellHeight);
+	scene.meshes = new ofxCalibrationMesh[gridWidth * gridHeight];
+	vector2df screenPoints[(SCENE_CELLS_WIDTH + 1) * (SCENE_CELLS_HEIGHT + 1)];
+	vector2df cameraPoints[(SCENE_CELLS_WIDTH + 1) * (SCENE_CELLS_HEIGHT + 1)];
+	for (int c=0;c<gridWidth*gridHeight;c++)
+	{
+		int firstCellX = (c % gridWidth) * (SCENE_CELLS_WIDTH - 1);
+		int firstCellY = (c / gridWidth) * (SCENE_CELLS_HEIGHT - 1);
+		for (int j=0;j<=SCENE_CELLS_HEIGHT;j++)
+		{
+			for (int i=0;i<=SCENE_CELLS_WIDTH;i++)
+			{
+				bool isInner = (i > 0) && (j > 0) && (i < SCENE_CELLS_WIDTH) && (j < SCENE_CELLS_HEIGHT);
+				float moveX = isInner ? (float)(getRandom() % 7) * 0.5f - 1.5f : 0.0f;
+				float moveY = isInner ? (float)(getRandom() % 7) * 0.5f - 1.5f : 0.0f;
+				screenPoints[j * (SCENE_CELLS_WIDTH + 1) + i] = vector2df((firstCellX + i) * scene.cellWidth,(firstCellY + j) * scene.cellHeight);
+				cameraPoints[j * (SCENE_CELLS_WIDTH + 1) + i] = vector2df(i * (frameWidth - 1) / (float)SCENE_CELLS_WIDTH + moveX,
+					j * (frameHeight - 1) / (float)SCENE_CELLS_HEIGHT + moveY);
+			}
+		}
+		scene.meshes[c].build(SCENE_CELLS_WIDTH,SCENE_CELLS_HEIGHT,screenPoints,cameraPoints,scene.width,scene.height);
+	}
+}
+
+//the same rule as toBilinearTap of multiplexer
+static unsigned int toBilinearTapReference(float position,int size,unsigned short* fraction)
+{
+	float center = position - 0.5f;
+	if (center < 0.0f)
+		center = 0.0f;
+	if (center > (float)(size - 1))
+		center = (float)(size - 1);
+	int first = (int)center;
+	if (first > size - 2)
+		first = size - 2;
+	int fixedFraction = (int)((center - first) * (1 << REMAP_FRACTION_BITS) + 0.5f);
+	if ((fixedFraction == (1 << REMAP_FRACTION_BITS)) && (first < size - 2))
+	{
+		first++;
+		fixedFraction = 0;
+	}
+	*fraction = (unsigned short)(fixedFraction < (1 << REMAP_FRACTION_BITS) ? fixedFraction : (1 << REMAP_FRACTION_BITS) - 1);
+	return (unsigned int)first;
+}
+
+//cameras of each stitched pixel by calibration cells they cover, weights fall linearly over cells shared with
+//neighbouring camera. Camera positions are taken from meshes as the multiplexer takes them
+static void fillStitchRecords(StitchScene& scene,bool isBilinear,ofxRemapRecord* records)
+{
+	int camerasCount = scene.gridWidth * scene.gridHeight;
+	for (int i=0;i<scene.width*scene.height;i++)
+	{
+		ofxRemapRecord& record = records[i];
+		memset(&record,0,sizeof(ofxRemapRecord));
+		memset(record.cameras,REMAP_NULL_CAMERA,sizeof(record.cameras));
+		float cellPositionX = (i % scene.width) / scene.cellWidth;
+		float cellPositionY = (i / scene.width) / scene.cellHeight;
+		int cellX = (int)cellPositionX;
+		int cellY = (int)cellPositionY;
+		int count = 0;
+		for (int c=0;c<camerasCount;c++)
+		{
+			int firstCellX = (c % scene.gridWidth) * (SCENE_CELLS_WIDTH - 1);
+			int firstCellY = (c / scene.gridWidth) * (SCENE_CELLS_HEIGHT - 1);
+			if ((cellX < firstCellX) || (cellY < firstCellY) || (cellX >= firstCellX + SCENE_CELLS_WIDTH) || (cellY >= firstCellY + SCENE_CELLS_HEIGHT))
+				continue;
+			float weightX = 1.0f,weightY = 1.0f;
+			if ((cellX == firstCellX) && (c % scene.gridWidth > 0))
+				weightX = cellPositionX - cellX;
+			if ((cellX == firstCellX + SCENE_CELLS_WIDTH - 1) && (c % scene.gridWidth < scene.gridWidth - 1))
+				weightX = 1.0f - (cellPositionX - cellX);
+			if ((cellY == firstCellY) && (c / scene.gridWidth > 0))
+				weightY = cellPositionY - cellY;
+			if ((cellY == firstCellY + SCENE_CELLS_HEIGHT - 1) && (c / scene.gridWidth < scene.gridHeight - 1))
+				weightY = 1.0f - (cellPositionY - cellY);
+			record.cameras[count] = (unsigned char)c;
+			record.weights[count] = weightX * weightY;
+			count++;
+		}
+	}
+	float cameraX[CALIBRATION_MESH_TILE_SIZE * CALIBRATION_MESH_TILE_SIZE];
+	float cameraY[CALIBRATION_MESH_TILE_SIZE * CALIBRATION_MESH_TILE_SIZE];
+	int owners[CALIBRATION_MESH_TILE_SIZE * CALIBRATION_MESH_TILE_SIZE];
+	for (int c=0;c<camerasCount;c++)
+	{
+		ofxCalibrationMesh& mesh = scene.meshes[c];
+		for (int tile=0;tile<mesh.getTilesWidth()*mesh.getTilesHeight();tile++)
+		{
+			mesh.mapTile(tile,cameraX,cameraY,owners);
+			int tileLeft = (tile % mesh.getTilesWidth()) * CALIBRATION_MESH_TILE_SIZE;
+			int tileTop = (tile / mesh.getTilesWidth()) * CALIBRATION_MESH_TILE_SIZE;
+			for (int y=0;(y<CALIBRATION_MESH_TILE_SIZE) && (tileTop+y<scene.height);y++)
+			{
+				for (int x=0;(x<CALIBRATION_MESH_TILE_SIZE) && (tileLeft+x<scene.width);x++)
+				{
+					ofxRemapRecord& record = records[(tileTop + y) * scene.width + tileLeft + x];
+					int slot = 0;
+					while ((slot < REMAP_MAX_SOURCES) && (record.cameras[slot] != c))
+						slot++;
+					if (slot == REMAP_MAX_SOURCES)
+						continue;
+					float positionX = cameraX[y * CALIBRATION_MESH_TILE_SIZE + x];
+					float positionY = cameraY[y * CALIBRATION_MESH_TILE_SIZE + x];
+					if (isBilinear)
+					{
+						unsigned short fractionX,fractionY;
+						unsigned int firstX = toBilinearTapReference(positionX,scene.frameWidth,&fractionX);
+						unsigned int firstY = toBilinearTapReference(positionY,scene.frameHeight,&fractionY);
+						record.offsets[slot] = firstY * scene.frameWidth + firstX;
+						record.fractions[slot] = (unsigned short)(fractionX | (fractionY << REMAP_FRACTION_BITS));
+					}
+					else
+					{
+						unsigned int nearestX = (unsigned int)positionX;
+						unsigned int nearestY = (unsigned int)positionY;
+						if (nearestX >= (unsigned int)scene.frameWidth)
+							nearestX = scene.frameWidth - 1;
+						if (nearestY >= (unsigned int)scene.frameHeight)
+							nearestY = scene.frameHeight - 1;
+						record.offsets[slot] = nearestY * scene.frameWidth + nearestX;
+					}
+				}
+			}
+		}
+	}
+}
+
+//stitched frame position of center of each camera pixel by lookup table, cameras are one after another
+static void mapScenePixels(StitchScene& scene,float* pixelsX,float* pixelsY)
+{
+	int framePixels = scene.frameWidth * scene.frameHeight;
+	for (int i=0;i<scene.gridWidth*scene.gridHeight;i++)
+	{
+		CalibrationLUT lut;
+		lut.build(&scene.meshes[i],scene.frameWidth,scene.frameHeight,1);
+		for (int j=0;j<framePixels;j++)
+			lut.map((j % scene.frameWidth) + 0.5f,(j / scene.frameWidth) + 0.5f,&pixelsX[i * framePixels + j],&pixelsY[i * framePixels + j]);
+	}
+}
+
+struct RemapTask
+{
+	ofxRemapProgram* program;
+	unsigned char** frames;
+	unsigned char* target;
+	void operator()()
+	{
+		program->execute(frames,target,NULL);
+	}
+};
+
+//blob of scene, gaussian around its center in stitched frame
+static unsigned char getBlobPixel(float x,float y,float centerX,float centerY)
+{
+	const float sigma = 3.0f;
+	float distance = (x - centerX) * (x - centerX) + (y - centerY) * (y - centerY);
+	if (distance > 36.0f * sigma * sigma)
+		return 0;
+	return (unsigned char)(200.0f * exp(-distance / (2.0f * sigma * sigma)) + 0.5f);
+}
+
+static void checkStitchedRemap()
+{
+	//cost of bilinear taps against nearest pixels on blended 2x2 grid of 320x240 cameras
+	StitchScene scene;
+	setupStitchScene(scene,2,2,320,240,1.0f);
+	int camerasCount = scene.gridWidth * scene.gridHeight;
+	int frameWidths[4];
+	unsigned char* frames[4];
+	for (int i=0;i<camerasCount;i++)
+	{
+		frameWidths[i] = scene.frameWidth;
+		frames[i] = (unsigned char*)malloc(scene.frameWidth * scene.frameHeight);
+		fillRandom(frames[i],scene.frameWidth * scene.frameHeight);
+	}
+	ofxRemapRecord* records = (ofxRemapRecord*)malloc(scene.width * scene.height * sizeof(ofxRemapRecord));
+	double times[2];
+	for (int mode=0;mode<2;mode++)
+	{
+		fillStitchRecords(scene,mode == 1,records);
+		ofxRemapProgram program;
+		program.build(records,scene.width * scene.height,true,mode == 1,frameWidths,camerasCount);
+		RemapTask task;
+		task.program = &program;
+		task.frames = frames;
+		task.target = (unsigned char*)malloc(scene.width * scene.height);
+		times[mode] = measure(task,50);
+		free(task.target);
+	}
+	printf("  remap 2x2 cameras to %dx%d: bilinear %7.3f ms, nearest %7.3f ms\n",scene.width,scene.height,times[1],times[0]);
+	free(records);
+	for (int i=0;i<camerasCount;i++)
+		free(frames[i]);
+	delete[] scene.meshes;
+
+	//blob moving over shared cell of two cameras in quarter pixel steps, stitched frame upscales cameras twice.
+	//Camera pixels show blob at their centers mapped back by lookup table, so remap error is all centroid sees
+	setupStitchScene(scene,2,1,160,120,2.0f);
+	camerasCount = 2;
+	int framePixels = scene.frameWidth * scene.frameHeight;
+	float* pixelsX = (float*)malloc(camerasCount * framePixels * sizeof(float));
+	float* pixelsY = (float*)malloc(camerasCount * framePixels * sizeof(float));
+	mapScenePixels(scene,pixelsX,pixelsY);
+	for (int i=0;i<camerasCount;i++)
+	{
+		frameWidths[i] = scene.frameWidth;
+		frames[i] = (unsigned char*)malloc(framePixels);
+	}
+	records = (ofxRemapRecord*)malloc(scene.width * scene.height * sizeof(ofxRemapRecord));
+	ofxRemapProgram programs[2];
+	for (int mode=0;mode<2;mode++)
+	{
+		fillStitchRecords(scene,mode == 1,records);
+		programs[mode].build(records,scene.width * scene.height,true,mode == 1,frameWidths,camerasCount);
+	}
+	free(records);
+	unsigned char* stitched = (unsigned char*)malloc(scene.width * scene.height);
+	const int stepsCount = 800;
+	double errorSums[2][2] = {{0.0,0.0},{0.0,0.0}};
+	double* errors = (double*)malloc(2 * stepsCount * 2 * sizeof(double));
+	for (int step=0;step<stepsCount;step++)
+	{
+		//seam cell is 3 of 7, blob starts a cell before it and ends a cell after it
+		float centerX = 2.0f * scene.cellWidth + step * 0.25f;
+		float centerY = scene.height * 0.5f + step * 0.01f;
+		for (int i=0;i<camerasCount*framePixels;i++)
+			frames[i / framePixels][i % framePixels] = getBlobPixel(pixelsX[i],pixelsY[i],centerX,centerY);
+		for (int mode=0;mode<2;mode++)
+		{
+			programs[mode].execute(frames,stitched,NULL);
+			double sum = 0.0,sumX = 0.0,sumY = 0.0;
+			for (int y=(int)centerY-20;y<=(int)centerY+20;y++)
+			{
+				for (int x=(int)centerX-20;x<=(int)centerX+20;x++)
+				{
+					double pixel = stitched[y * scene.width + x];
+					sum += pixel;
+					sumX += pixel * x;
+					sumY += pixel * y;
+				}
+			}
+			double* error = errors + (mode * stepsCount + step) * 2;
+			error[0] = sumX / sum - centerX;
+			error[1] = sumY / sum - centerY;
+			errorSums[mode][0] += error[0];
+			errorSums[mode][1] += error[1];
+		}
+	}
+	//jitter is error around its mean, constant offset doesn't move blobs between frames
+	double rmsJitters[2],maxJitters[2];
+	for (int mode=0;mode<2;mode++)
+	{
+		double squaresSum = 0.0;
+		maxJitters[mode] = 0.0;
+		for (int step=0;step<stepsCount;step++)
+		{
+			const double* error = errors + (mode * stepsCount + step) * 2;
+			double x = error[0] - errorSums[mode][0] / stepsCount;
+			double y = error[1] - errorSums[mode][1] / stepsCount;
+			squaresSum += x * x + y * y;
+			if (sqrt(x * x + y * y) > maxJitters[mode])
+				maxJitters[mode] = sqrt(x * x + y * y);
+		}
+		rmsJitters[mode] = sqrt(squaresSum / stepsCount);
+	}
+	printf("  blob centroid jitter over seam: bilinear %.3f px rms %.3f px max, nearest %.3f px rms %.3f px max\n",
+		rmsJitters[1],maxJitters[1],rmsJitters[0],maxJitters[0]);
+	report("remap bilinear jitters less than nearest",rmsJitters[1] < rmsJitters[0] ? 0 : 1);
+	free(errors);
+	free(stitched);
+	free(pixelsX);
+	free(pixelsY);
+	for (int i=0;i<camerasCount;i++)
+		free(frames[i]);
+	delete[] scene.meshes;
+}
+
+//camera of empty map position, as in CalibrationUtils.h
+#define NULL_CAMERA 0xFF
+
+//interleave stitching of updateStitchedFrame before remap program, copied as it was. It ran on up to 4 OpenMP
+//threads, the check is built without OpenMP
+static void stitchBaseline(unsigned char** cameraMap,unsigned int** offsetMap,float** weightMap,unsigned char** cameraFrames,unsigned char* stitchedFrame,int size)
+{
+	for (int i=0;i<size;i++)
+	{
+		if (cameraMap[1][i] == NULL_CAMERA)
+		{
+			stitchedFrame[i] = cameraFrames[cameraMap[0][i]][offsetMap[cameraMap[0][i]][i]];
+		}
+		else
+		{
+			float result = ((float)cameraFrames[cameraMap[0][i]][offsetMap[cameraMap[0][i]][i]]*weightMap[cameraMap[0][i]][i]) + ((float)cameraFrames[cameraMap[1][i]][offsetMap[cameraMap[1][i]][i]]*weightMap[cameraMap[1][i]][i]);
+			if(cameraMap[2][i]!=NULL_CAMERA)
+				result+=((float)cameraFrames[cameraMap[2][i]][offsetMap[cameraMap[2][i]][i]]*weightMap[cameraMap[2][i]][i]);
+			if(cameraMap[3][i]!=NULL_CAMERA)
+				result+=((float)cameraFrames[cameraMap[3][i]][offsetMap[cameraMap[3][i]][i]]*weightMap[cameraMap[3][i]][i]);
+			if (result>255.0f)
+				result = 255.0f;
+			stitchedFrame[i] = (unsigned char)(result);
+		}
+	}
+}
+
+struct BaselineStitchTask
+{
+	unsigned char** cameraMap;
+	unsigned int** offsetMap;
+	float** weightMap;
+	unsigned char** frames;
+	unsigned char* target;
+	int size;
+	void operator()()
+	{
+		stitchBaseline(cameraMap,offsetMap,weightMap,frames,target,size);
+	}
+};
+
+//remap program against per pixel maps it replaced, nearest blended stitching of 320x240 cameras
+static void benchmarkBaselineStitching()
+{
+	const int grids[][2] = {{2,2},{4,2}};
+	for (int g=0;g<2;g++)
+	{
+		StitchScene scene;
+		setupStitchScene(scene,grids[g][0],grids[g][1],320,240,1.0f);
+		int camerasCount = scene.gridWidth * scene.gridHeight;
+		int size = scene.width * scene.height;
+		int* frameWidths = (int*)malloc(camerasCount * sizeof(int));
+		unsigned char** frames = (unsigned char**)malloc(camerasCount * sizeof(unsigned char*));
+		ofxRemapRecord* records = (ofxRemapRecord*)malloc(size * sizeof(ofxRemapRecord));
+		fillStitchRecords(scene,false,records);
+		BaselineStitchTask baseline;
+		baseline.cameraMap = (unsigned char**)malloc(REMAP_MAX_SOURCES * sizeof(unsigned char*));
+		baseline.offsetMap = (unsigned int**)malloc(camerasCount * sizeof(unsigned int*));
+		baseline.weightMap = (float**)malloc(camerasCount * sizeof(float*));
+		for (int i=0;i<REMAP_MAX_SOURCES;i++)
+			baseline.cameraMap[i] = (unsigned char*)malloc(size);
+		for (int i=0;i<camerasCount;i++)
+		{
+			frameWidths[i] = scene.frameWidth;
+			frames[i] = (unsigned char*)malloc(scene.frameWidth * scene.frameHeight);
+			fillRandom(frames[i],scene.frameWidth * scene.frameHeight);
+			baseline.offsetMap[i] = (unsigned int*)calloc(size,sizeof(unsigned int));
+			baseline.weightMap[i] = (float*)calloc(size,sizeof(float));
+		}
+		for (int i=0;i<size;i++)
+		{
+			for (int j=0;j<REMAP_MAX_SOURCES;j++)
+			{
+				int camera = records[i].cameras[j];
+				baseline.cameraMap[j][i] = (unsigned char)camera;
+				if (camera == REMAP_NULL_CAMERA)
+					continue;
+				baseline.offsetMap[camera][i] = records[i].offsets[j];
+				baseline.weightMap[camera][i] = records[i].weights[j];
+			}
+		}
+		baseline.frames = frames;
+		baseline.target = (unsigned char*)malloc(size);
+		baseline.size = size;
+		ofxRemapProgram program;
+		program.build(records,size,true,false,frameWidths,camerasCount);
+		RemapTask task;
+		task.program = &program;
+		task.frames = frames;
+		task.target = (unsigned char*)malloc(size);
+		double programTime = measure(task,50);
+		double baselineTime = measure(baseline,20);
+		printf("  stitch %dx%d cameras to %dx%d: remap program %7.3f ms, per pixel maps %7.3f ms\n",scene.gridWidth,scene.gridHeight,
+			scene.width,scene.height,programTime,baselineTime);
+		free(task.target);
+		free(baseline.target);
+		for (int i=0;i<REMAP_MAX_SOURCES;i++)
+			free(baseline.cameraMap[i]);
+		for (int i=0;i<camerasCount;i++)
+		{
+			free(frames[i]);
+			free(baseline.offsetMap[i]);
+			free(baseline.weightMap[i]);
+		}
+		free(baseline.cameraMap);
+		free(baseline.offsetMap);
+		free(baseline.weightMap);
+		free(frames);
+		free(frameWidths);
+		free(records);
+		delete[] scene.meshes;
+	}
+}
+
+/****************************************************************
+ *	Row filters
+ ****************************************************************/
+//cvRound rounds halves to even
+static int roundReference(double value)
+{
+	double rounded = floor(value + 0.5);
+	if ((rounded - value == 0.5) && (fmod(rounded,2.0) != 0.0))
+		rounded -= 1.0;
+	return (int)rounded;
+}
+
+static unsigned char saturateReference(int value)
+{
+	return (unsigned char)(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+static int clampIndex(int index,int size)
+{
+	return index < 0 ? 0 : (index >= size ? size - 1 : index);
+}
+
+//cvSmooth CV_BLUR as boxFilter of OpenCV does it: horizontal sums, running column sums, border pixels replicated
+static void blurReference(const unsigned char* source,unsigned char* target,int width,int height,int radius)
+{
+	int* rowSums = (int*)malloc(width * height * sizeof(int));
+	int* columnSums = (int*)malloc(width * sizeof(int));
+	double scale = 1.0 / ((2 * radius + 1) * (2 * radius + 1));
+	for (int y=0;y<height;y++)
+	{
+		const unsigned char* row = source + y * width;
+		int sum = 0;
+		for (int i=-radius;i<=radius;i++)
+			sum += row[clampIndex(i,width)];
+		for (int x=0;x<width;x++)
+		{
+			rowSums[y * width + x] = sum;
+			sum += row[clampIndex(x + radius + 1,width)] - row[clampIndex(x - radius,width)];
+		}
+	}
+	memset(columnSums,0,width * sizeof(int));
+	for (int i=-radius;i<=radius;i++)
+	{
+		for (int x=0;x<width;x++)
+			columnSums[x] += rowSums[clampIndex(i,height) * width + x];
+	}
+	for (int y=0;y<height;y++)
+	{
+		const int* added = rowSums + clampIndex(y + radius + 1,height) * width;
+		const int* removed = rowSums + clampIndex(y - radius,height) * width;
+		for (int x=0;x<width;x++)
+		{
+			target[y * width + x] = saturateReference(roundReference(columnSums[x] * scale));
+			columnSums[x] += added[x] - removed[x];
+		}
+	}
+	free(rowSums);
+	free(columnSums);
+}
+
+//the same box summed pixel by pixel, it checks blurReference
+static void blurPixelsReference(const unsigned char* source,unsigned char* target,int width,int height,int radius)
+{
+	double scale = 1.0 / ((2 * radius + 1) * (2 * radius + 1));
+	for (int y=0;y<height;y++)
+	{
+		for (int x=0;x<width;x++)
+		{
+			int sum = 0;
+			for (int j=-radius;j<=radius;j++)
+			{
+				for (int i=-radius;i<=radius;i++)
+					sum += source[clampIndex(y + j,height) * width + clampIndex(x + i,width)];
+			}
+			target[y * width + x] = saturateReference(roundReference(sum * scale));
+		}
+	}
+}
+
+//filters of ProcessFilters one by one over whole frame (flip, cvSub, cvSmooth, highpass, cvMul, cvThreshold).
+//Image after each stage goes to stages, indexed by ROW_FILTERS_..._PREVIEW, result is the last one
+static void filterReference(const unsigned char* source,int width,int height,const RowFiltersSettings& settings,unsigned char** stages)
+{
+	int size = width * height;
+	unsigned char* image = (unsigned char*)malloc(size);
+	unsigned char* blurred = (unsigned char*)malloc(size);
+	for (int y=0;y<height;y++)
+	{
+		for (int x=0;x<width;x++)
+		{
+			int sourceY = settings.isVerticalMirror ? height - 1 - y : y;
+			int sourceX = settings.isHorizontalMirror ? width - 1 - x : x;
+			image[y * width + x] = source[sourceY * width + sourceX];
+		}
+	}
+	memcpy(stages[ROW_FILTERS_SOURCE_PREVIEW],image,size);
+	if (settings.background != NULL)
+	{
+		for (int y=0;y<height;y++)
+		{
+			for (int x=0;x<width;x++)
+			{
+				int background = settings.background[y * settings.backgroundStep + x];
+				int value = image[y * width + x];
+				image[y * width + x] = saturateReference(settings.isTrackDark ? background - value : value - background);
+			}
+		}
+	}
+	if (settings.smoothRadius >= 0)
+		blurReference(image,image,width,height,settings.smoothRadius);
+	memcpy(stages[ROW_FILTERS_SMOOTH_PREVIEW],image,size);
+	if (settings.highpassRadius >= 0)
+	{
+		blurReference(image,blurred,width,height,settings.highpassRadius);
+		for (int i=0;i<size;i++)
+			image[i] = saturateReference(image[i] - blurred[i]);
+		if (settings.noiseRadius >= 0)
+			blurReference(image,image,width,height,settings.noiseRadius);
+	}
+	memcpy(stages[ROW_FILTERS_HIGHPASS_PREVIEW],image,size);
+	if (settings.amplifyLevel >= 0)
+	{
+		float scale = settings.amplifyLevel / 128.0f;
+		for (int i=0;i<size;i++)
+			image[i] = saturateReference(roundReference(scale * (float)image[i] * (float)image[i]));
+	}
+	memcpy(stages[ROW_FILTERS_AMPLIFY_PREVIEW],image,size);
+	if (settings.threshold >= 0)
+	{
+		for (int i=0;i<size;i++)
+			image[i] = image[i] > settings.threshold ? 255 : 0;
+	}
+	memcpy(stages[ROW_FILTERS_RESULT_PREVIEW],image,size);
+	free(image);
+	free(blurred);
+}
+
+static bool isStageOn(const RowFiltersSettings& settings,int stage)
+{
+	if (stage == ROW_FILTERS_SMOOTH_PREVIEW)
+		return settings.smoothRadius >= 0;
+	if (stage == ROW_FILTERS_HIGHPASS_PREVIEW)
+		return settings.highpassRadius >= 0;
+	if (stage == ROW_FILTERS_AMPLIFY_PREVIEW)
+		return settings.amplifyLevel >= 0;
+	return true;
+}
+
+//random stages, blurs up to highpass of noise blur size of GUI (200)
+static void setRandomRowFilters(RowFiltersSettings& settings,const unsigned char* background,int width)
+{
+	memset(&settings,0,sizeof(settings));
+	settings.isVerticalMirror = getRandom() % 2 == 0;
+	settings.isHorizontalMirror = getRandom() % 2 == 0;
+	settings.background = getRandom() % 2 == 0 ? background : NULL;
+	settings.backgroundStep = width;
+	settings.isTrackDark = getRandom() % 2 == 0;
+	settings.smoothRadius = getRandom() % 3 != 0 ? getRandom() % 16 : -1;
+	settings.highpassRadius = getRandom() % 3 != 0 ? 1 + getRandom() % (getRandom() % 4 == 0 ? 200 : 12) : -1;
+	settings.noiseRadius = getRandom() % 3 != 0 ? getRandom() % 30 : -1;
+	settings.amplifyLevel = getRandom() % 3 != 0 ? getRandom() % 301 : -1;
+	settings.threshold = getRandom() % 4 != 0 ? getRandom() % 256 : -1;
+}
+
+//smooth gradient with noise, spots of saturated pixels and bright squares as blobs
+static void fillScene(unsigned char* frame,int width,int height)
+{
+	for (int y=0;y<height;y++)
+	{
+		for (int x=0;x<width;x++)
+		{
+			int value = 40 + (int)(30 * sin(x * 0.05) + 20 * cos(y * 0.07)) + getRandom() % 20;
+			frame[y * width + x] = getRandom() % 200 == 0 ? 250 : (unsigned char)value;
+		}
+	}
+	for (int i=0;i<6;i++)
+	{
+		int left = getRandom() % width - 8;
+		int top = getRandom() % height - 8;
+		for (int y=(top > 0 ? top : 0);(y < top + 16) && (y < height);y++)
+		{
+			for (int x=(left > 0 ? left : 0);(x < left + 16) && (x < width);x++)
+				frame[y * width + x] = saturateReference(frame[y * width + x] + 150);
+		}
+	}
+}
+
+//RowFilters with full size previews of all stages, in place when source is copied to target first
+static int countRowFiltersMismatches(RowFilters& rowFilters,const unsigned char* source,int width,int height,RowFiltersSettings settings,
+	bool isInPlace,unsigned char** expected)
+{
+	int size = width * height;
+	unsigned char* previews[ROW_FILTERS_PREVIEWS];
+	for (int i=0;i<ROW_FILTERS_PREVIEWS;i++)
+	{
+		previews[i] = (unsigned char*)malloc(size);
+		memset(previews[i],0,size);
+		RowFiltersPreview& preview = settings.previews[i];
+		preview.pixels = isStageOn(settings,i) ? previews[i] : NULL;
+		preview.step = preview.width = width;
+		preview.height = height;
+	}
+	unsigned char* target = (unsigned char*)malloc(size);
+	if (isInPlace)
+	{
+		memcpy(target,source,size);
+		rowFilters.apply(target,width,target,width,width,height,settings);
+	}
+	else
+	{
+		memset(target,0,size);
+		rowFilters.apply(source,width,target,width,width,height,settings);
+	}
+	int mismatchesCount = 0;
+	for (int i=0;i<size;i++)
+		mismatchesCount += target[i] != expected[ROW_FILTERS_RESULT_PREVIEW][i] ? 1 : 0;
+	for (int i=0;i<ROW_FILTERS_PREVIEWS;i++)
+	{
+		for (int j=0;(settings.previews[i].pixels != NULL) && (j < size);j++)
+			mismatchesCount += previews[i][j] != expected[i][j] ? 1 : 0;
+		free(previews[i]);
+	}
+	free(target);
+	return mismatchesCount;
+}
+
+struct RowFiltersTask
+{
+	RowFilters* rowFilters;
+	const unsigned char* source;
+	unsigned char* target;
+	unsigned char* stages[ROW_FILTERS_PREVIEWS];
+	int width,height;
+	RowFiltersSettings settings;
+	bool isReference;
+	void operator()()
+	{
+		if (isReference)
+			filterReference(source,width,height,settings,stages);
+		else
+			rowFilters->apply(source,width,target,width,width,height,settings);
+	}
+};
+
+static void checkRowFilters()
+{
+	RowFilters rowFilters;
+	ofxThreadPool* pool = ofxThreadPool::getShared();
+	//reference box itself, sizes below kernel included
+	int mismatchesCount = 0;
+	for (int i=0;i<40;i++)
+	{
+		int width = 1 + getRandom() % 40;
+		int height = 1 + getRandom() % 30;
+		int radius = getRandom() % 12;
+		unsigned char* source = (unsigned char*)malloc(width * height);
+		unsigned char* expected = (unsigned char*)malloc(width * height);
+		unsigned char* actual = (unsigned char*)malloc(width * height);
+		fillRandom(source,width * height);
+		blurPixelsReference(source,expected,width,height,radius);
+		blurReference(source,actual,width,height,radius);
+		for (int j=0;j<width*height;j++)
+			mismatchesCount += expected[j] != actual[j] ? 1 : 0;
+		free(source);
+		free(expected);
+		free(actual);
+	}
+	report("box blur reference equals box of pixels",mismatchesCount);
+
+	//random chains on frames from one row to a few stripes high
+	mismatchesCount = 0;
+	for (int i=0;i<300;i++)
+	{
+		int width = 1 + getRandom() % (i % 2 == 0 ? 300 : 70);
+		int height = 1 + getRandom() % (i % 2 == 0 ? 400 : 50);
+		int size = width * height;
+		unsigned char* source = (unsigned char*)malloc(size);
+		unsigned char* background = (unsigned char*)malloc(size);
+		unsigned char* expected[ROW_FILTERS_PREVIEWS];
+		fillScene(source,width,height);
+		fillScene(background,width,height);
+		for (int j=0;j<size;j++)
+			background[j] /= 3;
+		for (int j=0;j<ROW_FILTERS_PREVIEWS;j++)
+			expected[j] = (unsigned char*)malloc(size);
+		RowFiltersSettings settings;
+		setRandomRowFilters(settings,background,width);
+		filterReference(source,width,height,settings,expected);
+		bool isInPlace = (!settings.isVerticalMirror) && (getRandom() % 2 == 0);
+		mismatchesCount += countRowFiltersMismatches(rowFilters,source,width,height,settings,isInPlace,expected);
+		free(source);
+		free(background);
+		for (int j=0;j<ROW_FILTERS_PREVIEWS;j++)
+			free(expected[j]);
+	}
+	report("row filters equal filter chain",mismatchesCount);
+
+	//the same frames split to 2 - 8 stripes, each stripe reads rows of its neighbours
+	int defaultWorkers = pool->getWorkersCount();
+	mismatchesCount = 0;
+	int maxStripes = 1;
+	for (int participants=2;participants<=8;participants++)
+	{
+		pool->setWorkersCount(participants - 1);
+		for (int i=0;i<12;i++)
+		{
+			int width = 64 + getRandom() % 600;
+			int height = 64 + getRandom() % 900;
+			int size = width * height;
+			unsigned char* source = (unsigned char*)malloc(size);
+			unsigned char* background = (unsigned char*)malloc(size);
+			unsigned char* expected[ROW_FILTERS_PREVIEWS];
+			fillScene(source,width,height);
+			fillScene(background,width,height);
+			for (int j=0;j<ROW_FILTERS_PREVIEWS;j++)
+				expected[j] = (unsigned char*)malloc(size);
+			RowFiltersSettings settings;
+			setRandomRowFilters(settings,background,width);
+			filterReference(source,width,height,settings,expected);
+			//in place frames are copied before striping, otherwise halo rows would be read after neighbour wrote them
+			bool isInPlace = (!settings.isVerticalMirror) && (i % 2 == 0);
+			mismatchesCount += countRowFiltersMismatches(rowFilters,source,width,height,settings,isInPlace,expected);
+			int haloRows = (settings.smoothRadius > 0 ? settings.smoothRadius : 0) + (settings.highpassRadius > 0 ? settings.highpassRadius : 0) +
+				((settings.highpassRadius >= 0) && (settings.noiseRadius > 0) ? settings.noiseRadius : 0);
+			int stripeRows = haloRows > ROW_FILTERS_MIN_STRIPE_ROWS ? haloRows : ROW_FILTERS_MIN_STRIPE_ROWS;
+			int stripesCount = height / stripeRows < participants ? height / stripeRows : participants;
+			if (stripesCount > maxStripes)
+				maxStripes = stripesCount;
+			free(source);
+			free(background);
+			for (int j=0;j<ROW_FILTERS_PREVIEWS;j++)
+				free(expected[j]);
+		}
+	}
+	pool->setWorkersCount(defaultWorkers);
+	char name[64];
+	sprintf(name,"row filter stripes (up to %d) equal one pass",maxStripes);
+	report(name,mismatchesCount);
+
+	//frame with a few changed tiles is filtered over target of the previous frame, rows reading only unchanged
+	//tiles are kept. Half of frames go to 4 stripes
+	mismatchesCount = 0;
+	for (int i=0;i<100;i++)
+	{
+		pool->setWorkersCount(i % 2 == 0 ? defaultWorkers : 3);
+		const int tileSize = 16;
+		int width = 16 + getRandom() % 600;
+		int height = 16 + getRandom() % 500;
+		int tilesWidth = (width + tileSize - 1) / tileSize;
+		int tilesHeight = (height + tileSize - 1) / tileSize;
+		int size = width * height;
+		unsigned char* previous = (unsigned char*)malloc(size);
+		unsigned char* source = (unsigned char*)malloc(size);
+		unsigned char* background = (unsigned char*)malloc(size);
+		unsigned char* target = (unsigned char*)malloc(size);
+		unsigned char* changedTiles = (unsigned char*)malloc(tilesWidth * tilesHeight);
+		unsigned char* expected[ROW_FILTERS_PREVIEWS];
+		fillScene(previous,width,height);
+		fillScene(background,width,height);
+		memcpy(source,previous,size);
+		memset(changedTiles,0,tilesWidth * tilesHeight);
+		int changesCount = getRandom() % 5;
+		for (int j=0;j<changesCount;j++)
+		{
+			int tile = getRandom() % (tilesWidth * tilesHeight);
+			changedTiles[tile] = 1;
+			for (int y=(tile / tilesWidth) * tileSize;(y < (tile / tilesWidth + 1) * tileSize) && (y < height);y++)
+			{
+				for (int x=(tile % tilesWidth) * tileSize;(x < (tile % tilesWidth + 1) * tileSize) && (x < width);x++)
+					source[y * width + x] = (unsigned char)getRandom();
+			}
+		}
+		for (int j=0;j<ROW_FILTERS_PREVIEWS;j++)
+			expected[j] = (unsigned char*)malloc(size);
+		RowFiltersSettings settings;
+		setRandomRowFilters(settings,background,width);
+		filterReference(source,width,height,settings,expected);
+		rowFilters.apply(previous,width,target,width,width,height,settings);
+		settings.changedTiles = changedTiles;
+		settings.tilesWidth = tilesWidth;
+		settings.tilesHeight = tilesHeight;
+		settings.tileSize = tileSize;
+		rowFilters.apply(source,width,target,width,width,height,settings);
+		for (int j=0;j<size;j++)
+			mismatchesCount += target[j] != expected[ROW_FILTERS_RESULT_PREVIEW][j] ? 1 : 0;
+		free(previous);
+		free(source);
+		free(background);
+		free(target);
+		free(changedTiles);
+		for (int j=0;j<ROW_FILTERS_PREVIEWS;j++)
+			free(expected[j]);
+	}
+	pool->setWorkersCount(defaultWorkers);
+	report("row filters of changed tiles equal whole frame",mismatchesCount);
+
+	//settings of GUI: subtraction only, usual blurs, big highpass with amplify
+	const int benchmarkSizes[][2] = {{640,480},{2560,960}};
+	const int benchmarkFilters[][6] = {{-1,-1,-1,-1,120,0},{1,6,1,-1,40,0},{2,30,3,200,40,1}};
+	const char* benchmarkNames[] = {"subtract, threshold","smooth 1, highpass 6/1, threshold","smooth 2, highpass 30/3, amplify, threshold"};
+	printf("  row filters on %d participants\n",pool->getParticipantsCount());
+	for (int s=0;s<2;s++)
+	{
+		RowFiltersTask task;
+		task.rowFilters = &rowFilters;
+		task.width = benchmarkSizes[s][0];
+		task.height = benchmarkSizes[s][1];
+		int size = task.width * task.height;
+		unsigned char* source = (unsigned char*)malloc(size);
+		unsigned char* background = (unsigned char*)malloc(size);
+		fillScene(source,task.width,task.height);
+		fillScene(background,task.width,task.height);
+		task.source = source;
+		task.target = (unsigned char*)malloc(size);
+		for (int i=0;i<ROW_FILTERS_PREVIEWS;i++)
+			task.stages[i] = (unsigned char*)malloc(size);
+		//blob moving across two tiles in the middle of frame
+		int tilesWidth = (task.width + 15) / 16;
+		int tilesHeight = (task.height + 15) / 16;
+		unsigned char* changedTiles = (unsigned char*)malloc(tilesWidth * tilesHeight);
+		memset(changedTiles,0,tilesWidth * tilesHeight);
+		changedTiles[(tilesHeight / 2) * tilesWidth + tilesWidth / 2] = changedTiles[(tilesHeight / 2) * tilesWidth + tilesWidth / 2 + 1] = 1;
+		for (int f=0;f<3;f++)
+		{
+			RowFiltersSettings& settings = task.settings;
+			memset(&settings,0,sizeof(settings));
+			settings.isVerticalMirror = benchmarkFilters[f][5] != 0;
+			settings.isHorizontalMirror = true;
+			settings.background = background;
+			settings.backgroundStep = task.width;
+			settings.smoothRadius = benchmarkFilters[f][0];
+			settings.highpassRadius = benchmarkFilters[f][1];
+			settings.noiseRadius = benchmarkFilters[f][2];
+			settings.amplifyLevel = benchmarkFilters[f][3];
+			settings.threshold = benchmarkFilters[f][4];
+			task.isReference = true;
+			double referenceTime = measure(task,s == 0 ? 4 : 1);
+			task.isReference = false;
+			double filtersTime = measure(task,s == 0 ? 20 : 5);
+			printf("  %4dx%-4d %-44s %7.3f ms, reference %7.3f ms\n",task.width,task.height,benchmarkNames[f],filtersTime,referenceTime);
+			settings.changedTiles = changedTiles;
+			settings.tilesWidth = tilesWidth;
+			settings.tilesHeight = tilesHeight;
+			settings.tileSize = 16;
+			double changedTime = measure(task,s == 0 ? 20 : 5);
+			printf("  %4dx%-4d %-44s %7.3f ms\n",task.width,task.height,"  the same, two tiles changed",changedTime);
+		}
+		free(changedTiles);
+		free(source);
+		free(background);
+		free(task.target);
+		for (int i=0;i<ROW_FILTERS_PREVIEWS;i++)
+			free(task.stages[i]);
+	}
+}
+
+/****************************************************************
+ *	Calibration lookup table
+ ****************************************************************/
+struct MapPointsTask
+{
+	CalibrationLUT* lut;
+	const float* source;
+	float* points;
+	unsigned char* inside;
+	int count;
+	bool isScalar;
+	void operator()()
+	{
+		memcpy(points,source,count * 2 * sizeof(float));
+		if (!isScalar)
+		{
+			lut->mapPoints(points,count,2,inside);
+			return;
+		}
+		for (int i=0;i<count;i++)
+			inside[i] = lut->map(points[i*2],points[i*2+1],&points[i*2],&points[i*2+1]) ? 1 : 0;
+	}
+};
+
+static void checkCalibrationLUT()
+{
+	//camera 160x120 seen by 4x3 grid over 400x300 screen, nodes are moved a bit as after calibration
+	const int gridWidth = 4,gridHeight = 3;
+	const int frameWidth = 160,frameHeight = 120;
+	vector2df screenPoints[(gridWidth + 1) * (gridHeight + 1)];
+	vector2df cameraPoints[(gridWidth + 1) * (gridHeight + 1)];
+	for (int j=0;j<=gridHeight;j++)
+	{
+		for (int i=0;i<=gridWidth;i++)
+		{
+			screenPoints[j * (gridWidth + 1) + i] = vector2df(i * 100.0f,j * 100.0f);
+			cameraPoints[j * (gridWidth + 1) + i] = vector2df(i * 40.0f + (float)(getRandom() % 9) - 4.0f,j * 40.0f + (float)(getRandom() % 9) - 4.0f);
+		}
+	}
+	ofxCalibrationMesh mesh;
+	mesh.build(gridWidth,gridHeight,screenPoints,cameraPoints,400,300);
+	//points leave the frame on every side, odd count leaves scalar tail of vector code
+	const int count = 1001;
+	float* source = (float*)malloc(count * 3 * sizeof(float));
+	float* expected = (float*)malloc(count * 3 * sizeof(float));
+	float* actual = (float*)malloc(count * 3 * sizeof(float));
+	unsigned char* expectedInside = (unsigned char*)malloc(count);
+	unsigned char* actualInside = (unsigned char*)malloc(count);
+	for (int i=0;i<count*3;i+=3)
+	{
+		source[i] = (float)(getRandom() % 20000) / 100.0f - 20.0f;
+		source[i+1] = (float)(getRandom() % 16000) / 100.0f - 20.0f;
+		source[i+2] = (float)i;
+	}
+	int mismatchesCount = 0;
+	for (int step=1;step<=4;step++)
+	{
+		CalibrationLUT lut;
+		lut.build(&mesh,frameWidth,frameHeight,step);
+		for (int stride=2;stride<=3;stride++)
+		{
+			memcpy(expected,source,count * 3 * sizeof(float));
+			memcpy(actual,source,count * 3 * sizeof(float));
+			for (int i=0;i<count;i++)
+			{
+				float* point = expected + i * stride;
+				expectedInside[i] = lut.map(point[0],point[1],&point[0],&point[1]) ? 1 : 0;
+			}
+			lut.mapPoints(actual,count,stride,actualInside);
+			//the same operations in both, so results are exact
+			for (int i=0;i<count*stride;i++)
+				mismatchesCount += expected[i] != actual[i] ? 1 : 0;
+			for (int i=0;i<count;i++)
+				mismatchesCount += expectedInside[i] != actualInside[i] ? 1 : 0;
+		}
+	}
+	report("LUT mapPoints equals map",mismatchesCount);
+
+	CalibrationLUT lut;
+	lut.build(&mesh,frameWidth,frameHeight,2);
+	MapPointsTask task;
+	task.lut = &lut;
+	task.source = source;
+	task.points = actual;
+	task.inside = actualInside;
+	task.count = count;
+	task.isScalar = true;
+	double scalarTime = measure(task,200);
+	task.isScalar = false;
+	double vectorTime = measure(task,200);
+	printf("  mapPoints %d points: %7.4f ms, map %7.4f ms\n",count,vectorTime,scalarTime);
+	free(source);
+	free(expected);
+	free(actual);
+	free(expectedInside);
+	free(actualInside);
+}
+
+/****************************************************************
+ *	Background subtraction order
+ ****************************************************************/
+//MULTIPLEXER_CHANGE_TILE_SIZE and MULTIPLEXER_BACKGROUND_NOISE_FLOOR of multiplexer
+#define SUBTRACTION_TILE_SIZE 16
+#define SUBTRACTION_NOISE_FLOOR 4
+//stitched pixels of both orders may differ by noise floor (sparse stitch clears tiles at it) and by two levels of
+//rounding of blends and of interpolated taps
+#define SUBTRACTION_TOLERANCE (SUBTRACTION_NOISE_FLOOR + 2)
+
+static unsigned char subtractReference(int frame,int background)
+{
+	return (unsigned char)(frame > background ? frame - background : 0);
+}
+
+//Multiplexer subtracts background of each camera and remaps only stitched tiles reading camera tiles above noise
+//floor, the rest is cleared. Filters subtracted stitched frame from its background before. Both learn backgrounds by
+//BackgroundModel, scene has smooth background, fixed pattern of each camera, noise and moving blobs
+static void checkSubtractionOrder()
+{
+	StitchScene scene;
+	setupStitchScene(scene,2,2,160,120,1.5f);
+	int camerasCount = scene.gridWidth * scene.gridHeight;
+	int framePixels = scene.frameWidth * scene.frameHeight;
+	int size = scene.width * scene.height;
+	float* pixelsX = (float*)malloc(camerasCount * framePixels * sizeof(float));
+	float* pixelsY = (float*)malloc(camerasCount * framePixels * sizeof(float));
+	mapScenePixels(scene,pixelsX,pixelsY);
+	unsigned char* pattern = (unsigned char*)malloc(camerasCount * framePixels);
+	fillRandom(pattern,camerasCount * framePixels);
+	int frameWidths[4];
+	unsigned char* frames[4];
+	unsigned char* subtractedFrames[4];
+	unsigned char* cameraBackgrounds[4];
+	unsigned char* cameraTiles[4];
+	int cameraTilesWidth = (scene.frameWidth + SUBTRACTION_TILE_SIZE - 1) / SUBTRACTION_TILE_SIZE;
+	int cameraTilesHeight = (scene.frameHeight + SUBTRACTION_TILE_SIZE - 1) / SUBTRACTION_TILE_SIZE;
+	for (int i=0;i<camerasCount;i++)
+	{
+		frameWidths[i] = scene.frameWidth;
+		frames[i] = (unsigned char*)malloc(framePixels);
+		subtractedFrames[i] = (unsigned char*)malloc(framePixels);
+		cameraBackgrounds[i] = (unsigned char*)malloc(framePixels);
+		cameraTiles[i] = (unsigned char*)malloc(cameraTilesWidth * cameraTilesHeight);
+	}
+	int tilesWidth = (scene.width + SUBTRACTION_TILE_SIZE - 1) / SUBTRACTION_TILE_SIZE;
+	int tilesHeight = (scene.height + SUBTRACTION_TILE_SIZE - 1) / SUBTRACTION_TILE_SIZE;
+	short* tileSources = (short*)malloc(tilesWidth * tilesHeight * camerasCount * 4 * sizeof(short));
+	unsigned char* tiles = (unsigned char*)malloc(tilesWidth * tilesHeight);
+	unsigned char* stitched = (unsigned char*)malloc(size);
+	unsigned char* stitchedBackground = (unsigned char*)malloc(size);
+	unsigned char* expected = (unsigned char*)malloc(size);
+	unsigned char* actual = (unsigned char*)malloc(size);
+	ofxRemapRecord* records = (ofxRemapRecord*)malloc(size * sizeof(ofxRemapRecord));
+	for (int mode=0;mode<2;mode++)
+	{
+		bool isBilinear = mode == 1;
+		fillStitchRecords(scene,isBilinear,records);
+		ofxRemapProgram program;
+		program.build(records,size,true,isBilinear,frameWidths,camerasCount);
+		program.getTileSources(scene.width,SUBTRACTION_TILE_SIZE,tilesWidth,tilesHeight,tileSources);
+		BackgroundModel stitchedModel;
+		stitchedModel.allocate(scene.width,scene.height);
+		BackgroundModel cameraModels[4];
+		for (int i=0;i<camerasCount;i++)
+			cameraModels[i].allocate(scene.frameWidth,scene.frameHeight);
+		int mismatchesCount = 0,maxDifference = 0,clearedTilesCount = 0;
+		for (int frame=0;frame<40;frame++)
+		{
+			for (int i=0;i<camerasCount*framePixels;i++)
+			{
+				float x = pixelsX[i],y = pixelsY[i];
+				float pixel = 70.0f + 30.0f * sin(x * 0.05f) * cos(y * 0.07f) + (pattern[i] % 13) - 6.0f + (getRandom() % 5) - 2.0f;
+				//blobs appear after background is learned from the first frame
+				for (int blob=0;(blob<3) && (frame>0);blob++)
+					pixel += 0.6f * getBlobPixel(x,y,60.0f + blob * 120.0f + frame * 3.0f,80.0f + blob * 60.0f);
+				frames[i / framePixels][i % framePixels] = (unsigned char)(pixel > 255.0f ? 255.0f : pixel);
+			}
+			//stitch, then subtract
+			program.execute(frames,stitched,NULL);
+			if (frame == 0)
+				stitchedModel.learn(stitched,scene.width,stitchedBackground,scene.width);
+			else
+				stitchedModel.update(stitched,scene.width,stitchedBackground,scene.width,0.05f);
+			for (int i=0;i<size;i++)
+				expected[i] = subtractReference(stitched[i],stitchedBackground[i]);
+			//subtract, then stitch tiles reading camera tiles above noise floor
+			for (int c=0;c<camerasCount;c++)
+			{
+				if (frame == 0)
+					cameraModels[c].learn(frames[c],scene.frameWidth,cameraBackgrounds[c],scene.frameWidth);
+				else
+					cameraModels[c].update(frames[c],scene.frameWidth,cameraBackgrounds[c],scene.frameWidth,0.05f);
+				memset(cameraTiles[c],0,cameraTilesWidth * cameraTilesHeight);
+				for (int i=0;i<framePixels;i++)
+				{
+					subtractedFrames[c][i] = subtractReference(frames[c][i],cameraBackgrounds[c][i]);
+					if (subtractedFrames[c][i] > SUBTRACTION_NOISE_FLOOR)
+						cameraTiles[c][(i / scene.frameWidth / SUBTRACTION_TILE_SIZE) * cameraTilesWidth + (i % scene.frameWidth) / SUBTRACTION_TILE_SIZE] = 1;
+				}
+			}
+			for (int i=0;i<tilesWidth*tilesHeight;i++)
+			{
+				tiles[i] = 0;
+				for (int c=0;c<camerasCount;c++)
+				{
+					const short* bounds = tileSources + (i * camerasCount + c) * 4;
+					for (int y=bounds[1];y<=bounds[3];y++)
+					{
+						for (int x=bounds[0];x<=bounds[2];x++)
+							tiles[i] |= cameraTiles[c][y * cameraTilesWidth + x];
+					}
+				}
+				clearedTilesCount += tiles[i] == 0 ? 1 : 0;
+			}
+			memset(actual,0,size);
+			ofxRemapSkip skip = { NULL, tiles, tilesWidth, SUBTRACTION_TILE_SIZE, scene.width };
+			program.execute(subtractedFrames,actual,&skip);
+			for (int i=0;i<size;i++)
+			{
+				int difference = abs((int)expected[i] - (int)actual[i]);
+				maxDifference = difference > maxDifference ? difference : maxDifference;
+				mismatchesCount += difference > SUBTRACTION_TOLERANCE ? 1 : 0;
+			}
+		}
+		printf("  %s: largest difference %d, %d%% of tiles cleared\n",isBilinear ? "bilinear" : "nearest",maxDifference,
+			clearedTilesCount * 100 / (40 * tilesWidth * tilesHeight));
+		char name[64];
+		sprintf(name,"subtracted %s stitch within %d of stitch subtracted",isBilinear ? "bilinear" : "nearest",SUBTRACTION_TOLERANCE);
+		report(name,mismatchesCount);
+	}
+	free(records);
+	free(expected);
+	free(actual);
+	free(stitched);
+	free(stitchedBackground);
+	free(tiles);
+	free(tileSources);
+	for (int i=0;i<camerasCount;i++)
+	{
+		free(frames[i]);
+		free(subtractedFrames[i]);
+		free(cameraBackgrounds[i]);
+		free(cameraTiles[i]);
+	}
+	free(pattern);
+	free(pixelsX);
+	free(pixelsY);
+	delete[] scene.meshes;
+}
+
+int main()
+{
+	checkBayerKernels();
+	checkRemapProgram();
+	checkStitchedRemap();
+	benchmarkBaselineStitching();
+	checkRowFilters();
+	checkCalibrationLUT();
+	checkSubtractionOrder();
+	return failuresCount;
+}